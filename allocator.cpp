@@ -0,0 +1,565 @@
+#include "allocator.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <ranges>
+
+#include "picante.hpp"
+
+std::optional<std::uint32_t>
+find_memory_type(const vk::PhysicalDeviceMemoryProperties& memory_properties,
+                 const std::uint32_t memory_type_bits,
+                 const vk::MemoryPropertyFlags properties) {
+  for (const auto index :
+       std::views::iota(0u, memory_properties.memoryTypeCount)) {
+    const auto& memory_type = memory_properties.memoryTypes[index];
+    if ((memory_type_bits & (1u << index)) &&
+        (memory_type.propertyFlags & properties) == properties) {
+      return index;
+    }
+  }
+  return std::nullopt;
+}
+
+std::optional<std::uint32_t>
+find_memory_type(const vk::PhysicalDevice& physical_device,
+                 const std::uint32_t memory_type_bits,
+                 const vk::MemoryPropertyFlags properties) {
+  return find_memory_type(physical_device.getMemoryProperties(),
+                          memory_type_bits, properties);
+}
+
+std::unique_ptr<DeviceAllocator>
+create_device_allocator(const vk::PhysicalDevice& physical_device,
+                        const vk::Device& logical_device,
+                        const vk::DeviceSize block_size) {
+  const auto limits              = physical_device.getProperties().limits;
+  auto allocator                 = std::make_unique<DeviceAllocator>();
+  allocator->logical_device      = logical_device;
+  allocator->memory_properties   = physical_device.getMemoryProperties();
+  allocator->buffer_image_granularity    = limits.bufferImageGranularity;
+  allocator->non_coherent_atom_size      = limits.nonCoherentAtomSize;
+  allocator->max_memory_allocation_count = limits.maxMemoryAllocationCount;
+  // The buddy allocator needs a power of two, round down so we never ask for
+  // more than the caller was willing to spend.
+  allocator->block_size =
+      std::bit_floor(std::max(block_size, min_allocation_size));
+  return allocator;
+}
+
+std::uint32_t order_count(const vk::DeviceSize block_size) {
+  return static_cast<std::uint32_t>(
+      std::countr_zero(block_size / min_allocation_size) + 1);
+}
+
+// Order of the smallest node that fits size bytes at the given alignment.
+std::uint32_t order_for(const vk::DeviceSize size,
+                        const vk::DeviceSize alignment) {
+  const auto node_size =
+      std::bit_ceil(std::max({size, alignment, min_allocation_size}));
+  return static_cast<std::uint32_t>(
+      std::countr_zero(node_size / min_allocation_size));
+}
+
+vk::DeviceSize node_size(const std::uint32_t order) {
+  return min_allocation_size << order;
+}
+
+std::unique_ptr<MemoryBlock>
+allocate_block(DeviceAllocator& allocator, const vk::DeviceSize size,
+               const std::uint32_t memory_type_index, const ResourceKind kind,
+               const bool dedicated) {
+  vk::MemoryAllocateInfo allocateInfo;
+  allocateInfo.allocationSize  = size;
+  allocateInfo.memoryTypeIndex = memory_type_index;
+  auto block    = std::make_unique<MemoryBlock>();
+  block->memory = allocator.logical_device.allocateMemoryUnique(allocateInfo);
+  block->size   = size;
+  block->memory_type_index = memory_type_index;
+  block->kind              = kind;
+  block->dedicated         = dedicated;
+  if (allocator.memory_properties.memoryTypes[memory_type_index].propertyFlags &
+      vk::MemoryPropertyFlagBits::eHostVisible) {
+    block->mapped = static_cast<std::byte*>(
+        allocator.logical_device.mapMemory(block->memory.get(), 0, size));
+  }
+  if (!dedicated) {
+    block->free_nodes.resize(order_count(size));
+    block->free_nodes.back().insert(0);
+  }
+  return block;
+}
+
+std::optional<vk::DeviceSize> take_node(MemoryBlock& block,
+                                        const std::uint32_t order) {
+  auto current_order = order;
+  while (current_order < block.free_nodes.size() &&
+         block.free_nodes[current_order].empty()) {
+    ++current_order;
+  }
+  if (current_order == block.free_nodes.size()) {
+    return std::nullopt;
+  }
+  auto& free_list   = block.free_nodes[current_order];
+  const auto offset = *free_list.begin();
+  free_list.erase(free_list.begin());
+  // Split until the node is the size we want, leaving the upper halves free.
+  while (current_order > order) {
+    --current_order;
+    block.free_nodes[current_order].insert(offset + node_size(current_order));
+  }
+  return offset;
+}
+
+void return_node(MemoryBlock& block, vk::DeviceSize offset,
+                 std::uint32_t order) {
+  // Merge with the buddy for as long as it is free as well.
+  while (order + 1 < block.free_nodes.size()) {
+    const auto buddy = offset ^ node_size(order);
+    if (block.free_nodes[order].erase(buddy) == 0) {
+      break;
+    }
+    offset = std::min(offset, buddy);
+    ++order;
+  }
+  block.free_nodes[order].insert(offset);
+}
+
+Allocation make_allocation(MemoryBlock& block, const vk::DeviceSize offset,
+                           const vk::DeviceSize size,
+                           const std::uint32_t order) {
+  auto allocation   = Allocation{};
+  allocation.memory = block.memory.get();
+  allocation.offset = offset;
+  allocation.size   = size;
+  allocation.mapped = block.mapped ? block.mapped + offset : nullptr;
+  allocation.block  = &block;
+  allocation.order  = order;
+  return allocation;
+}
+
+std::optional<Allocation>
+allocate_memory(DeviceAllocator& allocator,
+                const vk::MemoryRequirements& requirements,
+                const vk::MemoryPropertyFlags properties,
+                const ResourceKind kind) {
+  const auto memory_type_index =
+      find_memory_type(allocator.memory_properties,
+                       requirements.memoryTypeBits, properties);
+  if (!memory_type_index) {
+    return std::nullopt;
+  }
+  const auto lock  = std::scoped_lock{allocator.mutex};
+  const auto order = order_for(requirements.size, requirements.alignment);
+  // Anything bigger than half a block would waste most of it, give it its
+  // own allocation instead.
+  if (node_size(order) > allocator.block_size / 2) {
+    allocator.blocks.push_back(allocate_block(
+        allocator, requirements.size, *memory_type_index, kind, true));
+    auto& block            = *allocator.blocks.back();
+    block.bytes_allocated  = requirements.size;
+    block.allocation_count = 1;
+    allocator.bytes_requested += requirements.size;
+    return make_allocation(block, 0, requirements.size, 0);
+  }
+  for (auto& block : allocator.blocks) {
+    if (block->dedicated || block->memory_type_index != *memory_type_index ||
+        block->kind != kind) {
+      continue;
+    }
+    if (const auto offset = take_node(*block, order)) {
+      block->bytes_allocated += node_size(order);
+      ++block->allocation_count;
+      allocator.bytes_requested += requirements.size;
+      return make_allocation(*block, *offset, requirements.size, order);
+    }
+  }
+  allocator.blocks.push_back(allocate_block(
+      allocator, allocator.block_size, *memory_type_index, kind, false));
+  auto& block       = *allocator.blocks.back();
+  const auto offset = take_node(block, order).value();
+  block.bytes_allocated += node_size(order);
+  ++block.allocation_count;
+  allocator.bytes_requested += requirements.size;
+  return make_allocation(block, offset, requirements.size, order);
+}
+
+void free_memory(DeviceAllocator& allocator, const Allocation& allocation) {
+  if (!allocation.block || allocation.from_linear_pool) {
+    return;
+  }
+  const auto lock = std::scoped_lock{allocator.mutex};
+  auto& block     = *allocation.block;
+  allocator.bytes_requested -= allocation.size;
+  --block.allocation_count;
+  if (block.dedicated) {
+    block.bytes_allocated = 0;
+  } else {
+    block.bytes_allocated -= node_size(allocation.order);
+    return_node(block, allocation.offset, allocation.order);
+  }
+  if (block.allocation_count != 0) {
+    return;
+  }
+  // Give empty blocks back to the driver, but keep one regular block of each
+  // type and kind around so allocating and freeing in a loop doesn't thrash.
+  const auto is_spare = [&block](const auto& other) {
+    return other.get() != &block && !other->dedicated &&
+           other->memory_type_index == block.memory_type_index &&
+           other->kind == block.kind;
+  };
+  if (block.dedicated || std::ranges::any_of(allocator.blocks, is_spare)) {
+    std::erase_if(allocator.blocks, [&block](const auto& candidate) {
+      return candidate.get() == &block;
+    });
+  }
+}
+
+// The atom aligned range flush_memory and invalidate_memory work on, none
+// for coherent memory.
+std::optional<vk::MappedMemoryRange>
+non_coherent_range(const DeviceAllocator& allocator,
+                   const Allocation& allocation, const vk::DeviceSize offset,
+                   const vk::DeviceSize size) {
+  const auto flags =
+      allocator.memory_properties
+          .memoryTypes[allocation.block->memory_type_index]
+          .propertyFlags;
+  if (flags & vk::MemoryPropertyFlagBits::eHostCoherent) {
+    return std::nullopt;
+  }
+  // Regular allocations are already atom aligned, see min_allocation_size.
+  const auto atom  = allocator.non_coherent_atom_size;
+  const auto begin = (allocation.offset + offset) / atom * atom;
+  const auto end   = size == VK_WHOLE_SIZE
+                         ? allocation.offset + allocation.size
+                         : allocation.offset + offset + size;
+  const auto aligned_end =
+      std::min((end + atom - 1) / atom * atom, allocation.block->size);
+  vk::MappedMemoryRange range;
+  range.memory = allocation.memory;
+  range.offset = begin;
+  range.size   = aligned_end - begin;
+  return range;
+}
+
+void flush_memory(const DeviceAllocator& allocator,
+                  const Allocation& allocation, const vk::DeviceSize offset,
+                  const vk::DeviceSize size) {
+  if (const auto range =
+          non_coherent_range(allocator, allocation, offset, size)) {
+    allocator.logical_device.flushMappedMemoryRanges(*range);
+  }
+}
+
+void invalidate_memory(const DeviceAllocator& allocator,
+                       const Allocation& allocation,
+                       const vk::DeviceSize offset, const vk::DeviceSize size) {
+  if (const auto range =
+          non_coherent_range(allocator, allocation, offset, size)) {
+    allocator.logical_device.invalidateMappedMemoryRanges(*range);
+  }
+}
+
+AllocatorStats get_allocator_stats(const DeviceAllocator& allocator) {
+  const auto lock = std::scoped_lock{allocator.mutex};
+  auto stats      = AllocatorStats{};
+  stats.max_memory_allocation_count = allocator.max_memory_allocation_count;
+  stats.bytes_requested             = allocator.bytes_requested;
+  auto bytes_free                   = vk::DeviceSize{0};
+  for (const auto& block : allocator.blocks) {
+    ++stats.device_allocation_count;
+    stats.bytes_reserved += block->size;
+    stats.bytes_allocated += block->bytes_allocated;
+    stats.allocation_count += block->allocation_count;
+    if (block->dedicated) {
+      ++stats.dedicated_count;
+      continue;
+    }
+    ++stats.block_count;
+    bytes_free += block->size - block->bytes_allocated;
+    for (const auto order :
+         std::views::iota(0u, static_cast<std::uint32_t>(
+                                  block->free_nodes.size())) |
+             std::views::reverse) {
+      if (!block->free_nodes[order].empty()) {
+        stats.largest_free_range =
+            std::max(stats.largest_free_range, node_size(order));
+        break;
+      }
+    }
+  }
+  if (bytes_free != 0) {
+    stats.fragmentation =
+        1.0 - static_cast<double>(stats.largest_free_range) /
+                  static_cast<double>(bytes_free);
+  }
+  return stats;
+}
+
+MemoryBudget get_memory_budget(const vk::PhysicalDevice& physical_device,
+                               const DeviceAllocator& allocator,
+                               const bool memory_budget_enabled) {
+  const auto& heaps          = allocator.memory_properties.memoryHeaps;
+  const auto heap_count      = allocator.memory_properties.memoryHeapCount;
+  const auto is_device_local = [&heaps](const std::uint32_t heap) {
+    return static_cast<bool>(heaps[heap].flags &
+                             vk::MemoryHeapFlagBits::eDeviceLocal);
+  };
+  auto budget = MemoryBudget{};
+  if (memory_budget_enabled) {
+    const auto properties = physical_device.getMemoryProperties2<
+        vk::PhysicalDeviceMemoryProperties2,
+        vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+    const auto& heap_budgets =
+        properties.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+    for (const auto heap : std::views::iota(0u, heap_count)) {
+      if (is_device_local(heap)) {
+        budget.budget += heap_budgets.heapBudget[heap];
+        budget.usage += heap_budgets.heapUsage[heap];
+      }
+    }
+    return budget;
+  }
+  for (const auto heap : std::views::iota(0u, heap_count)) {
+    if (is_device_local(heap)) {
+      budget.budget += heaps[heap].size / 5 * 4;
+    }
+  }
+  const auto lock = std::scoped_lock{allocator.mutex};
+  for (const auto& block : allocator.blocks) {
+    const auto heap =
+        allocator.memory_properties.memoryTypes[block->memory_type_index]
+            .heapIndex;
+    if (is_device_local(heap)) {
+      budget.usage += block->size;
+    }
+  }
+  return budget;
+}
+
+std::optional<AllocatedBuffer>
+create_buffer(DeviceAllocator& allocator, const vk::DeviceSize size,
+              const vk::BufferUsageFlags usage,
+              const vk::MemoryPropertyFlags properties) {
+  vk::BufferCreateInfo bufferInfo;
+  bufferInfo.size        = size;
+  bufferInfo.usage       = usage;
+  bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+  auto buffer = allocator.logical_device.createBufferUnique(bufferInfo);
+  const auto requirements =
+      allocator.logical_device.getBufferMemoryRequirements(buffer.get());
+  return allocate_memory(allocator, requirements, properties,
+                         ResourceKind::eLinear)
+      .transform([&allocator, &buffer](const auto& allocation) {
+        allocator.logical_device.bindBufferMemory(
+            buffer.get(), allocation.memory, allocation.offset);
+        return AllocatedBuffer{std::move(buffer), allocation};
+      });
+}
+
+std::optional<AllocatedBuffer>
+create_buffer_with_data(DeviceAllocator& allocator, const vk::Queue& queue,
+                        const std::uint32_t queue_family_index,
+                        const std::span<const std::byte> data,
+                        const vk::BufferUsageFlags usage) {
+  const auto size = static_cast<vk::DeviceSize>(data.size());
+  auto staging    = create_buffer(allocator, size,
+                                  vk::BufferUsageFlagBits::eTransferSrc,
+                                  vk::MemoryPropertyFlagBits::eHostVisible);
+  if (!staging) {
+    return std::nullopt;
+  }
+  std::memcpy(staging->allocation.mapped, data.data(), data.size());
+  flush_memory(allocator, staging->allocation);
+  auto buffer = create_buffer(allocator, size,
+                              usage | vk::BufferUsageFlagBits::eTransferDst,
+                              vk::MemoryPropertyFlagBits::eDeviceLocal);
+  if (buffer) {
+    submit_immediate(allocator.logical_device, queue, queue_family_index,
+                     [&staging, &buffer, size](const auto& command_buffer) {
+                       command_buffer.copyBuffer(staging->buffer.get(),
+                                                 buffer->buffer.get(),
+                                                 vk::BufferCopy{0, 0, size});
+                     });
+  }
+  destroy_buffer(allocator, *staging);
+  return buffer;
+}
+
+std::optional<AllocatedImage>
+create_image(DeviceAllocator& allocator, const vk::ImageCreateInfo& image_info,
+             const vk::MemoryPropertyFlags properties) {
+  auto image = allocator.logical_device.createImageUnique(image_info);
+  const auto requirements =
+      allocator.logical_device.getImageMemoryRequirements(image.get());
+  const auto kind = image_info.tiling == vk::ImageTiling::eOptimal
+                        ? ResourceKind::eOptimal
+                        : ResourceKind::eLinear;
+  return allocate_memory(allocator, requirements, properties, kind)
+      .transform([&allocator, &image](const auto& allocation) {
+        allocator.logical_device.bindImageMemory(
+            image.get(), allocation.memory, allocation.offset);
+        return AllocatedImage{std::move(image), allocation};
+      });
+}
+
+std::optional<AllocatedImage>
+create_image_with_data(DeviceAllocator& allocator, const vk::Queue& queue,
+                       const std::uint32_t queue_family_index,
+                       vk::ImageCreateInfo image_info,
+                       const std::span<const std::byte> data) {
+  const auto size = static_cast<vk::DeviceSize>(data.size());
+  auto staging    = create_buffer(allocator, size,
+                                  vk::BufferUsageFlagBits::eTransferSrc,
+                                  vk::MemoryPropertyFlagBits::eHostVisible);
+  if (!staging) {
+    return std::nullopt;
+  }
+  std::memcpy(staging->allocation.mapped, data.data(), data.size());
+  flush_memory(allocator, staging->allocation);
+  image_info.usage |= vk::ImageUsageFlagBits::eTransferDst;
+  image_info.initialLayout = vk::ImageLayout::eUndefined;
+  auto image = create_image(allocator, image_info,
+                            vk::MemoryPropertyFlagBits::eDeviceLocal);
+  const auto record = [&staging, &image,
+                       &image_info](const vk::CommandBuffer& command_buffer) {
+    vk::ImageMemoryBarrier imageBarrier;
+    imageBarrier.dstAccessMask       = vk::AccessFlagBits::eTransferWrite;
+    imageBarrier.oldLayout           = vk::ImageLayout::eUndefined;
+    imageBarrier.newLayout           = vk::ImageLayout::eTransferDstOptimal;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image               = image->image.get();
+    imageBarrier.subresourceRange    = vk::ImageSubresourceRange{
+        vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0,
+        VK_REMAINING_ARRAY_LAYERS};
+    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+                                   vk::PipelineStageFlagBits::eTransfer, {},
+                                   {}, {}, imageBarrier);
+    vk::BufferImageCopy region;
+    region.imageSubresource = vk::ImageSubresourceLayers{
+        vk::ImageAspectFlagBits::eColor, 0, 0, image_info.arrayLayers};
+    region.imageExtent = image_info.extent;
+    command_buffer.copyBufferToImage(staging->buffer.get(), image->image.get(),
+                                     vk::ImageLayout::eTransferDstOptimal,
+                                     region);
+    imageBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    imageBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+    imageBarrier.oldLayout     = vk::ImageLayout::eTransferDstOptimal;
+    imageBarrier.newLayout     = vk::ImageLayout::eShaderReadOnlyOptimal;
+    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                   vk::PipelineStageFlagBits::eFragmentShader,
+                                   {}, {}, {}, imageBarrier);
+  };
+  if (image) {
+    submit_immediate(allocator.logical_device, queue, queue_family_index,
+                     record);
+  }
+  destroy_buffer(allocator, *staging);
+  return image;
+}
+
+void destroy_buffer(DeviceAllocator& allocator, AllocatedBuffer& buffer) {
+  buffer.buffer.reset();
+  free_memory(allocator, buffer.allocation);
+  buffer.allocation = {};
+}
+
+void destroy_image(DeviceAllocator& allocator, AllocatedImage& image) {
+  image.image.reset();
+  free_memory(allocator, image.allocation);
+  image.allocation = {};
+}
+
+LinearPool create_linear_pool(DeviceAllocator& allocator,
+                              const vk::MemoryPropertyFlags properties,
+                              const vk::DeviceSize chunk_size) {
+  auto pool       = LinearPool{};
+  pool.allocator  = &allocator;
+  pool.properties = properties;
+  // Chunks come out of the buddy allocator aligned to their own size, so as
+  // long as they are at least a granularity page big, resources in different
+  // chunks never share a page.
+  pool.chunk_size = std::bit_ceil(
+      std::max({chunk_size, allocator.buffer_image_granularity,
+                min_allocation_size}));
+  return pool;
+}
+
+vk::DeviceSize align_up(const vk::DeviceSize value,
+                        const vk::DeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+std::optional<Allocation>
+allocate_linear(LinearPool& pool, const vk::MemoryRequirements& requirements,
+                const ResourceKind kind) {
+  const auto fits_current_chunk = [&]() -> std::optional<vk::DeviceSize> {
+    if (pool.chunks.empty()) {
+      return std::nullopt;
+    }
+    const auto& chunk = pool.chunks.back();
+    if (!(requirements.memoryTypeBits &
+          (1u << chunk.block->memory_type_index))) {
+      return std::nullopt;
+    }
+    auto offset = align_up(pool.head, requirements.alignment);
+    if (pool.last_kind && *pool.last_kind != kind) {
+      offset = align_up(offset, pool.allocator->buffer_image_granularity);
+    }
+    if (offset + requirements.size > chunk.size) {
+      return std::nullopt;
+    }
+    return offset;
+  };
+  auto offset = fits_current_chunk();
+  if (!offset) {
+    auto chunk_requirements = requirements;
+    chunk_requirements.size =
+        std::max(pool.chunk_size, std::bit_ceil(requirements.size));
+    chunk_requirements.alignment = std::max(
+        requirements.alignment, pool.allocator->buffer_image_granularity);
+    const auto chunk = allocate_memory(*pool.allocator, chunk_requirements,
+                                       pool.properties, kind);
+    if (!chunk) {
+      return std::nullopt;
+    }
+    pool.chunks.push_back(*chunk);
+    pool.head      = 0;
+    pool.last_kind = std::nullopt;
+    offset         = 0;
+  }
+  const auto& chunk = pool.chunks.back();
+  auto allocation   = chunk;
+  allocation.offset = chunk.offset + *offset;
+  allocation.size   = requirements.size;
+  allocation.mapped = chunk.mapped ? chunk.mapped + *offset : nullptr;
+  // Linear allocations are never freed one by one, make sure nobody tries.
+  allocation.from_linear_pool = true;
+  pool.head                   = *offset + requirements.size;
+  pool.last_kind   = kind;
+  pool.bytes_used += requirements.size;
+  return allocation;
+}
+
+void reset_linear_pool(LinearPool& pool) {
+  while (pool.chunks.size() > 1) {
+    free_memory(*pool.allocator, pool.chunks.back());
+    pool.chunks.pop_back();
+  }
+  pool.head       = 0;
+  pool.last_kind  = std::nullopt;
+  pool.bytes_used = 0;
+}
+
+void destroy_linear_pool(LinearPool& pool) {
+  for (const auto& chunk : pool.chunks) {
+    free_memory(*pool.allocator, chunk);
+  }
+  pool.chunks.clear();
+  pool.head       = 0;
+  pool.last_kind  = std::nullopt;
+  pool.bytes_used = 0;
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+std::optional<std::uint32_t>
+find_memory_type(const vk::PhysicalDevice& physical_device,
+                 const std::uint32_t memory_type_bits,
+                 const vk::MemoryPropertyFlags properties);
+
+// Buffers and linear images can't share a bufferImageGranularity page with
+// optimal tiling images, so the two kinds never share a block.
+enum class ResourceKind { eLinear, eOptimal };
+
+// Smallest node handed out by the buddy allocator. Also the largest
+// nonCoherentAtomSize the spec allows, so any allocation can be flushed on
+// its own.
+constexpr vk::DeviceSize min_allocation_size = 256;
+constexpr vk::DeviceSize default_block_size  = 64ull * 1024 * 1024;
+
+// One vkAllocateMemory, either carved up by a buddy allocator or handed out
+// whole to a single large resource.
+struct MemoryBlock {
+  vk::UniqueDeviceMemory memory;
+  vk::DeviceSize size             = 0;
+  std::uint32_t memory_type_index = 0;
+  ResourceKind kind               = ResourceKind::eLinear;
+  bool dedicated                  = false;
+  // Host visible blocks stay mapped for their whole lifetime.
+  std::byte* mapped = nullptr;
+  // free_nodes[order] holds the offsets of free nodes of size
+  // min_allocation_size << order.
+  std::vector<std::set<vk::DeviceSize>> free_nodes;
+  vk::DeviceSize bytes_allocated = 0;
+  std::size_t allocation_count   = 0;
+};
+
+struct Allocation {
+  vk::DeviceMemory memory;
+  vk::DeviceSize offset = 0;
+  vk::DeviceSize size   = 0;
+  // Null unless the memory is host visible.
+  std::byte* mapped   = nullptr;
+  MemoryBlock* block  = nullptr;
+  std::uint32_t order = 0;
+  // Released as a whole with the pool it came from, never by free_memory.
+  bool from_linear_pool = false;
+};
+
+struct DeviceAllocator {
+  vk::Device logical_device;
+  vk::PhysicalDeviceMemoryProperties memory_properties;
+  vk::DeviceSize buffer_image_granularity    = 1;
+  vk::DeviceSize non_coherent_atom_size      = 1;
+  std::uint32_t max_memory_allocation_count = 0;
+  vk::DeviceSize block_size                 = default_block_size;
+  std::vector<std::unique_ptr<MemoryBlock>> blocks;
+  vk::DeviceSize bytes_requested = 0;
+  // Allocation happens from the streaming and recording threads too.
+  mutable std::mutex mutex;
+};
+
+struct AllocatorStats {
+  std::size_t block_count      = 0;
+  std::size_t dedicated_count  = 0;
+  std::size_t allocation_count = 0;
+  // vkAllocateMemory calls currently alive versus what the device allows.
+  std::uint32_t device_allocation_count     = 0;
+  std::uint32_t max_memory_allocation_count = 0;
+  // Device memory held by the allocator.
+  vk::DeviceSize bytes_reserved = 0;
+  // Memory handed out, including the rounding up to a power of two.
+  vk::DeviceSize bytes_allocated = 0;
+  // What callers actually asked for.
+  vk::DeviceSize bytes_requested    = 0;
+  vk::DeviceSize largest_free_range = 0;
+  // 0 when all free memory is one contiguous range, towards 1 as it gets
+  // scattered into small pieces.
+  double fragmentation = 0.0;
+};
+
+std::unique_ptr<DeviceAllocator>
+create_device_allocator(const vk::PhysicalDevice& physical_device,
+                        const vk::Device& logical_device,
+                        const vk::DeviceSize block_size = default_block_size);
+
+std::optional<Allocation>
+allocate_memory(DeviceAllocator& allocator,
+                const vk::MemoryRequirements& requirements,
+                const vk::MemoryPropertyFlags properties,
+                const ResourceKind kind);
+
+void free_memory(DeviceAllocator& allocator, const Allocation& allocation);
+
+// No-op on coherent memory.
+void flush_memory(const DeviceAllocator& allocator,
+                  const Allocation& allocation,
+                  const vk::DeviceSize offset = 0,
+                  const vk::DeviceSize size   = VK_WHOLE_SIZE);
+
+// Makes GPU writes visible to the host before reading them back, also a
+// no-op on coherent memory.
+void invalidate_memory(const DeviceAllocator& allocator,
+                       const Allocation& allocation,
+                       const vk::DeviceSize offset = 0,
+                       const vk::DeviceSize size   = VK_WHOLE_SIZE);
+
+AllocatorStats get_allocator_stats(const DeviceAllocator& allocator);
+
+// Device local memory summed over every device local heap. budget is how much
+// the process can use before the driver starts evicting or failing, usage how
+// much it does use, both as VK_EXT_memory_budget reports them. Without the
+// extension the budget falls back to 80% of the heaps and usage to what the
+// allocator holds.
+struct MemoryBudget {
+  vk::DeviceSize budget = 0;
+  vk::DeviceSize usage  = 0;
+};
+
+MemoryBudget get_memory_budget(const vk::PhysicalDevice& physical_device,
+                               const DeviceAllocator& allocator,
+                               const bool memory_budget_enabled);
+
+struct AllocatedBuffer {
+  vk::UniqueBuffer buffer;
+  Allocation allocation;
+};
+
+struct AllocatedImage {
+  vk::UniqueImage image;
+  Allocation allocation;
+};
+
+std::optional<AllocatedBuffer>
+create_buffer(DeviceAllocator& allocator, const vk::DeviceSize size,
+              const vk::BufferUsageFlags usage,
+              const vk::MemoryPropertyFlags properties);
+
+// Device local buffer filled through a throwaway staging buffer. Blocks until
+// the copy is done, meant for load time.
+std::optional<AllocatedBuffer>
+create_buffer_with_data(DeviceAllocator& allocator, const vk::Queue& queue,
+                        const std::uint32_t queue_family_index,
+                        const std::span<const std::byte> data,
+                        const vk::BufferUsageFlags usage);
+
+std::optional<AllocatedImage>
+create_image(DeviceAllocator& allocator, const vk::ImageCreateInfo& image_info,
+             const vk::MemoryPropertyFlags properties);
+
+// Device local image with the first mip level of every layer filled from
+// tightly packed texels, then left in SHADER_READ_ONLY_OPTIMAL. Blocks like
+// create_buffer_with_data.
+std::optional<AllocatedImage>
+create_image_with_data(DeviceAllocator& allocator, const vk::Queue& queue,
+                       const std::uint32_t queue_family_index,
+                       vk::ImageCreateInfo image_info,
+                       const std::span<const std::byte> data);
+
+void destroy_buffer(DeviceAllocator& allocator, AllocatedBuffer& buffer);
+void destroy_image(DeviceAllocator& allocator, AllocatedImage& image);
+
+// Bump allocator for data that lives and dies together, e.g. everything
+// belonging to one level. Memory comes from the device allocator in chunks
+// and is only given back all at once by reset_linear_pool.
+struct LinearPool {
+  DeviceAllocator* allocator = nullptr;
+  vk::MemoryPropertyFlags properties;
+  vk::DeviceSize chunk_size = 0;
+  std::vector<Allocation> chunks;
+  vk::DeviceSize head = 0;
+  std::optional<ResourceKind> last_kind;
+  vk::DeviceSize bytes_used = 0;
+};
+
+LinearPool create_linear_pool(DeviceAllocator& allocator,
+                              const vk::MemoryPropertyFlags properties,
+                              const vk::DeviceSize chunk_size =
+                                  8ull * 1024 * 1024);
+
+std::optional<Allocation>
+allocate_linear(LinearPool& pool, const vk::MemoryRequirements& requirements,
+                const ResourceKind kind);
+
+// Keeps the first chunk around so refilling the pool doesn't go back to the
+// device allocator.
+void reset_linear_pool(LinearPool& pool);
+void destroy_linear_pool(LinearPool& pool);
@@ -0,0 +1,290 @@
+#include "bench.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <ostream>
+#include <sstream>
+
+#include "bindless.hpp"
+#include "gpu_driven.hpp"
+#include "readback.hpp"
+#include "shaders.hpp"
+#include "textures.hpp"
+
+void print_usage(std::ostream& stream) {
+  stream << "usage: picante_bench [--scene NAME] [--frames N] [--warmup N] "
+            "[--instances N] [--objects N] [--frames-in-flight N] "
+            "[--threads N] [--output FILE]\n"
+            "scenes: triangles, pipelines, allocator, gpu_driven, "
+            "recording, uploads, streaming, bindless, particles, "
+            "render_graph, cpu_culling, jobs, textures, readback, "
+            "dynamic_resolution, upload_ring\n";
+}
+
+std::optional<BenchOptions> parse_options(int argc, char** argv) {
+  auto options         = BenchOptions{};
+  const auto arguments = std::vector<std::string_view>(argv + 1, argv + argc);
+  for (auto argument = arguments.begin(); argument != arguments.end();
+       ++argument) {
+    const auto next = std::next(argument);
+    if (next == arguments.end()) {
+      return std::nullopt;
+    }
+    const auto value = std::string{*next};
+    if (*argument == "--scene") {
+      options.scene = value;
+    } else if (*argument == "--frames") {
+      options.frames = std::stoul(value);
+    } else if (*argument == "--warmup") {
+      options.warmup_frames = std::stoul(value);
+    } else if (*argument == "--instances") {
+      options.instances = static_cast<std::uint32_t>(std::stoul(value));
+    } else if (*argument == "--objects") {
+      options.objects = static_cast<std::uint32_t>(std::stoul(value));
+    } else if (*argument == "--frames-in-flight") {
+      options.frames_in_flight = std::max(1ul, std::stoul(value));
+    } else if (*argument == "--threads") {
+      options.threads = std::max(1ul, std::stoul(value));
+    } else if (*argument == "--output") {
+      options.out = value;
+    } else {
+      return std::nullopt;
+    }
+    argument = next;
+  }
+  return options;
+}
+
+std::optional<BenchContext> create_bench_context() {
+  auto context = BenchContext{};
+  // No window and no validation, we want the numbers to mean something.
+  context.instance           = create_instance({}, false);
+  const auto physical_device = get_any_gpu(context.instance.get());
+  if (!physical_device) {
+    return std::nullopt;
+  }
+  context.physical_device = physical_device.value();
+  context.enabled_features = get_supported_features(
+      context.physical_device,
+      merge_features(
+          merge_features(gpu_driven_features(), bindless_features()),
+          merge_features(texture_features(), readback_features())));
+  context.memory_budget = supports_device_extension(
+      context.physical_device, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+  auto extensions       = std::vector<const char*>{};
+  if (context.memory_budget) {
+    extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+  }
+  context.logical_device = create_logical_device(
+      context.physical_device, extensions, context.enabled_features);
+  if (!context.logical_device) {
+    return std::nullopt;
+  }
+  context.queue_family_index = static_cast<std::uint32_t>(
+      get_graphics_queue_family_index(context.physical_device).value());
+  context.queue =
+      get_queue(context.physical_device, context.logical_device.value());
+  context.queues = get_device_queues(
+      context.device(), get_queue_families(context.physical_device).value());
+  return context;
+}
+
+std::string json_string(const std::string_view value) {
+  auto escaped = std::string{"\""};
+  for (const auto character : value) {
+    if (character == '"' || character == '\\') {
+      escaped += '\\';
+    }
+    escaped += character;
+  }
+  return escaped + "\"";
+}
+
+std::string json_number(const double value) {
+  if (!std::isfinite(value)) {
+    return "null";
+  }
+  auto stream = std::ostringstream{};
+  stream << value;
+  return stream.str();
+}
+
+FrameTimeStats summarize(std::vector<double> samples) {
+  if (samples.empty()) {
+    return {};
+  }
+  std::ranges::sort(samples);
+  const auto percentile = [&samples](const double fraction) {
+    const auto rank = static_cast<std::size_t>(
+        std::ceil(fraction * static_cast<double>(samples.size())));
+    return samples[std::clamp(rank, 1uz, samples.size()) - 1];
+  };
+  auto stats = FrameTimeStats{};
+  stats.mean = std::reduce(samples.begin(), samples.end()) /
+               static_cast<double>(samples.size());
+  stats.p50 = percentile(0.50);
+  stats.p95 = percentile(0.95);
+  stats.p99 = percentile(0.99);
+  return stats;
+}
+
+std::string json_stats(const std::vector<double>& samples) {
+  if (samples.empty()) {
+    return "null";
+  }
+  const auto stats = summarize(samples);
+  return "{\"mean\": " + json_number(stats.mean) +
+         ", \"p50\": " + json_number(stats.p50) +
+         ", \"p95\": " + json_number(stats.p95) +
+         ", \"p99\": " + json_number(stats.p99) + "}";
+}
+
+std::optional<GpuFrameTimer>
+create_gpu_frame_timer(const BenchContext& context,
+                       const std::size_t frames_in_flight) {
+  const auto valid_bits =
+      context.physical_device
+          .getQueueFamilyProperties()[context.queue_family_index]
+          .timestampValidBits;
+  if (valid_bits == 0) {
+    return std::nullopt;
+  }
+  auto timer = GpuFrameTimer{};
+  vk::QueryPoolCreateInfo queryPoolInfo;
+  queryPoolInfo.queryType  = vk::QueryType::eTimestamp;
+  queryPoolInfo.queryCount = static_cast<std::uint32_t>(frames_in_flight * 2);
+  timer.query_pool = context.device().createQueryPoolUnique(queryPoolInfo);
+  timer.timestamp_period_ns = static_cast<double>(
+      context.physical_device.getProperties().limits.timestampPeriod);
+  timer.timestamp_mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+  timer.pending.resize(frames_in_flight, false);
+  return timer;
+}
+
+void begin_gpu_frame_timer(GpuFrameTimer& timer,
+                           const vk::CommandBuffer& command_buffer,
+                           const std::size_t slot) {
+  const auto first_query = static_cast<std::uint32_t>(slot * 2);
+  command_buffer.resetQueryPool(timer.query_pool.get(), first_query, 2);
+  command_buffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe,
+                                timer.query_pool.get(), first_query);
+}
+
+void end_gpu_frame_timer(GpuFrameTimer& timer,
+                         const vk::CommandBuffer& command_buffer,
+                         const std::size_t slot) {
+  command_buffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe,
+                                timer.query_pool.get(),
+                                static_cast<std::uint32_t>(slot * 2 + 1));
+  timer.pending[slot] = true;
+}
+
+std::optional<double> collect_gpu_frame_time(const vk::Device& logical_device,
+                                             GpuFrameTimer& timer,
+                                             const std::size_t slot) {
+  if (!timer.pending[slot]) {
+    return std::nullopt;
+  }
+  timer.pending[slot] = false;
+  auto timestamps     = std::array<std::uint64_t, 2>{};
+  const auto result   = logical_device.getQueryPoolResults(
+      timer.query_pool.get(), static_cast<std::uint32_t>(slot * 2), 2,
+      sizeof(timestamps), timestamps.data(), sizeof(std::uint64_t),
+      vk::QueryResultFlagBits::e64);
+  if (result != vk::Result::eSuccess) {
+    return std::nullopt;
+  }
+  const auto ticks = (timestamps[1] - timestamps[0]) & timer.timestamp_mask;
+  return static_cast<double>(ticks) * timer.timestamp_period_ns / 1.0e6;
+}
+
+std::optional<vk::ShaderModule>
+load_bench_shader_module(const vk::Device& logical_device,
+                         const std::string_view name) {
+  const auto module = load_shader(logical_device, name);
+  if (!module) {
+    std::cerr << "No shader named " << name << "\n";
+  }
+  return module;
+}
+
+std::vector<vk::PipelineShaderStageCreateInfo>
+load_bench_shaders(const vk::Device& logical_device,
+                   const std::string_view vertex_name,
+                   const std::string_view fragment_name) {
+  const auto vertex_shader =
+      load_bench_shader_module(logical_device, vertex_name);
+  const auto fragment_shader =
+      load_bench_shader_module(logical_device, fragment_name);
+  if (!vertex_shader || !fragment_shader) {
+    return {};
+  }
+  static const auto shader_entry_point = std::string{"main"};
+  return {create_shader_pipeline_info(vertex_shader.value(),
+                                      vk::ShaderStageFlagBits::eVertex,
+                                      shader_entry_point),
+          create_shader_pipeline_info(fragment_shader.value(),
+                                      vk::ShaderStageFlagBits::eFragment,
+                                      shader_entry_point)};
+}
+
+int main(int argc, char** argv) {
+  using Scene = std::function<BenchReport(BenchContext&, const BenchOptions&)>;
+  const auto scenes = std::map<std::string_view, Scene>{
+      {"triangles", run_triangles_scene},
+      {"pipelines", run_pipelines_scene},
+      {"allocator", run_allocator_scene},
+      {"gpu_driven", run_gpu_driven_scene},
+      {"recording", run_recording_scene},
+      {"uploads", run_uploads_scene},
+      {"streaming", run_streaming_scene},
+      {"bindless", run_bindless_scene},
+      {"particles", run_particles_scene},
+      {"render_graph", run_render_graph_scene},
+      {"cpu_culling", run_cpu_culling_scene},
+      {"jobs", run_jobs_scene},
+      {"textures", run_textures_scene},
+      {"readback", run_readback_scene},
+      {"dynamic_resolution", run_dynamic_resolution_scene},
+      {"upload_ring", run_upload_ring_scene},
+  };
+  const auto options = parse_options(argc, argv);
+  if (!options || !scenes.contains(options->scene)) {
+    print_usage(std::cerr);
+    return 1;
+  }
+  auto context = create_bench_context();
+  if (!context) {
+    std::cerr << "No Vulkan device available\n";
+    return 1;
+  }
+  const auto results = scenes.at(options->scene)(*context, *options);
+  if (results.empty()) {
+    return 1;
+  }
+
+  auto report = BenchReport{
+      {"scene", json_string(options->scene)},
+      {"device",
+       json_string(
+           context->physical_device.getProperties().deviceName.data())},
+  };
+  report.insert(report.end(), results.begin(), results.end());
+  auto file = std::ofstream{};
+  if (options->out) {
+    file.open(*options->out);
+  }
+  auto& stream = options->out ? static_cast<std::ostream&>(file) : std::cout;
+  stream << "{\n";
+  for (auto field = report.begin(); field != report.end(); ++field) {
+    stream << "  " << json_string(field->first) << ": " << field->second
+           << (std::next(field) == report.end() ? "\n" : ",\n");
+  }
+  stream << "}\n";
+  return 0;
+}
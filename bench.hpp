@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "math.hpp"
+#include "picante.hpp"
+
+struct BenchOptions {
+  std::string scene              = "triangles";
+  std::size_t frames             = 1000;
+  std::size_t warmup_frames      = 30;
+  std::uint32_t instances        = 1;
+  std::uint32_t objects          = 100000;
+  std::size_t frames_in_flight   = default_frames_in_flight;
+  std::size_t threads            = std::thread::hardware_concurrency();
+  std::optional<std::string> out = std::nullopt;
+};
+
+// The headless device every scene runs on.
+struct BenchContext {
+  vk::UniqueInstance instance;
+  vk::PhysicalDevice physical_device;
+  std::optional<vk::UniqueDevice> logical_device;
+  std::uint32_t queue_family_index = 0;
+  vk::Queue queue;
+  // Graphics, transfer and compute, for scenes that spread work out.
+  DeviceQueues queues;
+  // Whatever subset of the features scenes ask for the device could give us.
+  DeviceFeatures enabled_features;
+  // VK_EXT_memory_budget, so get_memory_budget reports what the driver sees.
+  bool memory_budget = false;
+
+  const vk::Device& device() const { return logical_device.value().get(); }
+};
+
+std::optional<BenchContext> create_bench_context();
+
+// Key and already formatted JSON value, written out in order.
+using BenchReport = std::vector<std::pair<std::string, std::string>>;
+
+std::string json_string(std::string_view value);
+std::string json_number(double value);
+
+struct FrameTimeStats {
+  double mean = 0.0;
+  double p50  = 0.0;
+  double p95  = 0.0;
+  double p99  = 0.0;
+};
+
+// Nearest-rank percentiles, samples are in milliseconds.
+FrameTimeStats summarize(std::vector<double> samples);
+std::string json_stats(const std::vector<double>& samples);
+
+// Two timestamps per frame slot bracketing the recorded work. Read back once
+// the slot's fence has signalled so it never stalls the queue.
+struct GpuFrameTimer {
+  vk::UniqueQueryPool query_pool;
+  double timestamp_period_ns   = 0.0;
+  std::uint64_t timestamp_mask = 0;
+  std::vector<bool> pending;
+};
+
+std::optional<GpuFrameTimer>
+create_gpu_frame_timer(const BenchContext& context,
+                       const std::size_t frames_in_flight);
+
+void begin_gpu_frame_timer(GpuFrameTimer& timer,
+                           const vk::CommandBuffer& command_buffer,
+                           const std::size_t slot);
+void end_gpu_frame_timer(GpuFrameTimer& timer,
+                         const vk::CommandBuffer& command_buffer,
+                         const std::size_t slot);
+
+// Returns the GPU time of the last frame recorded into this slot, if any.
+std::optional<double> collect_gpu_frame_time(const vk::Device& logical_device,
+                                             GpuFrameTimer& timer,
+                                             const std::size_t slot);
+
+// Embedded shader by name, complaining on stderr if there is none.
+std::optional<vk::ShaderModule>
+load_bench_shader_module(const vk::Device& logical_device,
+                         const std::string_view name);
+
+// Vertex and fragment stages, the triangle shaders unless told otherwise.
+std::vector<vk::PipelineShaderStageCreateInfo>
+load_bench_shaders(const vk::Device& logical_device,
+                   const std::string_view vertex_name   = "picante.vert",
+                   const std::string_view fragment_name = "picante.frag");
+
+// The object soup the GPU driven and recording scenes draw, one transform
+// and bounding sphere per object, and the camera looking at it.
+struct BenchObjects {
+  std::vector<Vec4> bounds;
+  std::vector<Mat4> transforms;
+  Mat4 view_projection;
+  Frustum frustum;
+};
+
+BenchObjects create_bench_objects(const std::uint32_t count);
+
+BenchReport run_triangles_scene(BenchContext& context,
+                                const BenchOptions& options);
+BenchReport run_pipelines_scene(BenchContext& context,
+                                const BenchOptions& options);
+BenchReport run_allocator_scene(BenchContext& context,
+                                const BenchOptions& options);
+BenchReport run_gpu_driven_scene(BenchContext& context,
+                                 const BenchOptions& options);
+BenchReport run_recording_scene(BenchContext& context,
+                                const BenchOptions& options);
+BenchReport run_uploads_scene(BenchContext& context,
+                              const BenchOptions& options);
+BenchReport run_streaming_scene(BenchContext& context,
+                                const BenchOptions& options);
+BenchReport run_bindless_scene(BenchContext& context,
+                               const BenchOptions& options);
+BenchReport run_particles_scene(BenchContext& context,
+                                const BenchOptions& options);
+BenchReport run_render_graph_scene(BenchContext& context,
+                                   const BenchOptions& options);
+BenchReport run_cpu_culling_scene(BenchContext& context,
+                                  const BenchOptions& options);
+BenchReport run_jobs_scene(BenchContext& context, const BenchOptions& options);
+BenchReport run_textures_scene(BenchContext& context,
+                               const BenchOptions& options);
+BenchReport run_readback_scene(BenchContext& context,
+                               const BenchOptions& options);
+BenchReport run_dynamic_resolution_scene(BenchContext& context,
+                                         const BenchOptions& options);
+BenchReport run_upload_ring_scene(BenchContext& context,
+                                  const BenchOptions& options);
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <ranges>
+
+#include "allocator.hpp"
+#include "bench.hpp"
+
+// Allocation latency of the sub-allocator against raw vkAllocateMemory,
+// plus how fragmented the sub-allocator ends up after a churn of frees.
+BenchReport run_allocator_scene(BenchContext& context,
+                                const BenchOptions& options) {
+  const auto& device = context.device();
+  auto allocator = create_device_allocator(context.physical_device, device);
+  // --frames doubles as the number of allocations.
+  const auto count = std::max<std::size_t>(options.frames, 1);
+  auto random      = std::mt19937{1234};
+  auto size_dist =
+      std::uniform_int_distribution<vk::DeviceSize>{64, 1024 * 1024};
+  auto requirements = std::vector<vk::MemoryRequirements>{};
+  requirements.reserve(count);
+  for ([[maybe_unused]] const auto index : std::views::iota(0uz, count)) {
+    requirements.push_back(
+        vk::MemoryRequirements{size_dist(random), 256, ~0u});
+  }
+  const auto kind_of = [](const std::size_t index) {
+    return index % 4 == 0 ? ResourceKind::eOptimal : ResourceKind::eLinear;
+  };
+  const auto elapsed_ns = [](const auto start) {
+    return std::chrono::duration<double, std::nano>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+
+  auto allocations = std::vector<Allocation>{};
+  allocations.reserve(count);
+  auto start = std::chrono::steady_clock::now();
+  for (const auto index : std::views::iota(0uz, count)) {
+    allocations.push_back(
+        allocate_memory(*allocator, requirements[index],
+                        vk::MemoryPropertyFlagBits::eDeviceLocal,
+                        kind_of(index))
+            .value());
+  }
+  const auto allocate_ns = elapsed_ns(start) / static_cast<double>(count);
+
+  // Free every other allocation in random order to leave holes behind.
+  auto freed = std::vector<std::size_t>{};
+  for (const auto index : std::views::iota(0uz, count)) {
+    if (index % 2 == 1) {
+      freed.push_back(index);
+    }
+  }
+  std::ranges::shuffle(freed, random);
+  start = std::chrono::steady_clock::now();
+  for (const auto index : freed) {
+    free_memory(*allocator, allocations[index]);
+  }
+  const auto free_ns =
+      freed.empty() ? 0.0
+                    : elapsed_ns(start) / static_cast<double>(freed.size());
+  const auto stats = get_allocator_stats(*allocator);
+  for (const auto index : std::views::iota(0uz, count)) {
+    if (index % 2 == 0) {
+      free_memory(*allocator, allocations[index]);
+    }
+  }
+
+  // Stay well clear of maxMemoryAllocationCount, often only 4096.
+  const auto raw_count = std::min<std::size_t>(
+      {count, 1024, stats.max_memory_allocation_count / 2});
+  const auto memory_type_index =
+      find_memory_type(context.physical_device, ~0u,
+                       vk::MemoryPropertyFlagBits::eDeviceLocal)
+          .value();
+  auto raw_allocations = std::vector<vk::DeviceMemory>{};
+  raw_allocations.reserve(raw_count);
+  start = std::chrono::steady_clock::now();
+  for (const auto index : std::views::iota(0uz, raw_count)) {
+    vk::MemoryAllocateInfo allocateInfo;
+    allocateInfo.allocationSize  = requirements[index].size;
+    allocateInfo.memoryTypeIndex = memory_type_index;
+    raw_allocations.push_back(device.allocateMemory(allocateInfo));
+  }
+  const auto raw_allocate_ns =
+      raw_count == 0 ? 0.0
+                     : elapsed_ns(start) / static_cast<double>(raw_count);
+  for (const auto& memory : raw_allocations) {
+    device.freeMemory(memory);
+  }
+
+  const auto as_number = [](const auto value) {
+    return json_number(static_cast<double>(value));
+  };
+  return {
+      {"allocations", as_number(count)},
+      {"suballocate_ns", json_number(allocate_ns)},
+      {"subfree_ns", json_number(free_ns)},
+      {"vk_allocate_memory_ns", json_number(raw_allocate_ns)},
+      {"blocks", as_number(stats.block_count)},
+      {"dedicated", as_number(stats.dedicated_count)},
+      {"device_allocations", as_number(stats.device_allocation_count)},
+      {"max_memory_allocation_count",
+       as_number(stats.max_memory_allocation_count)},
+      {"bytes_reserved", as_number(stats.bytes_reserved)},
+      {"bytes_allocated", as_number(stats.bytes_allocated)},
+      {"bytes_requested", as_number(stats.bytes_requested)},
+      {"largest_free_range", as_number(stats.largest_free_range)},
+      {"fragmentation", json_number(stats.fragmentation)},
+  };
+}
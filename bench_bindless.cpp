@@ -0,0 +1,305 @@
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <ranges>
+
+#include "bench.hpp"
+#include "bindless.hpp"
+#include "offscreen.hpp"
+
+// Distinct textures the objects cycle through, so consecutive draws rarely
+// share one.
+constexpr std::uint32_t bindless_texture_count = 256;
+constexpr std::uint32_t bindless_texture_size  = 4;
+
+// The GPU driven scene's objects, each sampling one of a few hundred tiny
+// textures. Drawn once the traditional way, a descriptor set per texture
+// bound before every draw, and once with the bindless heap bound for the
+// whole frame and every draw picking its texture through push constants.
+BenchReport run_bindless_scene(BenchContext& context,
+                               const BenchOptions& options) {
+  const auto& device = context.device();
+  if (!supports_bindless(context.enabled_features)) {
+    std::cerr << "Descriptor indexing with update after bind is not "
+                 "supported\n";
+    return {};
+  }
+  const auto bindless_shaders =
+      load_bench_shaders(device, "bindless.vert", "bindless.frag");
+  const auto textured_shaders =
+      load_bench_shaders(device, "textured.vert", "textured.frag");
+  if (bindless_shaders.empty() || textured_shaders.empty()) {
+    return {};
+  }
+
+  auto allocator     = create_device_allocator(context.physical_device, device);
+  const auto objects = create_bench_objects(options.objects);
+  auto transforms    = create_buffer_with_data(
+      *allocator, context.queue, context.queue_family_index,
+      std::as_bytes(std::span{objects.transforms}),
+      vk::BufferUsageFlagBits::eStorageBuffer);
+  if (!transforms) {
+    std::cerr << "Failed to upload the transforms\n";
+    return {};
+  }
+  auto textures = std::vector<AllocatedImage>{};
+  auto views    = std::vector<vk::UniqueImageView>{};
+  for (const auto index : std::views::iota(0u, bindless_texture_count)) {
+    vk::ImageCreateInfo imageInfo;
+    imageInfo.imageType   = vk::ImageType::e2D;
+    imageInfo.format      = vk::Format::eR8G8B8A8Unorm;
+    imageInfo.extent      = vk::Extent3D{bindless_texture_size,
+                                    bindless_texture_size, 1};
+    imageInfo.mipLevels   = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.usage       = vk::ImageUsageFlagBits::eSampled;
+    const auto color      = std::array<std::uint8_t, 4>{
+        static_cast<std::uint8_t>(index), static_cast<std::uint8_t>(index * 7),
+        static_cast<std::uint8_t>(index * 13), 255};
+    auto texels = std::vector<std::uint8_t>{};
+    for ([[maybe_unused]] const auto texel : std::views::iota(
+             0u, bindless_texture_size * bindless_texture_size)) {
+      texels.insert(texels.end(), color.begin(), color.end());
+    }
+    auto texture = create_image_with_data(
+        *allocator, context.queue, context.queue_family_index, imageInfo,
+        std::as_bytes(std::span{texels}));
+    if (!texture) {
+      std::cerr << "Failed to upload the textures\n";
+      return {};
+    }
+    vk::ImageViewCreateInfo viewInfo;
+    viewInfo.image                       = texture->image.get();
+    viewInfo.viewType                    = vk::ImageViewType::e2D;
+    viewInfo.format                      = imageInfo.format;
+    viewInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.layerCount = 1;
+    views.push_back(device.createImageViewUnique(viewInfo));
+    textures.push_back(std::move(*texture));
+  }
+
+  // The bindless path.
+  auto heap = create_bindless_heap(context.physical_device, device);
+  const auto transforms_slot =
+      register_bindless_buffer(heap, device, transforms->buffer.get());
+  auto texture_slots = std::vector<std::uint32_t>{};
+  for (const auto& view : views) {
+    const auto slot = register_bindless_image(heap, device, view.get());
+    if (!slot) {
+      break;
+    }
+    texture_slots.push_back(*slot);
+  }
+  if (!transforms_slot || texture_slots.size() != views.size()) {
+    std::cerr << "The bindless heap is too small\n";
+    return {};
+  }
+  auto draws = std::vector<BindlessDraw>{};
+  draws.reserve(options.objects);
+  for (const auto object : std::views::iota(0u, options.objects)) {
+    draws.push_back({object, *transforms_slot,
+                     texture_slots[object % bindless_texture_count], 0});
+  }
+
+  // The per draw descriptor set path, one set per texture that also holds
+  // the transforms, as a material system without bindless would have it.
+  vk::SamplerCreateInfo samplerInfo;
+  samplerInfo.magFilter = vk::Filter::eLinear;
+  samplerInfo.minFilter = vk::Filter::eLinear;
+  const auto sampler    = device.createSamplerUnique(samplerInfo);
+  const auto bindings   = std::array{
+      vk::DescriptorSetLayoutBinding{0, vk::DescriptorType::eStorageBuffer, 1,
+                                     vk::ShaderStageFlagBits::eVertex},
+      vk::DescriptorSetLayoutBinding{
+          1, vk::DescriptorType::eCombinedImageSampler, 1,
+          vk::ShaderStageFlagBits::eFragment},
+  };
+  vk::DescriptorSetLayoutCreateInfo setLayoutInfo;
+  setLayoutInfo.bindingCount = bindings.size();
+  setLayoutInfo.pBindings    = bindings.data();
+  const auto set_layout =
+      device.createDescriptorSetLayoutUnique(setLayoutInfo);
+  const auto pool_sizes = std::array{
+      vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer,
+                             bindless_texture_count},
+      vk::DescriptorPoolSize{vk::DescriptorType::eCombinedImageSampler,
+                             bindless_texture_count},
+  };
+  vk::DescriptorPoolCreateInfo descriptorPoolInfo;
+  descriptorPoolInfo.maxSets       = bindless_texture_count;
+  descriptorPoolInfo.poolSizeCount = pool_sizes.size();
+  descriptorPoolInfo.pPoolSizes    = pool_sizes.data();
+  const auto descriptor_pool =
+      device.createDescriptorPoolUnique(descriptorPoolInfo);
+  const auto set_layouts = std::vector<vk::DescriptorSetLayout>(
+      bindless_texture_count, set_layout.get());
+  vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo;
+  descriptorSetAllocateInfo.descriptorPool     = descriptor_pool.get();
+  descriptorSetAllocateInfo.descriptorSetCount = set_layouts.size();
+  descriptorSetAllocateInfo.pSetLayouts        = set_layouts.data();
+  const auto descriptor_sets =
+      device.allocateDescriptorSets(descriptorSetAllocateInfo);
+  const auto buffer_info =
+      vk::DescriptorBufferInfo{transforms->buffer.get(), 0, VK_WHOLE_SIZE};
+  for (const auto index : std::views::iota(0u, bindless_texture_count)) {
+    const auto image_info =
+        vk::DescriptorImageInfo{sampler.get(), views[index].get(),
+                                vk::ImageLayout::eShaderReadOnlyOptimal};
+    auto writes = std::array<vk::WriteDescriptorSet, 2>{};
+    writes[0].dstSet          = descriptor_sets[index];
+    writes[0].dstBinding      = 0;
+    writes[0].descriptorCount = 1;
+    writes[0].descriptorType  = vk::DescriptorType::eStorageBuffer;
+    writes[0].pBufferInfo     = &buffer_info;
+    writes[1].dstSet          = descriptor_sets[index];
+    writes[1].dstBinding      = 1;
+    writes[1].descriptorCount = 1;
+    writes[1].descriptorType  = vk::DescriptorType::eCombinedImageSampler;
+    writes[1].pImageInfo      = &image_info;
+    device.updateDescriptorSets(writes, {});
+  }
+  struct TexturedConstants {
+    Mat4 view_projection;
+    std::uint32_t object = 0;
+  };
+  const auto push_constants = vk::PushConstantRange{
+      vk::ShaderStageFlagBits::eVertex, 0, sizeof(TexturedConstants)};
+  const auto textured_set_layout = set_layout.get();
+  vk::PipelineLayoutCreateInfo layoutInfo;
+  layoutInfo.setLayoutCount         = 1;
+  layoutInfo.pSetLayouts            = &textured_set_layout;
+  layoutInfo.pushConstantRangeCount = 1;
+  layoutInfo.pPushConstantRanges    = &push_constants;
+  const auto textured_layout = device.createPipelineLayoutUnique(layoutInfo);
+
+  const auto render_pass = create_offscreen_render_pass(device);
+  const auto targets =
+      create_offscreen_targets(context.physical_device, device, render_pass,
+                               options.frames_in_flight);
+  const auto bindless_pipeline =
+      create_bindless_pipeline(device, heap, render_pass, bindless_shaders);
+  auto textured_description          = GraphicsPipelineDescription{};
+  textured_description.render_pass   = render_pass;
+  textured_description.layout        = textured_layout.get();
+  textured_description.shader_stages = textured_shaders;
+  textured_description.cull_mode     = vk::CullModeFlagBits::eNone;
+  const auto textured_pipeline =
+      create_graphics_pipeline(device, textured_description);
+  auto frame_ring = create_frame_ring(device, context.queue_family_index, 0,
+                                      options.frames_in_flight);
+  auto gpu_timer = create_gpu_frame_timer(context, options.frames_in_flight);
+
+  const auto record_textured_draws = [&](const vk::CommandBuffer&
+                                             command_buffer) {
+    command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                                textured_pipeline);
+    auto constants            = TexturedConstants{};
+    constants.view_projection = objects.view_projection;
+    for (const auto object : std::views::iota(0u, options.objects)) {
+      constants.object = object;
+      command_buffer.bindDescriptorSets(
+          vk::PipelineBindPoint::eGraphics, textured_layout.get(), 0,
+          descriptor_sets[object % bindless_texture_count], {});
+      command_buffer.pushConstants(textured_layout.get(),
+                                   vk::ShaderStageFlagBits::eVertex, 0,
+                                   sizeof(constants), &constants);
+      command_buffer.draw(3, 1, 0, 0);
+    }
+  };
+
+  struct Timings {
+    std::vector<double> cpu_record_ms;
+    std::vector<double> gpu_frame_ms;
+  };
+  const auto run = [&](const bool bindless) {
+    auto timings   = Timings{};
+    auto measuring = false;
+    timings.cpu_record_ms.reserve(options.frames);
+    timings.gpu_frame_ms.reserve(options.frames);
+    const auto collect = [&](const std::size_t slot) {
+      if (!gpu_timer) {
+        return;
+      }
+      const auto gpu_ms = collect_gpu_frame_time(device, *gpu_timer, slot);
+      if (gpu_ms && measuring) {
+        timings.gpu_frame_ms.push_back(*gpu_ms);
+      }
+    };
+    const auto record_frame = [&](const vk::Framebuffer& frame_buffer,
+                                  const vk::CommandBuffer& command_buffer) {
+      const auto slot = frame_ring.current;
+      collect(slot);
+      const auto record_start = std::chrono::steady_clock::now();
+      vk::CommandBufferBeginInfo commandBufferBeginInfo;
+      commandBufferBeginInfo.flags =
+          vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+      command_buffer.begin(commandBufferBeginInfo);
+      if (gpu_timer) {
+        begin_gpu_frame_timer(*gpu_timer, command_buffer, slot);
+      }
+      begin_render_pass(render_pass, frame_buffer, command_buffer);
+      if (bindless) {
+        record_bindless_draws(heap, bindless_pipeline, command_buffer,
+                              objects.view_projection, draws);
+      } else {
+        record_textured_draws(command_buffer);
+      }
+      command_buffer.endRenderPass();
+      if (gpu_timer) {
+        end_gpu_frame_timer(*gpu_timer, command_buffer, slot);
+      }
+      command_buffer.end();
+      if (measuring) {
+        timings.cpu_record_ms.push_back(
+            std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - record_start)
+                .count());
+      }
+    };
+    for ([[maybe_unused]] const auto frame :
+         std::views::iota(0uz, options.warmup_frames)) {
+      draw_offscreen_frame(device, context.queue, targets, frame_ring,
+                           record_frame);
+    }
+    device.waitIdle();
+    for (const auto slot : std::views::iota(0uz, options.frames_in_flight)) {
+      collect(slot);
+    }
+    measuring = true;
+    for ([[maybe_unused]] const auto frame :
+         std::views::iota(0uz, options.frames)) {
+      draw_offscreen_frame(device, context.queue, targets, frame_ring,
+                           record_frame);
+    }
+    device.waitIdle();
+    for (const auto slot : std::views::iota(0uz, options.frames_in_flight)) {
+      collect(slot);
+    }
+    return timings;
+  };
+  const auto per_draw = run(false);
+  const auto bindless = run(true);
+
+  drain_frame_ring(device, frame_ring);
+  device.destroyPipeline(textured_pipeline);
+  device.destroyPipeline(bindless_pipeline);
+  device.destroyRenderPass(render_pass);
+  views.clear();
+  for (auto& texture : textures) {
+    destroy_image(*allocator, texture);
+  }
+  destroy_buffer(*allocator, *transforms);
+
+  return {
+      {"objects", json_number(options.objects)},
+      {"textures", json_number(bindless_texture_count)},
+      {"frames", json_number(static_cast<double>(options.frames))},
+      {"heap_image_capacity", json_number(heap.images.capacity)},
+      {"heap_buffer_capacity", json_number(heap.buffers.capacity)},
+      {"per_draw_sets_cpu_record_ms", json_stats(per_draw.cpu_record_ms)},
+      {"per_draw_sets_gpu_frame_ms", json_stats(per_draw.gpu_frame_ms)},
+      {"bindless_cpu_record_ms", json_stats(bindless.cpu_record_ms)},
+      {"bindless_gpu_frame_ms", json_stats(bindless.gpu_frame_ms)},
+  };
+}
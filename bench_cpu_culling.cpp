@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <ranges>
+#include <span>
+#include <string>
+
+#include "bench.hpp"
+#include "culling.hpp"
+#include "gpu_driven.hpp"
+#include "offscreen.hpp"
+
+constexpr auto cull_kernels = std::array{
+    std::pair{CullKernel::eScalar, "scalar"},
+    std::pair{CullKernel::eSse4, "sse4"},
+    std::pair{CullKernel::eAvx2, "avx2"},
+};
+
+// The GPU driven scene's objects culled on the CPU. First every kernel the
+// CPU has culls the whole scene once per frame with nothing else going on,
+// for objects per nanosecond at each SIMD width. Then the widest one feeds
+// real frames, one draw call per surviving object, to see what culling costs
+// next to the recording it saves.
+BenchReport run_cpu_culling_scene(BenchContext& context,
+                                  const BenchOptions& options) {
+  const auto objects       = create_bench_objects(options.objects);
+  const auto scene_objects = create_scene_objects(objects.bounds);
+  const auto view          = create_cull_view(
+      objects.view_projection, static_cast<float>(render_extent.height));
+
+  auto report = BenchReport{
+      {"objects", json_number(options.objects)},
+      {"frames", json_number(static_cast<double>(options.frames))},
+  };
+  auto reference     = CullResult{};
+  auto kernels_agree = true;
+  auto lod_counts    = std::array<std::size_t, max_mesh_lods>{};
+  cull_objects(scene_objects, view, reference, CullKernel::eScalar);
+  for (const auto lod : std::span(reference.lods).first(reference.count)) {
+    ++lod_counts[lod];
+  }
+  for (const auto [kernel, name] : cull_kernels) {
+    if (!supports_cull_kernel(kernel)) {
+      report.emplace_back(std::string{name} + "_cull_ms", "null");
+      continue;
+    }
+    auto result  = CullResult{};
+    auto cull_ms = std::vector<double>{};
+    cull_ms.reserve(options.frames);
+    for (const auto frame :
+         std::views::iota(0uz, options.warmup_frames + options.frames)) {
+      const auto start = std::chrono::steady_clock::now();
+      cull_objects(scene_objects, view, result, kernel);
+      const auto elapsed = std::chrono::duration<double, std::milli>(
+          std::chrono::steady_clock::now() - start);
+      if (frame >= options.warmup_frames) {
+        cull_ms.push_back(elapsed.count());
+      }
+    }
+    kernels_agree &=
+        result.count == reference.count &&
+        std::ranges::equal(std::span(result.objects).first(result.count),
+                           std::span(reference.objects).first(result.count)) &&
+        std::ranges::equal(std::span(result.lods).first(result.count),
+                           std::span(reference.lods).first(result.count));
+    const auto stats = summarize(cull_ms);
+    report.emplace_back(std::string{name} + "_cull_ms", json_stats(cull_ms));
+    report.emplace_back(std::string{name} + "_objects_per_ns",
+                        json_number(options.objects / (stats.p50 * 1e6)));
+  }
+  report.emplace_back("visible_objects",
+                      json_number(static_cast<double>(reference.count)));
+  for (const auto [lod, count] : std::views::enumerate(lod_counts)) {
+    report.emplace_back("lod" + std::to_string(lod) + "_objects",
+                        json_number(static_cast<double>(count)));
+  }
+  report.emplace_back("kernels_agree", kernels_agree ? "true" : "false");
+
+  const auto& device = context.device();
+  const auto draw_shaders =
+      load_bench_shaders(device, "object.vert", "picante.frag");
+  const auto cull_shader = load_bench_shader_module(device, "cull.comp");
+  if (draw_shaders.empty() || !cull_shader) {
+    return report;
+  }
+  auto allocator = create_device_allocator(context.physical_device, device);
+  auto scene =
+      create_gpu_driven_scene(*allocator, context.queue,
+                              context.queue_family_index, objects.bounds,
+                              objects.transforms);
+  if (!scene) {
+    std::cerr << "Failed to upload the scene\n";
+    return report;
+  }
+  const auto render_pass = create_offscreen_render_pass(device);
+  const auto targets =
+      create_offscreen_targets(context.physical_device, device, render_pass,
+                               options.frames_in_flight);
+  const auto pipelines = create_gpu_driven_pipelines(
+      context.physical_device, device, context.enabled_features, render_pass,
+      *scene, cull_shader.value(), draw_shaders);
+  auto frame_ring = create_frame_ring(device, context.queue_family_index, 0,
+                                      options.frames_in_flight);
+  auto gpu_timer = create_gpu_frame_timer(context, options.frames_in_flight);
+
+  const auto kernel  = best_cull_kernel();
+  auto visible       = CullResult{};
+  auto measuring     = false;
+  auto cpu_cull_ms   = std::vector<double>{};
+  auto cpu_record_ms = std::vector<double>{};
+  auto gpu_frame_ms  = std::vector<double>{};
+  cpu_cull_ms.reserve(options.frames);
+  cpu_record_ms.reserve(options.frames);
+  gpu_frame_ms.reserve(options.frames);
+  const auto collect = [&](const std::size_t slot) {
+    if (!gpu_timer) {
+      return;
+    }
+    const auto gpu_ms = collect_gpu_frame_time(device, *gpu_timer, slot);
+    if (gpu_ms && measuring) {
+      gpu_frame_ms.push_back(*gpu_ms);
+    }
+  };
+  const auto record_frame = [&](const vk::Framebuffer& frame_buffer,
+                                const vk::CommandBuffer& command_buffer) {
+    const auto slot = frame_ring.current;
+    collect(slot);
+    const auto cull_start = std::chrono::steady_clock::now();
+    cull_objects(scene_objects, view, visible, kernel);
+    const auto record_start = std::chrono::steady_clock::now();
+    vk::CommandBufferBeginInfo commandBufferBeginInfo;
+    commandBufferBeginInfo.flags =
+        vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    command_buffer.begin(commandBufferBeginInfo);
+    if (gpu_timer) {
+      begin_gpu_frame_timer(*gpu_timer, command_buffer, slot);
+    }
+    begin_render_pass(render_pass, frame_buffer, command_buffer);
+    record_visible_draws(pipelines, *scene, objects.view_projection,
+                         command_buffer,
+                         std::span(visible.objects).first(visible.count));
+    command_buffer.endRenderPass();
+    if (gpu_timer) {
+      end_gpu_frame_timer(*gpu_timer, command_buffer, slot);
+    }
+    command_buffer.end();
+    if (measuring) {
+      const auto record_end = std::chrono::steady_clock::now();
+      cpu_cull_ms.push_back(std::chrono::duration<double, std::milli>(
+                                record_start - cull_start)
+                                .count());
+      cpu_record_ms.push_back(std::chrono::duration<double, std::milli>(
+                                  record_end - record_start)
+                                  .count());
+    }
+  };
+  for ([[maybe_unused]] const auto frame :
+       std::views::iota(0uz, options.warmup_frames)) {
+    draw_offscreen_frame(device, context.queue, targets, frame_ring,
+                         record_frame);
+  }
+  device.waitIdle();
+  for (const auto slot : std::views::iota(0uz, options.frames_in_flight)) {
+    collect(slot);
+  }
+  measuring = true;
+  for ([[maybe_unused]] const auto frame :
+       std::views::iota(0uz, options.frames)) {
+    draw_offscreen_frame(device, context.queue, targets, frame_ring,
+                         record_frame);
+  }
+  device.waitIdle();
+  for (const auto slot : std::views::iota(0uz, options.frames_in_flight)) {
+    collect(slot);
+  }
+  drain_frame_ring(device, frame_ring);
+  destroy_gpu_driven_scene(*allocator, *scene);
+  device.destroyRenderPass(render_pass);
+
+  const auto frame_kernel = std::ranges::find(
+      cull_kernels, kernel, [](const auto& entry) { return entry.first; });
+  report.emplace_back("frame_kernel", json_string(frame_kernel->second));
+  report.emplace_back("frame_cpu_cull_ms", json_stats(cpu_cull_ms));
+  report.emplace_back("frame_cpu_record_ms", json_stats(cpu_record_ms));
+  report.emplace_back("frame_gpu_ms", json_stats(gpu_frame_ms));
+  return report;
+}
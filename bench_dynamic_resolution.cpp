@@ -0,0 +1,165 @@
+#include <array>
+#include <iostream>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "allocator.hpp"
+#include "bench.hpp"
+#include "offscreen.hpp"
+#include "resolution_scaling.hpp"
+
+// The load swings between --instances and this many times as much, staying
+// at each for load_period frames.
+constexpr std::uint32_t heavy_load = 4;
+constexpr std::size_t load_period  = 120;
+// The frame budget as a multiple of what a light frame takes at full
+// resolution, so heavy frames only fit scaled down.
+constexpr double budget_factor = 2.0;
+
+constexpr auto resolution_modes = std::array{
+    std::pair{false, std::string_view{"fixed"}},
+    std::pair{true, std::string_view{"dynamic"}},
+};
+
+// The triangle scene rendered into a scaled target and upscaled into the
+// offscreen target, under a load that keeps switching between light and
+// heavy. Once at full resolution throughout and once with the scale driven
+// by the GPU frame time. Dynamic should miss the budget only for the few
+// frames it takes to notice the load went up, and pay for it in scale.
+BenchReport run_dynamic_resolution_scene(BenchContext& context,
+                                         const BenchOptions& options) {
+  const auto& device       = context.device();
+  const auto scene_shaders = load_bench_shaders(device);
+  const auto upscale_shaders =
+      load_bench_shaders(device, "post.vert", "upscale.frag");
+  if (scene_shaders.empty() || upscale_shaders.empty()) {
+    return {};
+  }
+  auto gpu_timer = create_gpu_frame_timer(context, options.frames_in_flight);
+  if (!gpu_timer) {
+    std::cerr << "Dynamic resolution needs GPU timestamps\n";
+    return {};
+  }
+  auto allocator = create_device_allocator(context.physical_device, device);
+  const auto output_pass = create_offscreen_render_pass(device);
+  const auto outputs =
+      create_offscreen_targets(context.physical_device, device, output_pass,
+                               options.frames_in_flight);
+  const auto scaled_pass = create_scaled_render_pass(device);
+  auto scaled_targets    = create_scaled_render_targets(
+      *allocator, scaled_pass, render_extent, options.frames_in_flight);
+  if (!scaled_targets) {
+    std::cerr << "Failed to allocate the scaled targets\n";
+    return {};
+  }
+  const auto layout         = create_fixed_function_pipeline(device);
+  const auto scene_pipeline =
+      create_graphics_pipeline(device, scaled_pass, layout, scene_shaders);
+  const auto upscaler =
+      create_upscaler(device, output_pass, upscale_shaders, *scaled_targets);
+
+  auto report = BenchReport{
+      {"frames", json_number(static_cast<double>(options.frames))},
+      {"instances", json_number(options.instances)},
+  };
+  // Measured in the first mode's warmup, the same for both.
+  auto budget_ms = 0.0;
+  for (const auto& [dynamic, mode_name] : resolution_modes) {
+    auto frame_ring = create_frame_ring(device, context.queue_family_index, 0,
+                                        options.frames_in_flight);
+    auto controller = ResolutionScaleController{};
+    if (!dynamic) {
+      controller.settings.min_scale = controller.settings.max_scale;
+    }
+    auto slot_scales  = std::vector<float>(options.frames_in_flight, 1.0f);
+    auto measuring    = false;
+    auto frame        = 0uz;
+    auto warmup_ms    = std::vector<double>{};
+    auto gpu_frame_ms = std::vector<double>{};
+    auto scales       = std::vector<double>{};
+    auto over_budget  = 0uz;
+    gpu_frame_ms.reserve(options.frames);
+    scales.reserve(options.frames);
+    const auto collect = [&](const std::size_t slot) {
+      const auto gpu_ms = collect_gpu_frame_time(device, *gpu_timer, slot);
+      if (!gpu_ms) {
+        return;
+      }
+      if (!measuring) {
+        warmup_ms.push_back(*gpu_ms);
+        return;
+      }
+      update_resolution_scale(controller, *gpu_ms, slot_scales[slot]);
+      gpu_frame_ms.push_back(*gpu_ms);
+      scales.push_back(slot_scales[slot]);
+      if (*gpu_ms > budget_ms) {
+        ++over_budget;
+      }
+    };
+    const auto record_frame = [&](const vk::Framebuffer& frame_buffer,
+                                  const vk::CommandBuffer& command_buffer) {
+      const auto slot = frame_ring.current;
+      collect(slot);
+      const auto heavy         = measuring && (frame / load_period) % 2 == 1;
+      slot_scales[slot]        = controller.scale;
+      const auto& scaled       = (*scaled_targets)[slot];
+      const auto scaled_extent = scale_extent(scaled.extent, controller.scale);
+      vk::CommandBufferBeginInfo commandBufferBeginInfo;
+      commandBufferBeginInfo.flags =
+          vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+      command_buffer.begin(commandBufferBeginInfo);
+      begin_gpu_frame_timer(*gpu_timer, command_buffer, slot);
+      record_render_pass(scaled_pass, scene_pipeline,
+                         scaled.framebuffer.get(), command_buffer,
+                         options.instances * (heavy ? heavy_load : 1),
+                         scaled_extent);
+      begin_render_pass(output_pass, frame_buffer, command_buffer);
+      record_upscale(upscaler, command_buffer, *scaled_targets, slot,
+                     scaled_extent, render_extent);
+      command_buffer.endRenderPass();
+      end_gpu_frame_timer(*gpu_timer, command_buffer, slot);
+      command_buffer.end();
+    };
+    for ([[maybe_unused]] const auto warmup :
+         std::views::iota(0uz, options.warmup_frames)) {
+      draw_offscreen_frame(device, context.queue, outputs, frame_ring,
+                           record_frame);
+    }
+    device.waitIdle();
+    for (const auto slot : std::views::iota(0uz, options.frames_in_flight)) {
+      collect(slot);
+    }
+    if (budget_ms == 0.0) {
+      budget_ms = summarize(warmup_ms).p50 * budget_factor;
+    }
+    controller.settings.frame_budget_ms = budget_ms;
+    measuring                           = true;
+    for (const auto index : std::views::iota(0uz, options.frames)) {
+      frame = index;
+      draw_offscreen_frame(device, context.queue, outputs, frame_ring,
+                           record_frame);
+    }
+    device.waitIdle();
+    for (const auto slot : std::views::iota(0uz, options.frames_in_flight)) {
+      collect(slot);
+    }
+    drain_frame_ring(device, frame_ring);
+
+    const auto prefix = std::string{mode_name} + "_";
+    report.emplace_back(prefix + "gpu_frame_ms", json_stats(gpu_frame_ms));
+    report.emplace_back(prefix + "frames_over_budget",
+                        json_number(static_cast<double>(over_budget)));
+    report.emplace_back(prefix + "scale", json_stats(scales));
+  }
+  report.emplace_back("budget_ms", json_number(budget_ms));
+
+  destroy_scaled_render_targets(*allocator, *scaled_targets);
+  device.destroyPipeline(scene_pipeline);
+  device.destroyPipelineLayout(layout);
+  device.destroyRenderPass(scaled_pass);
+  device.destroyRenderPass(output_pass);
+  return report;
+}
@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <numbers>
+#include <random>
+#include <ranges>
+
+#include "bench.hpp"
+#include "gpu_driven.hpp"
+#include "offscreen.hpp"
+
+BenchObjects create_bench_objects(const std::uint32_t count) {
+  // Triangles scattered through a cube around a camera at the origin looking
+  // down -Z, so only part of them survive culling.
+  constexpr auto extent = 100.0f;
+  constexpr auto radius = 0.75f;
+  auto objects          = BenchObjects{};
+  auto random           = std::mt19937{1234};
+  auto position_dist    = std::uniform_real_distribution<float>{-extent, extent};
+  objects.bounds.reserve(count);
+  objects.transforms.reserve(count);
+  for ([[maybe_unused]] const auto object : std::views::iota(0u, count)) {
+    const auto position = Vec3{position_dist(random), position_dist(random),
+                               position_dist(random)};
+    objects.bounds.push_back(Vec4{position.x, position.y, position.z, radius});
+    objects.transforms.push_back(translation(position));
+  }
+  objects.view_projection =
+      perspective(std::numbers::pi_v<float> / 3.0f,
+                  static_cast<float>(render_extent.width) /
+                      static_cast<float>(render_extent.height),
+                  0.1f, 2.0f * extent);
+  objects.frustum = extract_frustum_planes(objects.view_projection);
+  return objects;
+}
+
+// Same scene drawn with one draw call per object and with the GPU culling
+// and issuing its own draws. What matters is how the CPU recording cost of
+// each grows with --objects, and what the GPU pays for it.
+BenchReport run_gpu_driven_scene(BenchContext& context,
+                                 const BenchOptions& options) {
+  const auto& device   = context.device();
+  const auto& features = context.enabled_features;
+  if (!features.core.drawIndirectFirstInstance) {
+    std::cerr << "drawIndirectFirstInstance is not supported\n";
+    return {};
+  }
+  const auto draw_shaders =
+      load_bench_shaders(device, "object.vert", "picante.frag");
+  const auto cull_shader = load_bench_shader_module(device, "cull.comp");
+  if (draw_shaders.empty() || !cull_shader) {
+    return {};
+  }
+
+  const auto objects          = create_bench_objects(options.objects);
+  const auto& frustum         = objects.frustum;
+  const auto& view_projection = objects.view_projection;
+  const auto visible_objects =
+      std::ranges::count_if(objects.bounds, [&frustum](const Vec4& sphere) {
+        return std::ranges::all_of(frustum, [&sphere](const Vec4& plane) {
+          return plane.x * sphere.x + plane.y * sphere.y + plane.z * sphere.z +
+                     plane.w >=
+                 -sphere.w;
+        });
+      });
+
+  auto allocator = create_device_allocator(context.physical_device, device);
+  auto scene =
+      create_gpu_driven_scene(*allocator, context.queue,
+                              context.queue_family_index, objects.bounds,
+                              objects.transforms);
+  if (!scene) {
+    std::cerr << "Failed to upload the scene\n";
+    return {};
+  }
+  const auto render_pass = create_offscreen_render_pass(device);
+  const auto targets =
+      create_offscreen_targets(context.physical_device, device, render_pass,
+                               options.frames_in_flight);
+  const auto pipelines = create_gpu_driven_pipelines(
+      context.physical_device, device, features, render_pass, *scene,
+      cull_shader.value(), draw_shaders);
+  auto frame_ring = create_frame_ring(device, context.queue_family_index, 0,
+                                      options.frames_in_flight);
+  auto gpu_timer = create_gpu_frame_timer(context, options.frames_in_flight);
+
+  struct Timings {
+    std::vector<double> cpu_record_ms;
+    std::vector<double> gpu_frame_ms;
+  };
+  const auto run = [&](const bool gpu_driven) {
+    auto timings   = Timings{};
+    auto measuring = false;
+    timings.cpu_record_ms.reserve(options.frames);
+    timings.gpu_frame_ms.reserve(options.frames);
+    const auto collect = [&](const std::size_t slot) {
+      if (!gpu_timer) {
+        return;
+      }
+      const auto gpu_ms = collect_gpu_frame_time(device, *gpu_timer, slot);
+      if (gpu_ms && measuring) {
+        timings.gpu_frame_ms.push_back(*gpu_ms);
+      }
+    };
+    const auto record_frame = [&](const vk::Framebuffer& frame_buffer,
+                                  const vk::CommandBuffer& command_buffer) {
+      const auto slot = frame_ring.current;
+      collect(slot);
+      const auto record_start = std::chrono::steady_clock::now();
+      vk::CommandBufferBeginInfo commandBufferBeginInfo;
+      commandBufferBeginInfo.flags =
+          vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+      command_buffer.begin(commandBufferBeginInfo);
+      if (gpu_timer) {
+        begin_gpu_frame_timer(*gpu_timer, command_buffer, slot);
+      }
+      if (gpu_driven) {
+        record_gpu_culling(pipelines, *scene, frustum, command_buffer);
+      }
+      begin_render_pass(render_pass, frame_buffer, command_buffer);
+      if (gpu_driven) {
+        record_gpu_driven_draws(pipelines, *scene, view_projection,
+                                command_buffer);
+      } else {
+        record_per_object_draws(pipelines, *scene, view_projection,
+                                command_buffer);
+      }
+      command_buffer.endRenderPass();
+      if (gpu_timer) {
+        end_gpu_frame_timer(*gpu_timer, command_buffer, slot);
+      }
+      command_buffer.end();
+      if (measuring) {
+        timings.cpu_record_ms.push_back(
+            std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - record_start)
+                .count());
+      }
+    };
+    for ([[maybe_unused]] const auto frame :
+         std::views::iota(0uz, options.warmup_frames)) {
+      draw_offscreen_frame(device, context.queue, targets, frame_ring,
+                           record_frame);
+    }
+    device.waitIdle();
+    for (const auto slot : std::views::iota(0uz, options.frames_in_flight)) {
+      collect(slot);
+    }
+    measuring = true;
+    for ([[maybe_unused]] const auto frame :
+         std::views::iota(0uz, options.frames)) {
+      draw_offscreen_frame(device, context.queue, targets, frame_ring,
+                           record_frame);
+    }
+    device.waitIdle();
+    for (const auto slot : std::views::iota(0uz, options.frames_in_flight)) {
+      collect(slot);
+    }
+    return timings;
+  };
+  const auto per_object = run(false);
+  const auto indirect   = run(true);
+
+  drain_frame_ring(device, frame_ring);
+  destroy_gpu_driven_scene(*allocator, *scene);
+  device.destroyRenderPass(render_pass);
+
+  return {
+      {"objects", json_number(options.objects)},
+      {"visible_objects", json_number(static_cast<double>(visible_objects))},
+      {"frames", json_number(static_cast<double>(options.frames))},
+      {"draw_indirect_count", pipelines.use_draw_count ? "true" : "false"},
+      {"multi_draw_indirect",
+       features.core.multiDrawIndirect ? "true" : "false"},
+      {"per_object_cpu_record_ms", json_stats(per_object.cpu_record_ms)},
+      {"per_object_gpu_frame_ms", json_stats(per_object.gpu_frame_ms)},
+      {"indirect_cpu_record_ms", json_stats(indirect.cpu_record_ms)},
+      {"indirect_gpu_frame_ms", json_stats(indirect.gpu_frame_ms)},
+  };
+}
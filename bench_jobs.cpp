@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <ranges>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+#include "culling.hpp"
+#include "frame_tasks.hpp"
+#include "gpu_driven.hpp"
+#include "jobs.hpp"
+#include "offscreen.hpp"
+
+// Objects moved per update job.
+constexpr std::size_t update_grain = 16384;
+// Radians the scene turns by every frame.
+constexpr float update_rotation = 0.01f;
+
+// The culling scene split into an update, a cull and a render task per
+// frame, run on the job system with 1, 2, 4... up to --threads threads, once
+// with every frame waiting for the last and once with two frames in flight.
+// The update spreads over the workers, and with two frames in flight the
+// next frame's update and cull overlap this one's recording and submit, so
+// frames per second should grow with the thread count until the recording
+// thread or the GPU is the limit.
+BenchReport run_jobs_scene(BenchContext& context,
+                           const BenchOptions& options) {
+  const auto& device = context.device();
+  const auto draw_shaders =
+      load_bench_shaders(device, "object.vert", "picante.frag");
+  const auto cull_shader = load_bench_shader_module(device, "cull.comp");
+  if (draw_shaders.empty() || !cull_shader) {
+    return {};
+  }
+  const auto objects = create_bench_objects(options.objects);
+  auto allocator = create_device_allocator(context.physical_device, device);
+  auto scene =
+      create_gpu_driven_scene(*allocator, context.queue,
+                              context.queue_family_index, objects.bounds,
+                              objects.transforms);
+  if (!scene) {
+    std::cerr << "Failed to upload the scene\n";
+    return {};
+  }
+  const auto render_pass = create_offscreen_render_pass(device);
+  const auto targets =
+      create_offscreen_targets(context.physical_device, device, render_pass,
+                               options.frames_in_flight);
+  const auto pipelines = create_gpu_driven_pipelines(
+      context.physical_device, device, context.enabled_features, render_pass,
+      *scene, cull_shader.value(), draw_shaders);
+  auto frame_ring = create_frame_ring(device, context.queue_family_index, 0,
+                                      options.frames_in_flight);
+
+  // Only the culling bounds turn with the scene, the draws keep the uploaded
+  // transforms. What is measured is the CPU side of the frame.
+  const auto rest_objects = create_scene_objects(objects.bounds);
+  const auto view         = create_cull_view(
+      objects.view_projection, static_cast<float>(render_extent.height));
+  constexpr auto max_depth = std::size_t{2};
+  auto moved_objects =
+      std::array<SceneObjects, max_depth>{rest_objects, rest_objects};
+  auto visible = std::array<CullResult, max_depth>{};
+
+  auto graph = FrameTaskGraph{};
+  auto depth = max_depth;
+  auto jobs  = std::unique_ptr<JobSystem>{};
+  const auto update = add_frame_task(
+      graph, {"update", [&](const std::uint64_t frame) {
+                const auto angle  = update_rotation * static_cast<float>(frame);
+                const auto cosine = std::cos(angle);
+                const auto sine   = std::sin(angle);
+                auto& moved       = moved_objects[frame % depth];
+                parallel_for(
+                    *jobs, rest_objects.count, update_grain,
+                    [&](const std::size_t first, const std::size_t count) {
+                      for (const auto index :
+                           std::views::iota(first, first + count)) {
+                        const auto x          = rest_objects.center_x[index];
+                        const auto z          = rest_objects.center_z[index];
+                        moved.center_x[index] = cosine * x + sine * z;
+                        moved.center_z[index] = cosine * z - sine * x;
+                      }
+                    });
+              }});
+  const auto cull = add_frame_task(
+      graph, {"cull",
+              [&](const std::uint64_t frame) {
+                cull_objects(moved_objects[frame % depth], view,
+                             visible[frame % depth]);
+              },
+              {update}});
+  const auto record_frame = [&](const vk::Framebuffer& frame_buffer,
+                                const vk::CommandBuffer& command_buffer,
+                                const CullResult& result) {
+    vk::CommandBufferBeginInfo commandBufferBeginInfo;
+    commandBufferBeginInfo.flags =
+        vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    command_buffer.begin(commandBufferBeginInfo);
+    begin_render_pass(render_pass, frame_buffer, command_buffer);
+    record_visible_draws(pipelines, *scene, objects.view_projection,
+                         command_buffer,
+                         std::span(result.objects).first(result.count));
+    command_buffer.endRenderPass();
+    command_buffer.end();
+  };
+  add_frame_task(
+      graph, {"render",
+              [&](const std::uint64_t frame) {
+                const auto& result = visible[frame % depth];
+                draw_offscreen_frame(
+                    device, context.queue, targets, frame_ring,
+                    [&](const vk::Framebuffer& frame_buffer,
+                        const vk::CommandBuffer& command_buffer) {
+                      record_frame(frame_buffer, command_buffer, result);
+                    });
+              },
+              {cull}});
+
+  auto thread_counts = std::vector<std::size_t>{};
+  for (auto threads = 1uz; threads < options.threads; threads *= 2) {
+    thread_counts.push_back(threads);
+  }
+  thread_counts.push_back(std::max<std::size_t>(options.threads, 1));
+
+  auto report = BenchReport{
+      {"objects", json_number(options.objects)},
+      {"frames", json_number(static_cast<double>(options.frames))},
+  };
+  for (const auto threads : thread_counts) {
+    jobs = create_job_system(threads);
+    for (const auto frames_in_flight : {1uz, max_depth}) {
+      depth         = frames_in_flight;
+      auto pipeline = create_frame_pipeline(*jobs, graph, depth);
+      for ([[maybe_unused]] const auto frame :
+           std::views::iota(0uz, options.warmup_frames)) {
+        start_frame(pipeline);
+      }
+      finish_frames(pipeline);
+      const auto start = std::chrono::steady_clock::now();
+      for ([[maybe_unused]] const auto frame :
+           std::views::iota(0uz, options.frames)) {
+        start_frame(pipeline);
+      }
+      finish_frames(pipeline);
+      const auto seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+      report.emplace_back("fps_threads" + std::to_string(threads) +
+                              "_depth" + std::to_string(frames_in_flight),
+                          json_number(options.frames / seconds));
+    }
+    jobs.reset();
+  }
+
+  device.waitIdle();
+  drain_frame_ring(device, frame_ring);
+  destroy_gpu_driven_scene(*allocator, *scene);
+  device.destroyRenderPass(render_pass);
+  return report;
+}
@@ -0,0 +1,148 @@
+#include <array>
+#include <iostream>
+#include <numbers>
+#include <ranges>
+#include <string>
+
+#include "bench.hpp"
+#include "offscreen.hpp"
+#include "particles.hpp"
+
+// Half decades from ten thousand to ten million.
+constexpr auto particle_counts = std::array<std::uint32_t, 7>{
+    10'000, 30'000, 100'000, 300'000, 1'000'000, 3'000'000, 10'000'000};
+// Average lifetime particles.comp hands out, in seconds. Emitting the
+// capacity's worth over it keeps the system about full.
+constexpr auto mean_particle_lifetime = 2.5f;
+
+// One particle system per count, filled on the first warmup frame and kept
+// about full by emitting as many particles as die. Each frame steps once and
+// draws everything, the step and the whole frame are timed on the GPU apart.
+// Per particle cost staying flat is scaling, it creeping up is where the
+// memory bandwidth or the atomics ran out.
+BenchReport run_particles_scene(BenchContext& context,
+                                const BenchOptions& options) {
+  const auto& device = context.device();
+  if (!supports_particle_simulation(context.physical_device)) {
+    std::cerr << "Subgroup ballots are not supported in compute shaders\n";
+    return {};
+  }
+  const auto draw_shaders =
+      load_bench_shaders(device, "particle.vert", "particle.frag");
+  const auto step_shader = load_bench_shader_module(device, "particles.comp");
+  if (draw_shaders.empty() || !step_shader) {
+    return {};
+  }
+
+  auto allocator = create_device_allocator(context.physical_device, device);
+  const auto render_pass = create_offscreen_render_pass(device);
+  const auto targets =
+      create_offscreen_targets(context.physical_device, device, render_pass,
+                               options.frames_in_flight);
+  auto frame_ring = create_frame_ring(device, context.queue_family_index, 0,
+                                      options.frames_in_flight);
+  auto step_timer  = create_gpu_frame_timer(context, options.frames_in_flight);
+  auto frame_timer = create_gpu_frame_timer(context, options.frames_in_flight);
+  // Looking at the fountain from a few meters back and a little above.
+  const auto view_projection =
+      perspective(std::numbers::pi_v<float> / 3.0f,
+                  static_cast<float>(render_extent.width) /
+                      static_cast<float>(render_extent.height),
+                  0.1f, 100.0f) *
+      translation(Vec3{0.0f, -2.0f, -12.0f});
+
+  auto report = BenchReport{
+      {"frames", json_number(static_cast<double>(options.frames))},
+  };
+  for (const auto capacity : particle_counts) {
+    auto system = create_particle_system(
+        *allocator, context.queue, context.queue_family_index, render_pass,
+        step_shader.value(), draw_shaders, capacity);
+    const auto key = std::to_string(capacity);
+    if (!system) {
+      std::cerr << "Failed to allocate " << capacity << " particles\n";
+      report.emplace_back("step_gpu_ms_" + key, "null");
+      continue;
+    }
+    auto step      = ParticleStep{};
+    auto measuring = false;
+    auto step_ms   = std::vector<double>{};
+    auto frame_ms  = std::vector<double>{};
+    step_ms.reserve(options.frames);
+    frame_ms.reserve(options.frames);
+    const auto collect = [&](const std::size_t slot) {
+      if (!step_timer || !frame_timer) {
+        return;
+      }
+      const auto step_gpu_ms =
+          collect_gpu_frame_time(device, *step_timer, slot);
+      const auto frame_gpu_ms =
+          collect_gpu_frame_time(device, *frame_timer, slot);
+      if (step_gpu_ms && frame_gpu_ms && measuring) {
+        step_ms.push_back(*step_gpu_ms);
+        frame_ms.push_back(*frame_gpu_ms);
+      }
+    };
+    const auto record_frame = [&](const vk::Framebuffer& frame_buffer,
+                                  const vk::CommandBuffer& command_buffer) {
+      const auto slot = frame_ring.current;
+      collect(slot);
+      vk::CommandBufferBeginInfo commandBufferBeginInfo;
+      commandBufferBeginInfo.flags =
+          vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+      command_buffer.begin(commandBufferBeginInfo);
+      if (frame_timer) {
+        begin_gpu_frame_timer(*frame_timer, command_buffer, slot);
+      }
+      if (step_timer) {
+        begin_gpu_frame_timer(*step_timer, command_buffer, slot);
+      }
+      record_particle_step(*system, step, command_buffer);
+      if (step_timer) {
+        end_gpu_frame_timer(*step_timer, command_buffer, slot);
+      }
+      begin_render_pass(render_pass, frame_buffer, command_buffer);
+      record_particle_draws(*system, view_projection, command_buffer);
+      command_buffer.endRenderPass();
+      if (frame_timer) {
+        end_gpu_frame_timer(*frame_timer, command_buffer, slot);
+      }
+      command_buffer.end();
+    };
+
+    step.emit_count = capacity;
+    for (const auto frame : std::views::iota(0uz, options.warmup_frames)) {
+      draw_offscreen_frame(device, context.queue, targets, frame_ring,
+                           record_frame);
+      if (frame == 0) {
+        step.emit_count = static_cast<std::uint32_t>(
+            capacity * step.delta_time / mean_particle_lifetime);
+      }
+    }
+    device.waitIdle();
+    for (const auto slot : std::views::iota(0uz, options.frames_in_flight)) {
+      collect(slot);
+    }
+    measuring = true;
+    for ([[maybe_unused]] const auto frame :
+         std::views::iota(0uz, options.frames)) {
+      draw_offscreen_frame(device, context.queue, targets, frame_ring,
+                           record_frame);
+    }
+    device.waitIdle();
+    for (const auto slot : std::views::iota(0uz, options.frames_in_flight)) {
+      collect(slot);
+    }
+    drain_frame_ring(device, frame_ring);
+    destroy_particle_system(*allocator, *system);
+
+    const auto step_mean = summarize(step_ms).mean;
+    report.emplace_back("step_gpu_ms_" + key, json_stats(step_ms));
+    report.emplace_back("frame_gpu_ms_" + key, json_stats(frame_ms));
+    report.emplace_back("step_ns_per_particle_" + key,
+                        json_number(step_mean * 1e6 / capacity));
+  }
+
+  device.destroyRenderPass(render_pass);
+  return report;
+}
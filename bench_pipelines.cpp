@@ -0,0 +1,99 @@
+#include <chrono>
+
+#include "bench.hpp"
+#include "offscreen.hpp"
+#include "pipeline_cache.hpp"
+
+// Every combination of the fixed function knobs we expose, each one a
+// distinct pipeline as far as the driver is concerned.
+std::vector<GraphicsPipelineDescription>
+create_pipeline_variants(const vk::RenderPass& render_pass,
+                         const vk::PipelineLayout& layout,
+                         const std::vector<vk::PipelineShaderStageCreateInfo>&
+                             shaders) {
+  auto variants = std::vector<GraphicsPipelineDescription>{};
+  for (const auto topology : {vk::PrimitiveTopology::eTriangleList,
+                              vk::PrimitiveTopology::eTriangleStrip}) {
+    for (const auto cull_mode :
+         {vk::CullModeFlags{vk::CullModeFlagBits::eNone},
+          vk::CullModeFlags{vk::CullModeFlagBits::eFront},
+          vk::CullModeFlags{vk::CullModeFlagBits::eBack},
+          vk::CullModeFlags{vk::CullModeFlagBits::eFrontAndBack}}) {
+      for (const auto front_face :
+           {vk::FrontFace::eClockwise, vk::FrontFace::eCounterClockwise}) {
+        for (const auto blend_enable : {false, true}) {
+          auto description          = GraphicsPipelineDescription{};
+          description.render_pass   = render_pass;
+          description.layout        = layout;
+          description.shader_stages = shaders;
+          description.topology      = topology;
+          description.cull_mode     = cull_mode;
+          description.front_face    = front_face;
+          description.blend_enable  = blend_enable;
+          variants.push_back(description);
+        }
+      }
+    }
+  }
+  return variants;
+}
+
+// Builds the whole batch into the given cache and returns how long it took.
+double time_pipeline_batch(
+    const vk::Device& logical_device,
+    const std::vector<GraphicsPipelineDescription>& variants,
+    const vk::PipelineCache& pipeline_cache, const std::size_t threads) {
+  const auto start     = std::chrono::steady_clock::now();
+  const auto pipelines = create_graphics_pipelines_parallel(
+      logical_device, variants, pipeline_cache, threads);
+  const auto elapsed = std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+  for (const auto& pipeline : pipelines) {
+    logical_device.destroyPipeline(pipeline);
+  }
+  return elapsed;
+}
+
+// Cold numbers are only truly cold if the driver keeps no cache of its own,
+// e.g. run with MESA_SHADER_CACHE_DISABLE=true on Mesa drivers.
+BenchReport run_pipelines_scene(BenchContext& context,
+                                const BenchOptions& options) {
+  const auto& device = context.device();
+  const auto shaders = load_bench_shaders(device);
+  if (shaders.empty()) {
+    return {};
+  }
+  const auto render_pass = create_offscreen_render_pass(device);
+  const auto layout      = create_fixed_function_pipeline(device);
+  const auto variants = create_pipeline_variants(render_pass, layout, shaders);
+
+  const auto cold_serial_cache = device.createPipelineCacheUnique({});
+  const auto cold_serial_ms =
+      time_pipeline_batch(device, variants, cold_serial_cache.get(), 1);
+
+  const auto cold_cache = device.createPipelineCacheUnique({});
+  const auto cold_parallel_ms =
+      time_pipeline_batch(device, variants, cold_cache.get(), options.threads);
+
+  // Round trip through the serialized blob, exactly what a second launch
+  // would load from disk.
+  const auto cache_data = device.getPipelineCacheData(cold_cache.get());
+  auto warm_cache_info            = vk::PipelineCacheCreateInfo{};
+  warm_cache_info.initialDataSize = cache_data.size();
+  warm_cache_info.pInitialData    = cache_data.data();
+  const auto warm_cache = device.createPipelineCacheUnique(warm_cache_info);
+  const auto warm_parallel_ms =
+      time_pipeline_batch(device, variants, warm_cache.get(), options.threads);
+
+  device.destroyPipelineLayout(layout);
+  device.destroyRenderPass(render_pass);
+  return {
+      {"pipelines", json_number(static_cast<double>(variants.size()))},
+      {"threads", json_number(static_cast<double>(options.threads))},
+      {"cache_bytes", json_number(static_cast<double>(cache_data.size()))},
+      {"cold_serial_ms", json_number(cold_serial_ms)},
+      {"cold_parallel_ms", json_number(cold_parallel_ms)},
+      {"warm_parallel_ms", json_number(warm_parallel_ms)},
+  };
+}
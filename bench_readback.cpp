@@ -0,0 +1,169 @@
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <ostream>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "bench.hpp"
+#include "offscreen.hpp"
+#include "readback.hpp"
+
+struct ReadbackResolution {
+  std::string_view name;
+  vk::Extent2D extent;
+};
+
+constexpr auto readback_resolutions = std::array{
+    ReadbackResolution{"1024", {1024, 1024}},
+    ReadbackResolution{"4k", {3840, 2160}},
+};
+
+// Readback buffers beyond the frames in flight, slack for the consumer.
+constexpr std::size_t readback_spare_slots = 2;
+
+enum class ReadbackMode { eNone, eChecksum, eY4m };
+
+constexpr auto readback_modes = std::array{
+    std::pair{ReadbackMode::eNone, std::string_view{"no_readback"}},
+    std::pair{ReadbackMode::eChecksum, std::string_view{"checksum"}},
+    std::pair{ReadbackMode::eY4m, std::string_view{"y4m"}},
+};
+
+// Draws the triangle scene at 1024x1024 and at 4K, without reading frames
+// back, reading every frame back into a consumer that only sums its bytes,
+// and into one that converts it to Y4M as an encoder would want it. The
+// readback never drops frames here, so a consumer that can't keep up shows
+// up as lower frames per second rather than as dropped frames. Latency is
+// from the copy being recorded to the consumer getting the frame.
+BenchReport run_readback_scene(BenchContext& context,
+                               const BenchOptions& options) {
+  const auto& device = context.device();
+  const auto shaders = load_bench_shaders(device);
+  if (shaders.empty()) {
+    return {};
+  }
+  if (!supports_frame_readback(context.enabled_features)) {
+    std::cerr << "Frame readback needs timeline semaphores\n";
+    return {};
+  }
+  auto allocator = create_device_allocator(context.physical_device, device);
+  const auto render_pass       = create_offscreen_render_pass(device);
+  const auto layout            = create_fixed_function_pipeline(device);
+  const auto graphics_pipeline =
+      create_graphics_pipeline(device, render_pass, layout, shaders);
+
+  auto report = BenchReport{
+      {"frames", json_number(static_cast<double>(options.frames))},
+      {"instances", json_number(options.instances)},
+  };
+  for (const auto& [name, extent] : readback_resolutions) {
+    const auto targets =
+        create_offscreen_targets(context.physical_device, device, render_pass,
+                                 options.frames_in_flight, extent);
+    for (const auto& [mode, mode_name] : readback_modes) {
+      auto frame_ring = create_frame_ring(device, context.queue_family_index,
+                                          0, options.frames_in_flight);
+      // Outside the consumer so the reads can't be optimised out.
+      auto checksum    = std::uint64_t{0};
+      auto null_stream = std::ostream{nullptr};
+      auto consumer    = ReadbackConsumer{};
+      if (mode == ReadbackMode::eChecksum) {
+        consumer = [&checksum](const ReadbackFrame& frame) {
+          for (auto offset = 0uz; offset + 8 <= frame.pixels.size();
+               offset += 8) {
+            auto word = std::uint64_t{0};
+            std::memcpy(&word, frame.pixels.data() + offset, sizeof(word));
+            checksum += word;
+          }
+        };
+      } else if (mode == ReadbackMode::eY4m) {
+        consumer = [&null_stream](const ReadbackFrame& frame) {
+          write_y4m_frame(null_stream, frame);
+        };
+      }
+      auto readback =
+          mode == ReadbackMode::eNone
+              ? nullptr
+              : create_frame_readback(
+                    *allocator, extent, offscreen_format,
+                    options.frames_in_flight + readback_spare_slots,
+                    std::move(consumer), false);
+      if (mode != ReadbackMode::eNone && !readback) {
+        std::cerr << "Failed to allocate the readback buffers\n";
+        return {};
+      }
+
+      auto cpu_frame_ms       = std::vector<double>{};
+      const auto record_frame = [&](const vk::Framebuffer& frame_buffer,
+                                    const vk::CommandBuffer& command_buffer) {
+        const auto& target = targets[frame_ring.current];
+        vk::CommandBufferBeginInfo commandBufferBeginInfo;
+        commandBufferBeginInfo.flags =
+            vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+        command_buffer.begin(commandBufferBeginInfo);
+        record_render_pass(render_pass, graphics_pipeline, frame_buffer,
+                           command_buffer, options.instances, extent);
+        if (readback) {
+          record_frame_readback(*readback, frame_ring, command_buffer,
+                                target.image.get());
+        }
+        command_buffer.end();
+      };
+      for ([[maybe_unused]] const auto frame :
+           std::views::iota(0uz, options.warmup_frames)) {
+        draw_offscreen_frame(device, context.queue, targets, frame_ring,
+                             record_frame);
+      }
+      device.waitIdle();
+      if (readback) {
+        flush_frame_readback(*readback);
+      }
+      const auto consumed_before = readback ? readback->consumed_frames : 0;
+      const auto start           = std::chrono::steady_clock::now();
+      for ([[maybe_unused]] const auto frame :
+           std::views::iota(0uz, options.frames)) {
+        const auto frame_start = std::chrono::steady_clock::now();
+        draw_offscreen_frame(device, context.queue, targets, frame_ring,
+                             record_frame);
+        cpu_frame_ms.push_back(
+            std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - frame_start)
+                .count());
+      }
+      device.waitIdle();
+      if (readback) {
+        flush_frame_readback(*readback);
+      }
+      const auto seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+      drain_frame_ring(device, frame_ring);
+
+      const auto key = std::string{name} + "_" + std::string{mode_name};
+      report.emplace_back(key + "_fps", json_number(options.frames / seconds));
+      report.emplace_back(key + "_cpu_frame_ms", json_stats(cpu_frame_ms));
+      if (!readback) {
+        continue;
+      }
+      destroy_frame_readback(*readback);
+      const auto consumed   = readback->consumed_frames - consumed_before;
+      const auto latency_ms = std::vector(
+          readback->latency_ms.end() - static_cast<std::ptrdiff_t>(consumed),
+          readback->latency_ms.end());
+      report.emplace_back(
+          key + "_readback_gb_per_second",
+          json_number(static_cast<double>(consumed * readback->frame_bytes) /
+                      seconds / 1.0e9));
+      report.emplace_back(key + "_latency_ms", json_stats(latency_ms));
+    }
+  }
+
+  device.destroyPipeline(graphics_pipeline);
+  device.destroyPipelineLayout(layout);
+  device.destroyRenderPass(render_pass);
+  return report;
+}
@@ -0,0 +1,116 @@
+#include <chrono>
+#include <iostream>
+#include <ranges>
+
+#include "bench.hpp"
+#include "gpu_driven.hpp"
+#include "jobs.hpp"
+#include "offscreen.hpp"
+#include "parallel_recording.hpp"
+
+// One draw call per object recorded every frame, first inline into the
+// primary buffer by a single thread and then as secondary buffers from a job
+// system of --threads threads. Only CPU recording cost is of interest here,
+// the GPU does the same work either way.
+BenchReport run_recording_scene(BenchContext& context,
+                                const BenchOptions& options) {
+  const auto& device      = context.device();
+  const auto draw_shaders =
+      load_bench_shaders(device, "object.vert", "picante.frag");
+  const auto cull_shader = load_bench_shader_module(device, "cull.comp");
+  if (draw_shaders.empty() || !cull_shader) {
+    return {};
+  }
+  const auto objects = create_bench_objects(options.objects);
+  auto allocator = create_device_allocator(context.physical_device, device);
+  auto scene =
+      create_gpu_driven_scene(*allocator, context.queue,
+                              context.queue_family_index, objects.bounds,
+                              objects.transforms);
+  if (!scene) {
+    std::cerr << "Failed to upload the scene\n";
+    return {};
+  }
+  const auto render_pass = create_offscreen_render_pass(device);
+  const auto targets =
+      create_offscreen_targets(context.physical_device, device, render_pass,
+                               options.frames_in_flight);
+  const auto pipelines = create_gpu_driven_pipelines(
+      context.physical_device, device, context.enabled_features, render_pass,
+      *scene, cull_shader.value(), draw_shaders);
+  auto frame_ring = create_frame_ring(device, context.queue_family_index, 0,
+                                      options.frames_in_flight);
+  const auto jobs = create_job_system(options.threads);
+  auto recorder   = create_parallel_recorder(
+      device, *jobs, context.queue_family_index, options.frames_in_flight);
+  const auto record_slice = [&](const vk::CommandBuffer& command_buffer,
+                                const std::size_t first,
+                                const std::size_t count) {
+    record_per_object_draws(pipelines, *scene, objects.view_projection,
+                            command_buffer, static_cast<std::uint32_t>(first),
+                            static_cast<std::uint32_t>(count));
+  };
+
+  const auto run = [&](const bool parallel) {
+    auto cpu_record_ms      = std::vector<double>{};
+    auto measuring          = false;
+    const auto record_frame = [&](const vk::Framebuffer& frame_buffer,
+                                  const vk::CommandBuffer& command_buffer) {
+      const auto record_start = std::chrono::steady_clock::now();
+      vk::CommandBufferBeginInfo commandBufferBeginInfo;
+      commandBufferBeginInfo.flags =
+          vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+      command_buffer.begin(commandBufferBeginInfo);
+      if (parallel) {
+        const auto secondaries = record_secondary_command_buffers(
+            *recorder, frame_ring.current, render_pass, frame_buffer,
+            render_extent, scene->object_count, record_slice);
+        begin_render_pass(render_pass, frame_buffer, command_buffer,
+                          vk::SubpassContents::eSecondaryCommandBuffers);
+        if (!secondaries.empty()) {
+          command_buffer.executeCommands(secondaries);
+        }
+      } else {
+        begin_render_pass(render_pass, frame_buffer, command_buffer);
+        record_slice(command_buffer, 0, scene->object_count);
+      }
+      command_buffer.endRenderPass();
+      command_buffer.end();
+      if (measuring) {
+        cpu_record_ms.push_back(std::chrono::duration<double, std::milli>(
+                                    std::chrono::steady_clock::now() -
+                                    record_start)
+                                    .count());
+      }
+    };
+    for ([[maybe_unused]] const auto frame :
+         std::views::iota(0uz, options.warmup_frames)) {
+      draw_offscreen_frame(device, context.queue, targets, frame_ring,
+                           record_frame);
+    }
+    measuring = true;
+    cpu_record_ms.reserve(options.frames);
+    for ([[maybe_unused]] const auto frame :
+         std::views::iota(0uz, options.frames)) {
+      draw_offscreen_frame(device, context.queue, targets, frame_ring,
+                           record_frame);
+    }
+    device.waitIdle();
+    return cpu_record_ms;
+  };
+  const auto single_thread = run(false);
+  const auto multi_thread  = run(true);
+
+  drain_frame_ring(device, frame_ring);
+  destroy_gpu_driven_scene(*allocator, *scene);
+  device.destroyRenderPass(render_pass);
+
+  return {
+      {"objects", json_number(options.objects)},
+      {"frames", json_number(static_cast<double>(options.frames))},
+      {"threads",
+       json_number(static_cast<double>(recording_thread_count(*recorder)))},
+      {"inline_cpu_record_ms", json_stats(single_thread)},
+      {"secondary_cpu_record_ms", json_stats(multi_thread)},
+  };
+}
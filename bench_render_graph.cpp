@@ -0,0 +1,236 @@
+#include <array>
+#include <iostream>
+#include <optional>
+#include <ranges>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+#include "offscreen.hpp"
+#include "render_graph.hpp"
+
+// Lengths of the post processing chain the graph is built with.
+constexpr auto post_pass_counts = std::array<std::uint32_t, 5>{0, 1, 2, 4, 8};
+
+// The triangle scene followed by a chain of post processing passes, each
+// sampling the previous pass's image, the last one writing the offscreen
+// target. A debug pass nobody reads from is added too, for the graph to cull.
+// What should stay flat as the chain grows is the transient memory and the
+// barriers per pass.
+BenchReport run_render_graph_scene(BenchContext& context,
+                                   const BenchOptions& options) {
+  const auto& device       = context.device();
+  const auto scene_shaders = load_bench_shaders(device);
+  const auto post_shaders =
+      load_bench_shaders(device, "post.vert", "post.frag");
+  if (scene_shaders.empty() || post_shaders.empty()) {
+    return {};
+  }
+  auto allocator = create_device_allocator(context.physical_device, device);
+  const auto offscreen_pass = create_offscreen_render_pass(device);
+  const auto targets =
+      create_offscreen_targets(context.physical_device, device,
+                               offscreen_pass, options.frames_in_flight);
+  auto frame_ring = create_frame_ring(device, context.queue_family_index, 0,
+                                      options.frames_in_flight);
+  auto gpu_timer = create_gpu_frame_timer(context, options.frames_in_flight);
+
+  vk::SamplerCreateInfo samplerInfo;
+  samplerInfo.magFilter    = vk::Filter::eLinear;
+  samplerInfo.minFilter    = vk::Filter::eLinear;
+  samplerInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+  samplerInfo.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+  const auto sampler       = device.createSamplerUnique(samplerInfo);
+  const auto binding       = vk::DescriptorSetLayoutBinding{
+      0, vk::DescriptorType::eCombinedImageSampler, 1,
+      vk::ShaderStageFlagBits::eFragment};
+  vk::DescriptorSetLayoutCreateInfo setLayoutInfo;
+  setLayoutInfo.bindingCount = 1;
+  setLayoutInfo.pBindings    = &binding;
+  const auto set_layout = device.createDescriptorSetLayoutUnique(setLayoutInfo);
+  const auto post_set_layout = set_layout.get();
+  vk::PipelineLayoutCreateInfo layoutInfo;
+  layoutInfo.setLayoutCount = 1;
+  layoutInfo.pSetLayouts    = &post_set_layout;
+  const auto post_layout    = device.createPipelineLayoutUnique(layoutInfo);
+  const auto scene_layout   = device.createPipelineLayoutUnique({});
+
+  const auto description =
+      RenderGraphImageDescription{offscreen_format, render_extent};
+  auto report = BenchReport{
+      {"frames", json_number(static_cast<double>(options.frames))},
+  };
+  for (const auto post_passes : post_pass_counts) {
+    auto graph        = create_render_graph(*allocator);
+    const auto target = import_graph_image(
+        graph, "target", description, vk::ImageLayout::eUndefined,
+        vk::ImageLayout::eTransferSrcOptimal);
+    auto scene_pipeline = vk::Pipeline{};
+    auto post_pipeline  = vk::Pipeline{};
+    auto post_sets      = std::vector<vk::DescriptorSet>(post_passes);
+
+    auto previous = post_passes == 0
+                        ? target
+                        : create_graph_image(graph, "scene", description);
+    const auto scene_pass = add_graph_pass(
+        graph, "scene", {{previous, RenderGraphAccess::eColorAttachment}},
+        [&](const vk::CommandBuffer& command_buffer) {
+          set_viewport_and_scissor(command_buffer, render_extent);
+          command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                                      scene_pipeline);
+          command_buffer.draw(3, options.instances, 0, 0);
+        });
+    auto post_inputs = std::vector<RenderGraphResource>{};
+    auto first_post  = std::optional<RenderGraphPassIndex>{};
+    for (const auto index : std::views::iota(0u, post_passes)) {
+      const auto output =
+          index + 1 == post_passes
+              ? target
+              : create_graph_image(graph, "post" + std::to_string(index),
+                                   description);
+      const auto pass = add_graph_pass(
+          graph, "post" + std::to_string(index),
+          {{previous, RenderGraphAccess::eSampled},
+           {output, RenderGraphAccess::eColorAttachment}},
+          [&, index](const vk::CommandBuffer& command_buffer) {
+            set_viewport_and_scissor(command_buffer, render_extent);
+            command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                                        post_pipeline);
+            command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                              post_layout.get(), 0,
+                                              post_sets[index], {});
+            command_buffer.draw(3, 1, 0, 0);
+          });
+      first_post = first_post.value_or(pass);
+      post_inputs.push_back(previous);
+      previous = output;
+    }
+    const auto debug = create_graph_image(graph, "debug", description);
+    add_graph_pass(graph, "debug",
+                   {{debug, RenderGraphAccess::eColorAttachment}},
+                   [](const vk::CommandBuffer&) {});
+    if (!compile_render_graph(graph)) {
+      std::cerr << "Failed to allocate the transient images\n";
+      return {};
+    }
+
+    // Every post pass renders to the same format, so their render passes are
+    // compatible and one pipeline does for all of them.
+    scene_pipeline = create_graphics_pipeline(
+        device, graph_render_pass(graph, scene_pass), scene_layout.get(),
+        scene_shaders);
+    auto descriptor_pool = vk::UniqueDescriptorPool{};
+    if (first_post) {
+      auto post_description          = GraphicsPipelineDescription{};
+      post_description.render_pass   = graph_render_pass(graph, *first_post);
+      post_description.layout        = post_layout.get();
+      post_description.shader_stages = post_shaders;
+      post_description.cull_mode     = vk::CullModeFlagBits::eNone;
+      post_pipeline = create_graphics_pipeline(device, post_description);
+
+      const auto pool_size = vk::DescriptorPoolSize{
+          vk::DescriptorType::eCombinedImageSampler, post_passes};
+      vk::DescriptorPoolCreateInfo descriptorPoolInfo;
+      descriptorPoolInfo.maxSets       = post_passes;
+      descriptorPoolInfo.poolSizeCount = 1;
+      descriptorPoolInfo.pPoolSizes    = &pool_size;
+      descriptor_pool = device.createDescriptorPoolUnique(descriptorPoolInfo);
+      const auto set_layouts =
+          std::vector<vk::DescriptorSetLayout>(post_passes, post_set_layout);
+      vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo;
+      descriptorSetAllocateInfo.descriptorPool     = descriptor_pool.get();
+      descriptorSetAllocateInfo.descriptorSetCount = set_layouts.size();
+      descriptorSetAllocateInfo.pSetLayouts        = set_layouts.data();
+      post_sets = device.allocateDescriptorSets(descriptorSetAllocateInfo);
+      for (const auto [set, input] : std::views::zip(post_sets, post_inputs)) {
+        const auto image_info = vk::DescriptorImageInfo{
+            sampler.get(), graph_image_view(graph, input),
+            vk::ImageLayout::eShaderReadOnlyOptimal};
+        vk::WriteDescriptorSet write;
+        write.dstSet          = set;
+        write.dstBinding      = 0;
+        write.descriptorCount = 1;
+        write.descriptorType  = vk::DescriptorType::eCombinedImageSampler;
+        write.pImageInfo      = &image_info;
+        device.updateDescriptorSets(write, {});
+      }
+    }
+
+    auto measuring    = false;
+    auto gpu_frame_ms = std::vector<double>{};
+    gpu_frame_ms.reserve(options.frames);
+    const auto collect = [&](const std::size_t slot) {
+      if (!gpu_timer) {
+        return;
+      }
+      const auto gpu_ms = collect_gpu_frame_time(device, *gpu_timer, slot);
+      if (gpu_ms && measuring) {
+        gpu_frame_ms.push_back(*gpu_ms);
+      }
+    };
+    const auto record_frame = [&](const vk::Framebuffer&,
+                                  const vk::CommandBuffer& command_buffer) {
+      const auto slot = frame_ring.current;
+      collect(slot);
+      set_graph_image(graph, target, targets[slot].image.get(),
+                      targets[slot].view.get());
+      vk::CommandBufferBeginInfo commandBufferBeginInfo;
+      commandBufferBeginInfo.flags =
+          vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+      command_buffer.begin(commandBufferBeginInfo);
+      if (gpu_timer) {
+        begin_gpu_frame_timer(*gpu_timer, command_buffer, slot);
+      }
+      execute_render_graph(graph, command_buffer);
+      if (gpu_timer) {
+        end_gpu_frame_timer(*gpu_timer, command_buffer, slot);
+      }
+      command_buffer.end();
+    };
+    for ([[maybe_unused]] const auto frame :
+         std::views::iota(0uz, options.warmup_frames)) {
+      draw_offscreen_frame(device, context.queue, targets, frame_ring,
+                           record_frame);
+    }
+    device.waitIdle();
+    for (const auto slot : std::views::iota(0uz, options.frames_in_flight)) {
+      collect(slot);
+    }
+    measuring = true;
+    for ([[maybe_unused]] const auto frame :
+         std::views::iota(0uz, options.frames)) {
+      draw_offscreen_frame(device, context.queue, targets, frame_ring,
+                           record_frame);
+    }
+    device.waitIdle();
+    for (const auto slot : std::views::iota(0uz, options.frames_in_flight)) {
+      collect(slot);
+    }
+    drain_frame_ring(device, frame_ring);
+
+    const auto& stats = graph.stats;
+    const auto prefix = "post" + std::to_string(post_passes) + "_";
+    const auto add    = [&](const std::string& key, const auto value) {
+      report.emplace_back(prefix + key,
+                          json_number(static_cast<double>(value)));
+    };
+    add("passes", stats.passes);
+    add("culled_passes", stats.culled_passes);
+    add("barrier_calls", stats.barrier_calls);
+    add("image_barriers", stats.image_barriers);
+    add("transient_images", stats.transient_images);
+    add("lazy_images", stats.lazy_images);
+    add("transient_bytes_requested", stats.transient_bytes_requested);
+    add("transient_bytes_allocated", stats.transient_bytes_allocated);
+    report.emplace_back(prefix + "gpu_frame_ms", json_stats(gpu_frame_ms));
+
+    device.destroyPipeline(scene_pipeline);
+    if (post_pipeline) {
+      device.destroyPipeline(post_pipeline);
+    }
+    destroy_render_graph(graph);
+  }
+
+  device.destroyRenderPass(offscreen_pass);
+  return report;
+}
@@ -0,0 +1,197 @@
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <optional>
+#include <ranges>
+#include <string>
+
+#include "bench.hpp"
+#include "mesh_streaming.hpp"
+#include "offscreen.hpp"
+
+// Meshes in the synthetic pack and the side of each one's vertex grid, about
+// a megabyte apiece with their LODs.
+constexpr std::uint32_t streaming_mesh_count = 48;
+constexpr std::uint32_t streaming_grid_size  = 128;
+// Meshes requested every frame of the working set pass, and how many frames
+// pass before the window slides on by one.
+constexpr std::uint32_t streaming_window      = 8;
+constexpr std::uint32_t streaming_window_step = 8;
+
+// A bumpy grid, different for every seed so no two meshes simplify alike.
+MeshData create_grid_mesh(const std::uint32_t seed) {
+  auto mesh       = MeshData{"grid" + std::to_string(seed), {}, {}};
+  const auto side = streaming_grid_size + 1;
+  mesh.vertices.reserve(side * side);
+  for (const auto y : std::views::iota(0u, side)) {
+    for (const auto x : std::views::iota(0u, side)) {
+      auto vertex     = MeshVertex{};
+      vertex.u        = static_cast<float>(x) / streaming_grid_size;
+      vertex.v        = static_cast<float>(y) / streaming_grid_size;
+      vertex.position = {vertex.u, vertex.v,
+                         0.05f * std::sin(vertex.u * (seed + 3.0f)) *
+                             std::cos(vertex.v * (seed + 5.0f))};
+      vertex.normal   = {0.0f, 0.0f, 1.0f};
+      mesh.vertices.push_back(vertex);
+    }
+  }
+  for (const auto y : std::views::iota(0u, streaming_grid_size)) {
+    for (const auto x : std::views::iota(0u, streaming_grid_size)) {
+      const auto corner = y * side + x;
+      mesh.indices.insert(mesh.indices.end(),
+                          {corner, corner + 1, corner + side, corner + 1,
+                           corner + side + 1, corner + side});
+    }
+  }
+  return mesh;
+}
+
+// Streams a generated mesh pack while drawing the triangle scene. The first
+// pass asks for every mesh at once and times how long until the first and
+// the last are resident, the second walks a small window across the pack
+// under a resident limit of a quarter of it, so meshes keep getting evicted
+// and streamed back in. The streamed meshes aren't drawn, what's measured is
+// the streaming and what it costs the render thread.
+BenchReport run_streaming_scene(BenchContext& context,
+                                const BenchOptions& options) {
+  const auto& device = context.device();
+  const auto shaders = load_bench_shaders(device);
+  if (shaders.empty()) {
+    return {};
+  }
+  const auto pack_path =
+      std::filesystem::temp_directory_path() / "picante_streaming.pmesh";
+  auto source_meshes = std::vector<MeshData>{};
+  for (const auto seed : std::views::iota(0u, streaming_mesh_count)) {
+    source_meshes.push_back(create_grid_mesh(seed));
+  }
+  if (!write_mesh_pack(pack_path, source_meshes)) {
+    return {};
+  }
+  auto allocator = create_device_allocator(context.physical_device, device);
+  const auto render_pass = create_offscreen_render_pass(device);
+  const auto targets =
+      create_offscreen_targets(context.physical_device, device, render_pass,
+                               options.frames_in_flight);
+  const auto layout            = create_fixed_function_pipeline(device);
+  const auto graphics_pipeline =
+      create_graphics_pipeline(device, render_pass, layout, shaders);
+  auto frame_ring = create_frame_ring(device, context.queue_family_index, 0,
+                                      options.frames_in_flight);
+
+  // Runs frames until done says so, with request picking the meshes each
+  // frame asks for. Returns the streamer's stats and the CPU frame times.
+  const auto run = [&](const vk::DeviceSize resident_limit, auto&& request,
+                       auto&& done) {
+    auto pack     = open_mesh_pack(pack_path);
+    auto streamer = pack ? create_mesh_streamer(
+                               context.physical_device, *allocator,
+                               context.queues, std::move(*pack),
+                               context.memory_budget, resident_limit)
+                         : nullptr;
+    auto cpu_frame_ms = std::vector<double>{};
+    if (!streamer) {
+      return std::pair{MeshStreamerStats{}, cpu_frame_ms};
+    }
+    auto frame              = std::uint64_t{0};
+    const auto record_frame = [&](const vk::Framebuffer& frame_buffer,
+                                  const vk::CommandBuffer& command_buffer) {
+      vk::CommandBufferBeginInfo commandBufferBeginInfo;
+      commandBufferBeginInfo.flags =
+          vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+      command_buffer.begin(commandBufferBeginInfo);
+      update_mesh_streamer(*streamer, frame_ring, command_buffer);
+      request(*streamer, frame);
+      record_render_pass(render_pass, graphics_pipeline, frame_buffer,
+                         command_buffer, options.instances);
+      command_buffer.end();
+    };
+    while (!done(*streamer, frame)) {
+      const auto frame_start = std::chrono::steady_clock::now();
+      draw_offscreen_frame(device, context.queue, targets, frame_ring,
+                           record_frame);
+      cpu_frame_ms.push_back(std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() -
+                                 frame_start)
+                                 .count());
+      ++frame;
+    }
+    drain_frame_ring(device, frame_ring);
+    destroy_mesh_streamer(*streamer);
+    return std::pair{streamer->stats, cpu_frame_ms};
+  };
+
+  using Clock           = std::chrono::steady_clock;
+  const auto cold_start = Clock::now();
+  auto first_resident   = std::optional<Clock::time_point>{};
+  auto all_resident     = std::optional<Clock::time_point>{};
+  const auto [cold_stats, cold_frame_ms] = run(
+      0,
+      [&](MeshStreamer& streamer, std::uint64_t) {
+        auto resident = 0u;
+        for (const auto mesh : std::views::iota(0u, streaming_mesh_count)) {
+          resident += request_mesh(streamer, mesh) != nullptr;
+        }
+        if (resident > 0 && !first_resident) {
+          first_resident = Clock::now();
+        }
+        if (resident == streaming_mesh_count) {
+          all_resident = Clock::now();
+        }
+      },
+      [&](const MeshStreamer& streamer, const std::uint64_t frame) {
+        // Stalled streaming shows up as a missing time rather than a hang.
+        return all_resident.has_value() || streamer.stats.failed_loads > 0 ||
+               frame >= options.frames * 10;
+      });
+
+  const auto pack_bytes = std::filesystem::file_size(pack_path);
+  auto missed_frames    = std::size_t{0};
+  const auto [window_stats, window_frame_ms] = run(
+      pack_bytes / 4,
+      [&](MeshStreamer& streamer, const std::uint64_t frame) {
+        const auto first =
+            static_cast<std::uint32_t>(frame / streaming_window_step);
+        auto missed = false;
+        for (const auto offset : std::views::iota(0u, streaming_window)) {
+          const auto mesh = (first + offset) % streaming_mesh_count;
+          missed = request_mesh(streamer, mesh) == nullptr || missed;
+        }
+        missed_frames += missed;
+      },
+      [&](const MeshStreamer&, const std::uint64_t frame) {
+        return frame >= options.warmup_frames + options.frames;
+      });
+
+  device.destroyPipeline(graphics_pipeline);
+  device.destroyPipelineLayout(layout);
+  device.destroyRenderPass(render_pass);
+  std::filesystem::remove(pack_path);
+
+  const auto since_start = [&cold_start](const auto& time) {
+    return time ? json_number(std::chrono::duration<double, std::milli>(
+                                  *time - cold_start)
+                                  .count())
+                : std::string{"null"};
+  };
+  return {
+      {"mesh_count", json_number(streaming_mesh_count)},
+      {"pack_bytes", json_number(static_cast<double>(pack_bytes))},
+      {"memory_budget_extension", context.memory_budget ? "true" : "false"},
+      {"time_to_first_mesh_ms", since_start(first_resident)},
+      {"time_to_all_meshes_ms", since_start(all_resident)},
+      {"cold_load_frames", json_number(static_cast<double>(
+                               cold_frame_ms.size()))},
+      {"cold_load_cpu_frame_ms", json_stats(cold_frame_ms)},
+      {"cold_load_batches",
+       json_number(static_cast<double>(cold_stats.batches_streamed))},
+      {"window_cpu_frame_ms", json_stats(window_frame_ms)},
+      {"window_missed_frames", json_number(static_cast<double>(missed_frames))},
+      {"window_bytes_streamed",
+       json_number(static_cast<double>(window_stats.bytes_streamed))},
+      {"window_evictions",
+       json_number(static_cast<double>(window_stats.evictions))},
+      {"window_failed_loads",
+       json_number(static_cast<double>(window_stats.failed_loads))},
+  };
+}
@@ -0,0 +1,181 @@
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bench.hpp"
+#include "textures.hpp"
+
+// Side of every synthetic texture, and how many times each one is loaded.
+constexpr std::uint32_t texture_size       = 2048;
+constexpr std::size_t texture_load_repeats = 16;
+
+struct BenchTextureFormat {
+  std::string_view name;
+  TextureFormat format;
+};
+
+constexpr auto bench_texture_formats = std::array{
+    BenchTextureFormat{"rgba8", TextureFormat::eR8G8B8A8Srgb},
+    BenchTextureFormat{"bc1", TextureFormat::eBc1RgbSrgb},
+    BenchTextureFormat{"bc3", TextureFormat::eBc3Srgb},
+    BenchTextureFormat{"bc5", TextureFormat::eBc5Unorm},
+    BenchTextureFormat{"bc7", TextureFormat::eBc7Srgb},
+};
+
+// Random bytes for every level. Any bits make valid BC1, BC3 and BC5 blocks
+// and the odd reserved BC7 mode just decodes to black, nothing looks at them.
+std::vector<std::vector<std::byte>>
+create_random_levels(const TextureFormat format, const std::uint32_t levels,
+                     const bool generate_mips) {
+  auto random     = std::mt19937{1234};
+  auto byte_dist  = std::uniform_int_distribution<unsigned>{0, 255};
+  auto result     = std::vector<std::vector<std::byte>>{};
+  const auto last = generate_mips ? 1 : levels;
+  for (const auto level : std::views::iota(0u, last)) {
+    auto& bytes = result.emplace_back(
+        texture_level_size(format, texture_size, texture_size, level));
+    for (auto& byte : bytes) {
+      byte = static_cast<std::byte>(byte_dist(random));
+    }
+  }
+  return result;
+}
+
+// Loads a full mip chain of a 2048x2048 texture in each format from KTX2 and
+// times the whole load, mapping the file through to the image being ready to
+// sample, then generates an RGBA8 texture's mips with blits and times that on
+// the GPU. Block compressed formats upload a quarter (BC3, BC5, BC7) or an
+// eighth (BC1) of the bytes, formats the device can't sample are decoded on
+// the CPU and reported as such.
+BenchReport run_textures_scene(BenchContext& context,
+                               const BenchOptions& options) {
+  const auto& device = context.device();
+  auto allocator = create_device_allocator(context.physical_device, device);
+  const auto directory =
+      std::filesystem::temp_directory_path() / "picante_textures";
+  std::filesystem::create_directories(directory);
+  const auto level_count = full_mip_level_count(texture_size, texture_size);
+
+  auto report = BenchReport{
+      {"texture_size", json_number(texture_size)},
+      {"loads", json_number(static_cast<double>(texture_load_repeats))},
+  };
+  const auto rgba8_bytes = static_cast<double>(
+      texture_level_size(TextureFormat::eR8G8B8A8Srgb, texture_size,
+                         texture_size, 0));
+  for (const auto& [name, format] : bench_texture_formats) {
+    const auto key  = std::string{name};
+    const auto path = directory / (key + ".ktx2");
+    if (!write_ktx2(path, format, texture_size, texture_size,
+                    create_random_levels(format, level_count, false))) {
+      std::cerr << "Failed to write " << path << '\n';
+      return {};
+    }
+    auto load_ms  = std::vector<double>{};
+    auto uploaded = vk::DeviceSize{0};
+    auto decoded  = false;
+    for ([[maybe_unused]] const auto load :
+         std::views::iota(0uz, texture_load_repeats)) {
+      const auto start  = std::chrono::steady_clock::now();
+      const auto source = open_ktx2(path);
+      auto texture =
+          source ? create_ktx2_texture(*allocator, context.physical_device,
+                                       context.queue,
+                                       context.queue_family_index, *source)
+                 : std::nullopt;
+      if (!texture) {
+        break;
+      }
+      load_ms.push_back(std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - start)
+                            .count());
+      uploaded = texture->uploaded_bytes;
+      decoded  = texture->decoded;
+      destroy_texture(*allocator, *texture);
+    }
+    std::filesystem::remove(path);
+    if (load_ms.empty()) {
+      report.emplace_back(key + "_supported", "false");
+      continue;
+    }
+    report.emplace_back(key + "_load_ms", json_stats(load_ms));
+    report.emplace_back(key + "_uploaded_bytes",
+                        json_number(static_cast<double>(uploaded)));
+    const auto level0_bytes = static_cast<double>(
+        texture_level_size(format, texture_size, texture_size, 0));
+    report.emplace_back(key + "_level0_vs_rgba8",
+                        json_number(level0_bytes / rgba8_bytes));
+    report.emplace_back(key + "_decoded", decoded ? "true" : "false");
+  }
+
+  // Level 0 only, the file asks for the rest to be generated.
+  const auto source_path = directory / "generated.ktx2";
+  if (!write_ktx2(source_path, TextureFormat::eR8G8B8A8Srgb, texture_size,
+                  texture_size,
+                  create_random_levels(TextureFormat::eR8G8B8A8Srgb,
+                                       level_count, true),
+                  true)) {
+    return report;
+  }
+  const auto source = open_ktx2(source_path);
+  std::filesystem::remove(source_path);
+  auto texture =
+      source ? create_ktx2_texture(*allocator, context.physical_device,
+                                   context.queue, context.queue_family_index,
+                                   *source)
+             : std::nullopt;
+  auto timer = create_gpu_frame_timer(context, 1);
+  if (!texture || !timer) {
+    return report;
+  }
+  report.emplace_back("generated_levels",
+                      json_number(static_cast<double>(texture->level_count)));
+  const auto filter =
+      supports_format_features(
+          context.physical_device, texture->format,
+          vk::FormatFeatureFlagBits::eSampledImageFilterLinear)
+          ? vk::Filter::eLinear
+          : vk::Filter::eNearest;
+  // Level 0 keeps its texels, the rest are about to be overwritten.
+  vk::ImageMemoryBarrier imageBarrier;
+  imageBarrier.srcAccessMask       = vk::AccessFlagBits::eShaderRead;
+  imageBarrier.dstAccessMask       = vk::AccessFlagBits::eTransferWrite |
+                               vk::AccessFlagBits::eTransferRead;
+  imageBarrier.oldLayout           = vk::ImageLayout::eShaderReadOnlyOptimal;
+  imageBarrier.newLayout           = vk::ImageLayout::eTransferDstOptimal;
+  imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  imageBarrier.image               = texture->image.image.get();
+  imageBarrier.subresourceRange    = vk::ImageSubresourceRange{
+      vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0,
+      VK_REMAINING_ARRAY_LAYERS};
+  const auto record = [&](const vk::CommandBuffer& command_buffer) {
+    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader,
+                                   vk::PipelineStageFlagBits::eTransfer, {},
+                                   {}, {}, imageBarrier);
+    begin_gpu_frame_timer(*timer, command_buffer, 0);
+    record_mip_generation(command_buffer, texture->image.image.get(),
+                          texture->extent, texture->level_count,
+                          texture->layer_count, filter);
+    end_gpu_frame_timer(*timer, command_buffer, 0);
+  };
+  auto generate_ms = std::vector<double>{};
+  const auto runs  = texture->level_count > 1 ? options.frames : 0;
+  for ([[maybe_unused]] const auto run : std::views::iota(0uz, runs)) {
+    submit_immediate(device, context.queue, context.queue_family_index,
+                     record);
+    if (const auto time = collect_gpu_frame_time(device, *timer, 0)) {
+      generate_ms.push_back(*time);
+    }
+  }
+  report.emplace_back("mip_generation_gpu_ms", json_stats(generate_ms));
+
+  destroy_texture(*allocator, *texture);
+  return report;
+}
@@ -0,0 +1,112 @@
+#include <chrono>
+#include <ranges>
+
+#include "bench.hpp"
+#include "offscreen.hpp"
+
+// N instances of the same triangle scales vertex and fragment load without
+// needing any geometry of our own.
+BenchReport run_triangles_scene(BenchContext& context,
+                                const BenchOptions& options) {
+  const auto& device = context.device();
+  const auto shaders = load_bench_shaders(device);
+  if (shaders.empty()) {
+    return {};
+  }
+  const auto render_pass = create_offscreen_render_pass(device);
+  const auto targets =
+      create_offscreen_targets(context.physical_device, device, render_pass,
+                               options.frames_in_flight);
+  const auto layout            = create_fixed_function_pipeline(device);
+  const auto graphics_pipeline =
+      create_graphics_pipeline(device, render_pass, layout, shaders);
+  auto frame_ring = create_frame_ring(device, context.queue_family_index, 0,
+                                      options.frames_in_flight);
+  auto gpu_timer = create_gpu_frame_timer(context, options.frames_in_flight);
+
+  auto cpu_frame_ms = std::vector<double>{};
+  auto gpu_frame_ms = std::vector<double>{};
+  cpu_frame_ms.reserve(options.frames);
+  gpu_frame_ms.reserve(options.frames);
+  auto measuring          = false;
+  const auto record_frame = [&](const vk::Framebuffer& frame_buffer,
+                                const vk::CommandBuffer& command_buffer) {
+    const auto slot = frame_ring.current;
+    if (gpu_timer) {
+      const auto gpu_ms = collect_gpu_frame_time(device, *gpu_timer, slot);
+      if (gpu_ms && measuring) {
+        gpu_frame_ms.push_back(*gpu_ms);
+      }
+    }
+    vk::CommandBufferBeginInfo commandBufferBeginInfo;
+    commandBufferBeginInfo.flags =
+        vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    command_buffer.begin(commandBufferBeginInfo);
+    if (gpu_timer) {
+      begin_gpu_frame_timer(*gpu_timer, command_buffer, slot);
+    }
+    record_render_pass(render_pass, graphics_pipeline, frame_buffer,
+                       command_buffer, options.instances);
+    if (gpu_timer) {
+      end_gpu_frame_timer(*gpu_timer, command_buffer, slot);
+    }
+    command_buffer.end();
+  };
+  const auto collect_remaining = [&] {
+    if (!gpu_timer) {
+      return;
+    }
+    for (const auto slot : std::views::iota(0uz, options.frames_in_flight)) {
+      const auto gpu_ms = collect_gpu_frame_time(device, *gpu_timer, slot);
+      if (gpu_ms && measuring) {
+        gpu_frame_ms.push_back(*gpu_ms);
+      }
+    }
+  };
+
+  for ([[maybe_unused]] const auto frame :
+       std::views::iota(0uz, options.warmup_frames)) {
+    draw_offscreen_frame(device, context.queue, targets, frame_ring,
+                         record_frame);
+  }
+  device.waitIdle();
+  collect_remaining();
+  measuring        = true;
+  const auto start = std::chrono::steady_clock::now();
+  for ([[maybe_unused]] const auto frame :
+       std::views::iota(0uz, options.frames)) {
+    const auto frame_start = std::chrono::steady_clock::now();
+    draw_offscreen_frame(device, context.queue, targets, frame_ring,
+                         record_frame);
+    cpu_frame_ms.push_back(std::chrono::duration<double, std::milli>(
+                               std::chrono::steady_clock::now() - frame_start)
+                               .count());
+  }
+  device.waitIdle();
+  const auto wall_seconds = std::chrono::duration<double>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+  // Pick up the frames that were still in flight when the loop ended.
+  collect_remaining();
+  drain_frame_ring(device, frame_ring);
+  device.destroyPipeline(graphics_pipeline);
+  device.destroyPipelineLayout(layout);
+  device.destroyRenderPass(render_pass);
+
+  const auto frames_per_second =
+      static_cast<double>(options.frames) / wall_seconds;
+  return {
+      {"width", json_number(render_extent.width)},
+      {"height", json_number(render_extent.height)},
+      {"frames", json_number(static_cast<double>(options.frames))},
+      {"instances", json_number(options.instances)},
+      {"frames_in_flight",
+       json_number(static_cast<double>(options.frames_in_flight))},
+      {"wall_seconds", json_number(wall_seconds)},
+      {"frames_per_second", json_number(frames_per_second)},
+      {"triangles_per_second",
+       json_number(frames_per_second * options.instances)},
+      {"cpu_frame_ms", json_stats(cpu_frame_ms)},
+      {"gpu_frame_ms", json_stats(gpu_frame_ms)},
+  };
+}
@@ -0,0 +1,220 @@
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "allocator.hpp"
+#include "bench.hpp"
+#include "gpu_driven.hpp"
+#include "offscreen.hpp"
+#include "upload_ring.hpp"
+
+enum class UploadMode { eRing, eAllocate };
+
+constexpr auto upload_modes = std::array{
+    std::pair{UploadMode::eRing, std::string_view{"ring"}},
+    std::pair{UploadMode::eAllocate, std::string_view{"allocate"}},
+};
+
+// Every object's transform uploaded again each frame and drawn through a
+// dynamic storage buffer, once bump allocated from the upload ring and once
+// from a host visible buffer created for the frame and destroyed with it.
+// upload_ms is the CPU time from asking for the memory to the flush.
+BenchReport run_upload_ring_scene(BenchContext& context,
+                                  const BenchOptions& options) {
+  const auto& device = context.device();
+  const auto shaders =
+      load_bench_shaders(device, "object.vert", "picante.frag");
+  if (shaders.empty()) {
+    return {};
+  }
+  const auto objects      = create_bench_objects(options.objects);
+  const auto transforms   = std::as_bytes(std::span{objects.transforms});
+  const auto upload_bytes = static_cast<vk::DeviceSize>(transforms.size());
+  auto allocator = create_device_allocator(context.physical_device, device);
+  auto ring = create_upload_ring(*allocator, context.physical_device,
+                                 options.frames_in_flight, upload_bytes);
+  if (!ring) {
+    std::cerr << "Failed to allocate the upload ring\n";
+    return {};
+  }
+  const auto render_pass = create_offscreen_render_pass(device);
+  const auto targets =
+      create_offscreen_targets(context.physical_device, device, render_pass,
+                               options.frames_in_flight);
+
+  const auto binding = vk::DescriptorSetLayoutBinding{
+      0, vk::DescriptorType::eStorageBufferDynamic, 1,
+      vk::ShaderStageFlagBits::eVertex};
+  vk::DescriptorSetLayoutCreateInfo setLayoutInfo;
+  setLayoutInfo.bindingCount = 1;
+  setLayoutInfo.pBindings    = &binding;
+  const auto set_layout = device.createDescriptorSetLayoutUnique(setLayoutInfo);
+  const auto layout     = create_push_constant_layout(
+      device, set_layout.get(),
+      vk::PushConstantRange{vk::ShaderStageFlagBits::eVertex, 0,
+                            sizeof(Mat4)});
+  auto description          = GraphicsPipelineDescription{};
+  description.render_pass   = render_pass;
+  description.layout        = layout.get();
+  description.shader_stages = shaders;
+  description.cull_mode     = vk::CullModeFlagBits::eNone;
+  const auto pipeline       = vk::UniquePipeline{
+      create_graphics_pipeline(device, description), device};
+
+  // One set per slot, so the per frame buffers can be swapped in while the
+  // other slots are in flight. The ring's sets all point at the ring.
+  const auto set_count = static_cast<std::uint32_t>(options.frames_in_flight);
+  const auto pool_size =
+      vk::DescriptorPoolSize{vk::DescriptorType::eStorageBufferDynamic,
+                             set_count};
+  vk::DescriptorPoolCreateInfo descriptorPoolInfo;
+  descriptorPoolInfo.maxSets       = set_count;
+  descriptorPoolInfo.poolSizeCount = 1;
+  descriptorPoolInfo.pPoolSizes    = &pool_size;
+  const auto descriptor_pool =
+      device.createDescriptorPoolUnique(descriptorPoolInfo);
+  const auto set_layouts =
+      std::vector<vk::DescriptorSetLayout>(set_count, set_layout.get());
+  vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo;
+  descriptorSetAllocateInfo.descriptorPool     = descriptor_pool.get();
+  descriptorSetAllocateInfo.descriptorSetCount = set_layouts.size();
+  descriptorSetAllocateInfo.pSetLayouts        = set_layouts.data();
+  const auto sets = device.allocateDescriptorSets(descriptorSetAllocateInfo);
+  const auto point_set_at = [&](const vk::DescriptorSet& set,
+                                const vk::Buffer& buffer) {
+    const auto buffer_info = vk::DescriptorBufferInfo{buffer, 0, upload_bytes};
+    vk::WriteDescriptorSet write;
+    write.dstSet          = set;
+    write.dstBinding      = 0;
+    write.descriptorCount = 1;
+    write.descriptorType  = vk::DescriptorType::eStorageBufferDynamic;
+    write.pBufferInfo     = &buffer_info;
+    device.updateDescriptorSets(write, {});
+  };
+
+  auto report = BenchReport{
+      {"objects", json_number(options.objects)},
+      {"frames", json_number(static_cast<double>(options.frames))},
+      {"upload_bytes", json_number(static_cast<double>(upload_bytes))},
+  };
+  for (const auto& [mode, mode_name] : upload_modes) {
+    if (mode == UploadMode::eRing) {
+      for (const auto& set : sets) {
+        point_set_at(set, ring->buffer.buffer.get());
+      }
+    }
+    auto frame_ring = create_frame_ring(device, context.queue_family_index, 0,
+                                        options.frames_in_flight);
+    auto measuring    = false;
+    auto failed       = false;
+    auto upload_ms    = std::vector<double>{};
+    auto cpu_frame_ms = std::vector<double>{};
+    upload_ms.reserve(options.frames);
+    cpu_frame_ms.reserve(options.frames);
+    const auto record_frame = [&](const vk::Framebuffer& frame_buffer,
+                                  const vk::CommandBuffer& command_buffer) {
+      const auto slot         = frame_ring.current;
+      const auto upload_start = std::chrono::steady_clock::now();
+      auto dynamic_offset     = vk::DeviceSize{0};
+      if (mode == UploadMode::eRing) {
+        begin_upload_frame(*ring, slot);
+        const auto upload = upload_to_ring(*ring, transforms);
+        failed |= !upload;
+        dynamic_offset = upload ? upload->offset : 0;
+        flush_upload_frame(*ring);
+      } else {
+        auto buffer = create_buffer(*allocator, upload_bytes,
+                                    vk::BufferUsageFlagBits::eStorageBuffer,
+                                    vk::MemoryPropertyFlagBits::eHostVisible);
+        failed |= !buffer;
+        if (buffer) {
+          std::memcpy(buffer->allocation.mapped, transforms.data(),
+                      transforms.size());
+          flush_memory(*allocator, buffer->allocation);
+          point_set_at(sets[slot], buffer->buffer.get());
+          const auto retired =
+              std::make_shared<AllocatedBuffer>(std::move(*buffer));
+          defer_deletion(frame_ring, [&allocator, retired] {
+            destroy_buffer(*allocator, *retired);
+          });
+        }
+      }
+      if (measuring) {
+        upload_ms.push_back(std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - upload_start)
+                                .count());
+      }
+      vk::CommandBufferBeginInfo commandBufferBeginInfo;
+      commandBufferBeginInfo.flags =
+          vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+      command_buffer.begin(commandBufferBeginInfo);
+      begin_render_pass(render_pass, frame_buffer, command_buffer);
+      command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                                  pipeline.get());
+      command_buffer.bindDescriptorSets(
+          vk::PipelineBindPoint::eGraphics, layout.get(), 0, sets[slot],
+          static_cast<std::uint32_t>(dynamic_offset));
+      command_buffer.pushConstants<Mat4>(layout.get(),
+                                         vk::ShaderStageFlagBits::eVertex, 0,
+                                         objects.view_projection);
+      command_buffer.draw(3, options.objects, 0, 0);
+      command_buffer.endRenderPass();
+      command_buffer.end();
+    };
+    for ([[maybe_unused]] const auto frame :
+         std::views::iota(0uz, options.warmup_frames)) {
+      draw_offscreen_frame(device, context.queue, targets, frame_ring,
+                           record_frame);
+    }
+    device.waitIdle();
+    measuring        = true;
+    const auto start = std::chrono::steady_clock::now();
+    for ([[maybe_unused]] const auto frame :
+         std::views::iota(0uz, options.frames)) {
+      const auto frame_start = std::chrono::steady_clock::now();
+      draw_offscreen_frame(device, context.queue, targets, frame_ring,
+                           record_frame);
+      cpu_frame_ms.push_back(std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() - frame_start)
+                                 .count());
+    }
+    device.waitIdle();
+    const auto seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+    drain_frame_ring(device, frame_ring);
+    if (failed) {
+      std::cerr << "Failed to allocate upload memory\n";
+    }
+
+    const auto prefix = std::string{mode_name} + "_";
+    report.emplace_back(prefix + "fps", json_number(options.frames / seconds));
+    report.emplace_back(prefix + "cpu_frame_ms", json_stats(cpu_frame_ms));
+    report.emplace_back(prefix + "upload_ms", json_stats(upload_ms));
+    report.emplace_back(
+        prefix + "upload_gb_per_second",
+        json_number(static_cast<double>(options.frames * upload_bytes) /
+                    seconds / 1.0e9));
+  }
+  report.emplace_back(
+      "ring_bytes_per_frame",
+      json_number(static_cast<double>(ring->last_frame_bytes)));
+  report.emplace_back(
+      "ring_peak_bytes_per_frame",
+      json_number(static_cast<double>(ring->peak_frame_bytes)));
+  report.emplace_back(
+      "ring_overflows",
+      json_number(static_cast<double>(ring->overflow_count)));
+
+  destroy_upload_ring(*ring);
+  device.destroyRenderPass(render_pass);
+  return report;
+}
@@ -0,0 +1,112 @@
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <ranges>
+
+#include "bench.hpp"
+#include "offscreen.hpp"
+#include "queues.hpp"
+
+// Bytes streamed to the GPU every frame.
+constexpr std::size_t upload_bytes = 8 * 1024 * 1024;
+
+// Draws the triangle scene while uploading a fresh buffer every frame, first
+// blocking on the graphics queue the way create_buffer_with_data does and
+// then on the transfer queue with the frame waiting on a semaphore. CPU frame
+// time is where a blocking upload shows up.
+BenchReport run_uploads_scene(BenchContext& context,
+                              const BenchOptions& options) {
+  const auto& device = context.device();
+  const auto shaders = load_bench_shaders(device);
+  if (shaders.empty()) {
+    return {};
+  }
+  auto allocator = create_device_allocator(context.physical_device, device);
+  const auto render_pass = create_offscreen_render_pass(device);
+  const auto targets =
+      create_offscreen_targets(context.physical_device, device, render_pass,
+                               options.frames_in_flight);
+  const auto layout            = create_fixed_function_pipeline(device);
+  const auto graphics_pipeline =
+      create_graphics_pipeline(device, render_pass, layout, shaders);
+  auto frame_ring = create_frame_ring(device, context.queue_family_index, 0,
+                                      options.frames_in_flight);
+  const auto data = std::vector<std::byte>(upload_bytes);
+
+  const auto run = [&](const bool async) {
+    auto cpu_frame_ms       = std::vector<double>{};
+    auto pending            = std::optional<AsyncUpload>{};
+    const auto record_frame = [&](const vk::Framebuffer& frame_buffer,
+                                  const vk::CommandBuffer& command_buffer) {
+      vk::CommandBufferBeginInfo commandBufferBeginInfo;
+      commandBufferBeginInfo.flags =
+          vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+      command_buffer.begin(commandBufferBeginInfo);
+      if (pending) {
+        // Nothing reads it, retiring it with this frame is enough to keep
+        // the acquire honest.
+        const auto buffer = std::make_shared<AllocatedBuffer>(acquire_upload(
+            *allocator, frame_ring, command_buffer, std::move(*pending)));
+        pending.reset();
+        defer_deletion(frame_ring, [&allocator, buffer] {
+          destroy_buffer(*allocator, *buffer);
+        });
+      }
+      record_render_pass(render_pass, graphics_pipeline, frame_buffer,
+                         command_buffer, options.instances);
+      command_buffer.end();
+    };
+    const auto draw = [&] {
+      if (async) {
+        pending = upload_buffer_async(
+            *allocator, context.queues, data,
+            vk::BufferUsageFlagBits::eVertexBuffer,
+            vk::PipelineStageFlagBits::eVertexInput,
+            vk::AccessFlagBits::eVertexAttributeRead);
+      } else {
+        auto buffer = create_buffer_with_data(
+            *allocator, context.queue, context.queue_family_index, data,
+            vk::BufferUsageFlagBits::eVertexBuffer);
+        if (buffer) {
+          destroy_buffer(*allocator, *buffer);
+        }
+      }
+      draw_offscreen_frame(device, context.queue, targets, frame_ring,
+                           record_frame);
+    };
+    for ([[maybe_unused]] const auto frame :
+         std::views::iota(0uz, options.warmup_frames)) {
+      draw();
+    }
+    cpu_frame_ms.reserve(options.frames);
+    for ([[maybe_unused]] const auto frame :
+         std::views::iota(0uz, options.frames)) {
+      const auto frame_start = std::chrono::steady_clock::now();
+      draw();
+      cpu_frame_ms.push_back(std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() -
+                                 frame_start)
+                                 .count());
+    }
+    device.waitIdle();
+    return cpu_frame_ms;
+  };
+  const auto blocking = run(false);
+  const auto async    = run(true);
+
+  drain_frame_ring(device, frame_ring);
+  device.destroyPipeline(graphics_pipeline);
+  device.destroyPipelineLayout(layout);
+  device.destroyRenderPass(render_pass);
+
+  const auto& families = context.queues.families;
+  return {
+      {"upload_bytes", json_number(static_cast<double>(upload_bytes))},
+      {"frames", json_number(static_cast<double>(options.frames))},
+      {"graphics_family", json_number(families.graphics)},
+      {"transfer_family", json_number(families.transfer)},
+      {"compute_family", json_number(families.compute)},
+      {"blocking_cpu_frame_ms", json_stats(blocking)},
+      {"async_cpu_frame_ms", json_stats(async)},
+  };
+}
@@ -0,0 +1,238 @@
+#include "bindless.hpp"
+
+#include <algorithm>
+#include <array>
+
+DeviceFeatures bindless_features() {
+  auto features = DeviceFeatures{};
+  auto& vulkan12                = features.vulkan12;
+  vulkan12.descriptorIndexing   = VK_TRUE;
+  vulkan12.runtimeDescriptorArray = VK_TRUE;
+  // Most slots are empty most of the time.
+  vulkan12.descriptorBindingPartiallyBound = VK_TRUE;
+  // Registering a texture mustn't wait for frames in flight to finish.
+  vulkan12.descriptorBindingSampledImageUpdateAfterBind  = VK_TRUE;
+  vulkan12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+  vulkan12.descriptorBindingUpdateUnusedWhilePending     = VK_TRUE;
+  // Indices come from push constants, which are uniform, but compute
+  // shaders walking a list of objects index per invocation.
+  vulkan12.shaderSampledImageArrayNonUniformIndexing  = VK_TRUE;
+  vulkan12.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+  return features;
+}
+
+bool supports_bindless(const DeviceFeatures& enabled_features) {
+  const auto& vulkan12 = enabled_features.vulkan12;
+  return vulkan12.runtimeDescriptorArray &&
+         vulkan12.descriptorBindingPartiallyBound &&
+         vulkan12.descriptorBindingSampledImageUpdateAfterBind &&
+         vulkan12.descriptorBindingStorageBufferUpdateAfterBind &&
+         vulkan12.descriptorBindingUpdateUnusedWhilePending;
+}
+
+std::optional<std::uint32_t> allocate_descriptor_slot(DescriptorSlots& slots) {
+  if (!slots.free.empty()) {
+    const auto slot = slots.free.back();
+    slots.free.pop_back();
+    return slot;
+  }
+  if (slots.next == slots.capacity) {
+    return std::nullopt;
+  }
+  return slots.next++;
+}
+
+void free_descriptor_slot(DescriptorSlots& slots, const std::uint32_t slot) {
+  slots.free.push_back(slot);
+}
+
+BindlessHeap create_bindless_heap(const vk::PhysicalDevice& physical_device,
+                                  const vk::Device& logical_device,
+                                  const std::uint32_t image_count,
+                                  const std::uint32_t buffer_count) {
+  const auto properties =
+      physical_device.getProperties2<vk::PhysicalDeviceProperties2,
+                                     vk::PhysicalDeviceVulkan12Properties>();
+  const auto& limits = properties.get<vk::PhysicalDeviceVulkan12Properties>();
+  // Both arrays are visible to every stage, so they split the per stage
+  // resource limit between them.
+  const auto per_stage = limits.maxPerStageUpdateAfterBindResources / 2;
+  auto heap            = BindlessHeap{};
+  heap.images.capacity = std::min(
+      {image_count, per_stage,
+       limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+       limits.maxDescriptorSetUpdateAfterBindSampledImages});
+  heap.buffers.capacity = std::min(
+      {buffer_count, per_stage,
+       limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+       limits.maxDescriptorSetUpdateAfterBindStorageBuffers});
+
+  vk::SamplerCreateInfo samplerInfo;
+  samplerInfo.magFilter    = vk::Filter::eLinear;
+  samplerInfo.minFilter    = vk::Filter::eLinear;
+  samplerInfo.mipmapMode   = vk::SamplerMipmapMode::eLinear;
+  samplerInfo.addressModeU = vk::SamplerAddressMode::eRepeat;
+  samplerInfo.addressModeV = vk::SamplerAddressMode::eRepeat;
+  samplerInfo.addressModeW = vk::SamplerAddressMode::eRepeat;
+  samplerInfo.maxLod       = VK_LOD_CLAMP_NONE;
+  heap.sampler             = logical_device.createSamplerUnique(samplerInfo);
+
+  const auto stages = vk::ShaderStageFlagBits::eVertex |
+                      vk::ShaderStageFlagBits::eFragment |
+                      vk::ShaderStageFlagBits::eCompute;
+  const auto sampler  = heap.sampler.get();
+  const auto bindings = std::array{
+      vk::DescriptorSetLayoutBinding{bindless_image_binding,
+                                     vk::DescriptorType::eSampledImage,
+                                     heap.images.capacity, stages},
+      vk::DescriptorSetLayoutBinding{bindless_buffer_binding,
+                                     vk::DescriptorType::eStorageBuffer,
+                                     heap.buffers.capacity, stages},
+      vk::DescriptorSetLayoutBinding{bindless_sampler_binding,
+                                     vk::DescriptorType::eSampler, 1, stages,
+                                     &sampler},
+  };
+  const auto array_flags =
+      vk::DescriptorBindingFlagBits::ePartiallyBound |
+      vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+      vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+  const auto binding_flags =
+      std::array<vk::DescriptorBindingFlags, 3>{array_flags, array_flags, {}};
+  vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo;
+  bindingFlagsInfo.bindingCount  = binding_flags.size();
+  bindingFlagsInfo.pBindingFlags = binding_flags.data();
+  vk::DescriptorSetLayoutCreateInfo setLayoutInfo;
+  setLayoutInfo.pNext = &bindingFlagsInfo;
+  setLayoutInfo.flags =
+      vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool;
+  setLayoutInfo.bindingCount = bindings.size();
+  setLayoutInfo.pBindings    = bindings.data();
+  heap.set_layout =
+      logical_device.createDescriptorSetLayoutUnique(setLayoutInfo);
+
+  const auto pool_sizes = std::array{
+      vk::DescriptorPoolSize{vk::DescriptorType::eSampledImage,
+                             heap.images.capacity},
+      vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer,
+                             heap.buffers.capacity},
+      vk::DescriptorPoolSize{vk::DescriptorType::eSampler, 1},
+  };
+  vk::DescriptorPoolCreateInfo descriptorPoolInfo;
+  descriptorPoolInfo.flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind;
+  descriptorPoolInfo.maxSets       = 1;
+  descriptorPoolInfo.poolSizeCount = pool_sizes.size();
+  descriptorPoolInfo.pPoolSizes    = pool_sizes.data();
+  heap.pool = logical_device.createDescriptorPoolUnique(descriptorPoolInfo);
+  const auto set_layout = heap.set_layout.get();
+  vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo;
+  descriptorSetAllocateInfo.descriptorPool     = heap.pool.get();
+  descriptorSetAllocateInfo.descriptorSetCount = 1;
+  descriptorSetAllocateInfo.pSetLayouts        = &set_layout;
+  heap.set =
+      logical_device.allocateDescriptorSets(descriptorSetAllocateInfo).front();
+
+  const auto push_constants =
+      vk::PushConstantRange{stages, 0, sizeof(BindlessConstants)};
+  vk::PipelineLayoutCreateInfo layoutInfo;
+  layoutInfo.setLayoutCount         = 1;
+  layoutInfo.pSetLayouts            = &set_layout;
+  layoutInfo.pushConstantRangeCount = 1;
+  layoutInfo.pPushConstantRanges    = &push_constants;
+  heap.pipeline_layout = logical_device.createPipelineLayoutUnique(layoutInfo);
+  return heap;
+}
+
+std::optional<std::uint32_t>
+register_bindless_image(BindlessHeap& heap, const vk::Device& logical_device,
+                        const vk::ImageView& image_view,
+                        const vk::ImageLayout layout) {
+  const auto slot = allocate_descriptor_slot(heap.images);
+  if (!slot) {
+    return std::nullopt;
+  }
+  const auto image_info = vk::DescriptorImageInfo{{}, image_view, layout};
+  vk::WriteDescriptorSet write;
+  write.dstSet          = heap.set;
+  write.dstBinding      = bindless_image_binding;
+  write.dstArrayElement = *slot;
+  write.descriptorCount = 1;
+  write.descriptorType  = vk::DescriptorType::eSampledImage;
+  write.pImageInfo      = &image_info;
+  logical_device.updateDescriptorSets(write, {});
+  return slot;
+}
+
+std::optional<std::uint32_t>
+register_bindless_buffer(BindlessHeap& heap, const vk::Device& logical_device,
+                         const vk::Buffer& buffer, const vk::DeviceSize offset,
+                         const vk::DeviceSize range) {
+  const auto slot = allocate_descriptor_slot(heap.buffers);
+  if (!slot) {
+    return std::nullopt;
+  }
+  const auto buffer_info = vk::DescriptorBufferInfo{buffer, offset, range};
+  vk::WriteDescriptorSet write;
+  write.dstSet          = heap.set;
+  write.dstBinding      = bindless_buffer_binding;
+  write.dstArrayElement = *slot;
+  write.descriptorCount = 1;
+  write.descriptorType  = vk::DescriptorType::eStorageBuffer;
+  write.pBufferInfo     = &buffer_info;
+  logical_device.updateDescriptorSets(write, {});
+  return slot;
+}
+
+void release_bindless_image(BindlessHeap& heap, FrameRing& frame_ring,
+                            const std::uint32_t slot) {
+  defer_deletion(frame_ring,
+                 [&heap, slot] { free_descriptor_slot(heap.images, slot); });
+}
+
+void release_bindless_buffer(BindlessHeap& heap, FrameRing& frame_ring,
+                             const std::uint32_t slot) {
+  defer_deletion(frame_ring,
+                 [&heap, slot] { free_descriptor_slot(heap.buffers, slot); });
+}
+
+void bind_bindless_heap(const BindlessHeap& heap,
+                        const vk::CommandBuffer& command_buffer,
+                        const vk::PipelineBindPoint bind_point) {
+  command_buffer.bindDescriptorSets(bind_point, heap.pipeline_layout.get(), 0,
+                                    heap.set, {});
+}
+
+vk::Pipeline create_bindless_pipeline(
+    const vk::Device& logical_device, const BindlessHeap& heap,
+    const vk::RenderPass& render_pass,
+    const std::vector<vk::PipelineShaderStageCreateInfo>& shader_stages,
+    const vk::PipelineCache& pipeline_cache) {
+  auto description          = GraphicsPipelineDescription{};
+  description.render_pass   = render_pass;
+  description.layout        = heap.pipeline_layout.get();
+  description.shader_stages = shader_stages;
+  // Same scattered triangles as the GPU driven scene, both faces count.
+  description.cull_mode = vk::CullModeFlagBits::eNone;
+  return create_graphics_pipeline(logical_device, description, pipeline_cache);
+}
+
+void record_bindless_draws(const BindlessHeap& heap,
+                           const vk::Pipeline& pipeline,
+                           const vk::CommandBuffer& command_buffer,
+                           const Mat4& view_projection,
+                           const std::span<const BindlessDraw> draws) {
+  const auto layout = heap.pipeline_layout.get();
+  const auto stages = vk::ShaderStageFlagBits::eVertex |
+                      vk::ShaderStageFlagBits::eFragment |
+                      vk::ShaderStageFlagBits::eCompute;
+  command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+  bind_bindless_heap(heap, command_buffer);
+  command_buffer.pushConstants(layout, stages,
+                               offsetof(BindlessConstants, view_projection),
+                               sizeof(Mat4), &view_projection);
+  for (const auto& draw : draws) {
+    command_buffer.pushConstants(layout, stages,
+                                 offsetof(BindlessConstants, draw),
+                                 sizeof(BindlessDraw), &draw);
+    command_buffer.draw(3, 1, 0, 0);
+  }
+}
@@ -0,0 +1,22 @@
+#version 460
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragUv;
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform texture2D textures[];
+layout(set = 0, binding = 2) uniform sampler linear_sampler;
+
+layout(push_constant) uniform Constants {
+  mat4 view_projection;
+  uint object;
+  uint transform_buffer;
+  uint texture_index;
+};
+
+void main() {
+  const vec4 texel =
+      texture(sampler2D(textures[texture_index], linear_sampler), fragUv);
+  outColor = vec4(fragColor, 1.0) * texel;
+}
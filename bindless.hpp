@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "math.hpp"
+#include "picante.hpp"
+
+// One descriptor set holding every texture and storage buffer there is, bound
+// once per command buffer. Draws find their resources by array index through
+// push constants instead of binding descriptor sets of their own, so a
+// thousand differently textured objects cost a thousand push constants and
+// draws and nothing else.
+
+// Descriptor indexing features the heap can't do without.
+DeviceFeatures bindless_features();
+bool supports_bindless(const DeviceFeatures& enabled_features);
+
+// Asked for, the device's update-after-bind limits may cut them down.
+constexpr std::uint32_t max_bindless_images  = 16384;
+constexpr std::uint32_t max_bindless_buffers = 16384;
+
+// Matching bindless.vert and bindless.frag.
+constexpr std::uint32_t bindless_image_binding   = 0;
+constexpr std::uint32_t bindless_buffer_binding  = 1;
+constexpr std::uint32_t bindless_sampler_binding = 2;
+
+// Hands out array indices and takes them back. Freed ones are reused first so
+// the used part of the array stays dense.
+struct DescriptorSlots {
+  std::uint32_t capacity = 0;
+  std::uint32_t next     = 0;
+  std::vector<std::uint32_t> free;
+};
+
+std::optional<std::uint32_t> allocate_descriptor_slot(DescriptorSlots& slots);
+void free_descriptor_slot(DescriptorSlots& slots, const std::uint32_t slot);
+
+// The per draw part of the push constant block, pushed after the view
+// projection matrix at offset 64.
+struct BindlessDraw {
+  // Index into the transforms buffer.
+  std::uint32_t object = 0;
+  // Heap slots.
+  std::uint32_t transforms = 0;
+  std::uint32_t texture    = 0;
+  std::uint32_t reserved   = 0;
+};
+
+struct BindlessConstants {
+  Mat4 view_projection;
+  BindlessDraw draw;
+};
+static_assert(sizeof(BindlessConstants) == 80);
+
+struct BindlessHeap {
+  // Immutable, every texture is sampled the same way.
+  vk::UniqueSampler sampler;
+  vk::UniqueDescriptorSetLayout set_layout;
+  vk::UniqueDescriptorPool pool;
+  vk::DescriptorSet set;
+  vk::UniquePipelineLayout pipeline_layout;
+  DescriptorSlots images;
+  DescriptorSlots buffers;
+};
+
+BindlessHeap
+create_bindless_heap(const vk::PhysicalDevice& physical_device,
+                     const vk::Device& logical_device,
+                     const std::uint32_t image_count  = max_bindless_images,
+                     const std::uint32_t buffer_count = max_bindless_buffers);
+
+// Writes the descriptor into a free slot and returns the slot, nullopt when
+// the heap is full. Update after bind makes that fine while command buffers
+// using the heap are pending, but the heap isn't thread safe, register and
+// release from the render thread only.
+std::optional<std::uint32_t> register_bindless_image(
+    BindlessHeap& heap, const vk::Device& logical_device,
+    const vk::ImageView& image_view,
+    const vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+std::optional<std::uint32_t>
+register_bindless_buffer(BindlessHeap& heap, const vk::Device& logical_device,
+                         const vk::Buffer& buffer,
+                         const vk::DeviceSize offset = 0,
+                         const vk::DeviceSize range  = VK_WHOLE_SIZE);
+
+// The slot is handed out again only once the frame being recorded is done,
+// frames still in flight may read it.
+void release_bindless_image(BindlessHeap& heap, FrameRing& frame_ring,
+                            const std::uint32_t slot);
+void release_bindless_buffer(BindlessHeap& heap, FrameRing& frame_ring,
+                             const std::uint32_t slot);
+
+void bind_bindless_heap(
+    const BindlessHeap& heap, const vk::CommandBuffer& command_buffer,
+    const vk::PipelineBindPoint bind_point = vk::PipelineBindPoint::eGraphics);
+
+vk::Pipeline create_bindless_pipeline(
+    const vk::Device& logical_device, const BindlessHeap& heap,
+    const vk::RenderPass& render_pass,
+    const std::vector<vk::PipelineShaderStageCreateInfo>& shader_stages,
+    const vk::PipelineCache& pipeline_cache = {});
+
+// Draws bindless.vert's triangle once per entry, inside a render pass. The
+// heap is bound and the matrix pushed once, each draw only pushes its
+// indices.
+void record_bindless_draws(const BindlessHeap& heap,
+                           const vk::Pipeline& pipeline,
+                           const vk::CommandBuffer& command_buffer,
+                           const Mat4& view_projection,
+                           const std::span<const BindlessDraw> draws);
@@ -0,0 +1,32 @@
+#version 460
+#extension GL_EXT_nonuniform_qualifier : require
+
+// object.vert's triangle, with its transform found through the bindless heap
+// rather than a descriptor set of its own. See bindless.hpp.
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragUv;
+
+layout(std430, set = 0, binding = 1) readonly buffer Transforms {
+  mat4 transforms[];
+} buffers[];
+
+layout(push_constant) uniform Constants {
+  mat4 view_projection;
+  uint object;
+  uint transform_buffer;
+  uint texture_index;
+};
+
+vec2 positions[3] = vec2[](vec2(0.0, -0.5), vec2(0.5, 0.5), vec2(-0.5, 0.5));
+
+vec3 colors[3] =
+    vec3[](vec3(1.0, 0.0, 0.0), vec3(0.0, 1.0, 0.0), vec3(0.0, 0.0, 1.0));
+
+void main() {
+  const vec4 position  = vec4(positions[gl_VertexIndex], 0.0, 1.0);
+  const mat4 transform = buffers[transform_buffer].transforms[object];
+  gl_Position = view_projection * transform * position;
+  fragColor   = colors[gl_VertexIndex];
+  fragUv      = positions[gl_VertexIndex] + 0.5;
+}
@@ -0,0 +1,130 @@
+#include "cpu_profiler.hpp"
+
+#include <condition_variable>
+#include <string>
+
+struct ZoneRegistry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ZoneBuffer>> buffers;
+};
+
+ZoneRegistry& zone_registry() {
+  // Leaked on purpose, threads may still record zones during static
+  // destruction.
+  static auto* const registry = new ZoneRegistry{};
+  return *registry;
+}
+
+ZoneBuffer* register_zone_buffer() {
+  auto& registry  = zone_registry();
+  const auto lock = std::scoped_lock{registry.mutex};
+  auto& buffer =
+      registry.buffers.emplace_back(std::make_unique<ZoneBuffer>());
+  buffer->thread_name = "thread " + std::to_string(registry.buffers.size());
+  return buffer.get();
+}
+
+void set_zone_thread_name(const std::string_view name) {
+  auto& buffer    = thread_zone_buffer();
+  const auto lock = std::scoped_lock{zone_registry().mutex};
+  buffer.thread_name = name;
+}
+
+std::uint64_t dropped_zone_count() {
+  auto& registry  = zone_registry();
+  const auto lock = std::scoped_lock{registry.mutex};
+  auto dropped    = std::uint64_t{0};
+  for (const auto& buffer : registry.buffers) {
+    dropped += buffer->dropped.load(std::memory_order_relaxed);
+  }
+  return dropped;
+}
+
+void update_zone_clock_rate(CpuTraceCollector& collector) {
+#if defined(__x86_64__)
+  // Assumes an invariant TSC, which anything from the last decade has.
+  const auto ticks   = read_zone_clock();
+  const auto time    = std::chrono::steady_clock::now();
+  const auto elapsed = std::chrono::duration<double, std::micro>(
+                           time - collector.origin_time)
+                           .count();
+  if (elapsed > 1000.0) {
+    collector.ticks_per_us =
+        static_cast<double>(ticks - collector.origin_ticks) / elapsed;
+  }
+#else
+  collector.ticks_per_us = 1.0e-6 / std::chrono::duration<double>(
+                                        std::chrono::steady_clock::duration{1})
+                                        .count();
+#endif
+}
+
+double zone_time_us(const CpuTraceCollector& collector,
+                    const std::uint64_t ticks) {
+  const auto since_origin =
+      static_cast<double>(static_cast<std::int64_t>(ticks -
+                                                    collector.origin_ticks)) /
+      collector.ticks_per_us;
+  return trace_time_us(collector.origin_time) + since_origin;
+}
+
+void drain_zone_buffers(CpuTraceCollector& collector) {
+  update_zone_clock_rate(collector);
+  auto& registry        = zone_registry();
+  const auto lock       = std::scoped_lock{registry.mutex};
+  const auto event_lock = std::scoped_lock{collector.mutex};
+  for (const auto& buffer : registry.buffers) {
+    const auto head = buffer->head.load(std::memory_order_acquire);
+    auto tail       = buffer->tail.load(std::memory_order_relaxed);
+    for (; tail != head; ++tail) {
+      const auto& zone = buffer->events[tail % zone_buffer_capacity];
+      if (collector.events.size() < collector.max_events) {
+        const auto start_us = zone_time_us(collector, zone.begin);
+        collector.events.push_back({zone.name, buffer->thread_name, start_us,
+                                    zone_time_us(collector, zone.end) -
+                                        start_us});
+      }
+    }
+    buffer->tail.store(tail, std::memory_order_release);
+  }
+}
+
+std::unique_ptr<CpuTraceCollector>
+start_cpu_trace_collector(const std::chrono::milliseconds period) {
+  auto collector          = std::make_unique<CpuTraceCollector>();
+  collector->origin_ticks = read_zone_clock();
+  collector->origin_time  = std::chrono::steady_clock::now();
+  // Zones recorded before collection started would land before the origin,
+  // throw them away.
+  {
+    auto& registry  = zone_registry();
+    const auto lock = std::scoped_lock{registry.mutex};
+    for (const auto& buffer : registry.buffers) {
+      buffer->tail.store(buffer->head.load(std::memory_order_acquire),
+                         std::memory_order_release);
+    }
+  }
+  collector->thread = std::jthread{[&collector = *collector,
+                                    period](const std::stop_token stop_token) {
+    set_zone_thread_name("trace collector");
+    auto wake_mutex = std::mutex{};
+    auto wake       = std::condition_variable_any{};
+    auto lock       = std::unique_lock{wake_mutex};
+    const auto stopping = [&stop_token] { return stop_token.stop_requested(); };
+    while (!wake.wait_for(lock, stop_token, period, stopping)) {
+      drain_zone_buffers(collector);
+    }
+  }};
+  return collector;
+}
+
+std::vector<TraceEvent>
+finish_cpu_trace_collector(CpuTraceCollector& collector) {
+  collector.thread.request_stop();
+  if (collector.thread.joinable()) {
+    collector.thread.join();
+  }
+  drain_zone_buffers(collector);
+  const auto lock = std::scoped_lock{collector.mutex};
+  return std::move(collector.events);
+}
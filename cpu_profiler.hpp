@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+#include "trace.hpp"
+
+// Scoped CPU zones, e.g.
+//
+//   PICANTE_ZONE("acquire");
+//
+// times everything until the end of the enclosing block. Zones are written to
+// a ring owned by the calling thread without taking any lock, and a
+// collector thread drains the rings into trace events. Built without
+// PICANTE_PROFILING the macro expands to nothing.
+
+// Per thread ring capacity, in zones. Zones recorded while the ring is full
+// are dropped rather than blocking the thread.
+constexpr std::size_t zone_buffer_capacity = 16384;
+
+struct ZoneEvent {
+  // Must outlive the collector, string literals in practice.
+  const char* name    = nullptr;
+  std::uint64_t begin = 0;
+  std::uint64_t end   = 0;
+};
+
+// Single producer, single consumer. Only the owning thread moves head and
+// only the collector moves tail.
+struct ZoneBuffer {
+  std::array<ZoneEvent, zone_buffer_capacity> events;
+  alignas(64) std::atomic<std::uint64_t> head{0};
+  alignas(64) std::atomic<std::uint64_t> tail{0};
+  std::atomic<std::uint64_t> dropped{0};
+  std::string thread_name;
+};
+
+// Raw ticks, the TSC where there is one. Converted to steady_clock time by
+// the collector.
+inline std::uint64_t read_zone_clock() {
+#if defined(__x86_64__)
+  return __rdtsc();
+#else
+  return static_cast<std::uint64_t>(
+      std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// Allocates and registers the calling thread's ring. Rings are never freed,
+// so zones from threads that have since exited still make it into the trace.
+ZoneBuffer* register_zone_buffer();
+
+inline ZoneBuffer& thread_zone_buffer() {
+  thread_local ZoneBuffer* const buffer = register_zone_buffer();
+  return *buffer;
+}
+
+// Names the calling thread's track in the trace.
+void set_zone_thread_name(const std::string_view name);
+
+inline void record_zone(const char* name, const std::uint64_t begin,
+                        const std::uint64_t end) {
+  auto& buffer    = thread_zone_buffer();
+  const auto head = buffer.head.load(std::memory_order_relaxed);
+  if (head - buffer.tail.load(std::memory_order_acquire) >=
+      zone_buffer_capacity) {
+    // Only this thread ever writes it, no need for an atomic add.
+    buffer.dropped.store(buffer.dropped.load(std::memory_order_relaxed) + 1,
+                         std::memory_order_relaxed);
+    return;
+  }
+  buffer.events[head % zone_buffer_capacity] = {name, begin, end};
+  buffer.head.store(head + 1, std::memory_order_release);
+}
+
+struct CpuZone {
+  explicit CpuZone(const char* name) : name{name}, begin{read_zone_clock()} {}
+  ~CpuZone() { record_zone(name, begin, read_zone_clock()); }
+  CpuZone(const CpuZone&)            = delete;
+  CpuZone& operator=(const CpuZone&) = delete;
+
+  const char* name;
+  std::uint64_t begin;
+};
+
+#define PICANTE_ZONE_CONCAT_INNER(a, b) a##b
+#define PICANTE_ZONE_CONCAT(a, b) PICANTE_ZONE_CONCAT_INNER(a, b)
+#ifdef PICANTE_PROFILING
+#define PICANTE_ZONE(name)                                                     \
+  const CpuZone PICANTE_ZONE_CONCAT(picante_zone_, __LINE__) { name }
+#else
+#define PICANTE_ZONE(name)
+#endif
+
+// Periodically drains every thread's ring into trace events on the
+// steady_clock timeline the GPU profiler uses too.
+struct CpuTraceCollector {
+  std::mutex mutex;
+  std::vector<TraceEvent> events;
+  std::size_t max_events = 1 << 22;
+  // Zone clock ticks and the steady_clock read together when collection
+  // started, the rate between the two is refined on every drain.
+  std::uint64_t origin_ticks = 0;
+  std::chrono::steady_clock::time_point origin_time;
+  double ticks_per_us = 1.0;
+  // Last so it is stopped before anything it uses is destroyed.
+  std::jthread thread;
+};
+
+std::unique_ptr<CpuTraceCollector> start_cpu_trace_collector(
+    const std::chrono::milliseconds period = std::chrono::milliseconds{10});
+
+// Stops the collector, drains whatever is left and hands over the events.
+std::vector<TraceEvent>
+finish_cpu_trace_collector(CpuTraceCollector& collector);
+
+// Zones dropped so far because a ring was full.
+std::uint64_t dropped_zone_count();
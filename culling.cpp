@@ -0,0 +1,302 @@
+#include "culling.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <ranges>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PICANTE_CULL_X86 1
+#endif
+
+// Nothing is this close to the near plane without covering the whole screen,
+// keeps the LOD division finite.
+constexpr auto min_lod_distance = 1e-3f;
+
+SceneObjects create_scene_objects(const std::span<const Vec4> bounds) {
+  const auto padded = (bounds.size() + cull_lane_count - 1) / cull_lane_count *
+                      cull_lane_count;
+  auto objects  = SceneObjects{};
+  objects.count = bounds.size();
+  objects.center_x.resize(padded);
+  objects.center_y.resize(padded);
+  objects.center_z.resize(padded);
+  // Nothing is ever within a negative infinite distance of every plane.
+  objects.radius.resize(padded, -std::numeric_limits<float>::infinity());
+  for (const auto [index, sphere] : std::views::enumerate(bounds)) {
+    objects.center_x[index] = sphere.x;
+    objects.center_y[index] = sphere.y;
+    objects.center_z[index] = sphere.z;
+    objects.radius[index]   = sphere.w;
+  }
+  return objects;
+}
+
+CullView create_cull_view(const Mat4& view_projection,
+                          const float viewport_height,
+                          const LodThresholds& lod_thresholds) {
+  // With a rigid view matrix the second row of the view projection is the
+  // view's up axis scaled by the projection's focal length.
+  const auto focal = length(Vec3{view_projection.at(0, 1),
+                                 view_projection.at(1, 1),
+                                 view_projection.at(2, 1)});
+  auto view           = CullView{};
+  view.frustum        = extract_frustum_planes(view_projection);
+  view.lod_scale      = focal * viewport_height;
+  view.lod_thresholds = lod_thresholds;
+  return view;
+}
+
+// Same operation order in every kernel so they agree on objects sitting
+// right on a plane.
+float plane_distance(const Vec4& plane, const float x, const float y,
+                     const float z) {
+  return plane.x * x + plane.y * y + plane.z * z + plane.w;
+}
+
+void cull_scalar(const SceneObjects& objects, const CullView& view,
+                 CullResult& result) {
+  auto count = std::size_t{0};
+  for (const auto index : std::views::iota(0uz, objects.center_x.size())) {
+    const auto x      = objects.center_x[index];
+    const auto y      = objects.center_y[index];
+    const auto z      = objects.center_z[index];
+    const auto radius = objects.radius[index];
+    auto visible      = true;
+    for (const auto& plane : view.frustum) {
+      visible &= plane_distance(plane, x, y, z) >= -radius;
+    }
+    const auto distance =
+        std::max(plane_distance(view.frustum[4], x, y, z), min_lod_distance);
+    const auto size = radius * view.lod_scale / distance;
+    auto lod        = 0u;
+    for (const auto threshold : view.lod_thresholds) {
+      lod += size < threshold;
+    }
+    // Written either way and only kept by moving count past it, branching
+    // on visibility mispredicts about as often as the frustum cuts the scene.
+    result.objects[count] = static_cast<std::uint32_t>(index);
+    result.lods[count]    = lod;
+    count += visible;
+  }
+  result.count = count;
+}
+
+#ifdef PICANTE_CULL_X86
+
+// For every mask of visible lanes, the lanes to move to the front in order.
+template <std::size_t lanes>
+constexpr auto make_compaction_table() {
+  auto table = std::array<std::array<std::uint32_t, lanes>, 1 << lanes>{};
+  for (auto mask = 0u; mask < table.size(); ++mask) {
+    auto out = 0u;
+    for (auto lane = 0u; lane < lanes; ++lane) {
+      if (mask & (1u << lane)) {
+        table[mask][out++] = lane;
+      }
+    }
+  }
+  return table;
+}
+
+constexpr auto avx2_compaction = make_compaction_table<8>();
+
+// pshufb wants bytes rather than lanes.
+constexpr auto sse4_compaction = [] {
+  const auto lanes = make_compaction_table<4>();
+  auto table       = std::array<std::array<std::uint8_t, 16>, 16>{};
+  for (auto mask = 0u; mask < table.size(); ++mask) {
+    for (auto lane = 0u; lane < 4; ++lane) {
+      for (auto byte = 0u; byte < 4; ++byte) {
+        table[mask][lane * 4 + byte] =
+            static_cast<std::uint8_t>(lanes[mask][lane] * 4 + byte);
+      }
+    }
+  }
+  return table;
+}();
+
+__attribute__((target("avx2"))) void
+cull_avx2(const SceneObjects& objects, const CullView& view,
+          CullResult& result) {
+  // Broadcast once up front. Plain arrays, std::array drops the vector
+  // types' alignment attributes.
+  __m256 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+  for (const auto [index, plane] : std::views::enumerate(view.frustum)) {
+    plane_x[index] = _mm256_set1_ps(plane.x);
+    plane_y[index] = _mm256_set1_ps(plane.y);
+    plane_z[index] = _mm256_set1_ps(plane.z);
+    plane_w[index] = _mm256_set1_ps(plane.w);
+  }
+  __m256 thresholds[max_mesh_lods - 1];
+  for (const auto [index, threshold] :
+       std::views::enumerate(view.lod_thresholds)) {
+    thresholds[index] = _mm256_set1_ps(threshold);
+  }
+  const auto lod_scale    = _mm256_set1_ps(view.lod_scale);
+  const auto min_distance = _mm256_set1_ps(min_lod_distance);
+  const auto lane_offsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+  auto count = std::size_t{0};
+  for (auto first = 0uz; first < objects.center_x.size();
+       first += cull_lane_count) {
+    const auto x      = _mm256_load_ps(&objects.center_x[first]);
+    const auto y      = _mm256_load_ps(&objects.center_y[first]);
+    const auto z      = _mm256_load_ps(&objects.center_z[first]);
+    const auto radius = _mm256_load_ps(&objects.radius[first]);
+    const auto negative_radius =
+        _mm256_sub_ps(_mm256_setzero_ps(), radius);
+    auto visible  = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    auto distance = min_distance;
+    for (const auto plane : std::views::iota(0, 6)) {
+      const auto plane_distance = _mm256_add_ps(
+          _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(plane_x[plane], x),
+                                      _mm256_mul_ps(plane_y[plane], y)),
+                        _mm256_mul_ps(plane_z[plane], z)),
+          plane_w[plane]);
+      visible = _mm256_and_ps(
+          visible, _mm256_cmp_ps(plane_distance, negative_radius, _CMP_GE_OQ));
+      if (plane == 4) {
+        distance = _mm256_max_ps(plane_distance, min_distance);
+      }
+    }
+    const auto mask = static_cast<std::uint32_t>(_mm256_movemask_ps(visible));
+    if (mask == 0) {
+      continue;
+    }
+
+    const auto size =
+        _mm256_div_ps(_mm256_mul_ps(radius, lod_scale), distance);
+    // Comparisons are all ones where true, so subtracting them counts.
+    auto lod = _mm256_setzero_si256();
+    for (const auto& threshold : thresholds) {
+      lod = _mm256_sub_epi32(
+          lod, _mm256_castps_si256(_mm256_cmp_ps(size, threshold, _CMP_LT_OQ)));
+    }
+
+    const auto permutation = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(avx2_compaction[mask].data()));
+    const auto indices = _mm256_add_epi32(
+        _mm256_set1_epi32(static_cast<int>(first)), lane_offsets);
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(&result.objects[count]),
+        _mm256_permutevar8x32_epi32(indices, permutation));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&result.lods[count]),
+                        _mm256_permutevar8x32_epi32(lod, permutation));
+    count += std::popcount(mask);
+  }
+  result.count = count;
+}
+
+__attribute__((target("sse4.1"))) void
+cull_sse4(const SceneObjects& objects, const CullView& view,
+          CullResult& result) {
+  __m128 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+  for (const auto [index, plane] : std::views::enumerate(view.frustum)) {
+    plane_x[index] = _mm_set1_ps(plane.x);
+    plane_y[index] = _mm_set1_ps(plane.y);
+    plane_z[index] = _mm_set1_ps(plane.z);
+    plane_w[index] = _mm_set1_ps(plane.w);
+  }
+  __m128 thresholds[max_mesh_lods - 1];
+  for (const auto [index, threshold] :
+       std::views::enumerate(view.lod_thresholds)) {
+    thresholds[index] = _mm_set1_ps(threshold);
+  }
+  const auto lod_scale    = _mm_set1_ps(view.lod_scale);
+  const auto min_distance = _mm_set1_ps(min_lod_distance);
+  const auto lane_offsets = _mm_setr_epi32(0, 1, 2, 3);
+
+  auto count = std::size_t{0};
+  for (auto first = 0uz; first < objects.center_x.size(); first += 4) {
+    const auto x      = _mm_load_ps(&objects.center_x[first]);
+    const auto y      = _mm_load_ps(&objects.center_y[first]);
+    const auto z      = _mm_load_ps(&objects.center_z[first]);
+    const auto radius = _mm_load_ps(&objects.radius[first]);
+    const auto negative_radius = _mm_sub_ps(_mm_setzero_ps(), radius);
+    auto visible  = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    auto distance = min_distance;
+    for (const auto plane : std::views::iota(0, 6)) {
+      const auto plane_distance =
+          _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(plane_x[plane], x),
+                                           _mm_mul_ps(plane_y[plane], y)),
+                                _mm_mul_ps(plane_z[plane], z)),
+                     plane_w[plane]);
+      visible =
+          _mm_and_ps(visible, _mm_cmpge_ps(plane_distance, negative_radius));
+      if (plane == 4) {
+        distance = _mm_max_ps(plane_distance, min_distance);
+      }
+    }
+    const auto mask = static_cast<std::uint32_t>(_mm_movemask_ps(visible));
+    if (mask == 0) {
+      continue;
+    }
+
+    const auto size = _mm_div_ps(_mm_mul_ps(radius, lod_scale), distance);
+    auto lod        = _mm_setzero_si128();
+    for (const auto& threshold : thresholds) {
+      lod = _mm_sub_epi32(lod,
+                          _mm_castps_si128(_mm_cmplt_ps(size, threshold)));
+    }
+
+    const auto shuffle = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(sse4_compaction[mask].data()));
+    const auto indices =
+        _mm_add_epi32(_mm_set1_epi32(static_cast<int>(first)), lane_offsets);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&result.objects[count]),
+                     _mm_shuffle_epi8(indices, shuffle));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&result.lods[count]),
+                     _mm_shuffle_epi8(lod, shuffle));
+    count += std::popcount(mask);
+  }
+  result.count = count;
+}
+
+#endif
+
+bool supports_cull_kernel(const CullKernel kernel) {
+  switch (kernel) {
+  case CullKernel::eScalar:
+    return true;
+#ifdef PICANTE_CULL_X86
+  case CullKernel::eSse4:
+    return __builtin_cpu_supports("sse4.1");
+  case CullKernel::eAvx2:
+    return __builtin_cpu_supports("avx2");
+#endif
+  default:
+    return false;
+  }
+}
+
+CullKernel best_cull_kernel() {
+  for (const auto kernel : {CullKernel::eAvx2, CullKernel::eSse4}) {
+    if (supports_cull_kernel(kernel)) {
+      return kernel;
+    }
+  }
+  return CullKernel::eScalar;
+}
+
+void cull_objects(const SceneObjects& objects, const CullView& view,
+                  CullResult& result, const CullKernel kernel) {
+  // The SIMD kernels store whole vectors past the last visible object, this
+  // leaves them room to.
+  result.objects.resize(objects.center_x.size());
+  result.lods.resize(objects.center_x.size());
+  switch (kernel) {
+#ifdef PICANTE_CULL_X86
+  case CullKernel::eAvx2:
+    cull_avx2(objects, view, result);
+    return;
+  case CullKernel::eSse4:
+    cull_sse4(objects, view, result);
+    return;
+#endif
+  default:
+    cull_scalar(objects, view, result);
+    return;
+  }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <span>
+#include <vector>
+
+#include "math.hpp"
+#include "mesh_format.hpp"
+
+// Frustum culling and LOD selection on the CPU, for when the GPU driven path
+// isn't available. Bounds are stored as structure of arrays so the kernels
+// load eight centers or radii in one go, and the visible objects come out
+// as a dense list ready to record draws from.
+
+// Widest kernel's lane count. Arrays are padded to a multiple of it with
+// objects no frustum contains, so kernels never deal with a remainder.
+constexpr std::size_t cull_lane_count = 8;
+
+// Allocates on cull_lane_count float boundaries, for aligned SIMD loads.
+template <typename T>
+struct CullAllocator {
+  using value_type = T;
+  static constexpr auto alignment =
+      std::align_val_t{cull_lane_count * sizeof(float)};
+
+  CullAllocator() = default;
+  template <typename U>
+  CullAllocator(const CullAllocator<U>&) {}
+
+  T* allocate(const std::size_t count) {
+    return static_cast<T*>(::operator new(count * sizeof(T), alignment));
+  }
+  void deallocate(T* pointer, const std::size_t) {
+    ::operator delete(pointer, alignment);
+  }
+  friend bool operator==(const CullAllocator&, const CullAllocator&) {
+    return true;
+  }
+};
+
+template <typename T>
+using CullArray = std::vector<T, CullAllocator<T>>;
+
+// World space bounding spheres, one entry per object in every array.
+struct SceneObjects {
+  std::size_t count = 0;
+  CullArray<float> center_x;
+  CullArray<float> center_y;
+  CullArray<float> center_z;
+  CullArray<float> radius;
+};
+
+// bounds are xyz center and w radius, as the GPU driven scene takes them.
+SceneObjects create_scene_objects(const std::span<const Vec4> bounds);
+
+// LOD i is picked while an object covers fewer than lod_thresholds[i - 1]
+// pixels of height, so thresholds go from large to small.
+using LodThresholds = std::array<float, max_mesh_lods - 1>;
+constexpr LodThresholds default_lod_thresholds = {128.0f, 32.0f, 8.0f};
+
+struct CullView {
+  Frustum frustum;
+  // Pixels covered per world unit of radius at unit distance past the near
+  // plane.
+  float lod_scale = 1.0f;
+  LodThresholds lod_thresholds = default_lod_thresholds;
+};
+
+CullView create_cull_view(const Mat4& view_projection,
+                          const float viewport_height,
+                          const LodThresholds& lod_thresholds =
+                              default_lod_thresholds);
+
+// Visible object indices in ascending order and the LOD picked for each.
+// Sized for every object being visible, only the first count entries mean
+// anything.
+struct CullResult {
+  CullArray<std::uint32_t> objects;
+  CullArray<std::uint32_t> lods;
+  std::size_t count = 0;
+};
+
+enum class CullKernel { eScalar, eSse4, eAvx2 };
+
+// The widest kernel the CPU we're running on supports.
+CullKernel best_cull_kernel();
+bool supports_cull_kernel(const CullKernel kernel);
+
+// result is resized as needed, so keeping it around from frame to frame means
+// no allocations after the first.
+void cull_objects(const SceneObjects& objects, const CullView& view,
+                  CullResult& result,
+                  const CullKernel kernel = best_cull_kernel());
@@ -0,0 +1,111 @@
+#include "frame_tasks.hpp"
+
+#include <algorithm>
+#include <ranges>
+#include <utility>
+
+#include "cpu_profiler.hpp"
+
+FrameTaskIndex add_frame_task(FrameTaskGraph& graph, FrameTask task) {
+  graph.tasks.push_back(std::move(task));
+  return static_cast<FrameTaskIndex>(graph.tasks.size() - 1);
+}
+
+FramePipeline create_frame_pipeline(JobSystem& jobs, FrameTaskGraph graph,
+                                    const std::size_t depth) {
+  auto pipeline  = FramePipeline{};
+  pipeline.jobs  = &jobs;
+  pipeline.graph = std::move(graph);
+  pipeline.depth = std::max<std::size_t>(depth, 1);
+  return pipeline;
+}
+
+// Nothing to wait for if the dependency has already finished.
+void add_frame_task_dependency(FrameTaskRun& dependency,
+                               FrameTaskRun& dependent) {
+  const auto lock = std::scoped_lock{dependency.mutex};
+  if (!dependency.finished) {
+    dependent.remaining.fetch_add(1);
+    dependency.dependents.push_back(&dependent);
+  }
+}
+
+void release_frame_task(FramePipeline& pipeline, FrameTaskRun& task_run);
+
+void run_frame_task(FramePipeline& pipeline, FrameTaskRun& task_run) {
+  const auto& task = pipeline.graph.tasks[task_run.index];
+  {
+    PICANTE_ZONE(task.name);
+    task.run(task_run.run->frame);
+  }
+  auto dependents = std::vector<FrameTaskRun*>{};
+  {
+    const auto lock   = std::scoped_lock{task_run.mutex};
+    task_run.finished = true;
+    dependents        = std::move(task_run.dependents);
+  }
+  // Dependents belong to this frame or the next, and neither is retired
+  // before this task's job has counted down.
+  for (auto* const dependent : dependents) {
+    release_frame_task(pipeline, *dependent);
+  }
+}
+
+void release_frame_task(FramePipeline& pipeline, FrameTaskRun& task_run) {
+  if (task_run.remaining.fetch_sub(1) != 1) {
+    return;
+  }
+  auto job = [&pipeline, &task_run] { run_frame_task(pipeline, task_run); };
+  if (pipeline.graph.tasks[task_run.index].main_thread) {
+    submit_main_thread_job(*pipeline.jobs, std::move(job),
+                           &task_run.run->done);
+  } else {
+    submit_job(*pipeline.jobs, std::move(job), &task_run.run->done);
+  }
+}
+
+// done only counts tasks that have been submitted, so it can read zero
+// while tasks waiting on the previous frame haven't been. Frames are retired
+// oldest first, and by the time the previous frame is retired every task of
+// this one has been submitted.
+std::uint64_t start_frame(FramePipeline& pipeline) {
+  while (pipeline.in_flight.size() >= pipeline.depth) {
+    wait_for_counter(*pipeline.jobs, pipeline.in_flight.front()->done, true);
+    pipeline.in_flight.pop_front();
+  }
+  const auto task_count = pipeline.graph.tasks.size();
+  auto run              = std::make_unique<FrameRun>();
+  run->frame            = pipeline.next_frame++;
+  run->tasks            = std::vector<FrameTaskRun>(task_count);
+  auto* const previous =
+      pipeline.in_flight.empty() ? nullptr : pipeline.in_flight.back().get();
+
+  // Every task is held back by one until all its dependencies are in place.
+  for (const auto index : std::views::iota(0uz, task_count)) {
+    auto& task_run = run->tasks[index];
+    task_run.run   = run.get();
+    task_run.index = static_cast<FrameTaskIndex>(index);
+    task_run.remaining.store(1);
+  }
+  for (const auto [index, task] : std::views::enumerate(pipeline.graph.tasks)) {
+    auto& task_run = run->tasks[index];
+    for (const auto dependency : task.dependencies) {
+      add_frame_task_dependency(run->tasks[dependency], task_run);
+    }
+    if (task.serial && previous != nullptr) {
+      add_frame_task_dependency(previous->tasks[index], task_run);
+    }
+  }
+  auto& started = *pipeline.in_flight.emplace_back(std::move(run));
+  for (auto& task_run : started.tasks) {
+    release_frame_task(pipeline, task_run);
+  }
+  return started.frame;
+}
+
+void finish_frames(FramePipeline& pipeline) {
+  while (!pipeline.in_flight.empty()) {
+    wait_for_counter(*pipeline.jobs, pipeline.in_flight.front()->done);
+    pipeline.in_flight.pop_front();
+  }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "jobs.hpp"
+
+// A frame as a graph of tasks run on the job system, with frames pipelined:
+// the next frame's tasks start as soon as their own dependencies allow
+// rather than once the whole previous frame is done, so frame N + 1's update
+// and culling overlap frame N's recording and submission.
+
+using FrameTaskIndex = std::uint32_t;
+
+struct FrameTask {
+  // A string literal, it names the task's profiler zone.
+  const char* name = nullptr;
+  std::function<void(std::uint64_t frame)> run;
+  // Earlier tasks of the same frame this one waits for.
+  std::vector<FrameTaskIndex> dependencies;
+  // GLFW and anything else tied to the main thread.
+  bool main_thread = false;
+  // Also waits for the same task of the previous frame. Tasks touching state
+  // that isn't kept per frame, the swapchain or the queue, need this.
+  bool serial = true;
+};
+
+struct FrameTaskGraph {
+  std::vector<FrameTask> tasks;
+};
+
+FrameTaskIndex add_frame_task(FrameTaskGraph& graph, FrameTask task);
+
+struct FrameRun;
+
+// One task of one frame in flight.
+struct FrameTaskRun {
+  FrameRun* run        = nullptr;
+  FrameTaskIndex index = 0;
+  // Dependencies not done yet, the task is submitted when it reaches zero.
+  std::atomic<std::uint32_t> remaining{0};
+  std::mutex mutex;
+  bool finished = false;
+  std::vector<FrameTaskRun*> dependents;
+};
+
+struct FrameRun {
+  std::uint64_t frame = 0;
+  std::vector<FrameTaskRun> tasks;
+  JobCounter done;
+};
+
+struct FramePipeline {
+  JobSystem* jobs = nullptr;
+  FrameTaskGraph graph;
+  // Frames allowed in flight at once. Per frame state a task keeps has to
+  // be indexed by frame % depth.
+  std::size_t depth        = 2;
+  std::uint64_t next_frame = 0;
+  std::deque<std::unique_ptr<FrameRun>> in_flight;
+};
+
+// Tasks hold on to the pipeline, it mustn't move while frames are in flight.
+FramePipeline create_frame_pipeline(JobSystem& jobs, FrameTaskGraph graph,
+                                    const std::size_t depth = 2);
+
+// Waits for the frame depth frames back, running main thread tasks
+// meanwhile, then starts the next one. Returns its number. Must be called
+// from the main thread, or main thread tasks never run.
+std::uint64_t start_frame(FramePipeline& pipeline);
+
+// Waits for every frame in flight.
+void finish_frames(FramePipeline& pipeline);
@@ -0,0 +1,314 @@
+#include "gpu_driven.hpp"
+
+#include <algorithm>
+#include <array>
+#include <ranges>
+#include <string>
+
+// Matches the push constant block in cull.comp.
+struct CullingConstants {
+  Frustum planes;
+  std::uint32_t object_count = 0;
+  std::uint32_t compact      = 0;
+  std::uint32_t index_count  = 0;
+};
+
+constexpr std::uint32_t cull_workgroup_size = 64;
+constexpr vk::DeviceSize draw_command_stride =
+    sizeof(vk::DrawIndexedIndirectCommand);
+
+DeviceFeatures gpu_driven_features() {
+  auto features = DeviceFeatures{};
+  // One vkCmdDrawIndexedIndirect covering many objects.
+  features.core.multiDrawIndirect = VK_TRUE;
+  // firstInstance is how each draw finds its object.
+  features.core.drawIndirectFirstInstance = VK_TRUE;
+  features.vulkan12.drawIndirectCount     = VK_TRUE;
+  return features;
+}
+
+std::optional<GpuDrivenScene>
+create_gpu_driven_scene(DeviceAllocator& allocator, const vk::Queue& queue,
+                        const std::uint32_t queue_family_index,
+                        const std::span<const Vec4> bounds,
+                        const std::span<const Mat4> transforms) {
+  // Zero sized buffers aren't allowed.
+  if (bounds.empty() || transforms.empty()) {
+    return std::nullopt;
+  }
+  const auto indices = std::array<std::uint32_t, 3>{0, 1, 2};
+  auto scene         = GpuDrivenScene{};
+  scene.object_count = static_cast<std::uint32_t>(bounds.size());
+  scene.index_count  = static_cast<std::uint32_t>(indices.size());
+  const auto storage = vk::BufferUsageFlagBits::eStorageBuffer;
+  auto bounds_buffer =
+      create_buffer_with_data(allocator, queue, queue_family_index,
+                              std::as_bytes(bounds), storage);
+  auto transforms_buffer =
+      create_buffer_with_data(allocator, queue, queue_family_index,
+                              std::as_bytes(transforms), storage);
+  auto index_buffer = create_buffer_with_data(
+      allocator, queue, queue_family_index,
+      std::as_bytes(std::span{indices}), vk::BufferUsageFlagBits::eIndexBuffer);
+  auto draw_commands = create_buffer(
+      allocator,
+      std::max<vk::DeviceSize>(scene.object_count, 1) * draw_command_stride,
+      storage | vk::BufferUsageFlagBits::eIndirectBuffer,
+      vk::MemoryPropertyFlagBits::eDeviceLocal);
+  auto draw_count = create_buffer(
+      allocator, sizeof(std::uint32_t),
+      storage | vk::BufferUsageFlagBits::eIndirectBuffer |
+          vk::BufferUsageFlagBits::eTransferDst,
+      vk::MemoryPropertyFlagBits::eDeviceLocal);
+  if (!bounds_buffer || !transforms_buffer || !index_buffer ||
+      !draw_commands || !draw_count) {
+    for (auto* const buffer : {&bounds_buffer, &transforms_buffer,
+                               &index_buffer, &draw_commands, &draw_count}) {
+      if (*buffer) {
+        destroy_buffer(allocator, **buffer);
+      }
+    }
+    return std::nullopt;
+  }
+  scene.bounds        = std::move(*bounds_buffer);
+  scene.transforms    = std::move(*transforms_buffer);
+  scene.indices       = std::move(*index_buffer);
+  scene.draw_commands = std::move(*draw_commands);
+  scene.draw_count    = std::move(*draw_count);
+  return scene;
+}
+
+void destroy_gpu_driven_scene(DeviceAllocator& allocator,
+                              GpuDrivenScene& scene) {
+  destroy_buffer(allocator, scene.bounds);
+  destroy_buffer(allocator, scene.transforms);
+  destroy_buffer(allocator, scene.indices);
+  destroy_buffer(allocator, scene.draw_commands);
+  destroy_buffer(allocator, scene.draw_count);
+  scene.object_count = 0;
+}
+
+vk::UniqueDescriptorSetLayout
+create_storage_set_layout(const vk::Device& logical_device,
+                          const std::uint32_t binding_count,
+                          const vk::ShaderStageFlags stages) {
+  auto bindings = std::vector<vk::DescriptorSetLayoutBinding>{};
+  for (const auto binding : std::views::iota(0u, binding_count)) {
+    bindings.emplace_back(binding, vk::DescriptorType::eStorageBuffer, 1,
+                          stages);
+  }
+  vk::DescriptorSetLayoutCreateInfo setLayoutInfo;
+  setLayoutInfo.bindingCount = binding_count;
+  setLayoutInfo.pBindings    = bindings.data();
+  return logical_device.createDescriptorSetLayoutUnique(setLayoutInfo);
+}
+
+vk::UniquePipelineLayout
+create_push_constant_layout(const vk::Device& logical_device,
+                            const vk::DescriptorSetLayout& set_layout,
+                            const vk::PushConstantRange& push_constants) {
+  vk::PipelineLayoutCreateInfo layoutInfo;
+  layoutInfo.setLayoutCount         = 1;
+  layoutInfo.pSetLayouts            = &set_layout;
+  layoutInfo.pushConstantRangeCount = 1;
+  layoutInfo.pPushConstantRanges    = &push_constants;
+  return logical_device.createPipelineLayoutUnique(layoutInfo);
+}
+
+GpuDrivenPipelines create_gpu_driven_pipelines(
+    const vk::PhysicalDevice& physical_device, const vk::Device& logical_device,
+    const DeviceFeatures& enabled_features, const vk::RenderPass& render_pass,
+    const GpuDrivenScene& scene, const vk::ShaderModule& cull_shader,
+    const std::vector<vk::PipelineShaderStageCreateInfo>& draw_shaders,
+    const vk::PipelineCache& pipeline_cache) {
+  auto pipelines           = GpuDrivenPipelines{};
+  pipelines.use_draw_count = enabled_features.vulkan12.drawIndirectCount;
+  pipelines.max_draw_indirect_count =
+      std::max(physical_device.getProperties().limits.maxDrawIndirectCount, 1u);
+
+  pipelines.cull_set_layout = create_storage_set_layout(
+      logical_device, 3, vk::ShaderStageFlagBits::eCompute);
+  pipelines.draw_set_layout = create_storage_set_layout(
+      logical_device, 1, vk::ShaderStageFlagBits::eVertex);
+  pipelines.cull_layout = create_push_constant_layout(
+      logical_device, pipelines.cull_set_layout.get(),
+      vk::PushConstantRange{vk::ShaderStageFlagBits::eCompute, 0,
+                            sizeof(CullingConstants)});
+  pipelines.draw_layout = create_push_constant_layout(
+      logical_device, pipelines.draw_set_layout.get(),
+      vk::PushConstantRange{vk::ShaderStageFlagBits::eVertex, 0,
+                            sizeof(Mat4)});
+
+  static const auto shader_entry_point = std::string{"main"};
+  vk::ComputePipelineCreateInfo computePipelineInfo;
+  computePipelineInfo.stage  = create_shader_pipeline_info(
+      cull_shader, vk::ShaderStageFlagBits::eCompute, shader_entry_point);
+  computePipelineInfo.layout = pipelines.cull_layout.get();
+  pipelines.cull_pipeline =
+      logical_device
+          .createComputePipelineUnique(pipeline_cache, computePipelineInfo)
+          .value;
+
+  auto description          = GraphicsPipelineDescription{};
+  description.render_pass   = render_pass;
+  description.layout        = pipelines.draw_layout.get();
+  description.shader_stages = draw_shaders;
+  // Objects are scattered at random orientations, both faces count.
+  description.cull_mode   = vk::CullModeFlagBits::eNone;
+  pipelines.draw_pipeline = vk::UniquePipeline{
+      create_graphics_pipeline(logical_device, description, pipeline_cache),
+      logical_device};
+
+  const auto pool_size =
+      vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer, 4};
+  vk::DescriptorPoolCreateInfo descriptorPoolInfo;
+  descriptorPoolInfo.maxSets       = 2;
+  descriptorPoolInfo.poolSizeCount = 1;
+  descriptorPoolInfo.pPoolSizes    = &pool_size;
+  pipelines.descriptor_pool =
+      logical_device.createDescriptorPoolUnique(descriptorPoolInfo);
+  const auto set_layouts = std::array{pipelines.cull_set_layout.get(),
+                                      pipelines.draw_set_layout.get()};
+  vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo;
+  descriptorSetAllocateInfo.descriptorPool     = pipelines.descriptor_pool.get();
+  descriptorSetAllocateInfo.descriptorSetCount = set_layouts.size();
+  descriptorSetAllocateInfo.pSetLayouts        = set_layouts.data();
+  const auto sets =
+      logical_device.allocateDescriptorSets(descriptorSetAllocateInfo);
+  pipelines.cull_set = sets[0];
+  pipelines.draw_set = sets[1];
+
+  const auto whole = [](const AllocatedBuffer& buffer) {
+    return vk::DescriptorBufferInfo{buffer.buffer.get(), 0, VK_WHOLE_SIZE};
+  };
+  const auto buffer_infos =
+      std::array{whole(scene.bounds), whole(scene.draw_commands),
+                 whole(scene.draw_count), whole(scene.transforms)};
+  auto writes = std::array<vk::WriteDescriptorSet, 4>{};
+  for (const auto index : std::views::iota(0u, 4u)) {
+    // The first three go to the culling set, transforms to the draw set.
+    const auto is_draw_set        = index == 3;
+    writes[index].dstSet          = is_draw_set ? pipelines.draw_set
+                                                : pipelines.cull_set;
+    writes[index].dstBinding      = is_draw_set ? 0 : index;
+    writes[index].descriptorCount = 1;
+    writes[index].descriptorType  = vk::DescriptorType::eStorageBuffer;
+    writes[index].pBufferInfo     = &buffer_infos[index];
+  }
+  logical_device.updateDescriptorSets(writes, {});
+  return pipelines;
+}
+
+void record_gpu_culling(const GpuDrivenPipelines& pipelines,
+                        const GpuDrivenScene& scene, const Frustum& frustum,
+                        const vk::CommandBuffer& command_buffer) {
+  // The previous frame's indirect draw may still be reading the commands we
+  // are about to overwrite, an execution dependency is enough for that.
+  command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eDrawIndirect,
+                                 vk::PipelineStageFlagBits::eTransfer |
+                                     vk::PipelineStageFlagBits::eComputeShader,
+                                 {}, {}, {}, {});
+  if (pipelines.use_draw_count) {
+    command_buffer.fillBuffer(scene.draw_count.buffer.get(), 0,
+                              sizeof(std::uint32_t), 0);
+    const auto cleared = vk::MemoryBarrier{
+        vk::AccessFlagBits::eTransferWrite,
+        vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite};
+    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                   vk::PipelineStageFlagBits::eComputeShader,
+                                   {}, cleared, {}, {});
+  }
+
+  auto constants         = CullingConstants{};
+  constants.planes       = frustum;
+  constants.object_count = scene.object_count;
+  constants.compact      = pipelines.use_draw_count ? 1 : 0;
+  constants.index_count  = scene.index_count;
+  command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute,
+                              pipelines.cull_pipeline.get());
+  command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                    pipelines.cull_layout.get(), 0,
+                                    pipelines.cull_set, {});
+  command_buffer.pushConstants(pipelines.cull_layout.get(),
+                               vk::ShaderStageFlagBits::eCompute, 0,
+                               sizeof(constants), &constants);
+  command_buffer.dispatch(
+      (scene.object_count + cull_workgroup_size - 1) / cull_workgroup_size, 1,
+      1);
+
+  const auto culled = vk::MemoryBarrier{
+      vk::AccessFlagBits::eShaderWrite,
+      vk::AccessFlagBits::eIndirectCommandRead};
+  command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                 vk::PipelineStageFlagBits::eDrawIndirect, {},
+                                 culled, {}, {});
+}
+
+void bind_draw_state(const GpuDrivenPipelines& pipelines,
+                     const GpuDrivenScene& scene,
+                     const Mat4& view_projection,
+                     const vk::CommandBuffer& command_buffer) {
+  command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                              pipelines.draw_pipeline.get());
+  command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                    pipelines.draw_layout.get(), 0,
+                                    pipelines.draw_set, {});
+  command_buffer.pushConstants(pipelines.draw_layout.get(),
+                               vk::ShaderStageFlagBits::eVertex, 0,
+                               sizeof(view_projection), &view_projection);
+  command_buffer.bindIndexBuffer(scene.indices.buffer.get(), 0,
+                                 vk::IndexType::eUint32);
+}
+
+void record_gpu_driven_draws(const GpuDrivenPipelines& pipelines,
+                             const GpuDrivenScene& scene,
+                             const Mat4& view_projection,
+                             const vk::CommandBuffer& command_buffer) {
+  bind_draw_state(pipelines, scene, view_projection, command_buffer);
+  if (pipelines.use_draw_count) {
+    command_buffer.drawIndexedIndirectCount(
+        scene.draw_commands.buffer.get(), 0, scene.draw_count.buffer.get(), 0,
+        scene.object_count, draw_command_stride);
+    return;
+  }
+  // One command per object, in as few calls as maxDrawIndirectCount allows.
+  for (auto first = 0u; first < scene.object_count;
+       first += pipelines.max_draw_indirect_count) {
+    command_buffer.drawIndexedIndirect(
+        scene.draw_commands.buffer.get(), first * draw_command_stride,
+        std::min(pipelines.max_draw_indirect_count,
+                 scene.object_count - first),
+        draw_command_stride);
+  }
+}
+
+void record_per_object_draws(const GpuDrivenPipelines& pipelines,
+                             const GpuDrivenScene& scene,
+                             const Mat4& view_projection,
+                             const vk::CommandBuffer& command_buffer,
+                             const std::uint32_t first,
+                             const std::uint32_t count) {
+  bind_draw_state(pipelines, scene, view_projection, command_buffer);
+  for (const auto object : std::views::iota(first, first + count)) {
+    command_buffer.drawIndexed(scene.index_count, 1, 0, 0, object);
+  }
+}
+
+void record_per_object_draws(const GpuDrivenPipelines& pipelines,
+                             const GpuDrivenScene& scene,
+                             const Mat4& view_projection,
+                             const vk::CommandBuffer& command_buffer) {
+  record_per_object_draws(pipelines, scene, view_projection, command_buffer, 0,
+                          scene.object_count);
+}
+
+void record_visible_draws(const GpuDrivenPipelines& pipelines,
+                          const GpuDrivenScene& scene,
+                          const Mat4& view_projection,
+                          const vk::CommandBuffer& command_buffer,
+                          const std::span<const std::uint32_t> visible) {
+  bind_draw_state(pipelines, scene, view_projection, command_buffer);
+  for (const auto object : visible) {
+    command_buffer.drawIndexed(scene.index_count, 1, 0, 0, object);
+  }
+}
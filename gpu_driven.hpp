@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "allocator.hpp"
+#include "math.hpp"
+#include "picante.hpp"
+
+// Features the GPU driven path can't do without. drawIndirectCount is
+// optional on top of these.
+DeviceFeatures gpu_driven_features();
+
+// Everything the GPU needs to draw a scene without the CPU touching a single
+// object per frame. Every object is the same indexed mesh for now, placed by
+// its transform.
+struct GpuDrivenScene {
+  AllocatedBuffer bounds;
+  AllocatedBuffer transforms;
+  AllocatedBuffer indices;
+  // Written by the culling pass, consumed by the indirect draw.
+  AllocatedBuffer draw_commands;
+  AllocatedBuffer draw_count;
+  std::uint32_t object_count = 0;
+  std::uint32_t index_count  = 0;
+};
+
+// bounds are world space spheres, xyz center and w radius, one per transform.
+// Null when there are no objects or the buffers can't be allocated.
+std::optional<GpuDrivenScene>
+create_gpu_driven_scene(DeviceAllocator& allocator, const vk::Queue& queue,
+                        const std::uint32_t queue_family_index,
+                        const std::span<const Vec4> bounds,
+                        const std::span<const Mat4> transforms);
+
+void destroy_gpu_driven_scene(DeviceAllocator& allocator,
+                              GpuDrivenScene& scene);
+
+struct GpuDrivenPipelines {
+  vk::UniqueDescriptorSetLayout cull_set_layout;
+  vk::UniqueDescriptorSetLayout draw_set_layout;
+  vk::UniquePipelineLayout cull_layout;
+  vk::UniquePipelineLayout draw_layout;
+  vk::UniquePipeline cull_pipeline;
+  vk::UniquePipeline draw_pipeline;
+  vk::UniqueDescriptorPool descriptor_pool;
+  vk::DescriptorSet cull_set;
+  vk::DescriptorSet draw_set;
+  // Without drawIndirectCount the culling pass writes one command per object
+  // and culled ones draw zero instances.
+  bool use_draw_count                  = false;
+  std::uint32_t max_draw_indirect_count = 1;
+};
+
+// vertex_shader reads its transform from set 0 binding 0 indexed by
+// gl_InstanceIndex, and takes the view projection matrix as a push constant.
+GpuDrivenPipelines create_gpu_driven_pipelines(
+    const vk::PhysicalDevice& physical_device, const vk::Device& logical_device,
+    const DeviceFeatures& enabled_features, const vk::RenderPass& render_pass,
+    const GpuDrivenScene& scene, const vk::ShaderModule& cull_shader,
+    const std::vector<vk::PipelineShaderStageCreateInfo>& draw_shaders,
+    const vk::PipelineCache& pipeline_cache = {});
+
+// binding_count storage buffers at bindings 0 and up, and a layout with that
+// set and one push constant range. Shared with the other compute passes.
+vk::UniqueDescriptorSetLayout
+create_storage_set_layout(const vk::Device& logical_device,
+                          const std::uint32_t binding_count,
+                          const vk::ShaderStageFlags stages);
+vk::UniquePipelineLayout
+create_push_constant_layout(const vk::Device& logical_device,
+                            const vk::DescriptorSetLayout& set_layout,
+                            const vk::PushConstantRange& push_constants);
+
+// Culls every object against the frustum and rebuilds the indirect commands.
+// Must be recorded outside of a render pass, before record_gpu_driven_draws.
+void record_gpu_culling(const GpuDrivenPipelines& pipelines,
+                        const GpuDrivenScene& scene, const Frustum& frustum,
+                        const vk::CommandBuffer& command_buffer);
+
+// Draws whatever survived culling. Must be recorded inside the render pass.
+void record_gpu_driven_draws(const GpuDrivenPipelines& pipelines,
+                             const GpuDrivenScene& scene,
+                             const Mat4& view_projection,
+                             const vk::CommandBuffer& command_buffer);
+
+// The naive path, one draw call per object and no culling at all. Only here
+// so the benchmarks have something to compare against. Draws count objects
+// starting at first, so slices can be recorded from several threads.
+void record_per_object_draws(const GpuDrivenPipelines& pipelines,
+                             const GpuDrivenScene& scene,
+                             const Mat4& view_projection,
+                             const vk::CommandBuffer& command_buffer,
+                             const std::uint32_t first,
+                             const std::uint32_t count);
+void record_per_object_draws(const GpuDrivenPipelines& pipelines,
+                             const GpuDrivenScene& scene,
+                             const Mat4& view_projection,
+                             const vk::CommandBuffer& command_buffer);
+
+// One draw call per object in visible, as the CPU culling pass leaves them.
+void record_visible_draws(const GpuDrivenPipelines& pipelines,
+                          const GpuDrivenScene& scene,
+                          const Mat4& view_projection,
+                          const vk::CommandBuffer& command_buffer,
+                          const std::span<const std::uint32_t> visible);
@@ -0,0 +1,289 @@
+#include "gpu_profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <map>
+#include <numeric>
+#include <ranges>
+
+double ticks_to_us(const GpuProfiler& profiler, const std::uint64_t ticks) {
+  return static_cast<double>(ticks) * profiler.timestamp_period_ns / 1.0e3;
+}
+
+// There is no portable way to read both clocks at once without
+// VK_EXT_calibrated_timestamps, so bracket a timestamp with two CPU reads
+// and assume it landed halfway. Good to within a few tens of microseconds,
+// plenty to line passes up against CPU zones.
+void calibrate_gpu_profiler(const vk::Device& logical_device,
+                            const vk::Queue& queue,
+                            const std::uint32_t queue_family_index,
+                            GpuProfiler& profiler) {
+  vk::QueryPoolCreateInfo queryPoolInfo;
+  queryPoolInfo.queryType  = vk::QueryType::eTimestamp;
+  queryPoolInfo.queryCount = 1;
+  const auto query_pool = logical_device.createQueryPoolUnique(queryPoolInfo);
+  const auto before     = std::chrono::steady_clock::now();
+  submit_immediate(logical_device, queue, queue_family_index,
+                   [&query_pool](const vk::CommandBuffer& command_buffer) {
+                     command_buffer.resetQueryPool(query_pool.get(), 0, 1);
+                     command_buffer.writeTimestamp(
+                         vk::PipelineStageFlagBits::eTopOfPipe,
+                         query_pool.get(), 0);
+                   });
+  const auto after = std::chrono::steady_clock::now();
+  auto timestamp   = std::uint64_t{};
+  if (logical_device.getQueryPoolResults(
+          query_pool.get(), 0, 1, sizeof(timestamp), &timestamp,
+          sizeof(timestamp), vk::QueryResultFlagBits::e64) !=
+      vk::Result::eSuccess) {
+    return;
+  }
+  const auto midpoint_us =
+      (trace_time_us(before) + trace_time_us(after)) / 2.0;
+  profiler.gpu_to_cpu_offset_us =
+      midpoint_us - ticks_to_us(profiler, timestamp & profiler.timestamp_mask);
+}
+
+GpuProfiler create_gpu_profiler(const vk::PhysicalDevice& physical_device,
+                                const vk::Device& logical_device,
+                                const vk::Queue& queue,
+                                const std::uint32_t queue_family_index,
+                                const std::size_t frames_in_flight,
+                                const std::uint32_t scopes_per_frame) {
+  auto profiler = GpuProfiler{};
+  profiler.frames.resize(frames_in_flight);
+  const auto valid_bits = physical_device.getQueueFamilyProperties()
+                              [queue_family_index]
+                                  .timestampValidBits;
+  if (valid_bits == 0) {
+    return profiler;
+  }
+  profiler.queries_per_frame = scopes_per_frame * 2;
+  vk::QueryPoolCreateInfo queryPoolInfo;
+  queryPoolInfo.queryType  = vk::QueryType::eTimestamp;
+  queryPoolInfo.queryCount = static_cast<std::uint32_t>(
+      frames_in_flight * profiler.queries_per_frame);
+  profiler.query_pool = logical_device.createQueryPoolUnique(queryPoolInfo);
+  profiler.timestamp_period_ns = static_cast<double>(
+      physical_device.getProperties().limits.timestampPeriod);
+  profiler.timestamp_mask =
+      valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+  calibrate_gpu_profiler(logical_device, queue, queue_family_index, profiler);
+  return profiler;
+}
+
+void add_scope_sample(const GpuProfiler& profiler, GpuScopeHistory& history,
+                      const double sample_ms) {
+  if (history.samples.size() < gpu_scope_history) {
+    history.samples.push_back(sample_ms);
+  } else {
+    history.samples[history.next_sample] = sample_ms;
+  }
+  history.next_sample    = (history.next_sample + 1) % gpu_scope_history;
+  history.last_read_back = profiler.read_backs;
+}
+
+void read_back_frame(const vk::Device& logical_device, GpuProfiler& profiler,
+                     const std::size_t slot) {
+  ++profiler.read_backs;
+  auto& frame = profiler.frames[slot];
+  if (frame.queries_used == 0) {
+    return;
+  }
+  // Each query comes back as its timestamp followed by whether it was
+  // written. A scope left open, or ended in another command buffer, never
+  // gets its end written and only that scope is skipped, not the frame.
+  auto results = std::vector<std::uint64_t>(frame.queries_used * 2);
+  const auto first =
+      static_cast<std::uint32_t>(slot) * profiler.queries_per_frame;
+  const auto result = logical_device.getQueryPoolResults(
+      profiler.query_pool.get(), first, frame.queries_used,
+      results.size() * sizeof(std::uint64_t), results.data(),
+      2 * sizeof(std::uint64_t),
+      vk::QueryResultFlagBits::e64 |
+          vk::QueryResultFlagBits::eWithAvailability);
+  if (result != vk::Result::eSuccess && result != vk::Result::eNotReady) {
+    return;
+  }
+  const auto available = [&results](const std::uint32_t query) {
+    return results[query * 2 + 1] != 0;
+  };
+  auto frame_totals = std::map<std::uint32_t, double>{};
+  for (const auto& record : frame.scopes) {
+    if (!available(record.begin_query) ||
+        !available(record.begin_query + 1)) {
+      continue;
+    }
+    const auto begin = results[record.begin_query * 2];
+    const auto ticks =
+        (results[(record.begin_query + 1) * 2] - begin) &
+        profiler.timestamp_mask;
+    const auto duration_us = ticks_to_us(profiler, ticks);
+    frame_totals[record.scope] += duration_us / 1.0e3;
+    if (profiler.capture_trace &&
+        profiler.trace_events.size() < profiler.max_trace_events) {
+      profiler.trace_events.push_back(
+          {profiler.scopes[record.scope].name, "GPU",
+           ticks_to_us(profiler, begin & profiler.timestamp_mask) +
+               profiler.gpu_to_cpu_offset_us,
+           duration_us});
+    }
+  }
+  for (const auto& [scope, total_ms] : frame_totals) {
+    add_scope_sample(profiler, profiler.scopes[scope], total_ms);
+  }
+}
+
+void begin_gpu_profiler_frame(const vk::Device& logical_device,
+                              GpuProfiler& profiler,
+                              const vk::CommandBuffer& command_buffer,
+                              const std::size_t slot) {
+  profiler.current = slot;
+  if (!profiler.query_pool) {
+    return;
+  }
+  read_back_frame(logical_device, profiler, slot);
+  auto& frame        = profiler.frames[slot];
+  frame.queries_used = 0;
+  frame.scopes.clear();
+  frame.open.clear();
+  command_buffer.resetQueryPool(
+      profiler.query_pool.get(),
+      static_cast<std::uint32_t>(slot) * profiler.queries_per_frame,
+      profiler.queries_per_frame);
+}
+
+std::uint32_t intern_scope(GpuProfiler& profiler,
+                           const std::string_view name) {
+  const auto existing = profiler.scope_ids.find(name);
+  if (existing != profiler.scope_ids.end()) {
+    return existing->second;
+  }
+  const auto id = static_cast<std::uint32_t>(profiler.scopes.size());
+  profiler.scopes.push_back(GpuScopeHistory{std::string{name}, {}, 0});
+  profiler.scope_ids.emplace(name, id);
+  return id;
+}
+
+void begin_gpu_scope(GpuProfiler& profiler,
+                     const vk::CommandBuffer& command_buffer,
+                     const std::string_view name) {
+  if (!profiler.query_pool) {
+    return;
+  }
+  auto& frame = profiler.frames[profiler.current];
+  if (frame.queries_used + 2 > profiler.queries_per_frame) {
+    // Out of queries, drop the scope but keep begin and end paired up.
+    frame.open.push_back(std::nullopt);
+    return;
+  }
+  const auto query = frame.queries_used;
+  frame.queries_used += 2;
+  frame.open.push_back(frame.scopes.size());
+  frame.scopes.push_back({intern_scope(profiler, name), query});
+  command_buffer.writeTimestamp(
+      vk::PipelineStageFlagBits::eTopOfPipe, profiler.query_pool.get(),
+      static_cast<std::uint32_t>(profiler.current) *
+              profiler.queries_per_frame +
+          query);
+}
+
+void end_gpu_scope(GpuProfiler& profiler,
+                   const vk::CommandBuffer& command_buffer) {
+  if (!profiler.query_pool) {
+    return;
+  }
+  auto& frame = profiler.frames[profiler.current];
+  if (frame.open.empty()) {
+    return;
+  }
+  const auto open = frame.open.back();
+  frame.open.pop_back();
+  if (!open) {
+    return;
+  }
+  command_buffer.writeTimestamp(
+      vk::PipelineStageFlagBits::eBottomOfPipe, profiler.query_pool.get(),
+      static_cast<std::uint32_t>(profiler.current) *
+              profiler.queries_per_frame +
+          frame.scopes[*open].begin_query + 1);
+}
+
+GpuScope::GpuScope(GpuProfiler& profiler,
+                   const vk::CommandBuffer& command_buffer,
+                   const std::string_view name)
+    : profiler{profiler}, command_buffer{command_buffer} {
+  begin_gpu_scope(profiler, command_buffer, name);
+}
+
+GpuScope::~GpuScope() { end_gpu_scope(profiler, command_buffer); }
+
+void collect_gpu_profiler(const vk::Device& logical_device,
+                          GpuProfiler& profiler) {
+  if (!profiler.query_pool) {
+    return;
+  }
+  for (const auto slot : std::views::iota(0uz, profiler.frames.size())) {
+    read_back_frame(logical_device, profiler, slot);
+    profiler.frames[slot].queries_used = 0;
+    profiler.frames[slot].scopes.clear();
+  }
+}
+
+std::vector<GpuScopeStats> get_gpu_scope_stats(const GpuProfiler& profiler) {
+  auto stats = std::vector<GpuScopeStats>{};
+  for (const auto& scope : profiler.scopes) {
+    if (scope.samples.empty()) {
+      continue;
+    }
+    const auto [min, max] = std::ranges::minmax(scope.samples);
+    const auto last       = (scope.next_sample + gpu_scope_history - 1) %
+                      gpu_scope_history;
+    stats.push_back(
+        {scope.name, scope.samples.size(), scope.samples[last],
+         std::reduce(scope.samples.begin(), scope.samples.end()) /
+             static_cast<double>(scope.samples.size()),
+         min, max});
+  }
+  return stats;
+}
+
+std::optional<double> last_gpu_scope_ms(const GpuProfiler& profiler,
+                                        const std::string_view name) {
+  const auto id = profiler.scope_ids.find(name);
+  if (id == profiler.scope_ids.end()) {
+    return std::nullopt;
+  }
+  const auto& scope = profiler.scopes[id->second];
+  if (scope.samples.empty() || scope.last_read_back != profiler.read_backs) {
+    return std::nullopt;
+  }
+  return scope.samples[(scope.next_sample + gpu_scope_history - 1) %
+                       gpu_scope_history];
+}
+
+void write_gpu_profile_table(std::ostream& stream,
+                             const GpuProfiler& profiler) {
+  const auto stats = get_gpu_scope_stats(profiler);
+  if (stats.empty()) {
+    stream << "No GPU scopes recorded\n";
+    return;
+  }
+  const auto name_width = std::ranges::max(
+      stats | std::views::transform([](const auto& scope) {
+        return scope.name.size();
+      }));
+  const auto flags = stream.flags();
+  stream << std::left << std::setw(static_cast<int>(name_width)) << "scope"
+         << std::right << std::fixed << std::setprecision(3) << std::setw(11)
+         << "last ms" << std::setw(11) << "mean ms" << std::setw(11)
+         << "min ms" << std::setw(11) << "max ms" << "\n";
+  for (const auto& scope : stats) {
+    stream << std::left << std::setw(static_cast<int>(name_width))
+           << scope.name << std::right << std::setw(11) << scope.last_ms
+           << std::setw(11) << scope.mean_ms << std::setw(11) << scope.min_ms
+           << std::setw(11) << scope.max_ms << "\n";
+  }
+  stream.flags(flags);
+}
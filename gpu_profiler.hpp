@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "picante.hpp"
+#include "trace.hpp"
+
+constexpr std::uint32_t default_gpu_scopes_per_frame = 64;
+// Frames the rolling statistics are computed over.
+constexpr std::size_t gpu_scope_history = 128;
+
+struct GpuScopeRecord {
+  std::uint32_t scope       = 0;
+  std::uint32_t begin_query = 0;
+};
+
+// The queries one frame slot wrote. Read back when the slot comes around
+// again, by which point its fence has signalled and nothing can stall.
+struct GpuProfilerFrame {
+  std::vector<GpuScopeRecord> scopes;
+  // Index into scopes of every scope still open, innermost last. Scopes that
+  // didn't fit in the frame's queries are pushed as nullopt.
+  std::vector<std::optional<std::size_t>> open;
+  std::uint32_t queries_used = 0;
+};
+
+struct GpuScopeHistory {
+  std::string name;
+  // Ring of per frame totals in milliseconds, a scope that ran twice in a
+  // frame counts once with the sum of both.
+  std::vector<double> samples;
+  std::size_t next_sample = 0;
+  // The read back the newest sample came from.
+  std::uint64_t last_read_back = 0;
+};
+
+struct GpuProfiler {
+  // Null when the queue can't write timestamps, everything is a no-op then.
+  vk::UniqueQueryPool query_pool;
+  std::uint32_t queries_per_frame = 0;
+  double timestamp_period_ns      = 0.0;
+  std::uint64_t timestamp_mask    = 0;
+  // Added to a timestamp in microseconds to land on the steady_clock.
+  double gpu_to_cpu_offset_us = 0.0;
+  std::vector<GpuProfilerFrame> frames;
+  std::size_t current = 0;
+  // Frames read back so far, the newest one's number.
+  std::uint64_t read_backs = 0;
+  std::vector<GpuScopeHistory> scopes;
+  std::map<std::string, std::uint32_t, std::less<>> scope_ids;
+  // Every scope instance is also kept as a trace event while capturing.
+  bool capture_trace           = false;
+  std::size_t max_trace_events = 1 << 20;
+  std::vector<TraceEvent> trace_events;
+};
+
+// Also calibrates the GPU clock against the steady_clock with one blocking
+// submit on queue, which is why this belongs at startup.
+GpuProfiler create_gpu_profiler(
+    const vk::PhysicalDevice& physical_device, const vk::Device& logical_device,
+    const vk::Queue& queue, const std::uint32_t queue_family_index,
+    const std::size_t frames_in_flight     = default_frames_in_flight,
+    const std::uint32_t scopes_per_frame = default_gpu_scopes_per_frame);
+
+// Collects what the slot measured last time around and resets its queries.
+// Record it right after beginning the slot's command buffer, outside of any
+// render pass.
+void begin_gpu_profiler_frame(const vk::Device& logical_device,
+                              GpuProfiler& profiler,
+                              const vk::CommandBuffer& command_buffer,
+                              const std::size_t slot);
+
+// Scopes nest and may sit inside or around render passes and dispatches.
+void begin_gpu_scope(GpuProfiler& profiler,
+                     const vk::CommandBuffer& command_buffer,
+                     const std::string_view name);
+void end_gpu_scope(GpuProfiler& profiler,
+                   const vk::CommandBuffer& command_buffer);
+
+struct GpuScope {
+  GpuScope(GpuProfiler& profiler, const vk::CommandBuffer& command_buffer,
+           const std::string_view name);
+  ~GpuScope();
+  GpuScope(const GpuScope&)            = delete;
+  GpuScope& operator=(const GpuScope&) = delete;
+
+  GpuProfiler& profiler;
+  vk::CommandBuffer command_buffer;
+};
+
+// Picks up the results of every slot. Only once the device is idle.
+void collect_gpu_profiler(const vk::Device& logical_device,
+                          GpuProfiler& profiler);
+
+struct GpuScopeStats {
+  std::string name;
+  std::size_t samples = 0;
+  double last_ms      = 0.0;
+  double mean_ms      = 0.0;
+  double min_ms       = 0.0;
+  double max_ms       = 0.0;
+};
+
+std::vector<GpuScopeStats> get_gpu_scope_stats(const GpuProfiler& profiler);
+
+// The named scope's total in the frame the last begin_gpu_profiler_frame
+// collected. nullopt when that frame didn't run it or its timestamps weren't
+// written, rather than a sample from some older frame.
+std::optional<double> last_gpu_scope_ms(const GpuProfiler& profiler,
+                                        const std::string_view name);
+
+void write_gpu_profile_table(std::ostream& stream,
+                             const GpuProfiler& profiler);
@@ -0,0 +1,262 @@
+#include "jobs.hpp"
+
+#include <algorithm>
+#include <ranges>
+#include <string>
+#include <utility>
+
+#include "cpu_profiler.hpp"
+
+// Which system's deque the calling thread owns, if any.
+thread_local JobSystem* current_system = nullptr;
+thread_local std::size_t current_deque = 0;
+
+bool push_job(JobDeque& deque, Job* job) {
+  const auto bottom = deque.bottom.load(std::memory_order_relaxed);
+  const auto top    = deque.top.load(std::memory_order_acquire);
+  if (bottom - top >= static_cast<std::int64_t>(job_deque_capacity)) {
+    return false;
+  }
+  deque.jobs[bottom % job_deque_capacity].store(job,
+                                                std::memory_order_relaxed);
+  // Publishes the job to thieves, who read bottom with acquire.
+  deque.bottom.store(bottom + 1, std::memory_order_release);
+  return true;
+}
+
+Job* pop_job(JobDeque& deque) {
+  const auto bottom = deque.bottom.load(std::memory_order_relaxed) - 1;
+  deque.bottom.store(bottom, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  auto top = deque.top.load(std::memory_order_relaxed);
+  if (top > bottom) {
+    deque.bottom.store(bottom + 1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  auto* job =
+      deque.jobs[bottom % job_deque_capacity].load(std::memory_order_relaxed);
+  if (top == bottom) {
+    // The last job, a thief may be after it too.
+    if (!deque.top.compare_exchange_strong(top, top + 1,
+                                           std::memory_order_seq_cst,
+                                           std::memory_order_relaxed)) {
+      job = nullptr;
+    }
+    deque.bottom.store(bottom + 1, std::memory_order_relaxed);
+  }
+  return job;
+}
+
+Job* steal_job(JobDeque& deque) {
+  auto top = deque.top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const auto bottom = deque.bottom.load(std::memory_order_acquire);
+  if (top >= bottom) {
+    return nullptr;
+  }
+  auto* const job =
+      deque.jobs[top % job_deque_capacity].load(std::memory_order_relaxed);
+  if (!deque.top.compare_exchange_strong(top, top + 1,
+                                         std::memory_order_seq_cst,
+                                         std::memory_order_relaxed)) {
+    return nullptr;
+  }
+  return job;
+}
+
+void wake_job_threads(JobSystem& system, const bool everyone) {
+  // Pairs with the fence in sleep_for_work, either the sleeper sees the new
+  // work or we see the sleeper.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (system.sleeping.load() == 0) {
+    return;
+  }
+  {
+    const auto lock = std::scoped_lock{system.sleep_mutex};
+    ++system.epoch;
+  }
+  if (everyone) {
+    system.wake.notify_all();
+  } else {
+    system.wake.notify_one();
+  }
+}
+
+Job* pop_queued_job(JobSystem& system, std::deque<Job*>& queue) {
+  const auto lock = std::scoped_lock{system.queue_mutex};
+  if (queue.empty()) {
+    return nullptr;
+  }
+  auto* const job = queue.front();
+  queue.pop_front();
+  return job;
+}
+
+Job* find_job(JobSystem& system, const bool main_thread_only) {
+  const auto owned = current_system == &system;
+  if (std::this_thread::get_id() == system.main_thread) {
+    if (auto* const job = pop_queued_job(system, system.main_thread_jobs)) {
+      return job;
+    }
+  }
+  if (main_thread_only) {
+    return nullptr;
+  }
+  if (owned) {
+    if (auto* const job = pop_job(*system.deques[current_deque])) {
+      return job;
+    }
+  }
+  if (auto* const job = pop_queued_job(system, system.injected_jobs)) {
+    return job;
+  }
+  // Start at a different victim every time so thieves spread out.
+  thread_local auto victim = std::size_t{0};
+  const auto deque_count   = system.deques.size();
+  for ([[maybe_unused]] const auto attempt :
+       std::views::iota(0uz, deque_count)) {
+    victim = (victim + 1) % deque_count;
+    if (owned && victim == current_deque) {
+      continue;
+    }
+    if (auto* const job = steal_job(*system.deques[victim])) {
+      return job;
+    }
+  }
+  return nullptr;
+}
+
+void run_job(JobSystem& system, Job* job) {
+  try {
+    job->function();
+  } catch (...) {
+    const auto lock = std::scoped_lock{system.failure_mutex};
+    if (!system.failure) {
+      system.failure = std::current_exception();
+    }
+  }
+  if (job->counter != nullptr && job->counter->pending.fetch_sub(1) == 1) {
+    wake_job_threads(system, true);
+  }
+  delete job;
+}
+
+// One last look for work after announcing we're about to sleep, so a job
+// submitted in between isn't missed. Returns that job if there was one.
+Job* sleep_for_work(JobSystem& system, const std::stop_token& stop_token,
+                    const JobCounter* counter, const bool main_thread_only) {
+  auto seen = std::uint64_t{0};
+  {
+    const auto lock = std::scoped_lock{system.sleep_mutex};
+    seen            = system.epoch;
+    system.sleeping.fetch_add(1);
+  }
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  auto* const job = find_job(system, main_thread_only);
+  if (job == nullptr && (counter == nullptr || counter->pending.load() != 0)) {
+    auto lock = std::unique_lock{system.sleep_mutex};
+    system.wake.wait(lock, stop_token,
+                     [&system, seen] { return system.epoch != seen; });
+  }
+  system.sleeping.fetch_sub(1);
+  return job;
+}
+
+void job_worker(const std::stop_token stop_token, JobSystem& system,
+                const std::size_t deque) {
+  set_zone_thread_name("job worker " + std::to_string(deque));
+  current_system = &system;
+  current_deque  = deque;
+  while (!stop_token.stop_requested()) {
+    auto* job = find_job(system, false);
+    if (job == nullptr) {
+      job = sleep_for_work(system, stop_token, nullptr, false);
+    }
+    if (job != nullptr) {
+      run_job(system, job);
+    }
+  }
+}
+
+std::unique_ptr<JobSystem> create_job_system(const std::size_t thread_count) {
+  auto system         = std::make_unique<JobSystem>();
+  const auto threads  = std::max<std::size_t>(thread_count, 1);
+  system->main_thread = std::this_thread::get_id();
+  for ([[maybe_unused]] const auto thread : std::views::iota(0uz, threads)) {
+    system->deques.push_back(std::make_unique<JobDeque>());
+  }
+  current_system = system.get();
+  current_deque  = 0;
+  system->workers.reserve(threads - 1);
+  for (const auto thread : std::views::iota(1uz, threads)) {
+    system->workers.emplace_back(job_worker, std::ref(*system), thread);
+  }
+  return system;
+}
+
+std::size_t job_thread_count(const JobSystem& system) {
+  return system.deques.size();
+}
+
+void submit_job(JobSystem& system, std::function<void()> function,
+                JobCounter* counter) {
+  if (counter != nullptr) {
+    counter->pending.fetch_add(1);
+  }
+  auto* const job = new Job{std::move(function), counter};
+  if (current_system != &system) {
+    const auto lock = std::scoped_lock{system.queue_mutex};
+    system.injected_jobs.push_back(job);
+  } else if (!push_job(*system.deques[current_deque], job)) {
+    run_job(system, job);
+    return;
+  }
+  wake_job_threads(system, false);
+}
+
+void submit_main_thread_job(JobSystem& system, std::function<void()> function,
+                            JobCounter* counter) {
+  if (counter != nullptr) {
+    counter->pending.fetch_add(1);
+  }
+  {
+    const auto lock = std::scoped_lock{system.queue_mutex};
+    system.main_thread_jobs.push_back(new Job{std::move(function), counter});
+  }
+  // Whoever wakes up might not be the main thread.
+  wake_job_threads(system, true);
+}
+
+void wait_for_counter(JobSystem& system, const JobCounter& counter,
+                      const bool main_thread_jobs_only) {
+  // Without workers nobody else would run the rest.
+  const auto main_thread_only =
+      main_thread_jobs_only && !system.workers.empty() &&
+      std::this_thread::get_id() == system.main_thread;
+  while (counter.pending.load() != 0) {
+    auto* job = find_job(system, main_thread_only);
+    if (job == nullptr) {
+      job = sleep_for_work(system, {}, &counter, main_thread_only);
+    }
+    if (job != nullptr) {
+      run_job(system, job);
+    }
+  }
+  const auto lock = std::scoped_lock{system.failure_mutex};
+  if (system.failure) {
+    std::rethrow_exception(std::exchange(system.failure, nullptr));
+  }
+}
+
+void parallel_for(
+    JobSystem& system, const std::size_t count, const std::size_t grain,
+    const std::function<void(std::size_t first, std::size_t count)>& function) {
+  auto counter      = JobCounter{};
+  const auto stride = std::max<std::size_t>(grain, 1);
+  for (auto first = 0uz; first < count; first += stride) {
+    const auto slice = std::min(stride, count - first);
+    submit_job(system, [&function, first, slice] { function(first, slice); },
+               &counter);
+  }
+  wait_for_counter(system, counter);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work stealing job scheduler. Every thread has its own deque it pushes and
+// pops jobs at the bottom of without taking a lock, idle threads steal from
+// the top of the others'. Jobs are counted down on a JobCounter instead of
+// being waited on one by one, and a thread waiting on a counter runs other
+// jobs in the meantime rather than blocking. Jobs that have to run on the
+// main thread, GLFW calls for one, go to a lane only the main thread drains.
+
+struct JobCounter {
+  std::atomic<std::uint32_t> pending{0};
+};
+
+struct Job {
+  std::function<void()> function;
+  // Counted down once the job has run, if set.
+  JobCounter* counter = nullptr;
+};
+
+// Jobs a deque can hold. Pushing to a full deque runs the job right away.
+constexpr std::size_t job_deque_capacity = 4096;
+
+// Chase-Lev deque with a fixed capacity. Only the owning thread pushes and
+// pops, any thread steals.
+struct JobDeque {
+  alignas(64) std::atomic<std::int64_t> top{0};
+  alignas(64) std::atomic<std::int64_t> bottom{0};
+  std::array<std::atomic<Job*>, job_deque_capacity> jobs{};
+};
+
+bool push_job(JobDeque& deque, Job* job);
+Job* pop_job(JobDeque& deque);
+Job* steal_job(JobDeque& deque);
+
+struct JobSystem {
+  // deques[0] belongs to the main thread, the thread that created the
+  // system, the rest to one worker each.
+  std::vector<std::unique_ptr<JobDeque>> deques;
+  std::thread::id main_thread;
+
+  // Jobs for the main thread only, and jobs submitted from threads that
+  // aren't the system's own.
+  std::mutex queue_mutex;
+  std::deque<Job*> main_thread_jobs;
+  std::deque<Job*> injected_jobs;
+
+  // Threads out of work sleep until epoch moves. It moves on every submit
+  // while anyone is asleep and whenever a counter reaches zero.
+  std::mutex sleep_mutex;
+  std::condition_variable_any wake;
+  std::uint64_t epoch = 0;
+  std::atomic<std::uint32_t> sleeping{0};
+
+  // First exception thrown by a job, rethrown by the next wait.
+  std::mutex failure_mutex;
+  std::exception_ptr failure;
+  // Last so the workers are stopped and joined before anything they use is
+  // destroyed.
+  std::vector<std::jthread> workers;
+};
+
+// thread_count includes the calling thread, which becomes the main thread.
+std::unique_ptr<JobSystem> create_job_system(
+    const std::size_t thread_count = std::thread::hardware_concurrency());
+
+std::size_t job_thread_count(const JobSystem& system);
+
+// counter is incremented here and decremented once the job has run, so it
+// can be waited on right away.
+void submit_job(JobSystem& system, std::function<void()> function,
+                JobCounter* counter = nullptr);
+void submit_main_thread_job(JobSystem& system, std::function<void()> function,
+                            JobCounter* counter = nullptr);
+
+// Runs jobs until the counter reaches zero, sleeping when there are none.
+// Main thread jobs only get to run while the main thread is in here. With
+// main_thread_jobs_only the main thread leaves every other job to the
+// workers, so it is free the moment main thread work shows up.
+void wait_for_counter(JobSystem& system, const JobCounter& counter,
+                      const bool main_thread_jobs_only = false);
+
+// Splits [0, count) into slices of about grain items run as jobs, returns
+// once every slice has run.
+void parallel_for(
+    JobSystem& system, const std::size_t count, const std::size_t grain,
+    const std::function<void(std::size_t first, std::size_t count)>& function);
@@ -0,0 +1,45 @@
+#include "mapped_file.hpp"
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+std::optional<MappedFile> map_file(const std::filesystem::path& path) {
+  const auto descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (descriptor < 0) {
+    return std::nullopt;
+  }
+  const auto size = lseek(descriptor, 0, SEEK_END);
+  if (size <= 0) {
+    ::close(descriptor);
+    return std::nullopt;
+  }
+  auto* const address =
+      mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+  // The mapping keeps the file alive on its own.
+  ::close(descriptor);
+  if (address == MAP_FAILED) {
+    return std::nullopt;
+  }
+  return MappedFile{std::shared_ptr<const std::byte>{
+                        static_cast<const std::byte*>(address),
+                        [size](const std::byte* mapped) {
+                          munmap(const_cast<std::byte*>(mapped), size);
+                        }},
+                    static_cast<std::size_t>(size)};
+}
+
+void prefetch_mapped_range(const MappedFile& file, const std::size_t offset,
+                           const std::size_t size) {
+  // madvise wants a page aligned start.
+  const auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  const auto start     = offset / page_size * page_size;
+  if (start >= file.size) {
+    return;
+  }
+  const auto length = std::min(offset + size, file.size) - start;
+  madvise(const_cast<std::byte*>(file.data.get()) + start, length,
+          MADV_WILLNEED);
+}
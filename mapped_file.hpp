@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <optional>
+
+// A read only mapping of a whole file, unmapped when the last copy goes away.
+struct MappedFile {
+  std::shared_ptr<const std::byte> data;
+  std::size_t size = 0;
+};
+
+std::optional<MappedFile> map_file(const std::filesystem::path& path);
+
+// Asks the kernel to start reading the range in, so the first touch doesn't
+// stall on a page fault. Purely a hint.
+void prefetch_mapped_range(const MappedFile& file, const std::size_t offset,
+                           const std::size_t size);
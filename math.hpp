@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+
+// Just enough linear algebra for cameras and culling. Matrices are column
+// major like GLSL so they can be copied into buffers as is.
+
+struct Vec3 {
+  float x = 0.0f;
+  float y = 0.0f;
+  float z = 0.0f;
+};
+
+struct Vec4 {
+  float x = 0.0f;
+  float y = 0.0f;
+  float z = 0.0f;
+  float w = 0.0f;
+};
+
+constexpr Vec3 operator+(const Vec3& left, const Vec3& right) {
+  return {left.x + right.x, left.y + right.y, left.z + right.z};
+}
+
+constexpr Vec3 operator-(const Vec3& left, const Vec3& right) {
+  return {left.x - right.x, left.y - right.y, left.z - right.z};
+}
+
+constexpr Vec3 operator*(const Vec3& vector, const float factor) {
+  return {vector.x * factor, vector.y * factor, vector.z * factor};
+}
+
+constexpr float dot(const Vec3& left, const Vec3& right) {
+  return left.x * right.x + left.y * right.y + left.z * right.z;
+}
+
+constexpr Vec3 cross(const Vec3& left, const Vec3& right) {
+  return {left.y * right.z - left.z * right.y,
+          left.z * right.x - left.x * right.z,
+          left.x * right.y - left.y * right.x};
+}
+
+inline float length(const Vec3& vector) {
+  return std::sqrt(dot(vector, vector));
+}
+
+struct Mat4 {
+  std::array<float, 16> elements{};
+
+  // column, row
+  constexpr float& at(const int column, const int row) {
+    return elements[column * 4 + row];
+  }
+  constexpr float at(const int column, const int row) const {
+    return elements[column * 4 + row];
+  }
+};
+
+constexpr Mat4 identity() {
+  auto matrix = Mat4{};
+  for (auto index = 0; index < 4; ++index) {
+    matrix.at(index, index) = 1.0f;
+  }
+  return matrix;
+}
+
+constexpr Mat4 operator*(const Mat4& left, const Mat4& right) {
+  auto product = Mat4{};
+  for (auto column = 0; column < 4; ++column) {
+    for (auto row = 0; row < 4; ++row) {
+      auto sum = 0.0f;
+      for (auto index = 0; index < 4; ++index) {
+        sum += left.at(index, row) * right.at(column, index);
+      }
+      product.at(column, row) = sum;
+    }
+  }
+  return product;
+}
+
+constexpr Mat4 translation(const Vec3& offset) {
+  auto matrix     = identity();
+  matrix.at(3, 0) = offset.x;
+  matrix.at(3, 1) = offset.y;
+  matrix.at(3, 2) = offset.z;
+  return matrix;
+}
+
+constexpr Mat4 scale(const float factor) {
+  auto matrix     = identity();
+  matrix.at(0, 0) = factor;
+  matrix.at(1, 1) = factor;
+  matrix.at(2, 2) = factor;
+  return matrix;
+}
+
+// Right handed view space looking down -Z into Vulkan clip space: y points
+// down and depth goes from 0 at the near plane to 1 at the far plane.
+inline Mat4 perspective(const float vertical_fov, const float aspect,
+                        const float near, const float far) {
+  const auto focal = 1.0f / std::tan(vertical_fov / 2.0f);
+  auto matrix      = Mat4{};
+  matrix.at(0, 0)  = focal / aspect;
+  matrix.at(1, 1)  = -focal;
+  matrix.at(2, 2)  = far / (near - far);
+  matrix.at(2, 3)  = -1.0f;
+  matrix.at(3, 2)  = near * far / (near - far);
+  return matrix;
+}
+
+// Left, right, bottom, top, near, far. A point p is inside a plane when
+// dot(plane.xyz, p) + plane.w >= 0, and the normals are unit length so that
+// value is a distance that can be compared against a radius.
+using Frustum = std::array<Vec4, 6>;
+
+inline Frustum extract_frustum_planes(const Mat4& view_projection) {
+  const auto row = [&view_projection](const int index) {
+    return Vec4{view_projection.at(0, index), view_projection.at(1, index),
+                view_projection.at(2, index), view_projection.at(3, index)};
+  };
+  const auto add = [](const Vec4& a, const Vec4& b) {
+    return Vec4{a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w};
+  };
+  const auto subtract = [](const Vec4& a, const Vec4& b) {
+    return Vec4{a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w};
+  };
+  const auto normalize = [](const Vec4& plane) {
+    const auto length =
+        std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+    return Vec4{plane.x / length, plane.y / length, plane.z / length,
+                plane.w / length};
+  };
+  const auto x = row(0);
+  const auto y = row(1);
+  const auto z = row(2);
+  const auto w = row(3);
+  // Vulkan clips depth to [0, w] rather than [-w, w], so near is just z.
+  return {normalize(add(w, x)),      normalize(subtract(w, x)),
+          normalize(add(w, y)),      normalize(subtract(w, y)),
+          normalize(z),              normalize(subtract(w, z))};
+}
@@ -0,0 +1,52 @@
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <span>
+#include <vector>
+
+#include "mesh_format.hpp"
+#include "mesh_import.hpp"
+
+// Offline converter from OBJ and glTF to a mesh pack. Every mesh of every
+// input ends up in the one pack, in order.
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::cerr << "usage: picante_mesh_convert OUTPUT.pmesh INPUT...\n"
+                 "inputs: .obj, .gltf, .glb\n";
+    return 1;
+  }
+  const auto output = std::filesystem::path{argv[1]};
+  auto meshes       = std::vector<MeshData>{};
+  for (const auto* const input : std::span{argv + 2, argv + argc}) {
+    auto imported = import_meshes(input);
+    if (!imported) {
+      std::cerr << "Failed to import " << input << "\n";
+      return 1;
+    }
+    std::ranges::move(*imported, std::back_inserter(meshes));
+  }
+  if (!write_mesh_pack(output, meshes)) {
+    std::cerr << "Failed to write " << output << "\n";
+    return 1;
+  }
+
+  // Read the pack back rather than trusting what was meant to be written.
+  const auto pack = open_mesh_pack(output);
+  if (!pack) {
+    std::cerr << "Wrote an invalid pack to " << output << "\n";
+    return 1;
+  }
+  for (const auto& record : pack->meshes) {
+    std::cout << mesh_name(record) << ": " << record.vertex_count
+              << " vertices, " << record.lod_count << " LODs, "
+              << record.meshlet_count << " meshlets\n";
+    for (const auto& lod : std::span{record.lods}.first(record.lod_count)) {
+      std::cout << "  " << lod.index_count / 3 << " triangles, "
+                << lod.meshlet_count << " meshlets, error " << lod.error
+                << "\n";
+    }
+  }
+  std::cout << output.string() << ": " << pack->file.size << " bytes\n";
+  return 0;
+}
@@ -0,0 +1,280 @@
+#include "mesh_format.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <ranges>
+#include <unordered_map>
+
+Vec4 compute_bounds(const std::span<const MeshVertex> vertices,
+                    const std::span<const std::uint32_t> indices) {
+  if (indices.empty()) {
+    return {};
+  }
+  auto low  = vertices[indices.front()].position;
+  auto high = low;
+  for (const auto index : indices) {
+    const auto& position = vertices[index].position;
+    low  = {std::min(low.x, position.x), std::min(low.y, position.y),
+            std::min(low.z, position.z)};
+    high = {std::max(high.x, position.x), std::max(high.y, position.y),
+            std::max(high.z, position.z)};
+  }
+  const auto center = Vec3{(low.x + high.x) / 2.0f, (low.y + high.y) / 2.0f,
+                           (low.z + high.z) / 2.0f};
+  auto radius_squared = 0.0f;
+  for (const auto index : indices) {
+    const auto& position = vertices[index].position;
+    const auto x         = position.x - center.x;
+    const auto y         = position.y - center.y;
+    const auto z         = position.z - center.z;
+    radius_squared       = std::max(radius_squared, x * x + y * y + z * z);
+  }
+  return {center.x, center.y, center.z, std::sqrt(radius_squared)};
+}
+
+std::vector<std::uint32_t>
+simplify_mesh(const std::span<const MeshVertex> vertices,
+              const std::span<const std::uint32_t> indices,
+              const float cell_size) {
+  // 21 bits per axis is a couple of million cells, more than any LOD wants.
+  const auto cell_key = [cell_size](const Vec3& position) {
+    const auto axis = [cell_size](const float value) {
+      return static_cast<std::uint64_t>(
+                 static_cast<std::int64_t>(std::floor(value / cell_size))) &
+             0x1fffff;
+    };
+    return axis(position.x) << 42 | axis(position.y) << 21 | axis(position.z);
+  };
+  // The first vertex to land in a cell stands in for all the others.
+  auto representatives = std::unordered_map<std::uint64_t, std::uint32_t>{};
+  const auto representative = [&](const std::uint32_t index) {
+    return representatives
+        .try_emplace(cell_key(vertices[index].position), index)
+        .first->second;
+  };
+  auto simplified = std::vector<std::uint32_t>{};
+  for (std::size_t triangle = 0; triangle + 2 < indices.size();
+       triangle += 3) {
+    const auto a = representative(indices[triangle]);
+    const auto b = representative(indices[triangle + 1]);
+    const auto c = representative(indices[triangle + 2]);
+    if (a != b && b != c && a != c) {
+      simplified.insert(simplified.end(), {a, b, c});
+    }
+  }
+  return simplified;
+}
+
+std::vector<Meshlet>
+build_meshlets(const std::span<const MeshVertex> vertices,
+               const std::span<const std::uint32_t> indices,
+               const std::uint32_t first_index) {
+  auto meshlets        = std::vector<Meshlet>{};
+  auto unique_vertices = std::vector<std::uint32_t>{};
+  auto start           = std::size_t{0};
+  const auto close     = [&](const std::size_t end) {
+    if (end == start) {
+      return;
+    }
+    const auto meshlet_indices = indices.subspan(start, end - start);
+    meshlets.push_back({first_index + static_cast<std::uint32_t>(start),
+                        static_cast<std::uint32_t>(meshlet_indices.size()),
+                        compute_bounds(vertices, meshlet_indices)});
+    unique_vertices.clear();
+    start = end;
+  };
+  for (std::size_t triangle = 0; triangle + 2 < indices.size();
+       triangle += 3) {
+    const auto corners  = indices.subspan(triangle, 3);
+    const auto new_ones = std::ranges::count_if(
+        corners, [&unique_vertices](const std::uint32_t index) {
+          return !std::ranges::contains(unique_vertices, index);
+        });
+    if (unique_vertices.size() + new_ones > max_meshlet_vertices ||
+        (triangle - start) / 3 == max_meshlet_triangles) {
+      close(triangle);
+    }
+    for (const auto index : corners) {
+      if (!std::ranges::contains(unique_vertices, index)) {
+        unique_vertices.push_back(index);
+      }
+    }
+  }
+  close(indices.size() - indices.size() % 3);
+  return meshlets;
+}
+
+std::uint64_t align_blob(const std::uint64_t offset) {
+  return (offset + mesh_blob_alignment - 1) / mesh_blob_alignment *
+         mesh_blob_alignment;
+}
+
+// LOD 0 is the mesh as is, every further level doubles the clustering cell
+// until simplifying stops paying off.
+void build_lods(const MeshData& mesh, MeshRecord& record,
+                std::vector<std::uint32_t>& indices,
+                std::vector<Meshlet>& meshlets) {
+  auto level_indices = mesh.indices;
+  auto error         = 0.0f;
+  auto cell_size     = record.bounds.w / 32.0f;
+  while (record.lod_count < max_mesh_lods) {
+    auto& lod         = record.lods[record.lod_count++];
+    lod.first_index   = static_cast<std::uint32_t>(indices.size());
+    lod.index_count   = static_cast<std::uint32_t>(level_indices.size());
+    lod.first_meshlet = static_cast<std::uint32_t>(meshlets.size());
+    lod.error         = error;
+    const auto level_meshlets =
+        build_meshlets(mesh.vertices, level_indices, lod.first_index);
+    lod.meshlet_count = static_cast<std::uint32_t>(level_meshlets.size());
+    indices.insert(indices.end(), level_indices.begin(), level_indices.end());
+    meshlets.insert(meshlets.end(), level_meshlets.begin(),
+                    level_meshlets.end());
+    if (cell_size <= 0.0f) {
+      break;
+    }
+    auto next = simplify_mesh(mesh.vertices, level_indices, cell_size);
+    if (next.empty() || next.size() * 5 > level_indices.size() * 4) {
+      break;
+    }
+    level_indices = std::move(next);
+    error         = cell_size;
+    cell_size *= 2.0f;
+  }
+}
+
+template <typename T>
+void write_blob(std::ofstream& stream, const std::uint64_t offset,
+                const std::span<const T> blob) {
+  // Zero padding up to the blob's page.
+  const auto position = static_cast<std::uint64_t>(stream.tellp());
+  std::fill_n(std::ostreambuf_iterator<char>{stream}, offset - position, '\0');
+  stream.write(reinterpret_cast<const char*>(blob.data()),
+               static_cast<std::streamsize>(blob.size_bytes()));
+}
+
+bool write_mesh_pack(const std::filesystem::path& path,
+                     const std::span<const MeshData> meshes) {
+  using IndexBlob       = std::vector<std::uint32_t>;
+  auto records          = std::vector<MeshRecord>(meshes.size());
+  auto index_blobs      = std::vector<IndexBlob>(meshes.size());
+  auto meshlet_blobs    = std::vector<std::vector<Meshlet>>(meshes.size());
+  auto header           = MeshPackHeader{};
+  header.mesh_count     = static_cast<std::uint32_t>(meshes.size());
+  header.records_offset = sizeof(MeshPackHeader);
+  auto offset = header.records_offset + records.size() * sizeof(MeshRecord);
+  for (const auto [mesh, record, indices, meshlets] :
+       std::views::zip(meshes, records, index_blobs, meshlet_blobs)) {
+    const auto name_length = std::min(mesh.name.size(), record.name.size() - 1);
+    std::ranges::copy_n(mesh.name.begin(), name_length, record.name.begin());
+    record.bounds = compute_bounds(mesh.vertices, mesh.indices);
+    build_lods(mesh, record, indices, meshlets);
+    record.vertex_count  = static_cast<std::uint32_t>(mesh.vertices.size());
+    record.index_count   = static_cast<std::uint32_t>(indices.size());
+    record.meshlet_count = static_cast<std::uint32_t>(meshlets.size());
+    const auto vertex_bytes = mesh.vertices.size() * sizeof(MeshVertex);
+    const auto index_bytes  = indices.size() * sizeof(std::uint32_t);
+    record.vertex_offset    = align_blob(offset);
+    record.index_offset     = align_blob(record.vertex_offset + vertex_bytes);
+    record.meshlet_offset   = align_blob(record.index_offset + index_bytes);
+    offset = record.meshlet_offset + meshlets.size() * sizeof(Meshlet);
+  }
+  header.file_size = offset;
+
+  auto stream = std::ofstream{path, std::ios::binary | std::ios::trunc};
+  stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  stream.write(reinterpret_cast<const char*>(records.data()),
+               static_cast<std::streamsize>(records.size() *
+                                            sizeof(MeshRecord)));
+  for (const auto [mesh, record, indices, meshlets] :
+       std::views::zip(meshes, records, index_blobs, meshlet_blobs)) {
+    write_blob(stream, record.vertex_offset,
+               std::span<const MeshVertex>{mesh.vertices});
+    write_blob(stream, record.index_offset,
+               std::span<const std::uint32_t>{indices});
+    write_blob(stream, record.meshlet_offset,
+               std::span<const Meshlet>{meshlets});
+  }
+  return static_cast<bool>(stream);
+}
+
+// Whether count elements of stride bytes at offset fit in a file of size
+// bytes, without overflowing on garbage.
+bool fits_in_file(const std::uint64_t offset, const std::uint64_t count,
+                  const std::uint64_t stride, const std::uint64_t size) {
+  return offset <= size && count <= (size - offset) / stride;
+}
+
+bool is_valid_record(const MeshRecord& record, const std::uint64_t size) {
+  if (!fits_in_file(record.vertex_offset, record.vertex_count,
+                    sizeof(MeshVertex), size) ||
+      !fits_in_file(record.index_offset, record.index_count,
+                    sizeof(std::uint32_t), size) ||
+      !fits_in_file(record.meshlet_offset, record.meshlet_count,
+                    sizeof(Meshlet), size) ||
+      record.lod_count == 0 || record.lod_count > max_mesh_lods) {
+    return false;
+  }
+  return std::ranges::all_of(
+      std::span{record.lods}.first(record.lod_count),
+      [&record](const MeshLod& lod) {
+        return lod.first_index <= record.index_count &&
+               lod.index_count <= record.index_count - lod.first_index &&
+               lod.first_meshlet <= record.meshlet_count &&
+               lod.meshlet_count <= record.meshlet_count - lod.first_meshlet;
+      });
+}
+
+std::optional<MeshPack> open_mesh_pack(const std::filesystem::path& path) {
+  auto file = map_file(path);
+  if (!file || file->size < sizeof(MeshPackHeader)) {
+    return std::nullopt;
+  }
+  auto header = MeshPackHeader{};
+  std::memcpy(&header, file->data.get(), sizeof(header));
+  if (header.magic != mesh_pack_magic ||
+      header.version != mesh_pack_version ||
+      header.file_size != file->size ||
+      header.records_offset % alignof(MeshRecord) != 0 ||
+      !fits_in_file(header.records_offset, header.mesh_count,
+                    sizeof(MeshRecord), file->size)) {
+    return std::nullopt;
+  }
+  // mmap hands out page aligned memory and everything in the pack is
+  // aligned within it.
+  const auto meshes = std::span{reinterpret_cast<const MeshRecord*>(
+                                    file->data.get() + header.records_offset),
+                                header.mesh_count};
+  if (!std::ranges::all_of(meshes, [&file](const MeshRecord& record) {
+        return is_valid_record(record, file->size);
+      })) {
+    return std::nullopt;
+  }
+  return MeshPack{std::move(*file), meshes};
+}
+
+std::string_view mesh_name(const MeshRecord& record) {
+  const auto end = std::ranges::find(record.name, '\0');
+  return {record.name.begin(), end};
+}
+
+std::span<const std::byte> mesh_vertex_bytes(const MeshPack& pack,
+                                             const MeshRecord& record) {
+  return {pack.file.data.get() + record.vertex_offset,
+          record.vertex_count * sizeof(MeshVertex)};
+}
+
+std::span<const std::byte> mesh_index_bytes(const MeshPack& pack,
+                                            const MeshRecord& record) {
+  return {pack.file.data.get() + record.index_offset,
+          record.index_count * sizeof(std::uint32_t)};
+}
+
+std::span<const Meshlet> mesh_meshlets(const MeshPack& pack,
+                                       const MeshRecord& record) {
+  return {reinterpret_cast<const Meshlet*>(pack.file.data.get() +
+                                           record.meshlet_offset),
+          record.meshlet_count};
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mapped_file.hpp"
+#include "math.hpp"
+
+// Mesh packs, picante's geometry format. A header, a table of mesh records
+// and page aligned vertex, index and meshlet blobs, all little endian and in
+// the layout the GPU wants, so a pack is mmapped rather than parsed and its
+// blobs are copied straight from the mapping into staging memory. Written
+// offline by picante_mesh_convert. Nothing in here needs Vulkan.
+
+constexpr std::array<char, 4> mesh_pack_magic{'P', 'M', 'S', 'H'};
+constexpr std::uint32_t mesh_pack_version = 1;
+// Blobs start on a page so streaming one touches no page of its neighbours.
+constexpr std::uint64_t mesh_blob_alignment   = 4096;
+constexpr std::size_t max_mesh_lods           = 4;
+constexpr std::uint32_t max_meshlet_vertices  = 64;
+constexpr std::uint32_t max_meshlet_triangles = 124;
+
+struct MeshVertex {
+  Vec3 position;
+  Vec3 normal;
+  float u = 0.0f;
+  float v = 0.0f;
+};
+static_assert(sizeof(MeshVertex) == 32);
+
+// A run of triangles in the index blob small enough to be culled on its own,
+// with a bounding sphere in the w-is-radius layout cull.comp uses.
+struct Meshlet {
+  std::uint32_t first_index = 0;
+  std::uint32_t index_count = 0;
+  Vec4 bounds;
+};
+static_assert(sizeof(Meshlet) == 24);
+
+// Every LOD indexes the same vertices, only the index range differs. error is
+// how far in object space the simplified surface may stray from the
+// original, zero for LOD 0.
+struct MeshLod {
+  std::uint32_t first_index   = 0;
+  std::uint32_t index_count   = 0;
+  std::uint32_t first_meshlet = 0;
+  std::uint32_t meshlet_count = 0;
+  float error                 = 0.0f;
+  std::uint32_t reserved      = 0;
+};
+static_assert(sizeof(MeshLod) == 24);
+
+// Offsets are from the start of the file.
+struct MeshRecord {
+  std::array<char, 48> name{};
+  std::uint64_t vertex_offset  = 0;
+  std::uint64_t index_offset   = 0;
+  std::uint64_t meshlet_offset = 0;
+  std::uint32_t vertex_count   = 0;
+  std::uint32_t index_count    = 0;
+  std::uint32_t meshlet_count  = 0;
+  std::uint32_t lod_count      = 0;
+  Vec4 bounds;
+  std::array<MeshLod, max_mesh_lods> lods{};
+};
+static_assert(sizeof(MeshRecord) == 200);
+
+struct MeshPackHeader {
+  std::array<char, 4> magic    = mesh_pack_magic;
+  std::uint32_t version        = mesh_pack_version;
+  std::uint32_t mesh_count     = 0;
+  std::uint32_t reserved       = 0;
+  std::uint64_t records_offset = 0;
+  std::uint64_t file_size      = 0;
+};
+static_assert(sizeof(MeshPackHeader) == 32);
+
+// One mesh as an importer produces it, before LODs and meshlets.
+struct MeshData {
+  std::string name;
+  std::vector<MeshVertex> vertices;
+  std::vector<std::uint32_t> indices;
+};
+
+// Sphere around the centre of the bounding box.
+Vec4 compute_bounds(const std::span<const MeshVertex> vertices,
+                    const std::span<const std::uint32_t> indices);
+
+// Vertex clustering: snaps vertices to a grid of cell_size and keeps the
+// triangles whose corners still land in three different cells. Crude next
+// to quadric simplification but fast, and the result keeps indexing the
+// original vertices so all LODs share one vertex blob.
+std::vector<std::uint32_t>
+simplify_mesh(const std::span<const MeshVertex> vertices,
+              const std::span<const std::uint32_t> indices,
+              const float cell_size);
+
+// Greedily cuts the triangle list into meshlets of at most
+// max_meshlet_vertices unique vertices and max_meshlet_triangles triangles.
+// first_index is where indices starts in the mesh's index blob.
+std::vector<Meshlet>
+build_meshlets(const std::span<const MeshVertex> vertices,
+               const std::span<const std::uint32_t> indices,
+               const std::uint32_t first_index);
+
+bool write_mesh_pack(const std::filesystem::path& path,
+                     const std::span<const MeshData> meshes);
+
+struct MeshPack {
+  MappedFile file;
+  std::span<const MeshRecord> meshes;
+};
+
+// Maps the pack and checks that every record points inside the file. Reads
+// nothing past the record table, the blobs are paged in as they're used.
+std::optional<MeshPack> open_mesh_pack(const std::filesystem::path& path);
+
+std::string_view mesh_name(const MeshRecord& record);
+
+// Raw blobs, for copying to the GPU as is.
+std::span<const std::byte> mesh_vertex_bytes(const MeshPack& pack,
+                                             const MeshRecord& record);
+std::span<const std::byte> mesh_index_bytes(const MeshPack& pack,
+                                            const MeshRecord& record);
+
+std::span<const Meshlet> mesh_meshlets(const MeshPack& pack,
+                                       const MeshRecord& record);
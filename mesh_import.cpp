@@ -0,0 +1,766 @@
+#include "mesh_import.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <variant>
+
+#include "mapped_file.hpp"
+
+void generate_normals(MeshData& mesh) {
+  for (auto& vertex : mesh.vertices) {
+    vertex.normal = {};
+  }
+  // The cross product's length is twice the triangle's area, so summing the
+  // unnormalised ones weights every face by its size.
+  for (std::size_t triangle = 0; triangle + 2 < mesh.indices.size();
+       triangle += 3) {
+    auto& a           = mesh.vertices[mesh.indices[triangle]];
+    auto& b           = mesh.vertices[mesh.indices[triangle + 1]];
+    auto& c           = mesh.vertices[mesh.indices[triangle + 2]];
+    const auto normal = cross(b.position - a.position, c.position - a.position);
+    a.normal          = a.normal + normal;
+    b.normal          = b.normal + normal;
+    c.normal          = c.normal + normal;
+  }
+  for (auto& vertex : mesh.vertices) {
+    const auto normal_length = length(vertex.normal);
+    vertex.normal            = normal_length > 0.0f
+                                   ? vertex.normal * (1.0f / normal_length)
+                                   : Vec3{0.0f, 0.0f, 1.0f};
+  }
+}
+
+std::string_view mapped_text(const MappedFile& file) {
+  return {reinterpret_cast<const char*>(file.data.get()), file.size};
+}
+
+std::string_view next_token(std::string_view& line) {
+  const auto start = line.find_first_not_of(" \t\r");
+  if (start == std::string_view::npos) {
+    line = {};
+    return {};
+  }
+  line            = line.substr(start);
+  const auto end  = std::min(line.find_first_of(" \t\r"), line.size());
+  const auto word = line.substr(0, end);
+  line            = line.substr(end);
+  return word;
+}
+
+template <typename T>
+std::optional<T> parse_number(const std::string_view text) {
+  auto value        = T{};
+  const auto result = std::from_chars(text.data(), text.data() + text.size(),
+                                      value);
+  if (result.ec != std::errc{} || result.ptr != text.data() + text.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+// OBJ indices count from 1, negative ones from the end of what has been
+// read so far. Turns either into a zero based index, -1 if absent.
+std::optional<int> resolve_obj_index(const std::string_view text,
+                                     const std::size_t count) {
+  if (text.empty()) {
+    return -1;
+  }
+  const auto index = parse_number<int>(text);
+  if (!index || *index == 0) {
+    return std::nullopt;
+  }
+  const auto resolved =
+      *index < 0 ? static_cast<long long>(count) + *index : *index - 1LL;
+  if (resolved < 0 || resolved >= static_cast<long long>(count)) {
+    return std::nullopt;
+  }
+  return static_cast<int>(resolved);
+}
+
+struct CornerHash {
+  std::size_t operator()(const std::array<int, 3>& corner) const {
+    return std::hash<std::uint64_t>{}(
+        static_cast<std::uint64_t>(corner[0]) * 0x9e3779b97f4a7c15ull ^
+        static_cast<std::uint64_t>(corner[1]) << 21 ^
+        static_cast<std::uint64_t>(corner[2]));
+  }
+};
+
+std::optional<std::vector<MeshData>>
+import_obj(const std::filesystem::path& path) {
+  const auto file = map_file(path);
+  if (!file) {
+    return std::nullopt;
+  }
+  auto positions   = std::vector<Vec3>{};
+  auto normals     = std::vector<Vec3>{};
+  auto texcoords   = std::vector<std::array<float, 2>>{};
+  auto meshes      = std::vector<MeshData>{};
+  auto mesh        = MeshData{path.stem().string(), {}, {}};
+  auto corners     = std::unordered_map<std::array<int, 3>, std::uint32_t,
+                                        CornerHash>{};
+  auto has_normals = true;
+  const auto finish_mesh = [&](std::string next_name) {
+    if (!mesh.indices.empty()) {
+      if (!has_normals) {
+        generate_normals(mesh);
+      }
+      meshes.push_back(std::move(mesh));
+    }
+    mesh        = MeshData{std::move(next_name), {}, {}};
+    has_normals = true;
+    corners.clear();
+  };
+  const auto read_floats = [](std::string_view& line, auto&... values) {
+    const auto read = [&line](float& value) {
+      const auto parsed = parse_number<float>(next_token(line));
+      value             = parsed.value_or(0.0f);
+      return parsed.has_value();
+    };
+    return (read(values) && ...);
+  };
+  // Looks up or appends the vertex for one v/vt/vn corner of a face.
+  const auto read_corner =
+      [&](const std::string_view corner) -> std::optional<std::uint32_t> {
+    const auto first_slash  = corner.find('/');
+    const auto second_slash = first_slash == std::string_view::npos
+                                  ? std::string_view::npos
+                                  : corner.find('/', first_slash + 1);
+    const auto field = [&corner](const std::size_t start,
+                                 const std::size_t end) {
+      return start >= corner.size() ? std::string_view{}
+                                    : corner.substr(start, end - start);
+    };
+    const auto position = resolve_obj_index(corner.substr(0, first_slash),
+                                            positions.size());
+    const auto texcoord =
+        first_slash == std::string_view::npos
+            ? std::optional{-1}
+            : resolve_obj_index(field(first_slash + 1, second_slash),
+                                texcoords.size());
+    const auto normal =
+        second_slash == std::string_view::npos
+            ? std::optional{-1}
+            : resolve_obj_index(field(second_slash + 1, corner.size()),
+                                normals.size());
+    if (!position || *position < 0 || !texcoord || !normal) {
+      return std::nullopt;
+    }
+    const auto key = std::array{*position, *texcoord, *normal};
+    const auto [entry, inserted] =
+        corners.try_emplace(key, static_cast<std::uint32_t>(
+                                     mesh.vertices.size()));
+    if (inserted) {
+      auto vertex     = MeshVertex{};
+      vertex.position = positions[*position];
+      if (*texcoord >= 0) {
+        // OBJ puts v = 0 at the bottom, Vulkan samples from the top.
+        vertex.u = texcoords[*texcoord][0];
+        vertex.v = 1.0f - texcoords[*texcoord][1];
+      }
+      if (*normal >= 0) {
+        vertex.normal = normals[*normal];
+      } else {
+        has_normals = false;
+      }
+      mesh.vertices.push_back(vertex);
+    }
+    return entry->second;
+  };
+
+  auto text = mapped_text(*file);
+  while (!text.empty()) {
+    const auto line_end = std::min(text.find('\n'), text.size());
+    auto line           = text.substr(0, line_end);
+    text = text.substr(std::min(line_end + 1, text.size()));
+    line = line.substr(0, std::min(line.find('#'), line.size()));
+    const auto keyword = next_token(line);
+    if (keyword == "v") {
+      auto& position = positions.emplace_back();
+      if (!read_floats(line, position.x, position.y, position.z)) {
+        return std::nullopt;
+      }
+    } else if (keyword == "vn") {
+      auto& normal = normals.emplace_back();
+      if (!read_floats(line, normal.x, normal.y, normal.z)) {
+        return std::nullopt;
+      }
+    } else if (keyword == "vt") {
+      auto& texcoord = texcoords.emplace_back();
+      if (!read_floats(line, texcoord[0], texcoord[1])) {
+        return std::nullopt;
+      }
+    } else if (keyword == "f") {
+      auto polygon = std::vector<std::uint32_t>{};
+      for (auto corner = next_token(line); !corner.empty();
+           corner      = next_token(line)) {
+        const auto index = read_corner(corner);
+        if (!index) {
+          return std::nullopt;
+        }
+        polygon.push_back(*index);
+      }
+      for (std::size_t corner = 2; corner < polygon.size(); ++corner) {
+        mesh.indices.insert(mesh.indices.end(),
+                            {polygon[0], polygon[corner - 1], polygon[corner]});
+      }
+    } else if (keyword == "o" || keyword == "g") {
+      const auto name = next_token(line);
+      finish_mesh(name.empty() ? path.stem().string() : std::string{name});
+    }
+  }
+  finish_mesh({});
+  return meshes;
+}
+
+// Just enough JSON for glTF: no validation beyond what parsing needs, numbers
+// are all doubles.
+struct JsonValue;
+using JsonArray = std::vector<JsonValue>;
+struct JsonObject {
+  std::vector<std::string> keys;
+  std::vector<JsonValue> values;
+};
+struct JsonValue {
+  std::variant<std::monostate, bool, double, std::string, JsonArray,
+               JsonObject>
+      value;
+};
+
+struct JsonParser {
+  std::string_view text;
+  std::size_t position = 0;
+};
+
+void skip_whitespace(JsonParser& parser) {
+  while (parser.position < parser.text.size() &&
+         std::string_view{" \t\r\n"}.contains(parser.text[parser.position])) {
+    ++parser.position;
+  }
+}
+
+bool consume(JsonParser& parser, const char expected) {
+  skip_whitespace(parser);
+  if (parser.position < parser.text.size() &&
+      parser.text[parser.position] == expected) {
+    ++parser.position;
+    return true;
+  }
+  return false;
+}
+
+void append_utf8(std::string& out, const std::uint32_t code_point) {
+  if (code_point < 0x80) {
+    out += static_cast<char>(code_point);
+  } else if (code_point < 0x800) {
+    out += static_cast<char>(0xc0 | code_point >> 6);
+    out += static_cast<char>(0x80 | (code_point & 0x3f));
+  } else {
+    out += static_cast<char>(0xe0 | code_point >> 12);
+    out += static_cast<char>(0x80 | (code_point >> 6 & 0x3f));
+    out += static_cast<char>(0x80 | (code_point & 0x3f));
+  }
+}
+
+std::optional<std::string> parse_json_string(JsonParser& parser) {
+  if (!consume(parser, '"')) {
+    return std::nullopt;
+  }
+  auto out         = std::string{};
+  const auto& text = parser.text;
+  while (parser.position < text.size()) {
+    const auto character = text[parser.position++];
+    if (character == '"') {
+      return out;
+    }
+    if (character != '\\') {
+      out += character;
+      continue;
+    }
+    if (parser.position == text.size()) {
+      return std::nullopt;
+    }
+    switch (const auto escaped = text[parser.position++]) {
+    case 'b':
+      out += '\b';
+      break;
+    case 'f':
+      out += '\f';
+      break;
+    case 'n':
+      out += '\n';
+      break;
+    case 'r':
+      out += '\r';
+      break;
+    case 't':
+      out += '\t';
+      break;
+    case 'u': {
+      // Surrogate pairs are encoded half by half. Names are the only strings
+      // that could hold one and they're cosmetic.
+      auto code_point = std::uint32_t{0};
+      if (parser.position + 4 > text.size() ||
+          std::from_chars(text.data() + parser.position,
+                          text.data() + parser.position + 4, code_point, 16)
+                  .ptr != text.data() + parser.position + 4) {
+        return std::nullopt;
+      }
+      parser.position += 4;
+      append_utf8(out, code_point);
+      break;
+    }
+    default:
+      out += escaped;
+      break;
+    }
+  }
+  return std::nullopt;
+}
+
+std::optional<JsonValue> parse_json_value(JsonParser& parser,
+                                          const int depth = 0) {
+  // Deep enough for any real glTF, shallow enough not to blow the stack.
+  if (depth > 64) {
+    return std::nullopt;
+  }
+  skip_whitespace(parser);
+  const auto rest = parser.text.substr(parser.position);
+  if (rest.empty()) {
+    return std::nullopt;
+  }
+  if (rest.front() == '"') {
+    return parse_json_string(parser).transform(
+        [](std::string string) { return JsonValue{std::move(string)}; });
+  }
+  if (rest.front() == '[') {
+    ++parser.position;
+    auto array = JsonArray{};
+    if (consume(parser, ']')) {
+      return JsonValue{std::move(array)};
+    }
+    do {
+      auto element = parse_json_value(parser, depth + 1);
+      if (!element) {
+        return std::nullopt;
+      }
+      array.push_back(std::move(*element));
+    } while (consume(parser, ','));
+    if (!consume(parser, ']')) {
+      return std::nullopt;
+    }
+    return JsonValue{std::move(array)};
+  }
+  if (rest.front() == '{') {
+    ++parser.position;
+    auto object = JsonObject{};
+    if (consume(parser, '}')) {
+      return JsonValue{std::move(object)};
+    }
+    do {
+      auto key = parse_json_string(parser);
+      if (!key || !consume(parser, ':')) {
+        return std::nullopt;
+      }
+      auto value = parse_json_value(parser, depth + 1);
+      if (!value) {
+        return std::nullopt;
+      }
+      object.keys.push_back(std::move(*key));
+      object.values.push_back(std::move(*value));
+    } while (consume(parser, ','));
+    if (!consume(parser, '}')) {
+      return std::nullopt;
+    }
+    return JsonValue{std::move(object)};
+  }
+  for (const auto& [literal, value] :
+       {std::pair{std::string_view{"true"}, JsonValue{true}},
+        std::pair{std::string_view{"false"}, JsonValue{false}},
+        std::pair{std::string_view{"null"}, JsonValue{}}}) {
+    if (rest.starts_with(literal)) {
+      parser.position += literal.size();
+      return value;
+    }
+  }
+  auto number       = 0.0;
+  const auto result = std::from_chars(rest.data(), rest.data() + rest.size(),
+                                      number);
+  if (result.ec != std::errc{}) {
+    return std::nullopt;
+  }
+  parser.position += result.ptr - rest.data();
+  return JsonValue{number};
+}
+
+const JsonValue* json_member(const JsonValue& value,
+                             const std::string_view key) {
+  const auto* object = std::get_if<JsonObject>(&value.value);
+  if (object == nullptr) {
+    return nullptr;
+  }
+  const auto found = std::ranges::find(object->keys, key);
+  return found == object->keys.end()
+             ? nullptr
+             : &object->values[found - object->keys.begin()];
+}
+
+const JsonArray& json_array(const JsonValue* value) {
+  static const auto empty = JsonArray{};
+  const auto* array =
+      value == nullptr ? nullptr : std::get_if<JsonArray>(&value->value);
+  return array == nullptr ? empty : *array;
+}
+
+std::optional<std::size_t> json_index(const JsonValue* value) {
+  const auto* number =
+      value == nullptr ? nullptr : std::get_if<double>(&value->value);
+  if (number == nullptr || *number < 0.0 || *number != std::floor(*number)) {
+    return std::nullopt;
+  }
+  return static_cast<std::size_t>(*number);
+}
+
+std::string_view json_string(const JsonValue* value) {
+  const auto* string =
+      value == nullptr ? nullptr : std::get_if<std::string>(&value->value);
+  return string == nullptr ? std::string_view{} : *string;
+}
+
+std::optional<std::vector<std::byte>>
+decode_base64(const std::string_view text) {
+  auto decoded = std::vector<std::byte>{};
+  decoded.reserve(text.size() / 4 * 3);
+  auto bits      = std::uint32_t{0};
+  auto bit_count = 0;
+  for (const auto character : text) {
+    if (character == '=') {
+      break;
+    }
+    constexpr auto alphabet = std::string_view{
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"};
+    const auto found = alphabet.find(character);
+    if (found == std::string_view::npos) {
+      return std::nullopt;
+    }
+    bits = bits << 6 | static_cast<std::uint32_t>(found);
+    bit_count += 6;
+    if (bit_count >= 8) {
+      bit_count -= 8;
+      decoded.push_back(static_cast<std::byte>(bits >> bit_count & 0xff));
+    }
+  }
+  return decoded;
+}
+
+// Everything the accessors can point into. The spans view either the file
+// mappings or the decoded data URIs, both kept alive alongside.
+struct GltfBuffers {
+  std::vector<MappedFile> files;
+  std::vector<std::vector<std::byte>> decoded;
+  std::vector<std::span<const std::byte>> buffers;
+};
+
+std::optional<GltfBuffers>
+load_gltf_buffers(const JsonValue& document, const std::filesystem::path& path,
+                  const std::span<const std::byte> glb_chunk) {
+  auto loaded = GltfBuffers{};
+  for (const auto& buffer : json_array(json_member(document, "buffers"))) {
+    const auto uri = json_string(json_member(buffer, "uri"));
+    if (uri.empty()) {
+      // Only the first buffer of a .glb may leave out its uri.
+      if (!loaded.buffers.empty() || glb_chunk.empty()) {
+        return std::nullopt;
+      }
+      loaded.buffers.push_back(glb_chunk);
+    } else if (uri.starts_with("data:")) {
+      const auto marker = uri.find(";base64,");
+      if (marker == std::string_view::npos) {
+        return std::nullopt;
+      }
+      auto decoded = decode_base64(uri.substr(marker + 8));
+      if (!decoded) {
+        return std::nullopt;
+      }
+      loaded.buffers.push_back(
+          loaded.decoded.emplace_back(std::move(*decoded)));
+    } else {
+      auto file = map_file(path.parent_path() / std::string{uri});
+      if (!file) {
+        return std::nullopt;
+      }
+      loaded.buffers.push_back({file->data.get(), file->size});
+      loaded.files.push_back(std::move(*file));
+    }
+  }
+  return loaded;
+}
+
+std::size_t component_size(const int component_type) {
+  switch (component_type) {
+  case 5121:
+    return 1;
+  case 5123:
+    return 2;
+  case 5125:
+  case 5126:
+    return 4;
+  default:
+    return 0;
+  }
+}
+
+std::size_t component_count(const std::string_view type) {
+  constexpr auto types = std::array<std::string_view, 4>{"SCALAR", "VEC2",
+                                                         "VEC3", "VEC4"};
+  const auto found     = std::ranges::find(types, type);
+  return found == types.end() ? 0 : found - types.begin() + 1;
+}
+
+// Reads any accessor as floats, or as integers for indices, widening the
+// component type. Normalised integer attributes come out in [0, 1], which is
+// all TEXCOORD_0 is allowed to hold. Sparse accessors aren't supported.
+template <typename T>
+std::optional<std::vector<T>>
+read_accessor(const JsonValue& document, const GltfBuffers& buffers,
+              const std::optional<std::size_t> accessor_index,
+              const std::size_t components) {
+  const auto& accessors = json_array(json_member(document, "accessors"));
+  if (!accessor_index || *accessor_index >= accessors.size()) {
+    return std::nullopt;
+  }
+  const auto& accessor = accessors[*accessor_index];
+  const auto& views    = json_array(json_member(document, "bufferViews"));
+  const auto view_index = json_index(json_member(accessor, "bufferView"));
+  const auto count      = json_index(json_member(accessor, "count"));
+  const auto type = json_index(json_member(accessor, "componentType"));
+  if (!view_index || *view_index >= views.size() || !count || !type ||
+      json_member(accessor, "sparse") != nullptr ||
+      component_count(json_string(json_member(accessor, "type"))) !=
+          components) {
+    return std::nullopt;
+  }
+  const auto& view         = views[*view_index];
+  const auto buffer_index  = json_index(json_member(view, "buffer"));
+  const auto view_length   = json_index(json_member(view, "byteLength"));
+  const auto size          = component_size(static_cast<int>(*type));
+  const auto element_size  = size * components;
+  const auto stride        = json_index(json_member(view, "byteStride"))
+                                 .value_or(element_size);
+  const auto view_offset   = json_index(json_member(view, "byteOffset"))
+                                 .value_or(0);
+  const auto accessor_offset =
+      json_index(json_member(accessor, "byteOffset")).value_or(0);
+  if (!buffer_index || *buffer_index >= buffers.buffers.size() ||
+      !view_length || size == 0 || stride < element_size) {
+    return std::nullopt;
+  }
+  const auto buffer = buffers.buffers[*buffer_index];
+  if (view_offset > buffer.size() ||
+      *view_length > buffer.size() - view_offset) {
+    return std::nullopt;
+  }
+  const auto bytes = buffer.subspan(view_offset, *view_length);
+  if (*count > 0 && (accessor_offset > bytes.size() ||
+                     (*count - 1) > (bytes.size() - accessor_offset) / stride ||
+                     accessor_offset + (*count - 1) * stride + element_size >
+                         bytes.size())) {
+    return std::nullopt;
+  }
+  auto values = std::vector<T>{};
+  values.reserve(*count * components);
+  for (std::size_t element = 0; element < *count; ++element) {
+    const auto* const start = bytes.data() + accessor_offset + element * stride;
+    for (std::size_t component = 0; component < components; ++component) {
+      const auto* const source = start + component * size;
+      switch (*type) {
+      case 5121: {
+        const auto value = std::to_integer<std::uint8_t>(*source);
+        values.push_back(std::is_floating_point_v<T> ? T(value / 255.0f)
+                                                     : T(value));
+        break;
+      }
+      case 5123: {
+        auto value = std::uint16_t{};
+        std::memcpy(&value, source, sizeof(value));
+        values.push_back(std::is_floating_point_v<T> ? T(value / 65535.0f)
+                                                     : T(value));
+        break;
+      }
+      case 5125: {
+        auto value = std::uint32_t{};
+        std::memcpy(&value, source, sizeof(value));
+        values.push_back(T(value));
+        break;
+      }
+      default: {
+        auto value = 0.0f;
+        std::memcpy(&value, source, sizeof(value));
+        values.push_back(T(value));
+        break;
+      }
+      }
+    }
+  }
+  return values;
+}
+
+// Appends one triangle primitive to the mesh. Returns whether it came with
+// normals, nullopt if it's broken.
+std::optional<bool> append_primitive(const JsonValue& document,
+                                     const GltfBuffers& buffers,
+                                     const JsonValue& primitive,
+                                     MeshData& mesh) {
+  const auto* attributes = json_member(primitive, "attributes");
+  if (attributes == nullptr) {
+    return std::nullopt;
+  }
+  const auto positions = read_accessor<float>(
+      document, buffers, json_index(json_member(*attributes, "POSITION")), 3);
+  if (!positions) {
+    return std::nullopt;
+  }
+  const auto vertex_count = positions->size() / 3;
+  const auto normals      = read_accessor<float>(
+      document, buffers, json_index(json_member(*attributes, "NORMAL")), 3);
+  const auto texcoords = read_accessor<float>(
+      document, buffers, json_index(json_member(*attributes, "TEXCOORD_0")),
+      2);
+  const auto has_normals   = normals && normals->size() == vertex_count * 3;
+  const auto has_texcoords = texcoords && texcoords->size() == vertex_count * 2;
+
+  const auto base = static_cast<std::uint32_t>(mesh.vertices.size());
+  for (std::size_t vertex = 0; vertex < vertex_count; ++vertex) {
+    auto& out    = mesh.vertices.emplace_back();
+    out.position = {(*positions)[vertex * 3], (*positions)[vertex * 3 + 1],
+                    (*positions)[vertex * 3 + 2]};
+    if (has_normals) {
+      out.normal = {(*normals)[vertex * 3], (*normals)[vertex * 3 + 1],
+                    (*normals)[vertex * 3 + 2]};
+    }
+    if (has_texcoords) {
+      out.u = (*texcoords)[vertex * 2];
+      out.v = (*texcoords)[vertex * 2 + 1];
+    }
+  }
+  const auto* indices_member = json_member(primitive, "indices");
+  if (indices_member == nullptr) {
+    for (std::uint32_t index = 0; index + 2 < vertex_count; index += 3) {
+      mesh.indices.insert(mesh.indices.end(),
+                          {base + index, base + index + 1, base + index + 2});
+    }
+    return has_normals;
+  }
+  const auto indices = read_accessor<std::uint32_t>(
+      document, buffers, json_index(indices_member), 1);
+  if (!indices || std::ranges::any_of(*indices, [vertex_count](auto index) {
+        return index >= vertex_count;
+      })) {
+    return std::nullopt;
+  }
+  for (std::size_t triangle = 0; triangle + 2 < indices->size();
+       triangle += 3) {
+    mesh.indices.insert(mesh.indices.end(),
+                        {base + (*indices)[triangle],
+                         base + (*indices)[triangle + 1],
+                         base + (*indices)[triangle + 2]});
+  }
+  return has_normals;
+}
+
+std::optional<std::vector<MeshData>>
+import_gltf(const std::filesystem::path& path) {
+  const auto file = map_file(path);
+  if (!file) {
+    return std::nullopt;
+  }
+  auto json      = mapped_text(*file);
+  auto glb_chunk = std::span<const std::byte>{};
+  const auto read_u32 = [&file](const std::size_t offset) {
+    auto value = std::uint32_t{};
+    std::memcpy(&value, file->data.get() + offset, sizeof(value));
+    return value;
+  };
+  if (json.starts_with("glTF")) {
+    // 12 byte header, then chunks of length, type and payload. The JSON
+    // chunk comes first, the binary one second if at all.
+    constexpr auto json_chunk_type = 0x4e4f534au;
+    constexpr auto bin_chunk_type  = 0x004e4942u;
+    if (file->size < 20 || read_u32(12) > file->size - 20 ||
+        read_u32(16) != json_chunk_type) {
+      return std::nullopt;
+    }
+    const auto json_length = read_u32(12);
+    json                   = json.substr(20, json_length);
+    const auto bin_header  = std::size_t{20} + json_length;
+    if (bin_header + 8 <= file->size &&
+        read_u32(bin_header + 4) == bin_chunk_type &&
+        read_u32(bin_header) <= file->size - bin_header - 8) {
+      glb_chunk = {file->data.get() + bin_header + 8, read_u32(bin_header)};
+    }
+  }
+  auto parser         = JsonParser{json};
+  const auto document = parse_json_value(parser);
+  if (!document) {
+    return std::nullopt;
+  }
+  const auto buffers = load_gltf_buffers(*document, path, glb_chunk);
+  if (!buffers) {
+    return std::nullopt;
+  }
+
+  auto meshes = std::vector<MeshData>{};
+  for (const auto& source : json_array(json_member(*document, "meshes"))) {
+    auto mesh = MeshData{std::string{json_string(json_member(source, "name"))},
+                         {}, {}};
+    if (mesh.name.empty()) {
+      mesh.name = path.stem().string() + std::to_string(meshes.size());
+    }
+    auto has_normals = true;
+    for (const auto& primitive :
+         json_array(json_member(source, "primitives"))) {
+      // Only triangle lists, mode 4 and the default.
+      if (json_index(json_member(primitive, "mode")).value_or(4) != 4) {
+        continue;
+      }
+      const auto primitive_normals =
+          append_primitive(*document, *buffers, primitive, mesh);
+      if (!primitive_normals) {
+        return std::nullopt;
+      }
+      has_normals = has_normals && *primitive_normals;
+    }
+    if (mesh.indices.empty()) {
+      continue;
+    }
+    if (!has_normals) {
+      generate_normals(mesh);
+    }
+    meshes.push_back(std::move(mesh));
+  }
+  return meshes;
+}
+
+std::optional<std::vector<MeshData>>
+import_meshes(const std::filesystem::path& path) {
+  auto extension = path.extension().string();
+  std::ranges::transform(extension, extension.begin(), [](const char c) {
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  });
+  if (extension == ".obj") {
+    return import_obj(path);
+  }
+  if (extension == ".gltf" || extension == ".glb") {
+    return import_gltf(path);
+  }
+  return std::nullopt;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include "mesh_format.hpp"
+
+// Importers behind picante_mesh_convert. Each returns every mesh in the file
+// as triangle lists with deduplicated vertices, or nullopt if the file can't
+// be read. Normals missing from the source are generated.
+
+// Wavefront OBJ. Every o or g statement starts a new mesh, materials are
+// ignored and polygons are fanned into triangles.
+std::optional<std::vector<MeshData>>
+import_obj(const std::filesystem::path& path);
+
+// glTF 2.0, both .gltf with external or data URI buffers and .glb. One mesh
+// per glTF mesh with its triangle primitives merged. Node transforms are
+// not applied, meshes come out in their own space.
+std::optional<std::vector<MeshData>>
+import_gltf(const std::filesystem::path& path);
+
+// Picks the importer by extension.
+std::optional<std::vector<MeshData>>
+import_meshes(const std::filesystem::path& path);
+
+// Area weighted vertex normals, for sources that come without.
+void generate_normals(MeshData& mesh);
@@ -0,0 +1,448 @@
+#include "mesh_streaming.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <ranges>
+#include <utility>
+
+#include "cpu_profiler.hpp"
+#include "queues.hpp"
+
+// What the streaming thread accumulates before handing a batch over.
+struct BatchBuilder {
+  // Copies grouped by destination, one vkCmdCopyBuffer per buffer.
+  std::vector<std::pair<vk::Buffer, std::vector<vk::BufferCopy>>> copies;
+  std::vector<std::pair<std::uint32_t, ResidentMesh>> finished_meshes;
+  std::uint64_t staging_end = 0;
+  vk::DeviceSize bytes      = 0;
+};
+
+vk::DeviceSize resident_size(const ResidentMesh& mesh) {
+  return mesh.vertices.allocation.size + mesh.indices.allocation.size;
+}
+
+std::array<BufferHandoff, 2> mesh_handoffs(const MeshStreamer& streamer,
+                                           const ResidentMesh& mesh) {
+  const auto handoff = [&streamer](const AllocatedBuffer& buffer) {
+    return BufferHandoff{buffer.buffer.get(),
+                         streamer.queues.families.transfer,
+                         streamer.queues.families.graphics,
+                         vk::PipelineStageFlagBits::eTransfer,
+                         vk::AccessFlagBits::eTransferWrite,
+                         vk::PipelineStageFlagBits::eVertexInput,
+                         vk::AccessFlagBits::eVertexAttributeRead |
+                             vk::AccessFlagBits::eIndexRead};
+  };
+  return {handoff(mesh.vertices), handoff(mesh.indices)};
+}
+
+void destroy_resident_mesh(DeviceAllocator& allocator, ResidentMesh& mesh) {
+  destroy_buffer(allocator, mesh.vertices);
+  destroy_buffer(allocator, mesh.indices);
+}
+
+// Records the builder's copies, plus the release of every mesh it finishes,
+// and queues the batch for the render thread to submit.
+void publish_batch(MeshStreamer& streamer, BatchBuilder& builder) {
+  if (builder.copies.empty() && builder.finished_meshes.empty()) {
+    return;
+  }
+  PICANTE_ZONE("record stream batch");
+  const auto& device = streamer.allocator->logical_device;
+  auto batch         = StreamBatch{};
+  vk::CommandPoolCreateInfo commandPoolInfo;
+  commandPoolInfo.flags            = vk::CommandPoolCreateFlagBits::eTransient;
+  commandPoolInfo.queueFamilyIndex = streamer.queues.families.transfer;
+  batch.command_pool = device.createCommandPoolUnique(commandPoolInfo);
+  vk::CommandBufferAllocateInfo commandBufferAllocateInfo;
+  commandBufferAllocateInfo.commandPool        = batch.command_pool.get();
+  commandBufferAllocateInfo.level              = vk::CommandBufferLevel::ePrimary;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  batch.command_buffer =
+      device.allocateCommandBuffers(commandBufferAllocateInfo).front();
+  vk::CommandBufferBeginInfo commandBufferBeginInfo;
+  commandBufferBeginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+  batch.command_buffer.begin(commandBufferBeginInfo);
+  for (const auto& [buffer, regions] : builder.copies) {
+    batch.command_buffer.copyBuffer(streamer.staging.buffer.get(), buffer,
+                                    regions);
+  }
+  // Earlier batches of a mesh ran before this one on the same queue, so the
+  // release covers their copies too.
+  for (const auto& [mesh, buffers] : builder.finished_meshes) {
+    for (const auto& handoff : mesh_handoffs(streamer, buffers)) {
+      record_release(batch.command_buffer, handoff);
+    }
+  }
+  batch.command_buffer.end();
+  batch.finished_meshes = std::move(builder.finished_meshes);
+  batch.staging_end     = builder.staging_end;
+  batch.bytes           = builder.bytes;
+  builder               = BatchBuilder{};
+  const auto lock       = std::scoped_lock{streamer.mutex};
+  streamer.ready.push_back(std::move(batch));
+}
+
+// Reserves size bytes of contiguous staging and returns their offset in the
+// ring. If the ring is full either gives up right away or waits for the
+// render thread to free some, nullopt then means the thread is stopping.
+std::optional<vk::DeviceSize>
+reserve_staging(MeshStreamer& streamer, BatchBuilder& builder,
+                const vk::DeviceSize size, const std::stop_token stop_token,
+                const bool wait) {
+  auto lock = std::unique_lock{streamer.mutex};
+  // Reservations never wrap, the rest of the ring is skipped instead.
+  const auto padding = [&streamer, size] {
+    const auto offset = streamer.staging_head % streamer.staging_size;
+    return offset + size > streamer.staging_size
+               ? streamer.staging_size - offset
+               : vk::DeviceSize{0};
+  };
+  const auto fits = [&streamer, &padding, size] {
+    return streamer.staging_head + padding() + size - streamer.staging_tail <=
+           streamer.staging_size;
+  };
+  if (!fits() && (!wait || !streamer.wake.wait(lock, stop_token, fits))) {
+    return std::nullopt;
+  }
+  streamer.staging_head += padding();
+  const auto offset = streamer.staging_head % streamer.staging_size;
+  streamer.staging_head += size;
+  builder.staging_end = streamer.staging_head;
+  return offset;
+}
+
+void add_copy(BatchBuilder& builder, const vk::Buffer& buffer,
+              const vk::BufferCopy& region) {
+  const auto existing = std::ranges::find(
+      builder.copies, buffer, &decltype(builder.copies)::value_type::first);
+  if (existing != builder.copies.end()) {
+    existing->second.push_back(region);
+  } else {
+    builder.copies.push_back({buffer, {region}});
+  }
+}
+
+// Copies a blob out of the mapped pack into staging in chunks of at most a
+// batch, publishing batches as they fill up. False if stopped halfway.
+bool stream_blob(MeshStreamer& streamer, BatchBuilder& builder,
+                 const std::span<const std::byte> bytes,
+                 const vk::Buffer& buffer, const std::stop_token stop_token) {
+  auto copied = vk::DeviceSize{0};
+  while (copied < bytes.size()) {
+    const auto size = std::min<vk::DeviceSize>(bytes.size() - copied,
+                                               streamer.batch_size);
+    // Every chunk on its own non-coherent atom, so flushing one never
+    // touches the next.
+    const auto reserved = (size + min_allocation_size - 1) /
+                          min_allocation_size * min_allocation_size;
+    auto offset = reserve_staging(streamer, builder, reserved, stop_token,
+                                  false);
+    if (!offset) {
+      // Get what's recorded going before waiting on it to free the ring.
+      publish_batch(streamer, builder);
+      offset = reserve_staging(streamer, builder, reserved, stop_token, true);
+      if (!offset) {
+        return false;
+      }
+    }
+    {
+      PICANTE_ZONE("copy to staging");
+      std::memcpy(streamer.staging.allocation.mapped + *offset,
+                  bytes.data() + copied, size);
+    }
+    flush_memory(*streamer.allocator, streamer.staging.allocation, *offset,
+                 size);
+    add_copy(builder, buffer, vk::BufferCopy{*offset, copied, size});
+    builder.bytes += size;
+    copied += size;
+    if (builder.bytes >= streamer.batch_size) {
+      publish_batch(streamer, builder);
+    }
+  }
+  return true;
+}
+
+bool stream_mesh(MeshStreamer& streamer, BatchBuilder& builder,
+                 const std::uint32_t mesh, const std::stop_token stop_token) {
+  PICANTE_ZONE("stream mesh");
+  auto& allocator         = *streamer.allocator;
+  const auto& record      = streamer.pack.meshes[mesh];
+  const auto vertex_bytes = mesh_vertex_bytes(streamer.pack, record);
+  const auto index_bytes  = mesh_index_bytes(streamer.pack, record);
+  const auto create = [&allocator](const std::span<const std::byte> bytes,
+                                   const vk::BufferUsageFlags usage) {
+    return bytes.empty()
+               ? std::nullopt
+               : create_buffer(allocator, bytes.size(),
+                               usage | vk::BufferUsageFlagBits::eTransferDst,
+                               vk::MemoryPropertyFlagBits::eDeviceLocal);
+  };
+  auto vertices = create(vertex_bytes, vk::BufferUsageFlagBits::eVertexBuffer);
+  auto indices  = create(index_bytes, vk::BufferUsageFlagBits::eIndexBuffer);
+  const auto abandon = [&allocator, &vertices, &indices] {
+    if (vertices) {
+      destroy_buffer(allocator, *vertices);
+    }
+    if (indices) {
+      destroy_buffer(allocator, *indices);
+    }
+  };
+  if (!vertices || !indices) {
+    // Out of memory or an empty mesh. The render thread puts it back to
+    // absent and a later request tries again.
+    abandon();
+    const auto lock = std::scoped_lock{streamer.mutex};
+    streamer.failed.push_back(mesh);
+    return true;
+  }
+  if (!stream_blob(streamer, builder, vertex_bytes, vertices->buffer.get(),
+                   stop_token) ||
+      !stream_blob(streamer, builder, index_bytes, indices->buffer.get(),
+                   stop_token)) {
+    abandon();
+    return false;
+  }
+  builder.finished_meshes.emplace_back(
+      mesh, ResidentMesh{std::move(*vertices), std::move(*indices)});
+  return true;
+}
+
+void streaming_worker(const std::stop_token stop_token,
+                      MeshStreamer& streamer) {
+  set_zone_thread_name("mesh streaming");
+  while (true) {
+    auto requests = std::vector<std::uint32_t>{};
+    {
+      auto lock = std::unique_lock{streamer.mutex};
+      if (!streamer.wake.wait(lock, stop_token, [&streamer] {
+            return !streamer.requests.empty();
+          })) {
+        return;
+      }
+      requests.swap(streamer.requests);
+    }
+    // Start the kernel reading everything asked for while the first meshes
+    // are copied.
+    for (const auto mesh : requests) {
+      const auto& record = streamer.pack.meshes[mesh];
+      prefetch_mapped_range(streamer.pack.file, record.vertex_offset,
+                            record.vertex_count * sizeof(MeshVertex));
+      prefetch_mapped_range(streamer.pack.file, record.index_offset,
+                            record.index_count * sizeof(std::uint32_t));
+    }
+    auto builder = BatchBuilder{};
+    for (const auto mesh : requests) {
+      if (!stream_mesh(streamer, builder, mesh, stop_token)) {
+        return;
+      }
+    }
+    publish_batch(streamer, builder);
+  }
+}
+
+std::unique_ptr<MeshStreamer> create_mesh_streamer(
+    const vk::PhysicalDevice& physical_device, DeviceAllocator& allocator,
+    const DeviceQueues& queues, MeshPack pack,
+    const bool memory_budget_enabled, const vk::DeviceSize resident_limit,
+    const vk::DeviceSize staging_size) {
+  auto staging = create_buffer(allocator, staging_size,
+                               vk::BufferUsageFlagBits::eTransferSrc,
+                               vk::MemoryPropertyFlagBits::eHostVisible);
+  if (!staging) {
+    return nullptr;
+  }
+  auto streamer                   = std::make_unique<MeshStreamer>();
+  streamer->physical_device       = physical_device;
+  streamer->allocator             = &allocator;
+  streamer->queues                = queues;
+  streamer->pack                  = std::move(pack);
+  streamer->memory_budget_enabled = memory_budget_enabled;
+  streamer->resident_limit        = resident_limit;
+  // At least two batches in the ring, so one can fill while one is copied.
+  streamer->batch_size = std::min(streamer->batch_size, staging_size / 2);
+  streamer->meshes.resize(streamer->pack.meshes.size());
+  streamer->staging      = std::move(*staging);
+  streamer->staging_size = staging_size;
+  streamer->worker = std::jthread{streaming_worker, std::ref(*streamer)};
+  return streamer;
+}
+
+const ResidentMesh* request_mesh(MeshStreamer& streamer,
+                                 const std::uint32_t mesh) {
+  auto& streamed     = streamer.meshes[mesh];
+  streamed.last_used = streamer.frame_index;
+  switch (streamed.residency) {
+  case MeshResidency::eResident:
+    return &streamed.buffers;
+  case MeshResidency::eLoading:
+    return nullptr;
+  case MeshResidency::eAbsent:
+    break;
+  }
+  streamed.residency = MeshResidency::eLoading;
+  ++streamer.stats.loading_meshes;
+  {
+    const auto lock = std::scoped_lock{streamer.mutex};
+    streamer.requests.push_back(mesh);
+  }
+  streamer.wake.notify_one();
+  return nullptr;
+}
+
+// Evicts the least recently used meshes no frame in flight can still draw
+// from, until the device is back under 90% of its budget and the streamer
+// under its own limit.
+void enforce_residency_budget(MeshStreamer& streamer, FrameRing& frame_ring) {
+  const auto budget = get_memory_budget(
+      streamer.physical_device, *streamer.allocator,
+      streamer.memory_budget_enabled);
+  // Evicted buffers still count against usage until their frames are done.
+  const auto usage =
+      budget.usage - std::min(budget.usage, streamer.bytes_evicting);
+  const auto device_limit = budget.budget / 10 * 9;
+  const auto resident     = streamer.stats.resident_bytes;
+  const auto device_excess =
+      usage > device_limit ? usage - device_limit : vk::DeviceSize{0};
+  const auto streamer_excess =
+      streamer.resident_limit != 0 && resident > streamer.resident_limit
+          ? resident - streamer.resident_limit
+          : vk::DeviceSize{0};
+  auto excess = std::max(device_excess, streamer_excess);
+  if (excess == 0) {
+    return;
+  }
+  PICANTE_ZONE("evict meshes");
+  const auto frames_in_flight = frame_ring.slots.size();
+  auto candidates             = std::vector<std::uint32_t>{};
+  for (const auto mesh : std::views::iota(
+           0u, static_cast<std::uint32_t>(streamer.meshes.size()))) {
+    const auto& streamed = streamer.meshes[mesh];
+    if (streamed.residency == MeshResidency::eResident &&
+        streamed.last_used + frames_in_flight <= streamer.frame_index) {
+      candidates.push_back(mesh);
+    }
+  }
+  std::ranges::sort(candidates, {}, [&streamer](const std::uint32_t mesh) {
+    return streamer.meshes[mesh].last_used;
+  });
+  for (const auto mesh : candidates) {
+    if (excess == 0) {
+      break;
+    }
+    auto& streamed     = streamer.meshes[mesh];
+    const auto size    = resident_size(streamed.buffers);
+    const auto buffers = std::make_shared<ResidentMesh>(
+        std::move(streamed.buffers));
+    streamed.residency = MeshResidency::eAbsent;
+    streamer.stats.resident_bytes -= size;
+    --streamer.stats.resident_meshes;
+    ++streamer.stats.evictions;
+    streamer.bytes_evicting += size;
+    excess -= std::min(excess, size);
+    defer_deletion(frame_ring, [&streamer, buffers, size] {
+      destroy_resident_mesh(*streamer.allocator, *buffers);
+      streamer.bytes_evicting -= size;
+    });
+  }
+}
+
+void update_mesh_streamer(MeshStreamer& streamer, FrameRing& frame_ring,
+                          const vk::CommandBuffer& command_buffer) {
+  PICANTE_ZONE("update mesh streamer");
+  streamer.frame_index = frame_ring.frame_index;
+  const auto& device   = streamer.allocator->logical_device;
+  auto ready           = std::vector<StreamBatch>{};
+  auto failed          = std::vector<std::uint32_t>{};
+  {
+    const auto lock = std::scoped_lock{streamer.mutex};
+    ready.swap(streamer.ready);
+    failed.swap(streamer.failed);
+  }
+  // Submitted from here rather than the streaming thread, the transfer queue
+  // may well be the graphics queue and submits to it have to be serialised.
+  for (auto& batch : ready) {
+    batch.finished              = device.createSemaphoreUnique({});
+    batch.fence                 = device.createFenceUnique({});
+    const auto signal_semaphore = batch.finished.get();
+    vk::SubmitInfo submitInfo;
+    submitInfo.commandBufferCount   = 1;
+    submitInfo.pCommandBuffers      = &batch.command_buffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores    = &signal_semaphore;
+    streamer.queues.transfer.submit(submitInfo, batch.fence.get());
+    streamer.in_flight.push_back(std::move(batch));
+  }
+  for (const auto mesh : failed) {
+    streamer.meshes[mesh].residency = MeshResidency::eAbsent;
+    --streamer.stats.loading_meshes;
+    ++streamer.stats.failed_loads;
+  }
+
+  // Oldest first, the transfer queue finishes them in order anyway and the
+  // ring can only be freed from its tail.
+  auto staging_tail = std::optional<std::uint64_t>{};
+  while (!streamer.in_flight.empty() &&
+         device.getFenceStatus(streamer.in_flight.front().fence.get()) ==
+             vk::Result::eSuccess) {
+    const auto batch =
+        std::make_shared<StreamBatch>(std::move(streamer.in_flight.front()));
+    streamer.in_flight.pop_front();
+    for (auto& [mesh, buffers] : batch->finished_meshes) {
+      for (const auto& handoff : mesh_handoffs(streamer, buffers)) {
+        record_acquire(command_buffer, handoff);
+      }
+      auto& streamed     = streamer.meshes[mesh];
+      streamed.buffers   = std::move(buffers);
+      streamed.residency = MeshResidency::eResident;
+      streamer.stats.resident_bytes += resident_size(streamed.buffers);
+      --streamer.stats.loading_meshes;
+      ++streamer.stats.resident_meshes;
+    }
+    // The batch is done, so the wait costs nothing, but it's what orders the
+    // acquire after the release.
+    wait_on_next_submit(frame_ring, batch->finished.get(),
+                        vk::PipelineStageFlagBits::eVertexInput);
+    defer_deletion(frame_ring, [batch] {});
+    // A batch holding nothing but the release of a mesh copied by earlier
+    // ones frees no staging of its own.
+    staging_tail = std::max(staging_tail.value_or(0), batch->staging_end);
+    streamer.stats.bytes_streamed += batch->bytes;
+    ++streamer.stats.batches_streamed;
+  }
+  if (staging_tail) {
+    {
+      const auto lock       = std::scoped_lock{streamer.mutex};
+      streamer.staging_tail = std::max(streamer.staging_tail, *staging_tail);
+    }
+    streamer.wake.notify_one();
+  }
+
+  enforce_residency_budget(streamer, frame_ring);
+}
+
+void destroy_mesh_streamer(MeshStreamer& streamer) {
+  streamer.worker.request_stop();
+  streamer.worker.join();
+  auto& allocator = *streamer.allocator;
+  for (auto& batch : streamer.ready) {
+    for (auto& [mesh, buffers] : batch.finished_meshes) {
+      destroy_resident_mesh(allocator, buffers);
+    }
+  }
+  for (auto& batch : streamer.in_flight) {
+    for (auto& [mesh, buffers] : batch.finished_meshes) {
+      destroy_resident_mesh(allocator, buffers);
+    }
+  }
+  streamer.ready.clear();
+  streamer.in_flight.clear();
+  for (auto& streamed : streamer.meshes) {
+    if (streamed.residency == MeshResidency::eResident) {
+      destroy_resident_mesh(allocator, streamed.buffers);
+      streamed.residency = MeshResidency::eAbsent;
+    }
+  }
+  destroy_buffer(allocator, streamer.staging);
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "allocator.hpp"
+#include "mesh_format.hpp"
+#include "picante.hpp"
+
+// Streams meshes out of a mapped mesh pack into device local buffers. A
+// background thread copies the pack's pages into a persistently mapped
+// staging ring and records the transfers in batches, the render thread
+// submits them on the transfer queue, hands finished meshes over to the
+// graphics queue and evicts the least recently used ones when the device runs
+// short of memory.
+
+constexpr vk::DeviceSize default_staging_ring_size = 32ull * 1024 * 1024;
+// A batch is closed and handed over once it holds this much.
+constexpr vk::DeviceSize default_stream_batch_size = 4ull * 1024 * 1024;
+
+enum class MeshResidency { eAbsent, eLoading, eResident };
+
+struct ResidentMesh {
+  AllocatedBuffer vertices;
+  AllocatedBuffer indices;
+};
+
+struct StreamedMesh {
+  MeshResidency residency = MeshResidency::eAbsent;
+  ResidentMesh buffers;
+  // Frame index of the last request, for picking what to evict.
+  std::uint64_t last_used = 0;
+};
+
+// Copies recorded by the streaming thread, waiting to be submitted or to
+// finish on the transfer queue.
+struct StreamBatch {
+  vk::UniqueCommandPool command_pool;
+  vk::CommandBuffer command_buffer;
+  // Meshes whose last bytes are in this batch, resident once it's done.
+  std::vector<std::pair<std::uint32_t, ResidentMesh>> finished_meshes;
+  // Ring position up to which staging is free again once the batch is done.
+  std::uint64_t staging_end = 0;
+  vk::DeviceSize bytes      = 0;
+  vk::UniqueSemaphore finished;
+  vk::UniqueFence fence;
+};
+
+struct MeshStreamerStats {
+  std::size_t resident_meshes    = 0;
+  std::size_t loading_meshes     = 0;
+  vk::DeviceSize resident_bytes  = 0;
+  std::uint64_t bytes_streamed   = 0;
+  std::uint64_t batches_streamed = 0;
+  std::uint64_t evictions        = 0;
+  std::uint64_t failed_loads     = 0;
+};
+
+struct MeshStreamer {
+  vk::PhysicalDevice physical_device;
+  DeviceAllocator* allocator = nullptr;
+  DeviceQueues queues;
+  MeshPack pack;
+  bool memory_budget_enabled = false;
+  // Cap on resident bytes on top of the device's own budget, 0 for none.
+  vk::DeviceSize resident_limit = 0;
+  vk::DeviceSize batch_size     = default_stream_batch_size;
+
+  // Render thread only.
+  std::vector<StreamedMesh> meshes;
+  std::deque<StreamBatch> in_flight;
+  std::uint64_t frame_index = 0;
+  // Freed by eviction but still waiting on the frames that used them.
+  vk::DeviceSize bytes_evicting = 0;
+  MeshStreamerStats stats;
+
+  // The ring is a single mapped buffer with monotonic positions, the
+  // streaming thread writes at staging_head and the render thread frees up to
+  // staging_tail as batches finish.
+  AllocatedBuffer staging;
+  vk::DeviceSize staging_size = 0;
+  std::mutex mutex;
+  std::condition_variable_any wake;
+  std::uint64_t staging_head = 0;
+  std::uint64_t staging_tail = 0;
+  std::vector<std::uint32_t> requests;
+  std::vector<StreamBatch> ready;
+  std::vector<std::uint32_t> failed;
+  // Last so it is stopped before anything it uses is destroyed.
+  std::jthread worker;
+};
+
+// Null if the staging ring can't be allocated. memory_budget_enabled says
+// whether the device was created with VK_EXT_memory_budget.
+std::unique_ptr<MeshStreamer> create_mesh_streamer(
+    const vk::PhysicalDevice& physical_device, DeviceAllocator& allocator,
+    const DeviceQueues& queues, MeshPack pack,
+    const bool memory_budget_enabled,
+    const vk::DeviceSize resident_limit = 0,
+    const vk::DeviceSize staging_size   = default_staging_ring_size);
+
+// Marks the mesh as used this frame and queues it for streaming if it isn't
+// resident. Returns its buffers once they can be drawn from, null until then.
+const ResidentMesh* request_mesh(MeshStreamer& streamer,
+                                 const std::uint32_t mesh);
+
+// Once per frame while recording it, before any request_mesh for the frame.
+// Submits what the streaming thread has recorded, acquires finished meshes on
+// command_buffer, makes the frame wait for their copies and evicts meshes
+// while over budget.
+void update_mesh_streamer(MeshStreamer& streamer, FrameRing& frame_ring,
+                          const vk::CommandBuffer& command_buffer);
+
+// Stops the streaming thread and frees everything. The frame ring has to be
+// drained first, evictions still queued on it refer back to the streamer.
+void destroy_mesh_streamer(MeshStreamer& streamer);
@@ -0,0 +1,24 @@
+#version 450
+
+// picante.vert's triangle placed in the world by a per-object transform.
+
+layout(location = 0) out vec3 fragColor;
+
+layout(std430, set = 0, binding = 0) readonly buffer Transforms {
+  mat4 transforms[];
+};
+
+layout(push_constant) uniform Camera {
+  mat4 view_projection;
+};
+
+vec2 positions[3] = vec2[](vec2(0.0, -0.5), vec2(0.5, 0.5), vec2(-0.5, 0.5));
+
+vec3 colors[3] =
+    vec3[](vec3(1.0, 0.0, 0.0), vec3(0.0, 1.0, 0.0), vec3(0.0, 0.0, 1.0));
+
+void main() {
+  const vec4 position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
+  gl_Position = view_projection * transforms[gl_InstanceIndex] * position;
+  fragColor   = colors[gl_VertexIndex];
+}
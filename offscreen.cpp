@@ -0,0 +1,113 @@
+#include "offscreen.hpp"
+
+#include <ranges>
+
+#include "cpu_profiler.hpp"
+
+vk::RenderPass create_offscreen_render_pass(const vk::Device& logical_device) {
+  return create_render_pass(logical_device, offscreen_format,
+                            vk::ImageLayout::eTransferSrcOptimal);
+}
+
+OffscreenTarget create_offscreen_target(const vk::PhysicalDevice& physical_device,
+                                        const vk::Device& logical_device,
+                                        const vk::RenderPass& render_pass,
+                                        const vk::Extent2D extent) {
+  auto target = OffscreenTarget{};
+  vk::ImageCreateInfo imageInfo;
+  imageInfo.imageType     = vk::ImageType::e2D;
+  imageInfo.format        = offscreen_format;
+  imageInfo.extent        = vk::Extent3D{extent, 1};
+  imageInfo.mipLevels     = 1;
+  imageInfo.arrayLayers   = 1;
+  imageInfo.samples       = vk::SampleCountFlagBits::e1;
+  imageInfo.tiling        = vk::ImageTiling::eOptimal;
+  imageInfo.usage         = vk::ImageUsageFlagBits::eColorAttachment |
+                    vk::ImageUsageFlagBits::eTransferSrc;
+  imageInfo.sharingMode   = vk::SharingMode::eExclusive;
+  imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+  target.image            = logical_device.createImageUnique(imageInfo);
+
+  const auto requirements =
+      logical_device.getImageMemoryRequirements(target.image.get());
+  vk::MemoryAllocateInfo allocateInfo;
+  allocateInfo.allocationSize  = requirements.size;
+  allocateInfo.memoryTypeIndex =
+      find_memory_type(physical_device, requirements.memoryTypeBits,
+                       vk::MemoryPropertyFlagBits::eDeviceLocal)
+          .value();
+  target.memory = logical_device.allocateMemoryUnique(allocateInfo);
+  logical_device.bindImageMemory(target.image.get(), target.memory.get(), 0);
+
+  vk::ImageViewCreateInfo viewInfo;
+  viewInfo.image                           = target.image.get();
+  viewInfo.viewType                        = vk::ImageViewType::e2D;
+  viewInfo.format                          = offscreen_format;
+  viewInfo.subresourceRange.aspectMask     = vk::ImageAspectFlagBits::eColor;
+  viewInfo.subresourceRange.baseMipLevel   = 0;
+  viewInfo.subresourceRange.levelCount     = 1;
+  viewInfo.subresourceRange.baseArrayLayer = 0;
+  viewInfo.subresourceRange.layerCount     = 1;
+  target.view = logical_device.createImageViewUnique(viewInfo);
+
+  std::array<vk::ImageView, 1> attachments{target.view.get()};
+  vk::FramebufferCreateInfo frameBufferInfo;
+  frameBufferInfo.renderPass      = render_pass;
+  frameBufferInfo.attachmentCount = 1;
+  frameBufferInfo.pAttachments    = attachments.data();
+  frameBufferInfo.width           = extent.width;
+  frameBufferInfo.height          = extent.height;
+  frameBufferInfo.layers          = 1;
+  target.framebuffer = logical_device.createFramebufferUnique(frameBufferInfo);
+  return target;
+}
+
+std::vector<OffscreenTarget>
+create_offscreen_targets(const vk::PhysicalDevice& physical_device,
+                         const vk::Device& logical_device,
+                         const vk::RenderPass& render_pass,
+                         const std::size_t count,
+                         const vk::Extent2D extent) {
+  auto targets = std::vector<OffscreenTarget>{};
+  targets.reserve(count);
+  for ([[maybe_unused]] const auto index : std::views::iota(0uz, count)) {
+    targets.push_back(create_offscreen_target(physical_device, logical_device,
+                                              render_pass, extent));
+  }
+  return targets;
+}
+
+void draw_offscreen_frame(const vk::Device& logical_device,
+                          const vk::Queue& queue,
+                          const std::vector<OffscreenTarget>& targets,
+                          FrameRing& frame_ring,
+                          const CommandBufferSetup& command_buffer_setup) {
+  PICANTE_ZONE("draw offscreen frame");
+  auto& slot = begin_frame_slot(logical_device, frame_ring);
+  logical_device.resetFences(slot.in_flight.get());
+  logical_device.resetCommandPool(slot.command_pool.get());
+  {
+    PICANTE_ZONE("record");
+    command_buffer_setup(targets[frame_ring.current].framebuffer.get(),
+                         slot.command_buffer);
+  }
+  const auto waits   = take_frame_waits(frame_ring);
+  const auto signals = take_frame_signals(frame_ring);
+  vk::TimelineSemaphoreSubmitInfo timelineInfo;
+  timelineInfo.signalSemaphoreValueCount = signals.values.size();
+  timelineInfo.pSignalSemaphoreValues    = signals.values.data();
+  vk::SubmitInfo submitInfo;
+  submitInfo.waitSemaphoreCount   = waits.semaphores.size();
+  submitInfo.pWaitSemaphores      = waits.semaphores.data();
+  submitInfo.pWaitDstStageMask    = waits.stages.data();
+  submitInfo.pCommandBuffers      = &slot.command_buffer;
+  submitInfo.commandBufferCount   = 1;
+  submitInfo.signalSemaphoreCount = signals.semaphores.size();
+  submitInfo.pSignalSemaphores    = signals.semaphores.data();
+  if (!signals.semaphores.empty()) {
+    submitInfo.pNext = &timelineInfo;
+  }
+  PICANTE_ZONE("submit");
+  queue.submit(submitInfo, slot.in_flight.get());
+  advance_frame_ring(frame_ring);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "allocator.hpp"
+#include "picante.hpp"
+
+// Supported as a color attachment by every implementation we care about,
+// lavapipe included, unlike the sRGB BGRA format the swapchain uses.
+constexpr vk::Format offscreen_format = vk::Format::eR8G8B8A8Unorm;
+
+// A color image we render into instead of a swapchain image. Each frame slot
+// gets its own so frames in flight never write to the same attachment.
+struct OffscreenTarget {
+  vk::UniqueImage image;
+  vk::UniqueDeviceMemory memory;
+  vk::UniqueImageView view;
+  vk::UniqueFramebuffer framebuffer;
+};
+
+// Render pass whose attachment ends up ready to be copied out, since nothing
+// ever presents it.
+vk::RenderPass create_offscreen_render_pass(const vk::Device& logical_device);
+
+std::vector<OffscreenTarget>
+create_offscreen_targets(const vk::PhysicalDevice& physical_device,
+                         const vk::Device& logical_device,
+                         const vk::RenderPass& render_pass,
+                         const std::size_t count,
+                         const vk::Extent2D extent = render_extent);
+
+// Headless counterpart of draw_frame. Records into the current slot's command
+// buffer against that slot's target and submits without any presentation.
+void draw_offscreen_frame(const vk::Device& logical_device,
+                          const vk::Queue& queue,
+                          const std::vector<OffscreenTarget>& targets,
+                          FrameRing& frame_ring,
+                          const CommandBufferSetup& command_buffer_setup);
@@ -0,0 +1,83 @@
+#include "parallel_recording.hpp"
+
+#include <algorithm>
+#include <ranges>
+
+#include "cpu_profiler.hpp"
+
+std::unique_ptr<ParallelRecorder>
+create_parallel_recorder(const vk::Device& logical_device, JobSystem& jobs,
+                         const std::uint32_t queue_family_index,
+                         const std::size_t frames_in_flight) {
+  auto recorder            = std::make_unique<ParallelRecorder>();
+  recorder->logical_device = logical_device;
+  recorder->jobs           = &jobs;
+  const auto slices        = job_thread_count(jobs);
+  recorder->pools.resize(frames_in_flight);
+  recorder->command_buffers.resize(frames_in_flight);
+  for (const auto slot : std::views::iota(0uz, frames_in_flight)) {
+    for ([[maybe_unused]] const auto slice : std::views::iota(0uz, slices)) {
+      // Transient and without RESET_COMMAND_BUFFER, buffers only ever go back
+      // to the pool all at once.
+      vk::CommandPoolCreateInfo commandPoolInfo;
+      commandPoolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+      commandPoolInfo.queueFamilyIndex = queue_family_index;
+      auto& pool = recorder->pools[slot].emplace_back(
+          logical_device.createCommandPoolUnique(commandPoolInfo));
+      vk::CommandBufferAllocateInfo commandBufferAllocateInfo;
+      commandBufferAllocateInfo.commandPool = pool.get();
+      commandBufferAllocateInfo.level = vk::CommandBufferLevel::eSecondary;
+      commandBufferAllocateInfo.commandBufferCount = 1;
+      recorder->command_buffers[slot].push_back(
+          logical_device.allocateCommandBuffers(commandBufferAllocateInfo)
+              .front());
+    }
+  }
+  return recorder;
+}
+
+std::size_t recording_thread_count(const ParallelRecorder& recorder) {
+  return recorder.command_buffers.empty()
+             ? 0
+             : recorder.command_buffers.front().size();
+}
+
+std::span<const vk::CommandBuffer> record_secondary_command_buffers(
+    ParallelRecorder& recorder, const std::size_t slot,
+    const vk::RenderPass& render_pass, const vk::Framebuffer& frame_buffer,
+    const vk::Extent2D extent, const std::size_t item_count,
+    const SecondaryCommandRecorder& record) {
+  for (const auto& pool : recorder.pools[slot]) {
+    recorder.logical_device.resetCommandPool(pool.get());
+  }
+  if (item_count == 0) {
+    return {};
+  }
+  const auto& command_buffers = recorder.command_buffers[slot];
+  // Never more slices than items, so every returned buffer has work in it.
+  const auto slice_count =
+      std::min(item_count, recording_thread_count(recorder));
+
+  vk::CommandBufferInheritanceInfo inheritanceInfo;
+  inheritanceInfo.renderPass  = render_pass;
+  inheritanceInfo.subpass     = 0;
+  inheritanceInfo.framebuffer = frame_buffer;
+  vk::CommandBufferBeginInfo commandBufferBeginInfo;
+  commandBufferBeginInfo.flags =
+      vk::CommandBufferUsageFlagBits::eOneTimeSubmit |
+      vk::CommandBufferUsageFlagBits::eRenderPassContinue;
+  commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
+  // One job per slice, this thread runs its share while it waits.
+  parallel_for(*recorder.jobs, slice_count, 1,
+               [&](const std::size_t slice, std::size_t) {
+                 const auto first = item_count * slice / slice_count;
+                 const auto last  = item_count * (slice + 1) / slice_count;
+                 PICANTE_ZONE("record secondary");
+                 const auto& command_buffer = command_buffers[slice];
+                 command_buffer.begin(commandBufferBeginInfo);
+                 set_viewport_and_scissor(command_buffer, extent);
+                 record(command_buffer, first, last - first);
+                 command_buffer.end();
+               });
+  return {command_buffers.data(), slice_count};
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "jobs.hpp"
+#include "picante.hpp"
+
+// Records one slice of the draw list into a secondary command buffer that
+// continues the render pass. Runs as a job, and nothing is
+// inherited from the primary, so it has to bind its own pipeline. Viewport
+// and scissor are set before it runs.
+using SecondaryCommandRecorder = std::function<void(
+    const vk::CommandBuffer&, std::size_t first, std::size_t count)>;
+
+// Command pools can only be used from one thread at a time, so every slice
+// gets its own pool per frame slot, with one slice per job system thread.
+// Resetting a slot's pools is then a handful of vkResetCommandPool calls
+// however many buffers were recorded.
+struct ParallelRecorder {
+  vk::Device logical_device;
+  // Slices are recorded as jobs on it rather than on threads of our own, so
+  // recording shares the cores with the rest of the frame.
+  JobSystem* jobs = nullptr;
+  // pools[slot][slice], each owning that slice's secondary buffer.
+  std::vector<std::vector<vk::UniqueCommandPool>> pools;
+  std::vector<std::vector<vk::CommandBuffer>> command_buffers;
+};
+
+std::unique_ptr<ParallelRecorder> create_parallel_recorder(
+    const vk::Device& logical_device, JobSystem& jobs,
+    const std::uint32_t queue_family_index,
+    const std::size_t frames_in_flight = default_frames_in_flight);
+
+std::size_t recording_thread_count(const ParallelRecorder& recorder);
+
+// Resets every pool belonging to the slot, then splits item_count items into
+// contiguous slices recorded in parallel against a framebuffer of the given
+// extent. The slot's fence must have signalled, which begin_frame_slot takes
+// care of. Returns the recorded buffers in slice order, ready for
+// executeCommands inside a render pass begun with eSecondaryCommandBuffers.
+// Rethrows whatever a slice threw.
+std::span<const vk::CommandBuffer> record_secondary_command_buffers(
+    ParallelRecorder& recorder, const std::size_t slot,
+    const vk::RenderPass& render_pass, const vk::Framebuffer& frame_buffer,
+    const vk::Extent2D extent, const std::size_t item_count,
+    const SecondaryCommandRecorder& record);
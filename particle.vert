@@ -0,0 +1,32 @@
+#version 450
+
+// A camera facing quad per live particle, drawn as a four vertex strip
+// instanced once per particle.
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragCorner;
+
+layout(std430, set = 0, binding = 0) readonly buffer Positions {
+  vec4 positions[];
+};
+
+layout(push_constant) uniform Camera {
+  mat4 view_projection;
+};
+
+const float particle_size = 0.05;
+
+vec2 corners[4] =
+    vec2[](vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(-1.0, 1.0), vec2(1.0, 1.0));
+
+void main() {
+  const vec4 particle = positions[gl_InstanceIndex];
+  const vec2 corner   = corners[gl_VertexIndex];
+  // Offset in clip space so the quad faces the camera whatever the view.
+  gl_Position = view_projection * vec4(particle.xyz, 1.0) +
+                vec4(corner * particle_size, 0.0, 0.0);
+  // Fades from white hot to red as the particle runs out of life.
+  fragColor  = mix(vec3(1.0, 0.2, 0.05), vec3(1.0, 0.9, 0.6),
+                   clamp(particle.w * 0.25, 0.0, 1.0));
+  fragCorner = corner;
+}
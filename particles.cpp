@@ -0,0 +1,241 @@
+#include "particles.hpp"
+
+#include <algorithm>
+#include <ranges>
+#include <string>
+
+#include "gpu_driven.hpp"
+
+// Matches the push constant block in particles.comp.
+struct ParticleConstants {
+  Vec4 emitter;
+  Vec4 gravity;
+  std::uint32_t capacity   = 0;
+  std::uint32_t emit_count = 0;
+  std::uint32_t seed       = 0;
+  std::uint32_t source     = 0;
+};
+
+constexpr vk::DeviceSize particle_draw_stride = sizeof(vk::DrawIndirectCommand);
+// The minimum every device supports, larger systems spill into y.
+constexpr std::uint32_t max_particle_workgroups_x = 65535;
+
+bool supports_particle_simulation(const vk::PhysicalDevice& physical_device) {
+  const auto properties =
+      physical_device.getProperties2<vk::PhysicalDeviceProperties2,
+                                     vk::PhysicalDeviceSubgroupProperties>();
+  const auto& subgroup = properties.get<vk::PhysicalDeviceSubgroupProperties>();
+  return (subgroup.supportedStages & vk::ShaderStageFlagBits::eCompute) &&
+         (subgroup.supportedOperations & vk::SubgroupFeatureFlagBits::eBallot);
+}
+
+std::optional<ParticleSystem> create_particle_system(
+    DeviceAllocator& allocator, const vk::Queue& queue,
+    const std::uint32_t queue_family_index, const vk::RenderPass& render_pass,
+    const vk::ShaderModule& step_shader,
+    const std::vector<vk::PipelineShaderStageCreateInfo>& draw_shaders,
+    const std::uint32_t capacity, const vk::PipelineCache& pipeline_cache) {
+  const auto& logical_device = allocator.logical_device;
+  auto system                = ParticleSystem{};
+  system.capacity            = capacity;
+  const auto stream_size =
+      std::max<vk::DeviceSize>(capacity, 1) * sizeof(Vec4);
+  auto streams = std::vector<std::optional<AllocatedBuffer>>{};
+  for ([[maybe_unused]] const auto stream : std::views::iota(0, 4)) {
+    streams.push_back(create_buffer(allocator, stream_size,
+                                    vk::BufferUsageFlagBits::eStorageBuffer,
+                                    vk::MemoryPropertyFlagBits::eDeviceLocal));
+  }
+  // Both sides start out empty, four vertices make a quad.
+  const auto empty = std::array{vk::DrawIndirectCommand{4, 0, 0, 0},
+                                vk::DrawIndirectCommand{4, 0, 0, 0}};
+  auto draw_commands = create_buffer_with_data(
+      allocator, queue, queue_family_index, std::as_bytes(std::span{empty}),
+      vk::BufferUsageFlagBits::eStorageBuffer |
+          vk::BufferUsageFlagBits::eIndirectBuffer |
+          vk::BufferUsageFlagBits::eTransferDst);
+  if (!std::ranges::all_of(streams, [](const auto& stream) {
+        return stream.has_value();
+      }) ||
+      !draw_commands) {
+    for (auto& stream : streams) {
+      if (stream) {
+        destroy_buffer(allocator, *stream);
+      }
+    }
+    if (draw_commands) {
+      destroy_buffer(allocator, *draw_commands);
+    }
+    return std::nullopt;
+  }
+  system.positions     = {std::move(*streams[0]), std::move(*streams[1])};
+  system.velocities    = {std::move(*streams[2]), std::move(*streams[3])};
+  system.draw_commands = std::move(*draw_commands);
+
+  system.step_set_layout = create_storage_set_layout(
+      logical_device, 5, vk::ShaderStageFlagBits::eCompute);
+  system.draw_set_layout = create_storage_set_layout(
+      logical_device, 1, vk::ShaderStageFlagBits::eVertex);
+  system.step_layout = create_push_constant_layout(
+      logical_device, system.step_set_layout.get(),
+      vk::PushConstantRange{vk::ShaderStageFlagBits::eCompute, 0,
+                            sizeof(ParticleConstants)});
+  system.draw_layout = create_push_constant_layout(
+      logical_device, system.draw_set_layout.get(),
+      vk::PushConstantRange{vk::ShaderStageFlagBits::eVertex, 0,
+                            sizeof(Mat4)});
+
+  static const auto shader_entry_point = std::string{"main"};
+  vk::ComputePipelineCreateInfo computePipelineInfo;
+  computePipelineInfo.stage  = create_shader_pipeline_info(
+      step_shader, vk::ShaderStageFlagBits::eCompute, shader_entry_point);
+  computePipelineInfo.layout = system.step_layout.get();
+  system.step_pipeline =
+      logical_device
+          .createComputePipelineUnique(pipeline_cache, computePipelineInfo)
+          .value;
+
+  auto description          = GraphicsPipelineDescription{};
+  description.render_pass   = render_pass;
+  description.layout        = system.draw_layout.get();
+  description.shader_stages = draw_shaders;
+  description.topology      = vk::PrimitiveTopology::eTriangleStrip;
+  description.cull_mode     = vk::CullModeFlagBits::eNone;
+  system.draw_pipeline      = vk::UniquePipeline{
+      create_graphics_pipeline(logical_device, description, pipeline_cache),
+      logical_device};
+
+  const auto pool_size =
+      vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer, 12};
+  vk::DescriptorPoolCreateInfo descriptorPoolInfo;
+  descriptorPoolInfo.maxSets       = 4;
+  descriptorPoolInfo.poolSizeCount = 1;
+  descriptorPoolInfo.pPoolSizes    = &pool_size;
+  system.descriptor_pool =
+      logical_device.createDescriptorPoolUnique(descriptorPoolInfo);
+  const auto set_layouts =
+      std::array{system.step_set_layout.get(), system.step_set_layout.get(),
+                 system.draw_set_layout.get(), system.draw_set_layout.get()};
+  vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo;
+  descriptorSetAllocateInfo.descriptorPool     = system.descriptor_pool.get();
+  descriptorSetAllocateInfo.descriptorSetCount = set_layouts.size();
+  descriptorSetAllocateInfo.pSetLayouts        = set_layouts.data();
+  const auto sets =
+      logical_device.allocateDescriptorSets(descriptorSetAllocateInfo);
+  system.step_sets = {sets[0], sets[1]};
+  system.draw_sets = {sets[2], sets[3]};
+
+  const auto whole = [](const AllocatedBuffer& buffer) {
+    return vk::DescriptorBufferInfo{buffer.buffer.get(), 0, VK_WHOLE_SIZE};
+  };
+  for (const auto side : std::views::iota(0u, 2u)) {
+    const auto other = 1 - side;
+    // Stepping reads this side and writes the other, drawing reads this side.
+    const auto buffer_infos = std::array{
+        whole(system.positions[side]), whole(system.velocities[side]),
+        whole(system.positions[other]), whole(system.velocities[other]),
+        whole(system.draw_commands), whole(system.positions[side])};
+    auto writes = std::array<vk::WriteDescriptorSet, 6>{};
+    for (const auto index : std::views::iota(0u, 6u)) {
+      const auto is_draw_set        = index == 5;
+      writes[index].dstSet          = is_draw_set ? system.draw_sets[side]
+                                                  : system.step_sets[side];
+      writes[index].dstBinding      = is_draw_set ? 0 : index;
+      writes[index].descriptorCount = 1;
+      writes[index].descriptorType  = vk::DescriptorType::eStorageBuffer;
+      writes[index].pBufferInfo     = &buffer_infos[index];
+    }
+    logical_device.updateDescriptorSets(writes, {});
+  }
+  return system;
+}
+
+void destroy_particle_system(DeviceAllocator& allocator,
+                             ParticleSystem& system) {
+  for (auto& buffer : system.positions) {
+    destroy_buffer(allocator, buffer);
+  }
+  for (auto& buffer : system.velocities) {
+    destroy_buffer(allocator, buffer);
+  }
+  destroy_buffer(allocator, system.draw_commands);
+  system.capacity = 0;
+}
+
+void record_particle_step(ParticleSystem& system, const ParticleStep& step,
+                          const vk::CommandBuffer& command_buffer) {
+  const auto source = system.current;
+  const auto target = 1 - source;
+  // Drawing or stepping from the target side may still be in flight, an
+  // execution dependency is enough before overwriting it.
+  command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eDrawIndirect |
+                                     vk::PipelineStageFlagBits::eVertexShader |
+                                     vk::PipelineStageFlagBits::eComputeShader,
+                                 vk::PipelineStageFlagBits::eTransfer |
+                                     vk::PipelineStageFlagBits::eComputeShader,
+                                 {}, {}, {}, {});
+  command_buffer.fillBuffer(
+      system.draw_commands.buffer.get(),
+      target * particle_draw_stride +
+          offsetof(VkDrawIndirectCommand, instanceCount),
+      sizeof(std::uint32_t), 0);
+  const auto cleared = vk::MemoryBarrier{
+      vk::AccessFlagBits::eTransferWrite,
+      vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite};
+  command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                 vk::PipelineStageFlagBits::eComputeShader, {},
+                                 cleared, {}, {});
+
+  auto constants       = ParticleConstants{};
+  constants.emitter    = Vec4{step.emitter.x, step.emitter.y, step.emitter.z,
+                           step.emitter_radius};
+  constants.gravity    = Vec4{step.gravity.x, step.gravity.y, step.gravity.z,
+                           step.delta_time};
+  constants.capacity   = system.capacity;
+  constants.emit_count = step.emit_count;
+  constants.seed       = system.steps;
+  constants.source     = source;
+  command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute,
+                              system.step_pipeline.get());
+  command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                    system.step_layout.get(), 0,
+                                    system.step_sets[source], {});
+  command_buffer.pushConstants(system.step_layout.get(),
+                               vk::ShaderStageFlagBits::eCompute, 0,
+                               sizeof(constants), &constants);
+  const auto workgroups =
+      (system.capacity + particle_workgroup_size - 1) / particle_workgroup_size;
+  const auto workgroups_x = std::min(workgroups, max_particle_workgroups_x);
+  command_buffer.dispatch(
+      workgroups_x,
+      (workgroups + max_particle_workgroups_x - 1) / max_particle_workgroups_x,
+      1);
+
+  const auto stepped = vk::MemoryBarrier{
+      vk::AccessFlagBits::eShaderWrite,
+      vk::AccessFlagBits::eIndirectCommandRead |
+          vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite};
+  command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                 vk::PipelineStageFlagBits::eDrawIndirect |
+                                     vk::PipelineStageFlagBits::eVertexShader |
+                                     vk::PipelineStageFlagBits::eComputeShader,
+                                 {}, stepped, {}, {});
+  system.current = target;
+  ++system.steps;
+}
+
+void record_particle_draws(const ParticleSystem& system,
+                           const Mat4& view_projection,
+                           const vk::CommandBuffer& command_buffer) {
+  command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                              system.draw_pipeline.get());
+  command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                    system.draw_layout.get(), 0,
+                                    system.draw_sets[system.current], {});
+  command_buffer.pushConstants(system.draw_layout.get(),
+                               vk::ShaderStageFlagBits::eVertex, 0,
+                               sizeof(view_projection), &view_projection);
+  command_buffer.drawIndirect(system.draw_commands.buffer.get(),
+                              system.current * particle_draw_stride, 1,
+                              particle_draw_stride);
+}
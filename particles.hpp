@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "allocator.hpp"
+#include "math.hpp"
+#include "picante.hpp"
+
+// Particles simulated entirely on the GPU. State is split into one buffer per
+// attribute so drawing only reads positions, and every buffer exists twice:
+// a step reads one side and writes the survivors plus newly emitted particles
+// densely into the other, which the draw then reads. The live count never
+// comes back to the CPU, it's the instance count of an indirect draw.
+
+// Matching particles.comp.
+constexpr std::uint32_t particle_workgroup_size = 256;
+
+// The compaction relies on subgroup ballots in compute shaders.
+bool supports_particle_simulation(const vk::PhysicalDevice& physical_device);
+
+struct ParticleSystem {
+  std::uint32_t capacity = 0;
+  // xyz position and w remaining lifetime in seconds, one buffer per side.
+  std::array<AllocatedBuffer, 2> positions;
+  // xyz velocity, w unused.
+  std::array<AllocatedBuffer, 2> velocities;
+  // A VkDrawIndirectCommand per side.
+  AllocatedBuffer draw_commands;
+  // The side the last step wrote.
+  std::uint32_t current = 0;
+  std::uint32_t steps   = 0;
+
+  vk::UniqueDescriptorSetLayout step_set_layout;
+  vk::UniqueDescriptorSetLayout draw_set_layout;
+  vk::UniquePipelineLayout step_layout;
+  vk::UniquePipelineLayout draw_layout;
+  vk::UniquePipeline step_pipeline;
+  vk::UniquePipeline draw_pipeline;
+  vk::UniqueDescriptorPool descriptor_pool;
+  // Indexed by the side being read.
+  std::array<vk::DescriptorSet, 2> step_sets;
+  std::array<vk::DescriptorSet, 2> draw_sets;
+};
+
+// Starts out empty. draw_shaders are particle.vert and particle.frag.
+std::optional<ParticleSystem> create_particle_system(
+    DeviceAllocator& allocator, const vk::Queue& queue,
+    const std::uint32_t queue_family_index, const vk::RenderPass& render_pass,
+    const vk::ShaderModule& step_shader,
+    const std::vector<vk::PipelineShaderStageCreateInfo>& draw_shaders,
+    const std::uint32_t capacity,
+    const vk::PipelineCache& pipeline_cache = {});
+
+void destroy_particle_system(DeviceAllocator& allocator,
+                             ParticleSystem& system);
+
+struct ParticleStep {
+  float delta_time = 1.0f / 60.0f;
+  // Spawned this step, as many as fit.
+  std::uint32_t emit_count = 0;
+  Vec3 emitter;
+  float emitter_radius = 0.5f;
+  Vec3 gravity         = {0.0f, -9.81f, 0.0f};
+};
+
+// Advances the simulation by one step. Must be recorded outside of a render
+// pass, any number of times per frame, before record_particle_draws.
+void record_particle_step(ParticleSystem& system, const ParticleStep& step,
+                          const vk::CommandBuffer& command_buffer);
+
+// Draws every live particle. Must be recorded inside the render pass.
+void record_particle_draws(const ParticleSystem& system,
+                           const Mat4& view_projection,
+                           const vk::CommandBuffer& command_buffer);
@@ -0,0 +1,663 @@
+#include "picante.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iostream>
+#include <string_view>
+
+#include "cpu_profiler.hpp"
+
+vk::UniqueInstance create_instance(std::vector<const char*> extensions,
+                                   const bool enable_validation) {
+  auto validation_layers = std::vector<const char*>{};
+  if (enable_validation) {
+    extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+    validation_layers.push_back("VK_LAYER_KHRONOS_validation");
+  }
+  const auto application_info = create_application_info();
+  const auto instance_info =
+      std::invoke([&application_info, &extensions, &validation_layers] {
+        auto instance_info                    = vk::InstanceCreateInfo{};
+        instance_info.pApplicationInfo        = &application_info;
+        instance_info.enabledLayerCount       = validation_layers.size();
+        instance_info.ppEnabledLayerNames     = validation_layers.data();
+        instance_info.enabledExtensionCount   = extensions.size();
+        instance_info.ppEnabledExtensionNames = extensions.data();
+        return instance_info;
+      });
+  return vk::createInstanceUnique(instance_info);
+}
+
+std::optional<vk::PhysicalDevice>
+get_discrete_gpu(const vk::Instance& instance) {
+  const auto physical_devices = instance.enumeratePhysicalDevices();
+  const auto discrete_gpu     = std::find_if(
+      std::begin(physical_devices), std::end(physical_devices),
+      [](const auto& device) {
+        const auto properties = device.getProperties();
+        return properties.deviceType == vk::PhysicalDeviceType::eDiscreteGpu;
+      });
+  if (discrete_gpu != std::end(physical_devices)) {
+    const auto properties = (*discrete_gpu).getProperties();
+    std::cout << "Found a discrete gpu: " << properties.deviceName << "\n";
+    return (*discrete_gpu);
+  } else {
+    std::cout << "No discrete gpu! Your rig sucks!\n";
+    return std::nullopt;
+  }
+}
+
+std::optional<vk::PhysicalDevice> get_any_gpu(const vk::Instance& instance) {
+  const auto physical_devices = instance.enumeratePhysicalDevices();
+  if (physical_devices.empty()) {
+    return std::nullopt;
+  }
+  // Lower rank is better, software rasterizers go last.
+  const auto rank = [](const vk::PhysicalDevice& device) {
+    switch (device.getProperties().deviceType) {
+    case vk::PhysicalDeviceType::eDiscreteGpu: return 0;
+    case vk::PhysicalDeviceType::eIntegratedGpu: return 1;
+    case vk::PhysicalDeviceType::eVirtualGpu: return 2;
+    case vk::PhysicalDeviceType::eCpu: return 3;
+    default: return 4;
+    }
+  };
+  return *std::ranges::min_element(physical_devices, {}, rank);
+}
+
+std::optional<std::size_t>
+get_graphics_queue_family_index(const vk::PhysicalDevice& physical_device) {
+  const auto properties   = physical_device.getQueueFamilyProperties();
+  const auto queue_family = std::find_if(
+      std::begin(properties), std::end(properties), [](const auto& property) {
+        return property.queueFlags & vk::QueueFlagBits::eGraphics;
+      });
+  if (queue_family != std::end(properties)) {
+    // return the index of the queue family
+    return std::distance(std::begin(properties), queue_family);
+  } else {
+    return std::nullopt;
+  }
+}
+
+std::optional<QueueFamilies>
+get_queue_families(const vk::PhysicalDevice& physical_device) {
+  const auto properties = physical_device.getQueueFamilyProperties();
+  // First family with all of wanted and none of unwanted.
+  const auto find_family =
+      [&properties](const vk::QueueFlags wanted,
+                    const vk::QueueFlags unwanted)
+      -> std::optional<std::uint32_t> {
+    const auto family =
+        std::ranges::find_if(properties, [&](const auto& property) {
+          return (property.queueFlags & wanted) == wanted &&
+                 !(property.queueFlags & unwanted);
+        });
+    if (family == properties.end()) {
+      return std::nullopt;
+    }
+    return static_cast<std::uint32_t>(
+        std::distance(properties.begin(), family));
+  };
+  return get_graphics_queue_family_index(physical_device)
+      .transform([&find_family](const auto graphics_index) {
+        using enum vk::QueueFlagBits;
+        const auto graphics = static_cast<std::uint32_t>(graphics_index);
+        auto families       = QueueFamilies{graphics, graphics, graphics};
+        // Transfer only families sit on the copy engines, better than a
+        // compute family that merely also copies.
+        families.transfer = find_family(eTransfer, eGraphics | eCompute)
+                                .or_else([&find_family] {
+                                  return find_family(eTransfer, eGraphics);
+                                })
+                                .value_or(graphics);
+        families.compute = find_family(eCompute, eGraphics).value_or(graphics);
+        return families;
+      });
+}
+
+std::vector<std::uint32_t>
+unique_queue_families(const QueueFamilies& families) {
+  auto indices =
+      std::vector{families.graphics, families.transfer, families.compute};
+  std::ranges::sort(indices);
+  const auto duplicates = std::ranges::unique(indices);
+  indices.erase(duplicates.begin(), duplicates.end());
+  return indices;
+}
+
+vk::DeviceQueueCreateInfo
+create_logical_device_queue_info(const std::size_t queue_family_index,
+                                 const std::array<float, 1>& priorities) {
+  auto device_queue_info             = vk::DeviceQueueCreateInfo{};
+  device_queue_info.queueFamilyIndex = queue_family_index;
+  device_queue_info.queueCount       = 1;
+  device_queue_info.setQueuePriorities(priorities);
+  return device_queue_info;
+}
+
+vk::DeviceCreateInfo create_logical_device_info(
+    const std::span<const vk::DeviceQueueCreateInfo> queue_infos,
+    const std::vector<const char*>& extensions) {
+  auto device_info                    = vk::DeviceCreateInfo{};
+  device_info.queueCreateInfoCount    = queue_infos.size();
+  device_info.pQueueCreateInfos       = queue_infos.data();
+  device_info.ppEnabledExtensionNames = extensions.data();
+  device_info.enabledExtensionCount   = extensions.size();
+  return device_info;
+}
+
+bool supports_vulkan_1_2(const vk::PhysicalDevice& physical_device) {
+  return physical_device.getProperties().apiVersion >= VK_API_VERSION_1_2;
+}
+
+// Both feature structs are nothing but VkBool32s past their headers.
+void intersect_feature_bits(vk::Bool32* wanted, const vk::Bool32* supported,
+                            const std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    wanted[i] = wanted[i] && supported[i];
+  }
+}
+
+DeviceFeatures get_supported_features(const vk::PhysicalDevice& physical_device,
+                                      DeviceFeatures wanted) {
+  auto supported12      = vk::PhysicalDeviceVulkan12Features{};
+  auto supported        = vk::PhysicalDeviceFeatures2{};
+  const auto vulkan_1_2 = supports_vulkan_1_2(physical_device);
+  if (vulkan_1_2) {
+    supported.pNext = &supported12;
+    physical_device.getFeatures2(&supported);
+  } else {
+    supported.features = physical_device.getFeatures();
+  }
+  intersect_feature_bits(&wanted.core.robustBufferAccess,
+                         &supported.features.robustBufferAccess,
+                         sizeof(vk::PhysicalDeviceFeatures) /
+                             sizeof(vk::Bool32));
+  constexpr auto vulkan12_header =
+      offsetof(VkPhysicalDeviceVulkan12Features, samplerMirrorClampToEdge);
+  intersect_feature_bits(&wanted.vulkan12.samplerMirrorClampToEdge,
+                         &supported12.samplerMirrorClampToEdge,
+                         (sizeof(VkPhysicalDeviceVulkan12Features) -
+                          vulkan12_header) /
+                             sizeof(vk::Bool32));
+  wanted.vulkan12.pNext = nullptr;
+  return wanted;
+}
+
+DeviceFeatures merge_features(DeviceFeatures left,
+                              const DeviceFeatures& right) {
+  const auto unite = [](vk::Bool32* into, const vk::Bool32* from,
+                        const std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+      into[i] = into[i] || from[i];
+    }
+  };
+  unite(&left.core.robustBufferAccess, &right.core.robustBufferAccess,
+        sizeof(vk::PhysicalDeviceFeatures) / sizeof(vk::Bool32));
+  constexpr auto vulkan12_header =
+      offsetof(VkPhysicalDeviceVulkan12Features, samplerMirrorClampToEdge);
+  unite(&left.vulkan12.samplerMirrorClampToEdge,
+        &right.vulkan12.samplerMirrorClampToEdge,
+        (sizeof(VkPhysicalDeviceVulkan12Features) - vulkan12_header) /
+            sizeof(vk::Bool32));
+  return left;
+}
+
+bool supports_device_extension(const vk::PhysicalDevice& physical_device,
+                               const std::string_view extension) {
+  return std::ranges::any_of(
+      physical_device.enumerateDeviceExtensionProperties(),
+      [&extension](const auto& properties) {
+        return std::string_view{properties.extensionName.data()} == extension;
+      });
+}
+
+std::optional<vk::UniqueDevice>
+create_logical_device(const vk::PhysicalDevice& physical_device,
+                      const std::vector<const char*>& extensions,
+                      const DeviceFeatures& features) {
+  const auto priorities = std::array<float, 1>{1.0f};
+  return get_queue_families(physical_device)
+      .transform([&priorities, &physical_device, &extensions,
+                  &features](const auto& families) {
+        auto device_queue_infos = std::vector<vk::DeviceQueueCreateInfo>{};
+        for (const auto index : unique_queue_families(families)) {
+          device_queue_infos.push_back(
+              create_logical_device_queue_info(index, priorities));
+        }
+        auto device_info =
+            create_logical_device_info(device_queue_infos, extensions);
+        // Features go through the pNext chain so 1.2 features can tag along.
+        auto vulkan12_features    = features.vulkan12;
+        auto enabled_features     = vk::PhysicalDeviceFeatures2{};
+        enabled_features.features = features.core;
+        if (supports_vulkan_1_2(physical_device)) {
+          vulkan12_features.pNext = nullptr;
+          enabled_features.pNext  = &vulkan12_features;
+        }
+        device_info.pNext = &enabled_features;
+        return physical_device.createDeviceUnique(device_info);
+      });
+}
+
+vk::Queue get_queue(const vk::PhysicalDevice& physical_device,
+                    const vk::UniqueDevice& logical_device) {
+  return logical_device.get().getQueue(
+      get_graphics_queue_family_index(physical_device).value(), 0);
+}
+
+DeviceQueues get_device_queues(const vk::Device& logical_device,
+                               const QueueFamilies& families) {
+  return DeviceQueues{families, logical_device.getQueue(families.graphics, 0),
+                      logical_device.getQueue(families.transfer, 0),
+                      logical_device.getQueue(families.compute, 0)};
+}
+
+std::vector<vk::ImageView>
+create_image_views(const vk::Device& logical_device,
+                   const std::vector<vk::Image> images,
+                   const vk::Format format) {
+  auto image_views = std::vector<vk::ImageView>{images.size()};
+  std::ranges::transform(
+      images, image_views.begin(),
+      [&logical_device, format](const vk::Image& image) -> vk::ImageView {
+        vk::ImageViewCreateInfo imageInfo;
+        imageInfo.image    = image;
+        imageInfo.viewType = vk::ImageViewType::e2D;
+        imageInfo.format   = format;
+        imageInfo.components.r                = vk::ComponentSwizzle::eIdentity;
+        imageInfo.components.g                = vk::ComponentSwizzle::eIdentity;
+        imageInfo.components.b                = vk::ComponentSwizzle::eIdentity;
+        imageInfo.components.a                = vk::ComponentSwizzle::eIdentity;
+        imageInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+        imageInfo.subresourceRange.baseMipLevel   = 0;
+        imageInfo.subresourceRange.levelCount     = 1;
+        imageInfo.subresourceRange.baseArrayLayer = 0;
+        imageInfo.subresourceRange.layerCount     = 1;
+        return logical_device.createImageView(imageInfo);
+      });
+  return image_views;
+}
+
+vk::PipelineShaderStageCreateInfo
+create_shader_pipeline_info(const vk::ShaderModule& module,
+                            const vk::ShaderStageFlagBits shader_stage,
+                            const std::string& name) {
+  auto shader_pipeline_info   = vk::PipelineShaderStageCreateInfo{};
+  shader_pipeline_info.module = module;
+  shader_pipeline_info.stage  = shader_stage;
+  shader_pipeline_info.pName  = name.c_str();
+  return shader_pipeline_info;
+}
+
+// TODO clean this up I stole it from one of my old repos
+vk::RenderPass create_render_pass(const vk::Device& logical_device,
+                                  const vk::Format format,
+                                  const vk::ImageLayout final_layout) {
+  vk::AttachmentDescription colorAttachmentDescription{};
+  colorAttachmentDescription.format         = format;
+  colorAttachmentDescription.samples        = vk::SampleCountFlagBits::e1;
+  colorAttachmentDescription.loadOp         = vk::AttachmentLoadOp::eClear;
+  colorAttachmentDescription.storeOp        = vk::AttachmentStoreOp::eStore;
+  colorAttachmentDescription.stencilLoadOp  = vk::AttachmentLoadOp::eDontCare;
+  colorAttachmentDescription.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+  colorAttachmentDescription.initialLayout  = vk::ImageLayout::eUndefined;
+  colorAttachmentDescription.finalLayout    = final_layout;
+  vk::AttachmentReference colorAttachmentReference;
+  colorAttachmentReference.attachment = 0;
+  colorAttachmentReference.layout = vk::ImageLayout::eColorAttachmentOptimal;
+  //
+  // Subpass creation
+  vk::SubpassDescription basicSubpass;
+  basicSubpass.pipelineBindPoint    = vk::PipelineBindPoint::eGraphics;
+  basicSubpass.colorAttachmentCount = 1;
+  basicSubpass.pColorAttachments    = &colorAttachmentReference;
+  //
+  //
+  // Render pass creation
+  vk::RenderPassCreateInfo renderPassInfo;
+  renderPassInfo.attachmentCount = 1;
+  renderPassInfo.pAttachments    = &colorAttachmentDescription;
+  renderPassInfo.subpassCount    = 1;
+  renderPassInfo.pSubpasses      = &basicSubpass;
+  vk::SubpassDependency subpassDependency;
+  subpassDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+  subpassDependency.dstSubpass = 0;
+  subpassDependency.srcStageMask =
+      vk::PipelineStageFlagBits::eColorAttachmentOutput;
+  subpassDependency.srcAccessMask = vk::AccessFlagBits::eNoneKHR;
+  subpassDependency.dstStageMask =
+      vk::PipelineStageFlagBits::eColorAttachmentOutput;
+  subpassDependency.dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+  renderPassInfo.dependencyCount  = 1;
+  renderPassInfo.pDependencies    = &subpassDependency;
+  return logical_device.createRenderPass(renderPassInfo);
+  //
+}
+
+vk::PipelineLayout
+create_fixed_function_pipeline(const vk::Device& logical_device) {
+  const vk::PipelineLayoutCreateInfo data{};
+  return logical_device.createPipelineLayout(data);
+}
+
+void set_viewport_and_scissor(const vk::CommandBuffer& command_buffer,
+                              const vk::Extent2D extent) {
+  vk::Viewport viewport;
+  viewport.x        = 0.0f;
+  viewport.y        = 0.0f;
+  viewport.width    = static_cast<float>(extent.width);
+  viewport.height   = static_cast<float>(extent.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  command_buffer.setViewport(0, viewport);
+  command_buffer.setScissor(0, vk::Rect2D{vk::Offset2D{0, 0}, extent});
+}
+
+void begin_render_pass(const vk::RenderPass& render_pass,
+                       const vk::Framebuffer& frame_buffer,
+                       const vk::CommandBuffer& command_buffer,
+                       const vk::SubpassContents contents,
+                       const vk::Extent2D extent) {
+  vk::RenderPassBeginInfo renderPassBeginInfo;
+  renderPassBeginInfo.renderPass        = render_pass;
+  renderPassBeginInfo.framebuffer       = frame_buffer;
+  renderPassBeginInfo.renderArea.offset = vk::Offset2D{0, 0};
+  renderPassBeginInfo.renderArea.extent = extent;
+  vk::ClearValue clearColor{std::array{0.0f, 0.0f, 0.0f, 1.0f}};  // black
+  renderPassBeginInfo.clearValueCount = 1;
+  renderPassBeginInfo.pClearValues    = &clearColor;
+  command_buffer.beginRenderPass(&renderPassBeginInfo, contents);
+  // Secondaries can't inherit dynamic state, they set their own.
+  if (contents == vk::SubpassContents::eInline) {
+    set_viewport_and_scissor(command_buffer, extent);
+  }
+}
+
+void record_render_pass(const vk::RenderPass& render_pass,
+                        const vk::Pipeline& graphics_pipeline,
+                        const vk::Framebuffer& frame_buffer,
+                        const vk::CommandBuffer& command_buffer,
+                        const std::uint32_t instance_count,
+                        const vk::Extent2D extent) {
+  begin_render_pass(render_pass, frame_buffer, command_buffer,
+                    vk::SubpassContents::eInline, extent);
+  command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                              graphics_pipeline);
+  command_buffer.draw(3, instance_count, 0, 0);
+  command_buffer.endRenderPass();
+}
+
+void setup_render_pass(const vk::RenderPass& render_pass,
+                       const vk::Pipeline& graphics_pipeline,
+                       const vk::Framebuffer& frame_buffer,
+                       const vk::CommandBuffer& command_buffer) {
+  vk::CommandBufferBeginInfo commandBufferBeginInfo;
+  commandBufferBeginInfo.flags =
+      vk::CommandBufferUsageFlagBits::eOneTimeSubmit;  // re-recorded per frame
+  command_buffer.begin(commandBufferBeginInfo);
+  // Begin recording
+  record_render_pass(render_pass, graphics_pipeline, frame_buffer,
+                     command_buffer);
+  command_buffer.end();
+}
+
+FrameRing create_frame_ring(const vk::Device& logical_device,
+                            const std::uint32_t queue_family_index,
+                            const std::size_t swapchain_image_count,
+                            const std::size_t frames_in_flight) {
+  auto frame_ring = FrameRing{};
+  frame_ring.slots.resize(frames_in_flight);
+  for (auto& slot : frame_ring.slots) {
+    slot.image_available = logical_device.createSemaphoreUnique({});
+    // Start signalled so the first wait on each slot returns immediately.
+    slot.in_flight = logical_device.createFenceUnique(
+        vk::FenceCreateInfo{vk::FenceCreateFlagBits::eSignaled});
+    vk::CommandPoolCreateInfo commandPoolInfo;
+    commandPoolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+    commandPoolInfo.queueFamilyIndex = queue_family_index;
+    slot.command_pool = logical_device.createCommandPoolUnique(commandPoolInfo);
+    vk::CommandBufferAllocateInfo commandBufferAllocateInfo;
+    commandBufferAllocateInfo.commandPool = slot.command_pool.get();
+    commandBufferAllocateInfo.level       = vk::CommandBufferLevel::ePrimary;
+    commandBufferAllocateInfo.commandBufferCount = 1;
+    slot.command_buffer =
+        logical_device.allocateCommandBuffers(commandBufferAllocateInfo)
+            .front();
+  }
+  frame_ring.render_finished.resize(swapchain_image_count);
+  for (auto& semaphore : frame_ring.render_finished) {
+    semaphore = logical_device.createSemaphoreUnique({});
+  }
+  return frame_ring;
+}
+
+void flush_deletion_queue(FrameSlot& slot) {
+  for (const auto& destroy : slot.deletion_queue) {
+    destroy();
+  }
+  slot.deletion_queue.clear();
+}
+
+void defer_deletion(FrameRing& frame_ring, std::function<void()> destroy) {
+  frame_ring.slots[frame_ring.current].deletion_queue.push_back(
+      std::move(destroy));
+}
+
+void defer_deletion_after_last_submit(FrameRing& frame_ring,
+                                      std::function<void()> destroy) {
+  const auto slot_count = frame_ring.slots.size();
+  frame_ring.slots[(frame_ring.current + slot_count - 1) % slot_count]
+      .deletion_queue.push_back(std::move(destroy));
+}
+
+void drain_frame_ring(const vk::Device& logical_device, FrameRing& frame_ring) {
+  logical_device.waitIdle();
+  for (auto& slot : frame_ring.slots) {
+    flush_deletion_queue(slot);
+  }
+}
+
+FrameSlot& begin_frame_slot(const vk::Device& logical_device,
+                            FrameRing& frame_ring) {
+  PICANTE_ZONE("wait for frame slot");
+  auto& slot       = frame_ring.slots[frame_ring.current];
+  const auto start = std::chrono::steady_clock::now();
+  // Only wait on the slot we are about to reuse, the other frames in flight
+  // keep running on the GPU.
+  if (vk::Result::eSuccess !=
+      logical_device.waitForFences(slot.in_flight.get(), VK_TRUE,
+                                   UINT64_MAX)) {
+    // TODO blow up
+  }
+  frame_ring.blocked = std::chrono::steady_clock::now() - start;
+  flush_deletion_queue(slot);
+  return slot;
+}
+
+void advance_frame_ring(FrameRing& frame_ring) {
+  frame_ring.current = (frame_ring.current + 1) % frame_ring.slots.size();
+  ++frame_ring.frame_index;
+}
+
+void wait_on_next_submit(FrameRing& frame_ring, const vk::Semaphore& semaphore,
+                         const vk::PipelineStageFlags stage) {
+  frame_ring.waits.push_back(semaphore);
+  frame_ring.wait_stages.push_back(stage);
+}
+
+FrameWaits take_frame_waits(FrameRing& frame_ring) {
+  auto waits = FrameWaits{std::move(frame_ring.waits),
+                          std::move(frame_ring.wait_stages)};
+  frame_ring.waits.clear();
+  frame_ring.wait_stages.clear();
+  return waits;
+}
+
+void signal_on_next_submit(FrameRing& frame_ring,
+                           const vk::Semaphore& semaphore,
+                           const std::uint64_t value) {
+  frame_ring.signals.push_back(semaphore);
+  frame_ring.signal_values.push_back(value);
+}
+
+FrameSignals take_frame_signals(FrameRing& frame_ring) {
+  auto signals = FrameSignals{std::move(frame_ring.signals),
+                              std::move(frame_ring.signal_values)};
+  frame_ring.signals.clear();
+  frame_ring.signal_values.clear();
+  return signals;
+}
+
+void submit_immediate(
+    const vk::Device& logical_device, const vk::Queue& queue,
+    const std::uint32_t queue_family_index,
+    const std::function<void(const vk::CommandBuffer&)>& record) {
+  PICANTE_ZONE("submit immediate");
+  vk::CommandPoolCreateInfo commandPoolInfo;
+  commandPoolInfo.flags            = vk::CommandPoolCreateFlagBits::eTransient;
+  commandPoolInfo.queueFamilyIndex = queue_family_index;
+  const auto command_pool =
+      logical_device.createCommandPoolUnique(commandPoolInfo);
+  vk::CommandBufferAllocateInfo commandBufferAllocateInfo;
+  commandBufferAllocateInfo.commandPool        = command_pool.get();
+  commandBufferAllocateInfo.level              = vk::CommandBufferLevel::ePrimary;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  const auto command_buffer =
+      logical_device.allocateCommandBuffers(commandBufferAllocateInfo).front();
+  vk::CommandBufferBeginInfo commandBufferBeginInfo;
+  commandBufferBeginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+  command_buffer.begin(commandBufferBeginInfo);
+  record(command_buffer);
+  command_buffer.end();
+  const auto fence = logical_device.createFenceUnique({});
+  vk::SubmitInfo submitInfo;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers    = &command_buffer;
+  queue.submit(submitInfo, fence.get());
+  const auto waited =
+      logical_device.waitForFences(fence.get(), VK_TRUE, UINT64_MAX);
+  if (waited != vk::Result::eSuccess) {
+    throw vk::SystemError(vk::make_error_code(waited), "waitForFences");
+  }
+}
+
+std::vector<vk::Framebuffer>
+create_framebuffers(const vk::Device& logical_device,
+                    const vk::RenderPass& render_pass,
+                    const std::vector<vk::ImageView>& image_views,
+                    const vk::Extent2D extent) {
+  // Create framebuffers
+  std::vector<vk::Framebuffer> frameBuffers{image_views.size()};
+  std::ranges::transform(
+      image_views, frameBuffers.begin(),
+      [&render_pass, &logical_device, extent](const vk::ImageView& imageView) {
+        std::array<vk::ImageView, 1> imageViewAttachment{imageView};
+        vk::FramebufferCreateInfo frameBufferInfo{};
+        frameBufferInfo.renderPass      = render_pass;
+        frameBufferInfo.attachmentCount = 1;
+        frameBufferInfo.pAttachments    = imageViewAttachment.data();
+        frameBufferInfo.width           = extent.width;
+        frameBufferInfo.height          = extent.height;
+        frameBufferInfo.layers          = 1;
+        return logical_device.createFramebuffer(frameBufferInfo);
+      });
+  return frameBuffers;
+}
+
+vk::Pipeline
+create_graphics_pipeline(const vk::Device& logical_device,
+                         const GraphicsPipelineDescription& description,
+                         const vk::PipelineCache& pipeline_cache) {
+  PICANTE_ZONE("create graphics pipeline");
+  // Everything lives on the stack so several threads can build pipelines at
+  // the same time.
+  // Setup vertex input
+  vk::PipelineVertexInputStateCreateInfo vertexInputInfo;
+  vertexInputInfo.vertexBindingDescriptionCount   = 0;
+  vertexInputInfo.vertexAttributeDescriptionCount = 0;
+  //
+  // Setup input assembly
+  vk::PipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
+  inputAssemblyInfo.topology               = description.topology;
+  inputAssemblyInfo.primitiveRestartEnable = false;
+  // Setup viewport, set at record time so the pipeline outlives a resize
+  vk::PipelineViewportStateCreateInfo viewPortStateInfo;
+  viewPortStateInfo.viewportCount = 1;
+  viewPortStateInfo.scissorCount  = 1;
+  const std::array dynamicStates{vk::DynamicState::eViewport,
+                                 vk::DynamicState::eScissor};
+  vk::PipelineDynamicStateCreateInfo dynamicStateInfo;
+  dynamicStateInfo.dynamicStateCount = dynamicStates.size();
+  dynamicStateInfo.pDynamicStates    = dynamicStates.data();
+  // Setup rasterizer
+  vk::PipelineRasterizationStateCreateInfo rasterizerInfo;
+  rasterizerInfo.depthClampEnable        = false;
+  rasterizerInfo.rasterizerDiscardEnable = false;
+  rasterizerInfo.polygonMode             = vk::PolygonMode::eFill;
+  rasterizerInfo.lineWidth               = 1.0f;
+  rasterizerInfo.cullMode                = description.cull_mode;
+  rasterizerInfo.frontFace               = description.front_face;
+  rasterizerInfo.depthBiasEnable         = false;
+  //
+  // Setup multisample
+
+  vk::PipelineMultisampleStateCreateInfo multisamplingInfo;
+  multisamplingInfo.sampleShadingEnable  = false;
+  multisamplingInfo.rasterizationSamples = vk::SampleCountFlagBits::e1;
+  //
+  //
+  // Setup color blending for framebuffers.
+  vk::PipelineColorBlendAttachmentState colorBlendAttachmentState;
+  colorBlendAttachmentState.colorWriteMask =
+      vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eB |
+      vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eA;
+  colorBlendAttachmentState.blendEnable = description.blend_enable;
+  if (description.blend_enable) {  // plain "over" alpha blending
+    colorBlendAttachmentState.srcColorBlendFactor =
+        vk::BlendFactor::eSrcAlpha;
+    colorBlendAttachmentState.dstColorBlendFactor =
+        vk::BlendFactor::eOneMinusSrcAlpha;
+    colorBlendAttachmentState.colorBlendOp        = vk::BlendOp::eAdd;
+    colorBlendAttachmentState.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+    colorBlendAttachmentState.dstAlphaBlendFactor = vk::BlendFactor::eZero;
+    colorBlendAttachmentState.alphaBlendOp        = vk::BlendOp::eAdd;
+  }
+  vk::PipelineColorBlendStateCreateInfo colorBlendStateInfo{};
+  colorBlendStateInfo.logicOpEnable   = false;
+  colorBlendStateInfo.attachmentCount = 1;
+  colorBlendStateInfo.pAttachments    = &colorBlendAttachmentState;
+  // Actually instantiate the pipeline
+  vk::GraphicsPipelineCreateInfo graphicsPipelineInfo{};
+  graphicsPipelineInfo.stageCount          = description.shader_stages.size();
+  graphicsPipelineInfo.pStages             = description.shader_stages.data();
+  graphicsPipelineInfo.pVertexInputState   = &vertexInputInfo;
+  graphicsPipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
+  graphicsPipelineInfo.pViewportState      = &viewPortStateInfo;
+  graphicsPipelineInfo.pRasterizationState = &rasterizerInfo;
+  graphicsPipelineInfo.pMultisampleState   = &multisamplingInfo;
+  graphicsPipelineInfo.pColorBlendState    = &colorBlendStateInfo;
+  graphicsPipelineInfo.pDynamicState       = &dynamicStateInfo;
+  graphicsPipelineInfo.layout              = description.layout;
+  graphicsPipelineInfo.renderPass          = description.render_pass;
+  graphicsPipelineInfo.subpass             = 0;
+  return logical_device
+      .createGraphicsPipeline(pipeline_cache, graphicsPipelineInfo)
+      .value;
+}
+
+vk::Pipeline
+create_graphics_pipeline(const vk::Device& logical_device,
+                         const vk::RenderPass& render_pass,
+                         const vk::PipelineLayout& layout,
+                         const std::vector<vk::PipelineShaderStageCreateInfo>&
+                             pipeline_shader_info,
+                         const vk::PipelineCache& pipeline_cache) {
+  auto description          = GraphicsPipelineDescription{};
+  description.render_pass   = render_pass;
+  description.layout        = layout;
+  description.shader_stages = pipeline_shader_info;
+  return create_graphics_pipeline(logical_device, description, pipeline_cache);
+}
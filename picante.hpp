@@ -0,0 +1,287 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+// Size of the offscreen targets and of the window we open. The swapchain
+// follows whatever size the window ends up with.
+constexpr vk::Extent2D render_extent{1024, 1024};
+
+constexpr vk::ApplicationInfo create_application_info() {
+  auto application_info               = vk::ApplicationInfo{};
+  application_info.pApplicationName   = "picante";
+  application_info.applicationVersion = 0;
+  application_info.pEngineName        = "picante";
+  application_info.apiVersion         = VK_API_VERSION_1_2;
+  return application_info;
+};
+
+vk::UniqueInstance create_instance(std::vector<const char*> extensions,
+                                   bool enable_validation = true);
+
+std::optional<vk::PhysicalDevice>
+get_discrete_gpu(const vk::Instance& instance);
+
+// Like get_discrete_gpu but settles for whatever is there, including software
+// implementations such as lavapipe. Used when we don't need to present.
+std::optional<vk::PhysicalDevice> get_any_gpu(const vk::Instance& instance);
+
+std::optional<std::size_t>
+get_graphics_queue_family_index(const vk::PhysicalDevice& physical_device);
+
+// Where each kind of work goes. Transfer and compute get families of their
+// own when the device has them, so uploads and async compute run on their
+// own hardware queues next to graphics, and fall back to the graphics
+// family otherwise.
+struct QueueFamilies {
+  std::uint32_t graphics = 0;
+  std::uint32_t transfer = 0;
+  std::uint32_t compute  = 0;
+};
+
+std::optional<QueueFamilies>
+get_queue_families(const vk::PhysicalDevice& physical_device);
+
+// Sorted, each family once. One queue gets created for each.
+std::vector<std::uint32_t>
+unique_queue_families(const QueueFamilies& families);
+
+vk::DeviceQueueCreateInfo
+create_logical_device_queue_info(const std::size_t queue_family_index,
+                                 const std::array<float, 1>& priorities);
+
+vk::DeviceCreateInfo create_logical_device_info(
+    const std::span<const vk::DeviceQueueCreateInfo> queue_infos,
+    const std::vector<const char*>& extensions);
+
+// Optional device features. Vulkan 1.2 ones are silently dropped on devices
+// that don't speak 1.2.
+struct DeviceFeatures {
+  vk::PhysicalDeviceFeatures core;
+  vk::PhysicalDeviceVulkan12Features vulkan12;
+};
+
+bool supports_vulkan_1_2(const vk::PhysicalDevice& physical_device);
+
+// Clears every wanted feature the device doesn't support, so the result can
+// be enabled as is and checked afterwards to pick code paths.
+DeviceFeatures get_supported_features(const vk::PhysicalDevice& physical_device,
+                                      DeviceFeatures wanted);
+
+// Every feature either side asks for, for devices several code paths share.
+DeviceFeatures merge_features(DeviceFeatures left, const DeviceFeatures& right);
+
+bool supports_device_extension(const vk::PhysicalDevice& physical_device,
+                               const std::string_view extension);
+
+std::optional<vk::UniqueDevice>
+create_logical_device(const vk::PhysicalDevice& physical_device,
+                      const std::vector<const char*>& extensions =
+                          {VK_KHR_SWAPCHAIN_EXTENSION_NAME},
+                      const DeviceFeatures& features = {});
+
+vk::Queue get_queue(const vk::PhysicalDevice& physical_device,
+                    const vk::UniqueDevice& logical_device);
+
+// Families that coincide share one VkQueue, and submits to a queue must
+// never race, so only use the async queues from the thread that owns them
+// unless the families are known to differ.
+struct DeviceQueues {
+  QueueFamilies families;
+  vk::Queue graphics;
+  vk::Queue transfer;
+  vk::Queue compute;
+};
+
+DeviceQueues get_device_queues(const vk::Device& logical_device,
+                               const QueueFamilies& families);
+
+std::vector<vk::ImageView>
+create_image_views(const vk::Device& logical_device,
+                   const std::vector<vk::Image> images,
+                   const vk::Format format = vk::Format::eB8G8R8A8Srgb);
+
+vk::PipelineShaderStageCreateInfo
+create_shader_pipeline_info(const vk::ShaderModule& module,
+                            const vk::ShaderStageFlagBits shader_stage,
+                            const std::string& name);
+
+vk::RenderPass create_render_pass(
+    const vk::Device& logical_device,
+    const vk::Format format             = vk::Format::eB8G8R8A8Srgb,
+    const vk::ImageLayout final_layout = vk::ImageLayout::ePresentSrcKHR);
+
+vk::PipelineLayout
+create_fixed_function_pipeline(const vk::Device& logical_device);
+
+// Viewport and scissor are dynamic state in every pipeline we build, so
+// pipelines survive a swapchain resize.
+void set_viewport_and_scissor(const vk::CommandBuffer& command_buffer,
+                              const vk::Extent2D extent);
+
+// Begins the render pass over the whole extent, cleared to black, and sets
+// the viewport and scissor to match when the subpass is recorded inline.
+// Pass eSecondaryCommandBuffers when the subpass is recorded by
+// record_secondary_command_buffers.
+void begin_render_pass(
+    const vk::RenderPass& render_pass, const vk::Framebuffer& frame_buffer,
+    const vk::CommandBuffer& command_buffer,
+    const vk::SubpassContents contents = vk::SubpassContents::eInline,
+    const vk::Extent2D extent          = render_extent);
+
+// Records the render pass itself, without beginning or ending the command
+// buffer, so callers can wrap it with their own commands.
+void record_render_pass(const vk::RenderPass& render_pass,
+                        const vk::Pipeline& graphics_pipeline,
+                        const vk::Framebuffer& frame_buffer,
+                        const vk::CommandBuffer& command_buffer,
+                        const std::uint32_t instance_count = 1,
+                        const vk::Extent2D extent          = render_extent);
+
+void setup_render_pass(const vk::RenderPass& render_pass,
+                       const vk::Pipeline& graphics_pipeline,
+                       const vk::Framebuffer& frame_buffer,
+                       const vk::CommandBuffer& command_buffer);
+
+// Number of frames the CPU may record ahead of the GPU. Two keeps latency low
+// while still letting recording overlap with execution of the previous frame.
+constexpr std::size_t default_frames_in_flight = 2;
+
+// Everything a single frame slot needs to be recorded and submitted. These are
+// created once and reused every time the ring wraps around to this slot.
+struct FrameSlot {
+  vk::UniqueSemaphore image_available;
+  vk::UniqueFence in_flight;
+  vk::UniqueCommandPool command_pool;
+  vk::CommandBuffer command_buffer;
+  // Resources retired while this slot was being recorded. They are destroyed
+  // once the slot's fence tells us the GPU is done with them.
+  std::vector<std::function<void()>> deletion_queue;
+};
+
+struct FrameRing {
+  std::vector<FrameSlot> slots;
+  // One per swapchain image, since a present may still be waiting on the
+  // semaphore after the frame slot that signalled it has been recycled.
+  std::vector<vk::UniqueSemaphore> render_finished;
+  std::size_t current       = 0;
+  std::uint64_t frame_index = 0;
+  // Semaphores the next frame submitted waits on, e.g. an upload finishing
+  // on the transfer queue. That submit clears them.
+  std::vector<vk::Semaphore> waits;
+  std::vector<vk::PipelineStageFlags> wait_stages;
+  // Timeline semaphores the next frame submitted signals, and the values it
+  // signals them to, e.g. a readback being ready. That submit clears them.
+  std::vector<vk::Semaphore> signals;
+  std::vector<std::uint64_t> signal_values;
+  // How long the CPU sat waiting on the GPU or the presentation engine for
+  // the last frame, fed to the latency limiter.
+  std::chrono::steady_clock::duration blocked{};
+};
+
+using CommandBufferSetup =
+    std::function<void(const vk::Framebuffer&, const vk::CommandBuffer&)>;
+
+FrameRing create_frame_ring(const vk::Device& logical_device,
+                            const std::uint32_t queue_family_index,
+                            const std::size_t swapchain_image_count,
+                            const std::size_t frames_in_flight =
+                                default_frames_in_flight);
+
+void flush_deletion_queue(FrameSlot& slot);
+
+// Queue a resource for destruction once the GPU has finished the frame that is
+// currently being recorded.
+void defer_deletion(FrameRing& frame_ring, std::function<void()> destroy);
+
+// Same, for resources retired between frames. They are tied to the last frame
+// submitted instead, whose fence covers every submission before it.
+void defer_deletion_after_last_submit(FrameRing& frame_ring,
+                                      std::function<void()> destroy);
+
+// Block until the GPU is idle and release everything still queued for
+// deletion. Only meant for shutdown.
+void drain_frame_ring(const vk::Device& logical_device, FrameRing& frame_ring);
+
+// Waits until the GPU is done with the current slot and releases whatever it
+// retired, the slot can then be reset and recorded again.
+FrameSlot& begin_frame_slot(const vk::Device& logical_device,
+                            FrameRing& frame_ring);
+
+void advance_frame_ring(FrameRing& frame_ring);
+
+// Makes the next frame submitted wait on semaphore before stage. Safe to call
+// while that frame is being recorded.
+void wait_on_next_submit(FrameRing& frame_ring, const vk::Semaphore& semaphore,
+                         const vk::PipelineStageFlags stage);
+
+// Hands over the waits queued for the frame about to be submitted, leaving
+// none for the one after.
+struct FrameWaits {
+  std::vector<vk::Semaphore> semaphores;
+  std::vector<vk::PipelineStageFlags> stages;
+};
+FrameWaits take_frame_waits(FrameRing& frame_ring);
+
+// Makes the next frame submitted signal a timeline semaphore to value once
+// it has finished. Same rules as wait_on_next_submit.
+void signal_on_next_submit(FrameRing& frame_ring,
+                           const vk::Semaphore& semaphore,
+                           const std::uint64_t value);
+
+struct FrameSignals {
+  std::vector<vk::Semaphore> semaphores;
+  std::vector<std::uint64_t> values;
+};
+FrameSignals take_frame_signals(FrameRing& frame_ring);
+
+// Records and submits a one-off command buffer and waits for it. For uploads
+// and other setup work, never per frame.
+void submit_immediate(
+    const vk::Device& logical_device, const vk::Queue& queue,
+    const std::uint32_t queue_family_index,
+    const std::function<void(const vk::CommandBuffer&)>& record);
+
+std::vector<vk::Framebuffer>
+create_framebuffers(const vk::Device& logical_device,
+                    const vk::RenderPass& render_pass,
+                    const std::vector<vk::ImageView>& image_views,
+                    const vk::Extent2D extent = render_extent);
+
+// The knobs that differ between the graphics pipelines we build. Everything
+// else is fixed function state shared by all of them.
+struct GraphicsPipelineDescription {
+  vk::RenderPass render_pass;
+  vk::PipelineLayout layout;
+  std::vector<vk::PipelineShaderStageCreateInfo> shader_stages;
+  vk::PrimitiveTopology topology = vk::PrimitiveTopology::eTriangleList;
+  vk::CullModeFlags cull_mode    = vk::CullModeFlagBits::eBack;
+  vk::FrontFace front_face       = vk::FrontFace::eClockwise;
+  bool blend_enable              = false;
+};
+
+// Safe to call from several threads at once, the pipeline cache is internally
+// synchronized.
+vk::Pipeline
+create_graphics_pipeline(const vk::Device& logical_device,
+                         const GraphicsPipelineDescription& description,
+                         const vk::PipelineCache& pipeline_cache = {});
+
+// The defaults of the description with the given pass, layout and stages.
+// The layout stays the caller's, e.g. from create_fixed_function_pipeline.
+vk::Pipeline
+create_graphics_pipeline(const vk::Device& logical_device,
+                         const vk::RenderPass& render_pass,
+                         const vk::PipelineLayout& layout,
+                         const std::vector<vk::PipelineShaderStageCreateInfo>&
+                             pipeline_shader_info,
+                         const vk::PipelineCache& pipeline_cache = {});
@@ -0,0 +1,153 @@
+#include "pipeline_cache.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <optional>
+
+std::filesystem::path default_pipeline_cache_path() {
+  const auto cache_root = std::invoke([]() -> std::filesystem::path {
+    if (const auto* xdg_cache = std::getenv("XDG_CACHE_HOME")) {
+      return xdg_cache;
+    }
+    if (const auto* home = std::getenv("HOME")) {
+      return std::filesystem::path{home} / ".cache";
+    }
+    return std::filesystem::current_path();
+  });
+  return cache_root / "picante" / "pipeline_cache.bin";
+}
+
+bool is_pipeline_cache_compatible(
+    const std::vector<char>& data,
+    const vk::PhysicalDeviceProperties& properties) {
+  auto header = VkPipelineCacheHeaderVersionOne{};
+  if (data.size() < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+  return header.headerSize >= sizeof(header) &&
+         header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header.vendorID == properties.vendorID &&
+         header.deviceID == properties.deviceID &&
+         std::ranges::equal(header.pipelineCacheUUID,
+                            properties.pipelineCacheUUID);
+}
+
+std::optional<std::vector<char>>
+read_pipeline_cache_file(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::ate | std::ios::binary);
+  if (!file.is_open()) {
+    return std::nullopt;
+  }
+  const auto file_size = file.tellg();
+  auto file_data       = std::vector<char>{};
+  file_data.resize(file_size);
+  file.seekg(0);
+  file.read(file_data.data(), file_size);
+  if (!file) {
+    return std::nullopt;
+  }
+  return file_data;
+}
+
+PipelineCache load_pipeline_cache(const vk::PhysicalDevice& physical_device,
+                                  const vk::Device& logical_device,
+                                  const std::filesystem::path& path) {
+  const auto properties = physical_device.getProperties();
+  const auto data       = read_pipeline_cache_file(path).and_then(
+      [&properties](auto data) -> std::optional<std::vector<char>> {
+        if (!is_pipeline_cache_compatible(data, properties)) {
+          std::cout << "Ignoring stale pipeline cache\n";
+          return std::nullopt;
+        }
+        return data;
+      });
+  auto cache_info = vk::PipelineCacheCreateInfo{};
+  if (data) {
+    cache_info.initialDataSize = data->size();
+    cache_info.pInitialData    = data->data();
+  }
+  auto pipeline_cache  = PipelineCache{};
+  pipeline_cache.cache = logical_device.createPipelineCacheUnique(cache_info);
+  pipeline_cache.warm  = data.has_value();
+  return pipeline_cache;
+}
+
+bool save_pipeline_cache(const vk::Device& logical_device,
+                         const vk::PipelineCache& pipeline_cache,
+                         const std::filesystem::path& path) {
+  const auto data = logical_device.getPipelineCacheData(pipeline_cache);
+  auto error      = std::error_code{};
+  std::filesystem::create_directories(path.parent_path(), error);
+  auto temporary_path = path;
+  temporary_path += ".tmp";
+  std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(data.data()), data.size());
+  // Closing flushes, which is where a full disk shows up.
+  file.close();
+  if (file) {
+    std::filesystem::rename(temporary_path, path, error);
+    if (!error) {
+      return true;
+    }
+  }
+  std::filesystem::remove(temporary_path, error);
+  return false;
+}
+
+std::vector<vk::Pipeline> create_graphics_pipelines_parallel(
+    const vk::Device& logical_device,
+    const std::vector<GraphicsPipelineDescription>& descriptions,
+    const vk::PipelineCache& pipeline_cache, const std::size_t thread_count) {
+  auto pipelines = std::vector<vk::Pipeline>(descriptions.size());
+  if (descriptions.empty()) {
+    return pipelines;
+  }
+  auto next_index    = std::atomic<std::size_t>{0};
+  auto failure       = std::exception_ptr{};
+  auto failure_mutex = std::mutex{};
+  const auto worker  = [&] {
+    auto index = std::size_t{};
+    while ((index = next_index.fetch_add(1)) < descriptions.size()) {
+      try {
+        pipelines[index] = create_graphics_pipeline(
+            logical_device, descriptions[index], pipeline_cache);
+      } catch (...) {
+        const auto lock = std::scoped_lock{failure_mutex};
+        if (!failure) {
+          failure = std::current_exception();
+        }
+      }
+    }
+  };
+  {
+    const auto worker_count =
+        std::clamp<std::size_t>(thread_count, 1, descriptions.size());
+    auto workers = std::vector<std::jthread>{};
+    workers.reserve(worker_count);
+    for (std::size_t i = 0; i < worker_count; ++i) {
+      workers.emplace_back(worker);
+    }
+  }
+  if (failure) {
+    for (const auto& pipeline : pipelines) {
+      if (pipeline) {
+        logical_device.destroyPipeline(pipeline);
+      }
+    }
+    std::rethrow_exception(failure);
+  }
+  return pipelines;
+}
+
+void report_pipeline_compile_timing(const PipelineCompileTiming& timing) {
+  std::cout << "Built " << timing.pipeline_count << " pipeline(s) with a "
+            << (timing.warm_cache ? "warm" : "cold") << " cache in "
+            << timing.elapsed.count() << " ms\n";
+}
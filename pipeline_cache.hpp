@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "picante.hpp"
+
+struct PipelineCache {
+  vk::UniquePipelineCache cache;
+  // True when the cache was seeded from data written by a previous run on the
+  // same driver and device, i.e. this is a warm start.
+  bool warm = false;
+};
+
+// $XDG_CACHE_HOME/picante/pipeline_cache.bin, falling back to ~/.cache and
+// then the working directory.
+std::filesystem::path default_pipeline_cache_path();
+
+// Checks the VkPipelineCacheHeaderVersionOne at the start of the blob against
+// the device, drivers reject (or worse, crash on) data from someone else.
+bool is_pipeline_cache_compatible(
+    const std::vector<char>& data,
+    const vk::PhysicalDeviceProperties& properties);
+
+// Loads the cache from disk, quietly starting from an empty one if the file is
+// missing or was written for a different device or driver version.
+PipelineCache load_pipeline_cache(const vk::PhysicalDevice& physical_device,
+                                  const vk::Device& logical_device,
+                                  const std::filesystem::path& path);
+
+// Writes through a temporary file so a crash mid-write never leaves a
+// truncated cache behind.
+bool save_pipeline_cache(const vk::Device& logical_device,
+                         const vk::PipelineCache& pipeline_cache,
+                         const std::filesystem::path& path);
+
+// Builds every description on a pool of worker threads sharing one cache.
+// The result is in the same order as the descriptions.
+std::vector<vk::Pipeline> create_graphics_pipelines_parallel(
+    const vk::Device& logical_device,
+    const std::vector<GraphicsPipelineDescription>& descriptions,
+    const vk::PipelineCache& pipeline_cache,
+    std::size_t thread_count = std::thread::hardware_concurrency());
+
+// Wall time spent building a batch, kept apart for cold and warm caches since
+// they differ by an order of magnitude.
+struct PipelineCompileTiming {
+  bool warm_cache = false;
+  std::size_t pipeline_count = 0;
+  std::chrono::duration<double, std::milli> elapsed{};
+};
+
+void report_pipeline_compile_timing(const PipelineCompileTiming& timing);
@@ -0,0 +1,20 @@
+#version 450
+
+// Stand-in post processing step: a small blur and a vignette, enough to
+// read the previous image around each pixel like real ones do.
+
+layout(location = 0) in vec2 fragUv;
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform sampler2D previous;
+
+void main() {
+  const vec2 texel = 1.0 / vec2(textureSize(previous, 0));
+  vec3 color       = texture(previous, fragUv).rgb * 0.5;
+  color += texture(previous, fragUv + vec2(texel.x, 0.0)).rgb * 0.125;
+  color += texture(previous, fragUv - vec2(texel.x, 0.0)).rgb * 0.125;
+  color += texture(previous, fragUv + vec2(0.0, texel.y)).rgb * 0.125;
+  color += texture(previous, fragUv - vec2(0.0, texel.y)).rgb * 0.125;
+  const float vignette = 1.0 - 0.3 * dot(fragUv - 0.5, fragUv - 0.5);
+  outColor = vec4(color * vignette, 1.0);
+}
@@ -0,0 +1,11 @@
+#version 450
+
+// One triangle covering the whole target, for passes that work on every
+// pixel of an image.
+
+layout(location = 0) out vec2 fragUv;
+
+void main() {
+  fragUv      = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+  gl_Position = vec4(fragUv * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,196 @@
+#include "queues.hpp"
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "cpu_profiler.hpp"
+
+AsyncSubmission
+submit_async(const vk::Device& logical_device, const vk::Queue& queue,
+             const std::uint32_t queue_family_index,
+             const std::function<void(const vk::CommandBuffer&)>& record,
+             const std::span<const QueueWait> waits) {
+  PICANTE_ZONE("submit async");
+  auto submission = AsyncSubmission{};
+  vk::CommandPoolCreateInfo commandPoolInfo;
+  commandPoolInfo.flags            = vk::CommandPoolCreateFlagBits::eTransient;
+  commandPoolInfo.queueFamilyIndex = queue_family_index;
+  submission.command_pool =
+      logical_device.createCommandPoolUnique(commandPoolInfo);
+  vk::CommandBufferAllocateInfo commandBufferAllocateInfo;
+  commandBufferAllocateInfo.commandPool        = submission.command_pool.get();
+  commandBufferAllocateInfo.level              = vk::CommandBufferLevel::ePrimary;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  submission.command_buffer =
+      logical_device.allocateCommandBuffers(commandBufferAllocateInfo).front();
+  vk::CommandBufferBeginInfo commandBufferBeginInfo;
+  commandBufferBeginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+  submission.command_buffer.begin(commandBufferBeginInfo);
+  record(submission.command_buffer);
+  submission.command_buffer.end();
+  submission.finished = logical_device.createSemaphoreUnique({});
+  submission.fence    = logical_device.createFenceUnique({});
+
+  auto wait_semaphores = std::vector<vk::Semaphore>{};
+  auto wait_stages     = std::vector<vk::PipelineStageFlags>{};
+  for (const auto& wait : waits) {
+    wait_semaphores.push_back(wait.semaphore);
+    wait_stages.push_back(wait.stage);
+  }
+  const auto signal_semaphore = submission.finished.get();
+  vk::SubmitInfo submitInfo;
+  submitInfo.waitSemaphoreCount   = wait_semaphores.size();
+  submitInfo.pWaitSemaphores      = wait_semaphores.data();
+  submitInfo.pWaitDstStageMask    = wait_stages.data();
+  submitInfo.commandBufferCount   = 1;
+  submitInfo.pCommandBuffers      = &submission.command_buffer;
+  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.pSignalSemaphores    = &signal_semaphore;
+  queue.submit(submitInfo, submission.fence.get());
+  return submission;
+}
+
+bool is_submission_complete(const vk::Device& logical_device,
+                            const AsyncSubmission& submission) {
+  return logical_device.getFenceStatus(submission.fence.get()) ==
+         vk::Result::eSuccess;
+}
+
+vk::BufferMemoryBarrier handoff_barrier(const BufferHandoff& handoff) {
+  vk::BufferMemoryBarrier bufferBarrier;
+  bufferBarrier.srcAccessMask       = handoff.src_access;
+  bufferBarrier.dstAccessMask       = handoff.dst_access;
+  bufferBarrier.srcQueueFamilyIndex = handoff.src_family;
+  bufferBarrier.dstQueueFamilyIndex = handoff.dst_family;
+  bufferBarrier.buffer              = handoff.buffer;
+  bufferBarrier.offset              = 0;
+  bufferBarrier.size                = VK_WHOLE_SIZE;
+  return bufferBarrier;
+}
+
+vk::ImageMemoryBarrier handoff_barrier(const ImageHandoff& handoff) {
+  vk::ImageMemoryBarrier imageBarrier;
+  imageBarrier.srcAccessMask       = handoff.src_access;
+  imageBarrier.dstAccessMask       = handoff.dst_access;
+  imageBarrier.oldLayout           = handoff.old_layout;
+  imageBarrier.newLayout           = handoff.new_layout;
+  imageBarrier.srcQueueFamilyIndex = handoff.src_family;
+  imageBarrier.dstQueueFamilyIndex = handoff.dst_family;
+  imageBarrier.image               = handoff.image;
+  imageBarrier.subresourceRange    = handoff.range;
+  return imageBarrier;
+}
+
+// The release only makes the source's writes available, the destination's
+// access mask means nothing on this side. The acquire is the mirror image,
+// its source access is covered by the semaphore.
+void record_release(const vk::CommandBuffer& command_buffer,
+                    const BufferHandoff& handoff) {
+  if (handoff.src_family == handoff.dst_family) {
+    return;
+  }
+  auto bufferBarrier          = handoff_barrier(handoff);
+  bufferBarrier.dstAccessMask = {};
+  command_buffer.pipelineBarrier(handoff.src_stage,
+                                 vk::PipelineStageFlagBits::eBottomOfPipe, {},
+                                 {}, bufferBarrier, {});
+}
+
+void record_release(const vk::CommandBuffer& command_buffer,
+                    const ImageHandoff& handoff) {
+  if (handoff.src_family == handoff.dst_family) {
+    return;
+  }
+  auto imageBarrier          = handoff_barrier(handoff);
+  imageBarrier.dstAccessMask = {};
+  command_buffer.pipelineBarrier(handoff.src_stage,
+                                 vk::PipelineStageFlagBits::eBottomOfPipe, {},
+                                 {}, {}, imageBarrier);
+}
+
+void record_acquire(const vk::CommandBuffer& command_buffer,
+                    const BufferHandoff& handoff) {
+  if (handoff.src_family == handoff.dst_family) {
+    return;
+  }
+  auto bufferBarrier          = handoff_barrier(handoff);
+  bufferBarrier.srcAccessMask = {};
+  // Chains onto the semaphore wait, which happens at dst_stage.
+  command_buffer.pipelineBarrier(handoff.dst_stage, handoff.dst_stage, {}, {},
+                                 bufferBarrier, {});
+}
+
+void record_acquire(const vk::CommandBuffer& command_buffer,
+                    const ImageHandoff& handoff) {
+  auto imageBarrier = handoff_barrier(handoff);
+  if (handoff.src_family == handoff.dst_family) {
+    if (handoff.old_layout == handoff.new_layout) {
+      return;
+    }
+    // Nothing to transfer, but the layout transition happens here.
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  }
+  imageBarrier.srcAccessMask = {};
+  command_buffer.pipelineBarrier(handoff.dst_stage, handoff.dst_stage, {}, {},
+                                 {}, imageBarrier);
+}
+
+std::optional<AsyncUpload>
+upload_buffer_async(DeviceAllocator& allocator, const DeviceQueues& queues,
+                    const std::span<const std::byte> data,
+                    const vk::BufferUsageFlags usage,
+                    const vk::PipelineStageFlags dst_stage,
+                    const vk::AccessFlags dst_access) {
+  PICANTE_ZONE("upload buffer async");
+  const auto size = static_cast<vk::DeviceSize>(data.size());
+  auto staging    = create_buffer(allocator, size,
+                                  vk::BufferUsageFlagBits::eTransferSrc,
+                                  vk::MemoryPropertyFlagBits::eHostVisible);
+  if (!staging) {
+    return std::nullopt;
+  }
+  std::memcpy(staging->allocation.mapped, data.data(), data.size());
+  flush_memory(allocator, staging->allocation);
+  auto buffer = create_buffer(allocator, size,
+                              usage | vk::BufferUsageFlagBits::eTransferDst,
+                              vk::MemoryPropertyFlagBits::eDeviceLocal);
+  if (!buffer) {
+    destroy_buffer(allocator, *staging);
+    return std::nullopt;
+  }
+  const auto handoff = BufferHandoff{buffer->buffer.get(),
+                                     queues.families.transfer,
+                                     queues.families.graphics,
+                                     vk::PipelineStageFlagBits::eTransfer,
+                                     vk::AccessFlagBits::eTransferWrite,
+                                     dst_stage,
+                                     dst_access};
+  auto submission = submit_async(
+      allocator.logical_device, queues.transfer, queues.families.transfer,
+      [&staging, &buffer, &handoff, size](const auto& command_buffer) {
+        command_buffer.copyBuffer(staging->buffer.get(), buffer->buffer.get(),
+                                  vk::BufferCopy{0, 0, size});
+        record_release(command_buffer, handoff);
+      });
+  return AsyncUpload{std::move(*buffer), std::move(*staging),
+                     std::move(submission), handoff};
+}
+
+AllocatedBuffer acquire_upload(DeviceAllocator& allocator,
+                               FrameRing& frame_ring,
+                               const vk::CommandBuffer& command_buffer,
+                               AsyncUpload&& upload) {
+  record_acquire(command_buffer, upload.handoff);
+  wait_on_next_submit(frame_ring, upload.submission.finished.get(),
+                      upload.handoff.dst_stage);
+  auto buffer        = std::move(upload.buffer);
+  const auto retired = std::make_shared<AsyncUpload>(std::move(upload));
+  // The frame waits for the copy, so once its fence signals the staging
+  // buffer and the transfer submission are done with too.
+  defer_deletion(frame_ring, [&allocator, retired] {
+    destroy_buffer(allocator, retired->staging);
+  });
+  return buffer;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+
+#include <vulkan/vulkan.hpp>
+
+#include "allocator.hpp"
+#include "picante.hpp"
+
+// Work for the transfer and compute queues, and handing what it produced
+// over to the queue that uses it.
+
+struct QueueWait {
+  vk::Semaphore semaphore;
+  vk::PipelineStageFlags stage;
+};
+
+// One batch on an async queue. finished is signalled for whichever queue
+// consumes the results, the fence tells the CPU when the batch's resources
+// can go.
+struct AsyncSubmission {
+  vk::UniqueCommandPool command_pool;
+  vk::CommandBuffer command_buffer;
+  vk::UniqueSemaphore finished;
+  vk::UniqueFence fence;
+};
+
+// Records and submits without waiting for anything but waits.
+AsyncSubmission
+submit_async(const vk::Device& logical_device, const vk::Queue& queue,
+             const std::uint32_t queue_family_index,
+             const std::function<void(const vk::CommandBuffer&)>& record,
+             const std::span<const QueueWait> waits = {});
+
+bool is_submission_complete(const vk::Device& logical_device,
+                            const AsyncSubmission& submission);
+
+// A resource moving from one queue family to another. With exclusive sharing
+// the source queue has to release it and the destination acquire it with
+// matching barriers, a semaphore between the two submits. Within one family
+// the semaphore alone does the job and the barriers are skipped, except for
+// an image's layout transition which the acquire still performs.
+struct BufferHandoff {
+  vk::Buffer buffer;
+  std::uint32_t src_family = 0;
+  std::uint32_t dst_family = 0;
+  vk::PipelineStageFlags src_stage;
+  vk::AccessFlags src_access;
+  vk::PipelineStageFlags dst_stage;
+  vk::AccessFlags dst_access;
+};
+
+struct ImageHandoff {
+  vk::Image image;
+  vk::ImageSubresourceRange range{vk::ImageAspectFlagBits::eColor, 0,
+                                  VK_REMAINING_MIP_LEVELS, 0,
+                                  VK_REMAINING_ARRAY_LAYERS};
+  vk::ImageLayout old_layout = vk::ImageLayout::eUndefined;
+  vk::ImageLayout new_layout = vk::ImageLayout::eUndefined;
+  std::uint32_t src_family   = 0;
+  std::uint32_t dst_family   = 0;
+  vk::PipelineStageFlags src_stage;
+  vk::AccessFlags src_access;
+  vk::PipelineStageFlags dst_stage;
+  vk::AccessFlags dst_access;
+};
+
+// Last thing the source records before signalling the semaphore.
+void record_release(const vk::CommandBuffer& command_buffer,
+                    const BufferHandoff& handoff);
+void record_release(const vk::CommandBuffer& command_buffer,
+                    const ImageHandoff& handoff);
+
+// First thing the destination records, outside any render pass, in a submit
+// waiting on the semaphore at dst_stage.
+void record_acquire(const vk::CommandBuffer& command_buffer,
+                    const BufferHandoff& handoff);
+void record_acquire(const vk::CommandBuffer& command_buffer,
+                    const ImageHandoff& handoff);
+
+// A device local buffer being filled on the transfer queue while graphics
+// carries on.
+struct AsyncUpload {
+  AllocatedBuffer buffer;
+  AllocatedBuffer staging;
+  AsyncSubmission submission;
+  BufferHandoff handoff;
+};
+
+// The buffer is handed to the graphics family for use at dst_stage with
+// dst_access.
+std::optional<AsyncUpload>
+upload_buffer_async(DeviceAllocator& allocator, const DeviceQueues& queues,
+                    const std::span<const std::byte> data,
+                    const vk::BufferUsageFlags usage,
+                    const vk::PipelineStageFlags dst_stage,
+                    const vk::AccessFlags dst_access);
+
+// Called while recording the first frame that uses the buffer, before its
+// render pass. Records the acquire, makes the frame's submit wait for the
+// copy and retires the staging buffer along with that frame.
+AllocatedBuffer acquire_upload(DeviceAllocator& allocator,
+                               FrameRing& frame_ring,
+                               const vk::CommandBuffer& command_buffer,
+                               AsyncUpload&& upload);
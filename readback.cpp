@@ -0,0 +1,310 @@
+#include "readback.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <ranges>
+#include <string>
+#include <utility>
+
+#include "cpu_profiler.hpp"
+
+// How long the consumer waits on the timeline before checking whether it was
+// asked to stop, in case a recorded frame never gets submitted.
+constexpr std::uint64_t readback_poll_ns = 100'000'000;
+
+DeviceFeatures readback_features() {
+  auto features                       = DeviceFeatures{};
+  features.vulkan12.timelineSemaphore = VK_TRUE;
+  return features;
+}
+
+bool supports_frame_readback(const DeviceFeatures& enabled_features) {
+  return enabled_features.vulkan12.timelineSemaphore;
+}
+
+void consume_readbacks(const std::stop_token stop_token,
+                       FrameReadback& readback) {
+  set_zone_thread_name("frame readback");
+  const auto& device  = readback.allocator->logical_device;
+  const auto timeline = readback.timeline.get();
+  while (true) {
+    auto index = std::size_t{0};
+    {
+      // Frames already queued are still consumed after a stop.
+      auto lock = std::unique_lock{readback.mutex};
+      if (!readback.changed.wait(lock, stop_token, [&readback] {
+            return !readback.queued.empty();
+          })) {
+        return;
+      }
+      index = readback.queued.front();
+    }
+    auto& slot = readback.slots[index];
+    vk::SemaphoreWaitInfo waitInfo;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores    = &timeline;
+    waitInfo.pValues        = &slot.value;
+    while (device.waitSemaphores(waitInfo, readback_poll_ns) ==
+           vk::Result::eTimeout) {
+      if (stop_token.stop_requested()) {
+        return;
+      }
+    }
+    const auto latency = std::chrono::steady_clock::now() - slot.recorded;
+    invalidate_memory(*readback.allocator, slot.buffer.allocation);
+    {
+      PICANTE_ZONE("consume frame");
+      readback.consumer(ReadbackFrame{
+          slot.frame, readback.extent, readback.format,
+          std::span<const std::byte>(slot.buffer.allocation.mapped,
+                                     readback.frame_bytes)});
+    }
+    {
+      const auto lock = std::scoped_lock{readback.mutex};
+      readback.queued.pop_front();
+      readback.free_slots.push_back(index);
+      ++readback.consumed_frames;
+      readback.latency_ms.push_back(
+          std::chrono::duration<double, std::milli>(latency).count());
+    }
+    readback.changed.notify_all();
+  }
+}
+
+std::unique_ptr<FrameReadback>
+create_frame_readback(DeviceAllocator& allocator, const vk::Extent2D extent,
+                      const vk::Format format, const std::size_t slot_count,
+                      ReadbackConsumer consumer, const bool drop_when_full) {
+  auto readback            = std::make_unique<FrameReadback>();
+  readback->allocator      = &allocator;
+  readback->extent         = extent;
+  readback->format         = format;
+  readback->consumer       = std::move(consumer);
+  readback->drop_when_full = drop_when_full;
+  // Every format the writers know is four bytes a texel.
+  readback->frame_bytes = vk::DeviceSize{extent.width} * extent.height * 4;
+
+  vk::SemaphoreTypeCreateInfo semaphoreTypeInfo;
+  semaphoreTypeInfo.semaphoreType = vk::SemaphoreType::eTimeline;
+  semaphoreTypeInfo.initialValue  = 0;
+  vk::SemaphoreCreateInfo semaphoreInfo;
+  semaphoreInfo.pNext = &semaphoreTypeInfo;
+  readback->timeline =
+      allocator.logical_device.createSemaphoreUnique(semaphoreInfo);
+
+  for (const auto index : std::views::iota(0uz, std::max(slot_count, 1uz))) {
+    // Cached memory makes the consumer's reads cost what reading any other
+    // memory does, uncached it is write combined and crawls.
+    auto buffer =
+        create_buffer(allocator, readback->frame_bytes,
+                      vk::BufferUsageFlagBits::eTransferDst,
+                      vk::MemoryPropertyFlagBits::eHostVisible |
+                          vk::MemoryPropertyFlagBits::eHostCached);
+    if (!buffer) {
+      buffer = create_buffer(allocator, readback->frame_bytes,
+                             vk::BufferUsageFlagBits::eTransferDst,
+                             vk::MemoryPropertyFlagBits::eHostVisible);
+    }
+    if (!buffer) {
+      destroy_frame_readback(*readback);
+      return nullptr;
+    }
+    readback->slots.push_back({std::move(*buffer)});
+    readback->free_slots.push_back(index);
+  }
+  std::ranges::reverse(readback->free_slots);
+  readback->consumer_thread =
+      std::jthread(consume_readbacks, std::ref(*readback));
+  return readback;
+}
+
+bool record_frame_readback(FrameReadback& readback, FrameRing& frame_ring,
+                           const vk::CommandBuffer& command_buffer,
+                           const vk::Image& image) {
+  auto index = std::size_t{0};
+  {
+    auto lock = std::unique_lock{readback.mutex};
+    if (readback.free_slots.empty()) {
+      if (readback.drop_when_full) {
+        ++readback.dropped_frames;
+        return false;
+      }
+      // Every queued frame has been submitted, so the consumer gets there.
+      PICANTE_ZONE("wait for readback slot");
+      readback.changed.wait(
+          lock, [&readback] { return !readback.free_slots.empty(); });
+    }
+    index = readback.free_slots.back();
+    readback.free_slots.pop_back();
+  }
+  auto& slot    = readback.slots[index];
+  slot.frame    = frame_ring.frame_index;
+  slot.value    = ++readback.next_value;
+  slot.recorded = std::chrono::steady_clock::now();
+
+  // The render pass leaves the image in TRANSFER_SRC_OPTIMAL but doesn't
+  // order its writes against the copy.
+  vk::ImageMemoryBarrier imageBarrier;
+  imageBarrier.srcAccessMask       = vk::AccessFlagBits::eColorAttachmentWrite;
+  imageBarrier.dstAccessMask       = vk::AccessFlagBits::eTransferRead;
+  imageBarrier.oldLayout           = vk::ImageLayout::eTransferSrcOptimal;
+  imageBarrier.newLayout           = vk::ImageLayout::eTransferSrcOptimal;
+  imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  imageBarrier.image               = image;
+  imageBarrier.subresourceRange =
+      vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1};
+  command_buffer.pipelineBarrier(
+      vk::PipelineStageFlagBits::eColorAttachmentOutput,
+      vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, imageBarrier);
+  vk::BufferImageCopy region;
+  region.imageSubresource =
+      vk::ImageSubresourceLayers{vk::ImageAspectFlagBits::eColor, 0, 0, 1};
+  region.imageExtent = vk::Extent3D{readback.extent, 1};
+  command_buffer.copyImageToBuffer(image, vk::ImageLayout::eTransferSrcOptimal,
+                                   slot.buffer.buffer.get(), region);
+  vk::BufferMemoryBarrier bufferBarrier;
+  bufferBarrier.srcAccessMask       = vk::AccessFlagBits::eTransferWrite;
+  bufferBarrier.dstAccessMask       = vk::AccessFlagBits::eHostRead;
+  bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  bufferBarrier.buffer              = slot.buffer.buffer.get();
+  bufferBarrier.size                = VK_WHOLE_SIZE;
+  command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                 vk::PipelineStageFlagBits::eHost, {}, {},
+                                 bufferBarrier, {});
+
+  signal_on_next_submit(frame_ring, readback.timeline.get(), slot.value);
+  {
+    const auto lock = std::scoped_lock{readback.mutex};
+    readback.queued.push_back(index);
+  }
+  readback.changed.notify_all();
+  return true;
+}
+
+void flush_frame_readback(FrameReadback& readback) {
+  auto lock = std::unique_lock{readback.mutex};
+  readback.changed.wait(lock, [&readback] { return readback.queued.empty(); });
+}
+
+void destroy_frame_readback(FrameReadback& readback) {
+  if (readback.consumer_thread.joinable()) {
+    readback.consumer_thread.request_stop();
+    readback.consumer_thread.join();
+  }
+  for (auto& slot : readback.slots) {
+    destroy_buffer(*readback.allocator, slot.buffer);
+  }
+  readback.slots.clear();
+  readback.timeline.reset();
+}
+
+// RGB of texel, whichever way round the source has its channels.
+std::array<std::uint8_t, 3> readback_rgb(const ReadbackFrame& frame,
+                                         const std::size_t texel) {
+  const auto* const bytes =
+      reinterpret_cast<const std::uint8_t*>(frame.pixels.data()) + texel * 4;
+  if (frame.format == vk::Format::eB8G8R8A8Unorm ||
+      frame.format == vk::Format::eB8G8R8A8Srgb) {
+    return {bytes[2], bytes[1], bytes[0]};
+  }
+  return {bytes[0], bytes[1], bytes[2]};
+}
+
+void write_raw_frame(std::ostream& stream, const ReadbackFrame& frame) {
+  stream.write(reinterpret_cast<const char*>(frame.pixels.data()),
+               static_cast<std::streamsize>(frame.pixels.size()));
+}
+
+void write_y4m_header(std::ostream& stream, const vk::Extent2D extent,
+                      const std::uint32_t frames_per_second) {
+  stream << "YUV4MPEG2 W" << extent.width << " H" << extent.height << " F"
+         << frames_per_second << ":1 Ip A1:1 C420jpeg\n";
+}
+
+void write_y4m_frame(std::ostream& stream, const ReadbackFrame& frame) {
+  const auto width         = std::size_t{frame.extent.width};
+  const auto height        = std::size_t{frame.extent.height};
+  const auto chroma_width  = (width + 1) / 2;
+  const auto chroma_height = (height + 1) / 2;
+  auto luma   = std::vector<std::uint8_t>(width * height);
+  auto chroma = std::vector<std::uint8_t>(chroma_width * chroma_height * 2);
+  // Full range BT.601 as JPEG has it, in 8.8 fixed point.
+  for (const auto texel : std::views::iota(0uz, width * height)) {
+    const auto [r, g, b] = readback_rgb(frame, texel);
+    luma[texel] =
+        static_cast<std::uint8_t>((77 * r + 150 * g + 29 * b + 128) >> 8);
+  }
+  // Chroma of each 2x2 block's average, the last row and column repeat on
+  // odd sizes.
+  for (const auto y : std::views::iota(0uz, chroma_height)) {
+    for (const auto x : std::views::iota(0uz, chroma_width)) {
+      auto sum = std::array<int, 3>{};
+      for (const auto [dx, dy] : {std::pair{0uz, 0uz}, std::pair{1uz, 0uz},
+                                  std::pair{0uz, 1uz}, std::pair{1uz, 1uz}}) {
+        const auto texel = std::min(y * 2 + dy, height - 1) * width +
+                           std::min(x * 2 + dx, width - 1);
+        const auto rgb = readback_rgb(frame, texel);
+        for (const auto channel : std::views::iota(0, 3)) {
+          sum[channel] += rgb[channel];
+        }
+      }
+      const auto [r, g, b] = sum;
+      const auto cb = ((-43 * r - 85 * g + 128 * b + 512) >> 10) + 128;
+      const auto cr = ((128 * r - 107 * g - 21 * b + 512) >> 10) + 128;
+      chroma[y * chroma_width + x] =
+          static_cast<std::uint8_t>(std::clamp(cb, 0, 255));
+      chroma[(chroma_height + y) * chroma_width + x] =
+          static_cast<std::uint8_t>(std::clamp(cr, 0, 255));
+    }
+  }
+  stream << "FRAME\n";
+  stream.write(reinterpret_cast<const char*>(luma.data()),
+               static_cast<std::streamsize>(luma.size()));
+  stream.write(reinterpret_cast<const char*>(chroma.data()),
+               static_cast<std::streamsize>(chroma.size()));
+}
+
+void write_ppm_frame(std::ostream& stream, const ReadbackFrame& frame) {
+  stream << "P6\n" << frame.extent.width << ' ' << frame.extent.height
+         << "\n255\n";
+  auto rgb = std::vector<std::uint8_t>{};
+  rgb.reserve(std::size_t{frame.extent.width} * frame.extent.height * 3);
+  for (const auto texel : std::views::iota(
+           0uz, std::size_t{frame.extent.width} * frame.extent.height)) {
+    const auto color = readback_rgb(frame, texel);
+    rgb.insert(rgb.end(), color.begin(), color.end());
+  }
+  stream.write(reinterpret_cast<const char*>(rgb.data()),
+               static_cast<std::streamsize>(rgb.size()));
+}
+
+ReadbackConsumer create_readback_writer(const std::filesystem::path& path,
+                                        const ReadbackFileFormat format,
+                                        const vk::Extent2D extent) {
+  if (format == ReadbackFileFormat::ePpm) {
+    return [path](const ReadbackFrame& frame) {
+      auto frame_path = path;
+      frame_path.replace_filename(path.stem().string() + "_" +
+                                  std::to_string(frame.frame) +
+                                  path.extension().string());
+      auto stream = std::ofstream{frame_path, std::ios::binary};
+      write_ppm_frame(stream, frame);
+    };
+  }
+  // std::function has to be copyable, the stream isn't.
+  auto stream = std::make_shared<std::ofstream>(
+      path, std::ios::binary | std::ios::trunc);
+  if (format == ReadbackFileFormat::eY4m) {
+    write_y4m_header(*stream, extent);
+  }
+  return [stream, format](const ReadbackFrame& frame) {
+    if (format == ReadbackFileFormat::eY4m) {
+      write_y4m_frame(*stream, frame);
+    } else {
+      write_raw_frame(*stream, frame);
+    }
+  };
+}
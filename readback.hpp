@@ -0,0 +1,117 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "allocator.hpp"
+#include "picante.hpp"
+
+// Frames copied out of the color attachment without the render thread ever
+// waiting for them. Each frame's command buffer copies the attachment into
+// one of a ring of host visible, preferably host cached, buffers, and the
+// frame's submit signals a timeline semaphore to that copy's value. A
+// consumer thread waits on the semaphore and hands out views straight into
+// the mapped buffer, which go back to the ring once the consumer returns.
+
+// Timeline semaphores, the readback can't signal without them.
+DeviceFeatures readback_features();
+bool supports_frame_readback(const DeviceFeatures& enabled_features);
+
+struct ReadbackFrame {
+  std::uint64_t frame = 0;
+  vk::Extent2D extent;
+  vk::Format format = vk::Format::eUndefined;
+  // Tightly packed rows, only valid until the consumer returns.
+  std::span<const std::byte> pixels;
+};
+
+using ReadbackConsumer = std::function<void(const ReadbackFrame&)>;
+
+struct ReadbackSlot {
+  AllocatedBuffer buffer;
+  std::uint64_t frame = 0;
+  // Timeline value the copy into the buffer signals.
+  std::uint64_t value = 0;
+  std::chrono::steady_clock::time_point recorded;
+};
+
+struct FrameReadback {
+  DeviceAllocator* allocator = nullptr;
+  vk::Extent2D extent;
+  vk::Format format          = vk::Format::eUndefined;
+  vk::DeviceSize frame_bytes = 0;
+  vk::UniqueSemaphore timeline;
+  // Only touched by the recording thread.
+  std::uint64_t next_value = 0;
+  std::vector<ReadbackSlot> slots;
+  ReadbackConsumer consumer;
+  // Drop frames when every slot is still waiting on the consumer, rather
+  // than waiting for it.
+  bool drop_when_full = true;
+
+  std::mutex mutex;
+  std::condition_variable_any changed;
+  // Slots recorded and not consumed yet, oldest first, and slots free to
+  // record into.
+  std::deque<std::size_t> queued;
+  std::vector<std::size_t> free_slots;
+  std::uint64_t dropped_frames  = 0;
+  std::uint64_t consumed_frames = 0;
+  // From the copy being recorded to the consumer being handed the frame.
+  std::vector<double> latency_ms;
+  // Last so it's stopped and joined before anything it uses is destroyed.
+  std::jthread consumer_thread;
+};
+
+// extent and format are those of the images record_frame_readback copies.
+// slot_count buffers of one frame each are allocated up front.
+std::unique_ptr<FrameReadback>
+create_frame_readback(DeviceAllocator& allocator, const vk::Extent2D extent,
+                      const vk::Format format, const std::size_t slot_count,
+                      ReadbackConsumer consumer,
+                      const bool drop_when_full = true);
+
+// Copies image, which has to be in TRANSFER_SRC_OPTIMAL, into a free slot
+// and makes the next frame submitted on frame_ring signal it ready. Record
+// after the render pass. Returns false if the frame was dropped.
+bool record_frame_readback(FrameReadback& readback, FrameRing& frame_ring,
+                           const vk::CommandBuffer& command_buffer,
+                           const vk::Image& image);
+
+// Blocks until every frame recorded so far has been consumed. Only call once
+// the frames have been submitted.
+void flush_frame_readback(FrameReadback& readback);
+
+// Stops the consumer, once it has consumed what was queued, and frees the
+// buffers. The GPU has to be done with every frame that was read back.
+void destroy_frame_readback(FrameReadback& readback);
+
+// Writers for the consumer. Rows are written top to bottom, BGRA and RGBA
+// sources are both turned into RGB.
+enum class ReadbackFileFormat { eRaw, eY4m, ePpm };
+
+// Raw writes the pixels as they are. Y4M writes 4:2:0 with full range BT.601
+// as JPEG has it, and needs write_y4m_header once before the first frame.
+void write_raw_frame(std::ostream& stream, const ReadbackFrame& frame);
+void write_y4m_header(std::ostream& stream, const vk::Extent2D extent,
+                      const std::uint32_t frames_per_second = 60);
+void write_y4m_frame(std::ostream& stream, const ReadbackFrame& frame);
+void write_ppm_frame(std::ostream& stream, const ReadbackFrame& frame);
+
+// Raw and Y4M append every frame to path, PPM writes one file per frame
+// with the frame number appended to path's stem.
+ReadbackConsumer create_readback_writer(const std::filesystem::path& path,
+                                        const ReadbackFileFormat format,
+                                        const vk::Extent2D extent);
@@ -0,0 +1,578 @@
+#include "render_graph.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <optional>
+#include <ranges>
+#include <utility>
+
+// What an access means to the barriers and the image's usage.
+struct GraphAccessInfo {
+  vk::PipelineStageFlags stages;
+  vk::AccessFlags access;
+  vk::ImageLayout layout;
+  vk::ImageUsageFlags usage;
+  bool write = false;
+};
+
+// How far the graph got with an image while compiling, as of the pass being
+// compiled.
+struct GraphImageState {
+  vk::ImageLayout layout;
+  // The last write, or layout transition, and who read since.
+  vk::PipelineStageFlags write_stages;
+  vk::AccessFlags write_access;
+  vk::PipelineStageFlags read_stages;
+  // Stages and accesses the last write has already been made visible to.
+  vk::PipelineStageFlags synced_stages;
+  vk::AccessFlags synced_access;
+};
+
+constexpr auto graph_write_access =
+    vk::AccessFlagBits::eColorAttachmentWrite |
+    vk::AccessFlagBits::eDepthStencilAttachmentWrite |
+    vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite;
+constexpr auto graph_attachment_usage =
+    vk::ImageUsageFlagBits::eColorAttachment |
+    vk::ImageUsageFlagBits::eDepthStencilAttachment |
+    vk::ImageUsageFlagBits::eInputAttachment;
+constexpr auto unused_pass = std::numeric_limits<std::uint32_t>::max();
+
+GraphAccessInfo get_graph_access_info(const RenderGraphAccess access) {
+  switch (access) {
+  case RenderGraphAccess::eColorAttachment:
+    return {vk::PipelineStageFlagBits::eColorAttachmentOutput,
+            vk::AccessFlagBits::eColorAttachmentRead |
+                vk::AccessFlagBits::eColorAttachmentWrite,
+            vk::ImageLayout::eColorAttachmentOptimal,
+            vk::ImageUsageFlagBits::eColorAttachment, true};
+  case RenderGraphAccess::eDepthAttachment:
+    return {vk::PipelineStageFlagBits::eEarlyFragmentTests |
+                vk::PipelineStageFlagBits::eLateFragmentTests,
+            vk::AccessFlagBits::eDepthStencilAttachmentRead |
+                vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+            vk::ImageLayout::eDepthStencilAttachmentOptimal,
+            vk::ImageUsageFlagBits::eDepthStencilAttachment, true};
+  case RenderGraphAccess::eSampled:
+    return {vk::PipelineStageFlagBits::eFragmentShader |
+                vk::PipelineStageFlagBits::eComputeShader,
+            vk::AccessFlagBits::eShaderRead,
+            vk::ImageLayout::eShaderReadOnlyOptimal,
+            vk::ImageUsageFlagBits::eSampled, false};
+  case RenderGraphAccess::eStorageRead:
+    return {vk::PipelineStageFlagBits::eComputeShader,
+            vk::AccessFlagBits::eShaderRead, vk::ImageLayout::eGeneral,
+            vk::ImageUsageFlagBits::eStorage, false};
+  case RenderGraphAccess::eStorageWrite:
+    return {vk::PipelineStageFlagBits::eComputeShader,
+            vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+            vk::ImageLayout::eGeneral, vk::ImageUsageFlagBits::eStorage, true};
+  case RenderGraphAccess::eTransferSource:
+    return {vk::PipelineStageFlagBits::eTransfer,
+            vk::AccessFlagBits::eTransferRead,
+            vk::ImageLayout::eTransferSrcOptimal,
+            vk::ImageUsageFlagBits::eTransferSrc, false};
+  case RenderGraphAccess::eTransferDestination:
+    return {vk::PipelineStageFlagBits::eTransfer,
+            vk::AccessFlagBits::eTransferWrite,
+            vk::ImageLayout::eTransferDstOptimal,
+            vk::ImageUsageFlagBits::eTransferDst, true};
+  }
+  return {};
+}
+
+bool is_attachment_access(const RenderGraphAccess access) {
+  return access == RenderGraphAccess::eColorAttachment ||
+         access == RenderGraphAccess::eDepthAttachment;
+}
+
+RenderGraph create_render_graph(DeviceAllocator& allocator) {
+  auto graph      = RenderGraph{};
+  graph.allocator = &allocator;
+  return graph;
+}
+
+RenderGraphResource
+create_graph_image(RenderGraph& graph, std::string name,
+                   const RenderGraphImageDescription& description) {
+  auto image        = RenderGraphImage{};
+  image.name        = std::move(name);
+  image.description = description;
+  graph.images.push_back(std::move(image));
+  return static_cast<RenderGraphResource>(graph.images.size() - 1);
+}
+
+RenderGraphResource
+import_graph_image(RenderGraph& graph, std::string name,
+                   const RenderGraphImageDescription& description,
+                   const vk::ImageLayout initial_layout,
+                   const vk::ImageLayout final_layout) {
+  const auto resource =
+      create_graph_image(graph, std::move(name), description);
+  auto& image          = graph.images[resource];
+  image.imported       = true;
+  image.initial_layout = initial_layout;
+  image.final_layout   = final_layout;
+  return resource;
+}
+
+RenderGraphPassIndex
+add_graph_pass(RenderGraph& graph, std::string name,
+               std::vector<RenderGraphUse> uses,
+               std::function<void(const vk::CommandBuffer&)> record) {
+  auto pass   = RenderGraphPass{};
+  pass.name   = std::move(name);
+  pass.uses   = std::move(uses);
+  pass.record = std::move(record);
+  graph.passes.push_back(std::move(pass));
+  return static_cast<RenderGraphPassIndex>(graph.passes.size() - 1);
+}
+
+// The barrier the use needs, if any, with its source stages added to
+// src_stages. Moves the state on past the use.
+std::optional<vk::ImageMemoryBarrier>
+advance_graph_image_state(GraphImageState& state, const GraphAccessInfo& info,
+                          const vk::ImageAspectFlags aspect,
+                          vk::PipelineStageFlags& src_stages) {
+  const auto transition = state.layout != info.layout;
+  // Reads in the same layout only wait for a write the previous barriers
+  // haven't already made visible to them.
+  const auto covered =
+      !transition && !info.write &&
+      (!state.write_stages ||
+       (!(info.stages & ~state.synced_stages) &&
+        !(info.access & ~state.synced_access)));
+  auto image_barrier = std::optional<vk::ImageMemoryBarrier>{};
+  if (!covered) {
+    image_barrier.emplace();
+    image_barrier->srcAccessMask       = state.write_access;
+    image_barrier->dstAccessMask       = info.access;
+    image_barrier->oldLayout           = state.layout;
+    image_barrier->newLayout           = info.layout;
+    image_barrier->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier->subresourceRange    = vk::ImageSubresourceRange{
+        aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+    // Writes wait for the reads before them too.
+    const auto waited_on = state.write_stages | state.read_stages;
+    src_stages |= waited_on ? waited_on
+                            : vk::PipelineStageFlags{
+                                  vk::PipelineStageFlagBits::eTopOfPipe};
+  }
+  if (info.write || transition) {
+    // A layout transition counts as a write for whoever comes next.
+    state.layout        = info.layout;
+    state.write_stages  = info.stages;
+    state.write_access  = info.write ? info.access & graph_write_access
+                                     : vk::AccessFlags{};
+    state.read_stages   = info.write ? vk::PipelineStageFlags{} : info.stages;
+    state.synced_stages = info.stages;
+    state.synced_access = info.access;
+  } else {
+    state.read_stages |= info.stages;
+    if (!covered) {
+      state.synced_stages |= info.stages;
+      state.synced_access |= info.access;
+    }
+  }
+  return image_barrier;
+}
+
+vk::UniqueRenderPass
+create_graph_render_pass(const RenderGraph& graph, RenderGraphPass& pass,
+                         const std::vector<bool>& written,
+                         const std::vector<std::uint32_t>& last_use,
+                         const std::uint32_t pass_index) {
+  auto descriptions     = std::vector<vk::AttachmentDescription>{};
+  auto color_references = std::vector<vk::AttachmentReference>{};
+  auto depth_reference  = std::optional<vk::AttachmentReference>{};
+  for (const auto& use : pass.uses) {
+    if (!is_attachment_access(use.access)) {
+      continue;
+    }
+    const auto& image = graph.images[use.resource];
+    const auto layout = get_graph_access_info(use.access).layout;
+    const auto index  = static_cast<std::uint32_t>(descriptions.size());
+    // Nothing written yet is cleared rather than loaded, nothing read later
+    // is never stored, which is what lets tilers keep transient attachments
+    // on chip.
+    const auto load  = written[use.resource] ? vk::AttachmentLoadOp::eLoad
+                                             : vk::AttachmentLoadOp::eClear;
+    const auto store = image.imported || last_use[use.resource] > pass_index
+                           ? vk::AttachmentStoreOp::eStore
+                           : vk::AttachmentStoreOp::eDontCare;
+    vk::AttachmentDescription attachmentDescription;
+    attachmentDescription.format         = image.description.format;
+    attachmentDescription.samples        = vk::SampleCountFlagBits::e1;
+    attachmentDescription.loadOp         = load;
+    attachmentDescription.storeOp        = store;
+    attachmentDescription.stencilLoadOp  = vk::AttachmentLoadOp::eDontCare;
+    attachmentDescription.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+    // The graph's own barriers do every layout transition.
+    attachmentDescription.initialLayout = layout;
+    attachmentDescription.finalLayout   = layout;
+    descriptions.push_back(attachmentDescription);
+    pass.attachments.push_back(use.resource);
+    if (use.access == RenderGraphAccess::eDepthAttachment) {
+      depth_reference = vk::AttachmentReference{index, layout};
+      pass.clear_values.emplace_back(vk::ClearDepthStencilValue{1.0f, 0});
+    } else {
+      color_references.emplace_back(index, layout);
+      pass.clear_values.emplace_back(
+          vk::ClearColorValue{std::array{0.0f, 0.0f, 0.0f, 1.0f}});
+    }
+  }
+  if (descriptions.empty()) {
+    return {};
+  }
+  vk::SubpassDescription subpass;
+  subpass.pipelineBindPoint    = vk::PipelineBindPoint::eGraphics;
+  subpass.colorAttachmentCount = color_references.size();
+  subpass.pColorAttachments    = color_references.data();
+  subpass.pDepthStencilAttachment =
+      depth_reference ? &*depth_reference : nullptr;
+  vk::RenderPassCreateInfo renderPassInfo;
+  renderPassInfo.attachmentCount = descriptions.size();
+  renderPassInfo.pAttachments    = descriptions.data();
+  renderPassInfo.subpassCount    = 1;
+  renderPassInfo.pSubpasses      = &subpass;
+  return graph.allocator->logical_device.createRenderPassUnique(
+      renderPassInfo);
+}
+
+bool compile_render_graph(RenderGraph& graph) {
+  auto& allocator    = *graph.allocator;
+  const auto& device = allocator.logical_device;
+  auto& images       = graph.images;
+  auto& passes       = graph.passes;
+  graph.stats        = RenderGraphStats{};
+  graph.stats.passes = passes.size();
+
+  // Walking back from the imported images, a pass is needed when it writes
+  // something a needed pass reads or writes after it. Writes don't end the
+  // chain, attachments load whatever was there before.
+  auto needed = std::vector<bool>(images.size(), false);
+  for (const auto [resource, image] : std::views::enumerate(images)) {
+    needed[resource] = image.imported;
+  }
+  for (auto& pass : passes | std::views::reverse) {
+    pass.culled = std::ranges::none_of(pass.uses, [&needed](const auto& use) {
+      return get_graph_access_info(use.access).write && needed[use.resource];
+    });
+    if (pass.culled) {
+      ++graph.stats.culled_passes;
+      continue;
+    }
+    for (const auto& use : pass.uses) {
+      needed[use.resource] = true;
+    }
+  }
+
+  auto first_use   = std::vector<std::uint32_t>(images.size(), unused_pass);
+  auto last_use    = std::vector<std::uint32_t>(images.size(), 0);
+  auto last_access = std::vector<GraphAccessInfo>(images.size());
+  for (const auto [index, pass] : std::views::enumerate(passes)) {
+    if (pass.culled) {
+      continue;
+    }
+    const auto pass_index = static_cast<std::uint32_t>(index);
+    for (const auto& use : pass.uses) {
+      const auto resource   = use.resource;
+      const auto info       = get_graph_access_info(use.access);
+      first_use[resource]   = std::min(first_use[resource], pass_index);
+      last_use[resource]    = pass_index;
+      last_access[resource] = info;
+      images[resource].usage |= info.usage;
+    }
+  }
+
+  // Transient images in the order they come alive, each going into the first
+  // memory slot whose images are all dead by then. Images only ever used as
+  // attachments get their own slots so they can be lazily allocated.
+  struct MemorySlot {
+    vk::MemoryRequirements requirements;
+    bool attachments_only  = false;
+    std::uint32_t last_use = 0;
+    std::vector<RenderGraphResource> images;
+  };
+  auto transients = std::vector<RenderGraphResource>{};
+  for (const auto resource :
+       std::views::iota(0u, static_cast<std::uint32_t>(images.size()))) {
+    if (!images[resource].imported && first_use[resource] != unused_pass) {
+      transients.push_back(resource);
+    }
+  }
+  std::ranges::sort(transients, {}, [&first_use](const auto resource) {
+    return first_use[resource];
+  });
+  auto slots = std::vector<MemorySlot>{};
+  for (const auto resource : transients) {
+    auto& image = images[resource];
+    const auto attachments_only = !(image.usage & ~graph_attachment_usage);
+    // Tells the driver the contents never leave the render pass.
+    const auto transient_usage =
+        attachments_only ? vk::ImageUsageFlagBits::eTransientAttachment
+                         : vk::ImageUsageFlags{};
+    vk::ImageCreateInfo imageInfo;
+    imageInfo.imageType     = vk::ImageType::e2D;
+    imageInfo.format        = image.description.format;
+    imageInfo.extent        = vk::Extent3D{image.description.extent, 1};
+    imageInfo.mipLevels     = 1;
+    imageInfo.arrayLayers   = 1;
+    imageInfo.samples       = vk::SampleCountFlagBits::e1;
+    imageInfo.tiling        = vk::ImageTiling::eOptimal;
+    imageInfo.usage         = image.usage | transient_usage;
+    imageInfo.sharingMode   = vk::SharingMode::eExclusive;
+    imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+    image.owned_image       = device.createImageUnique(imageInfo);
+    const auto requirements =
+        device.getImageMemoryRequirements(image.owned_image.get());
+    graph.stats.transient_bytes_requested += requirements.size;
+    ++graph.stats.transient_images;
+
+    auto slot = std::ranges::find_if(slots, [&](const MemorySlot& slot) {
+      return slot.last_use < first_use[resource] &&
+             slot.attachments_only == attachments_only &&
+             (slot.requirements.memoryTypeBits & requirements.memoryTypeBits);
+    });
+    if (slot == slots.end()) {
+      slots.push_back(MemorySlot{requirements, attachments_only, 0, {}});
+      slot = std::prev(slots.end());
+    }
+    slot->requirements.size =
+        std::max(slot->requirements.size, requirements.size);
+    slot->requirements.alignment =
+        std::max(slot->requirements.alignment, requirements.alignment);
+    slot->requirements.memoryTypeBits &= requirements.memoryTypeBits;
+    slot->last_use = last_use[resource];
+    slot->images.push_back(resource);
+    image.memory_slot = static_cast<std::uint32_t>(slot - slots.begin());
+  }
+
+  for (const auto& slot : slots) {
+    auto allocation = std::optional<Allocation>{};
+    if (slot.attachments_only) {
+      allocation = allocate_memory(
+          allocator, slot.requirements,
+          vk::MemoryPropertyFlagBits::eDeviceLocal |
+              vk::MemoryPropertyFlagBits::eLazilyAllocated,
+          ResourceKind::eOptimal);
+    }
+    const auto lazy = allocation.has_value();
+    if (!allocation) {
+      allocation = allocate_memory(allocator, slot.requirements,
+                                   vk::MemoryPropertyFlagBits::eDeviceLocal,
+                                   ResourceKind::eOptimal);
+    }
+    if (!allocation) {
+      destroy_render_graph(graph);
+      return false;
+    }
+    graph.stats.transient_bytes_allocated += slot.requirements.size;
+    for (const auto resource : slot.images) {
+      auto& image = images[resource];
+      device.bindImageMemory(image.owned_image.get(), allocation->memory,
+                             allocation->offset);
+      vk::ImageViewCreateInfo viewInfo;
+      viewInfo.image                       = image.owned_image.get();
+      viewInfo.viewType                    = vk::ImageViewType::e2D;
+      viewInfo.format                      = image.description.format;
+      viewInfo.subresourceRange.aspectMask = image.description.aspect;
+      viewInfo.subresourceRange.levelCount = 1;
+      viewInfo.subresourceRange.layerCount = 1;
+
+      image.owned_view = device.createImageViewUnique(viewInfo);
+      image.image      = image.owned_image.get();
+      image.view       = image.owned_view.get();
+      graph.stats.lazy_images += lazy;
+    }
+    graph.memory.push_back(*allocation);
+  }
+
+  // Every frame starts where the last one left off. Imported images wait on
+  // whoever handed them over, transient ones on the last use of the image
+  // before them in their memory slot, which for the first is the last image
+  // of the previous frame.
+  auto states  = std::vector<GraphImageState>(images.size());
+  auto written = std::vector<bool>(images.size(), false);
+  for (const auto [resource, image] : std::views::enumerate(images)) {
+    auto& state = states[resource];
+    if (image.imported) {
+      state.layout       = image.initial_layout;
+      state.write_stages = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+      written[resource]  = image.initial_layout != vk::ImageLayout::eUndefined;
+    }
+  }
+  for (const auto& slot : slots) {
+    for (const auto [index, resource] : std::views::enumerate(slot.images)) {
+      const auto previous =
+          slot.images[(index + slot.images.size() - 1) % slot.images.size()];
+      const auto& info   = last_access[previous];
+      auto& state        = states[resource];
+      state.layout       = vk::ImageLayout::eUndefined;
+      state.write_stages = info.stages;
+      state.write_access =
+          info.write ? info.access & graph_write_access : vk::AccessFlags{};
+    }
+  }
+
+  for (const auto [index, pass] : std::views::enumerate(passes)) {
+    if (pass.culled) {
+      continue;
+    }
+    const auto pass_index = static_cast<std::uint32_t>(index);
+    pass.render_pass =
+        create_graph_render_pass(graph, pass, written, last_use, pass_index);
+    for (const auto& use : pass.uses) {
+      const auto info          = get_graph_access_info(use.access);
+      const auto image_barrier = advance_graph_image_state(
+          states[use.resource], info,
+          images[use.resource].description.aspect, pass.barrier.src_stages);
+      if (image_barrier) {
+        pass.barrier.dst_stages |= info.stages;
+        pass.barrier.images.push_back({use.resource, *image_barrier});
+      }
+      written[use.resource] = written[use.resource] || info.write;
+    }
+    if (!pass.barrier.images.empty()) {
+      ++graph.stats.barrier_calls;
+      graph.stats.image_barriers += pass.barrier.images.size();
+    }
+  }
+
+  for (const auto [resource, image] : std::views::enumerate(images)) {
+    const auto& state = states[resource];
+    if (!image.imported || first_use[resource] == unused_pass ||
+        image.final_layout == vk::ImageLayout::eUndefined ||
+        state.layout == image.final_layout) {
+      continue;
+    }
+    vk::ImageMemoryBarrier imageBarrier;
+    imageBarrier.srcAccessMask       = state.write_access;
+    imageBarrier.dstAccessMask       = vk::AccessFlagBits::eMemoryRead;
+    imageBarrier.oldLayout           = state.layout;
+    imageBarrier.newLayout           = image.final_layout;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.subresourceRange    = vk::ImageSubresourceRange{
+        image.description.aspect, 0, VK_REMAINING_MIP_LEVELS, 0,
+        VK_REMAINING_ARRAY_LAYERS};
+    graph.final_barrier.src_stages |= state.write_stages | state.read_stages;
+    graph.final_barrier.dst_stages |= vk::PipelineStageFlagBits::eAllCommands;
+    graph.final_barrier.images.push_back(
+        {static_cast<RenderGraphResource>(resource), imageBarrier});
+  }
+  if (!graph.final_barrier.images.empty()) {
+    ++graph.stats.barrier_calls;
+    graph.stats.image_barriers += graph.final_barrier.images.size();
+  }
+  graph.compiled = true;
+  return true;
+}
+
+vk::RenderPass graph_render_pass(const RenderGraph& graph,
+                                 const RenderGraphPassIndex pass) {
+  return graph.passes[pass].render_pass.get();
+}
+
+vk::ImageView graph_image_view(const RenderGraph& graph,
+                               const RenderGraphResource resource) {
+  return graph.images[resource].view;
+}
+
+void set_graph_image(RenderGraph& graph, const RenderGraphResource resource,
+                     const vk::Image& image, const vk::ImageView& view) {
+  graph.images[resource].image = image;
+  graph.images[resource].view  = view;
+}
+
+std::vector<vk::UniqueFramebuffer>
+release_graph_framebuffers(RenderGraph& graph) {
+  auto released = std::vector<vk::UniqueFramebuffer>{};
+  for (auto& pass : graph.passes) {
+    for (auto& entry : pass.framebuffers) {
+      released.push_back(std::move(entry.second));
+    }
+    pass.framebuffers.clear();
+  }
+  return released;
+}
+
+void record_graph_barrier(const RenderGraph& graph,
+                          const RenderGraphBarrier& barrier,
+                          const vk::CommandBuffer& command_buffer) {
+  if (barrier.images.empty()) {
+    return;
+  }
+  auto image_barriers = std::vector<vk::ImageMemoryBarrier>{};
+  image_barriers.reserve(barrier.images.size());
+  for (const auto& [resource, image_barrier] : barrier.images) {
+    image_barriers.push_back(image_barrier);
+    image_barriers.back().image = graph.images[resource].image;
+  }
+  command_buffer.pipelineBarrier(barrier.src_stages, barrier.dst_stages, {},
+                                 {}, {}, image_barriers);
+}
+
+void execute_render_graph(RenderGraph& graph,
+                          const vk::CommandBuffer& command_buffer) {
+  const auto& device = graph.allocator->logical_device;
+  for (auto& pass : graph.passes) {
+    if (pass.culled) {
+      continue;
+    }
+    record_graph_barrier(graph, pass.barrier, command_buffer);
+    if (!pass.render_pass) {
+      pass.record(command_buffer);
+      continue;
+    }
+    auto views = std::vector<vk::ImageView>{};
+    for (const auto resource : pass.attachments) {
+      views.push_back(graph.images[resource].view);
+    }
+    const auto extent =
+        graph.images[pass.attachments.front()].description.extent;
+    auto framebuffer = pass.framebuffers.find(views);
+    if (framebuffer == pass.framebuffers.end()) {
+      vk::FramebufferCreateInfo frameBufferInfo;
+      frameBufferInfo.renderPass      = pass.render_pass.get();
+      frameBufferInfo.attachmentCount = views.size();
+      frameBufferInfo.pAttachments    = views.data();
+      frameBufferInfo.width           = extent.width;
+      frameBufferInfo.height          = extent.height;
+      frameBufferInfo.layers          = 1;
+      framebuffer =
+          pass.framebuffers
+              .emplace(views, device.createFramebufferUnique(frameBufferInfo))
+              .first;
+    }
+    vk::RenderPassBeginInfo renderPassBeginInfo;
+    renderPassBeginInfo.renderPass      = pass.render_pass.get();
+    renderPassBeginInfo.framebuffer     = framebuffer->second.get();
+    renderPassBeginInfo.renderArea      = vk::Rect2D{{0, 0}, extent};
+    renderPassBeginInfo.clearValueCount = pass.clear_values.size();
+    renderPassBeginInfo.pClearValues    = pass.clear_values.data();
+    command_buffer.beginRenderPass(renderPassBeginInfo,
+                                   vk::SubpassContents::eInline);
+    pass.record(command_buffer);
+    command_buffer.endRenderPass();
+  }
+  record_graph_barrier(graph, graph.final_barrier, command_buffer);
+}
+
+void destroy_render_graph(RenderGraph& graph) {
+  for (auto& pass : graph.passes) {
+    pass.framebuffers.clear();
+    pass.render_pass.reset();
+  }
+  for (auto& image : graph.images) {
+    image.owned_view.reset();
+    image.owned_image.reset();
+  }
+  for (const auto& allocation : graph.memory) {
+    free_memory(*graph.allocator, allocation);
+  }
+  graph.memory.clear();
+  graph.compiled = false;
+}
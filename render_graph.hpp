@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "allocator.hpp"
+
+// A frame described as passes and the images they read and write, compiled
+// once into render passes, barriers and memory. Passes whose results nobody
+// reads are dropped, consecutive reads of an image in the same layout share
+// one barrier, each pass gets at most one vkCmdPipelineBarrier, and transient
+// images whose lifetimes don't overlap share memory. A chain of post
+// processing passes therefore costs about two images of memory however long
+// it gets.
+
+using RenderGraphResource  = std::uint32_t;
+using RenderGraphPassIndex = std::uint32_t;
+
+enum class RenderGraphAccess {
+  eColorAttachment,
+  eDepthAttachment,
+  // Sampled from the fragment or compute shader.
+  eSampled,
+  eStorageRead,
+  eStorageWrite,
+  eTransferSource,
+  eTransferDestination,
+};
+
+struct RenderGraphImageDescription {
+  vk::Format format = vk::Format::eR8G8B8A8Unorm;
+  vk::Extent2D extent;
+  vk::ImageAspectFlags aspect = vk::ImageAspectFlagBits::eColor;
+};
+
+struct RenderGraphImage {
+  std::string name;
+  RenderGraphImageDescription description;
+  // Imported images belong to someone else and are handed over every frame
+  // by set_graph_image. Passes writing them are never culled.
+  bool imported                  = false;
+  vk::ImageLayout initial_layout = vk::ImageLayout::eUndefined;
+  vk::ImageLayout final_layout   = vk::ImageLayout::eUndefined;
+  vk::Image image;
+  vk::ImageView view;
+
+  // Set by compile_render_graph for transient images.
+  vk::UniqueImage owned_image;
+  vk::UniqueImageView owned_view;
+  vk::ImageUsageFlags usage;
+  // Index into RenderGraph::memory.
+  std::uint32_t memory_slot = 0;
+};
+
+struct RenderGraphUse {
+  RenderGraphResource resource = 0;
+  RenderGraphAccess access     = RenderGraphAccess::eSampled;
+};
+
+// Image barrier whose image is filled in when the graph is executed, imported
+// images change from frame to frame.
+struct RenderGraphImageBarrier {
+  RenderGraphResource resource = 0;
+  vk::ImageMemoryBarrier barrier;
+};
+
+struct RenderGraphBarrier {
+  vk::PipelineStageFlags src_stages;
+  vk::PipelineStageFlags dst_stages;
+  std::vector<RenderGraphImageBarrier> images;
+};
+
+struct RenderGraphPass {
+  std::string name;
+  // At most one use per image.
+  std::vector<RenderGraphUse> uses;
+  // Passes with attachments are recorded inside a render pass the graph
+  // begins and ends for them, with the viewport still to be set.
+  std::function<void(const vk::CommandBuffer&)> record;
+
+  // Set by compile_render_graph.
+  bool culled = true;
+  RenderGraphBarrier barrier;
+  vk::UniqueRenderPass render_pass;
+  std::vector<RenderGraphResource> attachments;
+  std::vector<vk::ClearValue> clear_values;
+  // Keyed by the attachments' views, which change with imported images.
+  // Only grows until release_graph_framebuffers.
+  std::map<std::vector<vk::ImageView>, vk::UniqueFramebuffer> framebuffers;
+};
+
+struct RenderGraphStats {
+  std::size_t passes        = 0;
+  std::size_t culled_passes = 0;
+  // vkCmdPipelineBarrier calls and the image barriers in them per execution.
+  std::size_t barrier_calls    = 0;
+  std::size_t image_barriers   = 0;
+  std::size_t transient_images = 0;
+  // Transient images backed by lazily allocated memory.
+  std::size_t lazy_images = 0;
+  // What the transient images would take on their own, and what they take
+  // sharing memory.
+  vk::DeviceSize transient_bytes_requested = 0;
+  vk::DeviceSize transient_bytes_allocated = 0;
+};
+
+struct RenderGraph {
+  DeviceAllocator* allocator = nullptr;
+  std::vector<RenderGraphImage> images;
+  std::vector<RenderGraphPass> passes;
+  // Set by compile_render_graph.
+  bool compiled = false;
+  std::vector<Allocation> memory;
+  // Imported images back to their final layouts after the last pass.
+  RenderGraphBarrier final_barrier;
+  RenderGraphStats stats;
+};
+
+RenderGraph create_render_graph(DeviceAllocator& allocator);
+
+// Created and given memory by compile_render_graph, contents don't survive
+// from one frame to the next.
+RenderGraphResource
+create_graph_image(RenderGraph& graph, std::string name,
+                   const RenderGraphImageDescription& description);
+
+// The image is in initial_layout when the graph starts executing and is left
+// in final_layout. Its first use waits for color attachment output, which is
+// where a swapchain image's acquire semaphore is waited on.
+RenderGraphResource
+import_graph_image(RenderGraph& graph, std::string name,
+                   const RenderGraphImageDescription& description,
+                   const vk::ImageLayout initial_layout,
+                   const vk::ImageLayout final_layout);
+
+// Passes execute in the order they are added.
+RenderGraphPassIndex
+add_graph_pass(RenderGraph& graph, std::string name,
+               std::vector<RenderGraphUse> uses,
+               std::function<void(const vk::CommandBuffer&)> record);
+
+// Culls, creates and aliases transient images, render passes and barriers.
+// Once only, the graph can't be changed afterwards. False if memory for the
+// transient images couldn't be found, with whatever had been created already
+// released again.
+bool compile_render_graph(RenderGraph& graph);
+
+// Null for culled passes and passes without attachments, for creating
+// pipelines against.
+vk::RenderPass graph_render_pass(const RenderGraph& graph,
+                                 const RenderGraphPassIndex pass);
+
+// Valid once compiled for transient images, once set for imported ones.
+vk::ImageView graph_image_view(const RenderGraph& graph,
+                               const RenderGraphResource resource);
+
+// Every frame for every imported image, before execute_render_graph. The view
+// is only needed when the image is used as an attachment.
+void set_graph_image(RenderGraph& graph, const RenderGraphResource resource,
+                     const vk::Image& image, const vk::ImageView& view);
+
+// For when imported images are recreated, e.g. with the swapchain, so
+// framebuffers for views that are gone don't pile up. Hands back every
+// framebuffer the graph has created, frames in flight may still use them,
+// to be retired along with the old images. New ones are made as needed.
+std::vector<vk::UniqueFramebuffer>
+release_graph_framebuffers(RenderGraph& graph);
+
+void execute_render_graph(RenderGraph& graph,
+                          const vk::CommandBuffer& command_buffer);
+
+// Waits for nothing, the device has to be done with the graph.
+void destroy_render_graph(RenderGraph& graph);
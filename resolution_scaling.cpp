@@ -0,0 +1,253 @@
+#include "resolution_scaling.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <ranges>
+#include <utility>
+
+#include "gpu_driven.hpp"
+
+// Matches the push constant block in upscale.frag.
+struct UpscaleConstants {
+  std::array<float, 2> uv_scale;
+  std::array<float, 2> uv_max;
+};
+
+float update_resolution_scale(ResolutionScaleController& controller,
+                              const double gpu_ms, const float measured_scale) {
+  const auto& settings = controller.settings;
+  if (gpu_ms <= 0.0 || measured_scale <= 0.0f) {
+    return controller.scale;
+  }
+  // Cost goes with the pixel count, the square of the scale.
+  const auto ratio     = controller.scale / measured_scale;
+  const auto projected = gpu_ms * ratio * ratio;
+  const auto ideal     = static_cast<float>(
+      measured_scale *
+      std::sqrt(settings.frame_budget_ms * settings.headroom / gpu_ms));
+  if (projected > settings.frame_budget_ms) {
+    controller.scale = ideal;
+  } else {
+    controller.scale += (ideal - controller.scale) * settings.ease_rate;
+  }
+  controller.scale =
+      std::clamp(controller.scale, settings.min_scale, settings.max_scale);
+  return controller.scale;
+}
+
+vk::Extent2D scale_extent(const vk::Extent2D extent, const float scale) {
+  const auto scale_side = [scale](const std::uint32_t side) {
+    const auto scaled = static_cast<std::uint32_t>(
+        std::lround(static_cast<float>(side) * scale));
+    return std::clamp(scaled, 1u, std::max(side, 1u));
+  };
+  return vk::Extent2D{scale_side(extent.width), scale_side(extent.height)};
+}
+
+vk::RenderPass create_scaled_render_pass(const vk::Device& logical_device) {
+  vk::AttachmentDescription colorAttachmentDescription{};
+  colorAttachmentDescription.format         = scaled_render_format;
+  colorAttachmentDescription.samples        = vk::SampleCountFlagBits::e1;
+  colorAttachmentDescription.loadOp         = vk::AttachmentLoadOp::eClear;
+  colorAttachmentDescription.storeOp        = vk::AttachmentStoreOp::eStore;
+  colorAttachmentDescription.stencilLoadOp  = vk::AttachmentLoadOp::eDontCare;
+  colorAttachmentDescription.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+  colorAttachmentDescription.initialLayout  = vk::ImageLayout::eUndefined;
+  colorAttachmentDescription.finalLayout =
+      vk::ImageLayout::eShaderReadOnlyOptimal;
+  vk::AttachmentReference colorAttachmentReference;
+  colorAttachmentReference.attachment = 0;
+  colorAttachmentReference.layout = vk::ImageLayout::eColorAttachmentOptimal;
+  vk::SubpassDescription basicSubpass;
+  basicSubpass.pipelineBindPoint    = vk::PipelineBindPoint::eGraphics;
+  basicSubpass.colorAttachmentCount = 1;
+  basicSubpass.pColorAttachments    = &colorAttachmentReference;
+  // The previous frame's upscale sampled the target this slot had, and the
+  // upscale after this pass samples what it writes.
+  const auto subpassDependencies = std::array{
+      vk::SubpassDependency{VK_SUBPASS_EXTERNAL, 0,
+                            vk::PipelineStageFlagBits::eFragmentShader,
+                            vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                            {}, vk::AccessFlagBits::eColorAttachmentWrite},
+      vk::SubpassDependency{0, VK_SUBPASS_EXTERNAL,
+                            vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                            vk::PipelineStageFlagBits::eFragmentShader,
+                            vk::AccessFlagBits::eColorAttachmentWrite,
+                            vk::AccessFlagBits::eShaderRead}};
+  vk::RenderPassCreateInfo renderPassInfo;
+  renderPassInfo.attachmentCount = 1;
+  renderPassInfo.pAttachments    = &colorAttachmentDescription;
+  renderPassInfo.subpassCount    = 1;
+  renderPassInfo.pSubpasses      = &basicSubpass;
+  renderPassInfo.dependencyCount = subpassDependencies.size();
+  renderPassInfo.pDependencies   = subpassDependencies.data();
+  return logical_device.createRenderPass(renderPassInfo);
+}
+
+std::optional<std::vector<ScaledRenderTarget>>
+create_scaled_render_targets(DeviceAllocator& allocator,
+                             const vk::RenderPass& render_pass,
+                             const vk::Extent2D extent,
+                             const std::size_t count) {
+  const auto& logical_device = allocator.logical_device;
+  auto targets               = std::vector<ScaledRenderTarget>{};
+  targets.reserve(count);
+  for ([[maybe_unused]] const auto index : std::views::iota(0uz, count)) {
+    vk::ImageCreateInfo imageInfo;
+    imageInfo.imageType     = vk::ImageType::e2D;
+    imageInfo.format        = scaled_render_format;
+    imageInfo.extent        = vk::Extent3D{extent, 1};
+    imageInfo.mipLevels     = 1;
+    imageInfo.arrayLayers   = 1;
+    imageInfo.samples       = vk::SampleCountFlagBits::e1;
+    imageInfo.tiling        = vk::ImageTiling::eOptimal;
+    imageInfo.usage         = vk::ImageUsageFlagBits::eColorAttachment |
+                      vk::ImageUsageFlagBits::eSampled;
+    imageInfo.sharingMode   = vk::SharingMode::eExclusive;
+    imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+
+    auto image = create_image(allocator, imageInfo,
+                              vk::MemoryPropertyFlagBits::eDeviceLocal);
+    if (!image) {
+      destroy_scaled_render_targets(allocator, targets);
+      return std::nullopt;
+    }
+    auto target   = ScaledRenderTarget{};
+    target.image  = std::move(*image);
+    target.extent = extent;
+
+    vk::ImageViewCreateInfo viewInfo;
+    viewInfo.image                           = target.image.image.get();
+    viewInfo.viewType                        = vk::ImageViewType::e2D;
+    viewInfo.format                          = scaled_render_format;
+    viewInfo.subresourceRange.aspectMask     = vk::ImageAspectFlagBits::eColor;
+    viewInfo.subresourceRange.baseMipLevel   = 0;
+    viewInfo.subresourceRange.levelCount     = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount     = 1;
+    target.view = logical_device.createImageViewUnique(viewInfo);
+
+    const auto attachment = target.view.get();
+    vk::FramebufferCreateInfo frameBufferInfo;
+    frameBufferInfo.renderPass      = render_pass;
+    frameBufferInfo.attachmentCount = 1;
+    frameBufferInfo.pAttachments    = &attachment;
+    frameBufferInfo.width           = extent.width;
+    frameBufferInfo.height          = extent.height;
+    frameBufferInfo.layers          = 1;
+    target.framebuffer =
+        logical_device.createFramebufferUnique(frameBufferInfo);
+    targets.push_back(std::move(target));
+  }
+  return targets;
+}
+
+void destroy_scaled_render_targets(DeviceAllocator& allocator,
+                                   std::vector<ScaledRenderTarget>& targets) {
+  for (auto& target : targets) {
+    target.framebuffer.reset();
+    target.view.reset();
+    destroy_image(allocator, target.image);
+  }
+  targets.clear();
+}
+
+Upscaler create_upscaler(
+    const vk::Device& logical_device, const vk::RenderPass& render_pass,
+    const std::vector<vk::PipelineShaderStageCreateInfo>& shader_stages,
+    const std::vector<ScaledRenderTarget>& targets,
+    const vk::PipelineCache& pipeline_cache) {
+  auto upscaler = Upscaler{};
+  vk::SamplerCreateInfo samplerInfo;
+  samplerInfo.magFilter    = vk::Filter::eLinear;
+  samplerInfo.minFilter    = vk::Filter::eLinear;
+  samplerInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+  samplerInfo.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+  upscaler.sampler         = logical_device.createSamplerUnique(samplerInfo);
+  const auto binding       = vk::DescriptorSetLayoutBinding{
+      0, vk::DescriptorType::eCombinedImageSampler, 1,
+      vk::ShaderStageFlagBits::eFragment};
+  vk::DescriptorSetLayoutCreateInfo setLayoutInfo;
+  setLayoutInfo.bindingCount = 1;
+  setLayoutInfo.pBindings    = &binding;
+  upscaler.set_layout =
+      logical_device.createDescriptorSetLayoutUnique(setLayoutInfo);
+  upscaler.layout = create_push_constant_layout(
+      logical_device, upscaler.set_layout.get(),
+      vk::PushConstantRange{vk::ShaderStageFlagBits::eFragment, 0,
+                            sizeof(UpscaleConstants)});
+
+  auto description          = GraphicsPipelineDescription{};
+  description.render_pass   = render_pass;
+  description.layout        = upscaler.layout.get();
+  description.shader_stages = shader_stages;
+  description.cull_mode     = vk::CullModeFlagBits::eNone;
+  upscaler.pipeline         = vk::UniquePipeline{
+      create_graphics_pipeline(logical_device, description, pipeline_cache),
+      logical_device};
+
+  set_upscaler_targets(logical_device, upscaler, targets);
+  return upscaler;
+}
+
+vk::UniqueDescriptorPool
+set_upscaler_targets(const vk::Device& logical_device, Upscaler& upscaler,
+                     const std::vector<ScaledRenderTarget>& targets) {
+  const auto set_count = static_cast<std::uint32_t>(targets.size());
+  const auto pool_size = vk::DescriptorPoolSize{
+      vk::DescriptorType::eCombinedImageSampler, set_count};
+  vk::DescriptorPoolCreateInfo descriptorPoolInfo;
+  descriptorPoolInfo.maxSets       = set_count;
+  descriptorPoolInfo.poolSizeCount = 1;
+  descriptorPoolInfo.pPoolSizes    = &pool_size;
+  auto retired = std::exchange(
+      upscaler.descriptor_pool,
+      logical_device.createDescriptorPoolUnique(descriptorPoolInfo));
+  const auto set_layouts = std::vector<vk::DescriptorSetLayout>(
+      set_count, upscaler.set_layout.get());
+  vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo;
+  descriptorSetAllocateInfo.descriptorPool     = upscaler.descriptor_pool.get();
+  descriptorSetAllocateInfo.descriptorSetCount = set_layouts.size();
+  descriptorSetAllocateInfo.pSetLayouts        = set_layouts.data();
+  upscaler.sets =
+      logical_device.allocateDescriptorSets(descriptorSetAllocateInfo);
+  for (const auto [set, target] : std::views::zip(upscaler.sets, targets)) {
+    const auto image_info = vk::DescriptorImageInfo{
+        upscaler.sampler.get(), target.view.get(),
+        vk::ImageLayout::eShaderReadOnlyOptimal};
+    vk::WriteDescriptorSet write;
+    write.dstSet          = set;
+    write.dstBinding      = 0;
+    write.descriptorCount = 1;
+    write.descriptorType  = vk::DescriptorType::eCombinedImageSampler;
+    write.pImageInfo      = &image_info;
+    logical_device.updateDescriptorSets(write, {});
+  }
+  return retired;
+}
+
+void record_upscale(const Upscaler& upscaler,
+                    const vk::CommandBuffer& command_buffer,
+                    const std::vector<ScaledRenderTarget>& targets,
+                    const std::size_t target,
+                    const vk::Extent2D rendered_extent,
+                    const vk::Extent2D output_extent) {
+  const auto& full     = targets[target].extent;
+  const auto width     = static_cast<float>(full.width);
+  const auto height    = static_cast<float>(full.height);
+  const auto constants = UpscaleConstants{
+      {static_cast<float>(rendered_extent.width) / width,
+       static_cast<float>(rendered_extent.height) / height},
+      {(static_cast<float>(rendered_extent.width) - 0.5f) / width,
+       (static_cast<float>(rendered_extent.height) - 0.5f) / height}};
+  set_viewport_and_scissor(command_buffer, output_extent);
+  command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                              upscaler.pipeline.get());
+  command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                    upscaler.layout.get(), 0,
+                                    upscaler.sets[target], {});
+  command_buffer.pushConstants<UpscaleConstants>(
+      upscaler.layout.get(), vk::ShaderStageFlagBits::eFragment, 0, constants);
+  command_buffer.draw(3, 1, 0, 0);
+}
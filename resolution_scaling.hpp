@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "allocator.hpp"
+#include "picante.hpp"
+
+// Dynamic resolution. The scene renders into an internal target as big as
+// the output, but only into its top left corner, scaled down by however much
+// it takes for the GPU to stay inside the frame budget. An upscale pass then
+// stretches that corner over the output. Changing the scale is a different
+// render area and viewport, nothing gets recreated.
+
+// sRGB so sampling it in the upscale pass gives back what the scene wrote.
+constexpr vk::Format scaled_render_format = vk::Format::eR8G8B8A8Srgb;
+
+struct ResolutionScaleSettings {
+  double frame_budget_ms = 1000.0 / 60.0;
+  float min_scale        = 0.5f;
+  float max_scale        = 1.0f;
+  // Fraction of the budget aimed for, so noise doesn't push frames over.
+  double headroom = 0.85;
+  // Fraction of the way to the ideal scale moved per frame while inside the
+  // budget. Over it the scale drops all the way at once, we would rather lose
+  // resolution than miss frames.
+  float ease_rate = 0.05f;
+};
+
+struct ResolutionScaleController {
+  ResolutionScaleSettings settings;
+  float scale = 1.0f;
+};
+
+// gpu_ms is what the scaled work took on a frame rendered at measured_scale,
+// which with frames in flight is usually not the current scale. Its cost is
+// taken to grow with the pixel count. Returns the scale to render at next.
+float update_resolution_scale(ResolutionScaleController& controller,
+                              const double gpu_ms, const float measured_scale);
+
+// At least one pixel either way.
+vk::Extent2D scale_extent(const vk::Extent2D extent, const float scale);
+
+// Like the offscreen pass but left ready to be sampled by the fragment
+// shader, which waits for it.
+vk::RenderPass create_scaled_render_pass(const vk::Device& logical_device);
+
+struct ScaledRenderTarget {
+  AllocatedImage image;
+  vk::UniqueImageView view;
+  vk::UniqueFramebuffer framebuffer;
+  // Full size, what a scale of 1 renders to.
+  vk::Extent2D extent;
+};
+
+// One per frame slot, so a frame never renders into the target the frame
+// before it is still upscaling from.
+std::optional<std::vector<ScaledRenderTarget>>
+create_scaled_render_targets(DeviceAllocator& allocator,
+                             const vk::RenderPass& render_pass,
+                             const vk::Extent2D extent,
+                             const std::size_t count);
+
+void destroy_scaled_render_targets(DeviceAllocator& allocator,
+                                   std::vector<ScaledRenderTarget>& targets);
+
+struct Upscaler {
+  vk::UniqueSampler sampler;
+  vk::UniqueDescriptorSetLayout set_layout;
+  vk::UniquePipelineLayout layout;
+  vk::UniqueDescriptorPool descriptor_pool;
+  // One per scaled target, in the same order.
+  std::vector<vk::DescriptorSet> sets;
+  vk::UniquePipeline pipeline;
+};
+
+// shader_stages are post.vert and upscale.frag, render_pass the pass the
+// upscale is recorded into.
+Upscaler create_upscaler(
+    const vk::Device& logical_device, const vk::RenderPass& render_pass,
+    const std::vector<vk::PipelineShaderStageCreateInfo>& shader_stages,
+    const std::vector<ScaledRenderTarget>& targets,
+    const vk::PipelineCache& pipeline_cache = {});
+
+// Points the upscaler at new targets, e.g. after a resize. They get
+// descriptor sets of their own, frames in flight may still use the old ones,
+// whose pool is handed back to be retired along with the old targets.
+vk::UniqueDescriptorPool
+set_upscaler_targets(const vk::Device& logical_device, Upscaler& upscaler,
+                     const std::vector<ScaledRenderTarget>& targets);
+
+// Records the upscale from the first rendered_extent texels of
+// targets[target] over output_extent. Inside the output's render pass.
+void record_upscale(const Upscaler& upscaler,
+                    const vk::CommandBuffer& command_buffer,
+                    const std::vector<ScaledRenderTarget>& targets,
+                    const std::size_t target,
+                    const vk::Extent2D rendered_extent,
+                    const vk::Extent2D output_extent);
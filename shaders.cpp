@@ -0,0 +1,67 @@
+#include "shaders.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+std::optional<std::span<const std::uint32_t>>
+find_embedded_shader(const std::string_view name) {
+  const auto shaders = embedded_shaders();
+  const auto shader  = std::ranges::find(shaders, name, &EmbeddedShader::name);
+  if (shader == shaders.end()) {
+    return std::nullopt;
+  }
+  return shader->code;
+}
+
+vk::ShaderModule
+create_shader_module(const vk::Device& logical_device,
+                     const std::span<const std::uint32_t> code) {
+  auto creation_info     = vk::ShaderModuleCreateInfo{};
+  creation_info.codeSize = code.size_bytes();
+  creation_info.pCode    = code.data();
+  return logical_device.createShaderModule(creation_info);
+}
+
+std::optional<vk::ShaderModule>
+load_shader_module(const vk::Device& logical_device,
+                   const std::filesystem::path& path_to_shader) {
+  const auto file = map_file(path_to_shader);
+  // SPIR-V is a stream of words, anything else isn't worth handing over.
+  if (!file || file->size % sizeof(std::uint32_t) != 0) {
+    return std::nullopt;
+  }
+  // mmap hands out page aligned memory, so reading it as words is fine.
+  return create_shader_module(
+      logical_device,
+      {reinterpret_cast<const std::uint32_t*>(file->data.get()),
+       file->size / sizeof(std::uint32_t)});
+}
+
+std::optional<std::filesystem::path> shader_override_directory() {
+  const auto* const directory = std::getenv("PICANTE_SHADER_DIR");
+  if (directory == nullptr || *directory == '\0') {
+    return std::nullopt;
+  }
+  return std::filesystem::path{directory};
+}
+
+std::optional<vk::ShaderModule>
+load_shader(const vk::Device& logical_device, const std::string_view name,
+            const std::optional<std::filesystem::path>& override_directory) {
+  if (override_directory) {
+    const auto path = *override_directory / (std::string{name} + ".spv");
+    if (std::filesystem::exists(path)) {
+      const auto module = load_shader_module(logical_device, path);
+      if (module) {
+        return module;
+      }
+      std::cerr << "Ignoring unreadable shader override " << path << "\n";
+    }
+  }
+  return find_embedded_shader(name).transform(
+      [&logical_device](const auto& code) {
+        return create_shader_module(logical_device, code);
+      });
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include <vulkan/vulkan.hpp>
+
+#include "mapped_file.hpp"
+
+// SPIR-V compiled into the binary by compile_shader, keyed by the name of
+// the source it came from, e.g. "picante.vert".
+struct EmbeddedShader {
+  std::string_view name;
+  std::span<const std::uint32_t> code;
+};
+
+// Defined in the source compile_shader generates for the renderer.
+std::span<const EmbeddedShader> embedded_shaders();
+
+std::optional<std::span<const std::uint32_t>>
+find_embedded_shader(const std::string_view name);
+
+// Maps the file and hands it straight to the driver, no copy on our side.
+std::optional<vk::ShaderModule>
+load_shader_module(const vk::Device& logical_device,
+                   const std::filesystem::path& path_to_shader);
+
+// $PICANTE_SHADER_DIR, if set. Meant for iterating on shaders without
+// rebuilding, put <name>.spv files in there to shadow the embedded ones.
+std::optional<std::filesystem::path> shader_override_directory();
+
+// Creates the module for a shader by name. Looks for <name>.spv in the
+// override directory first and falls back to the embedded SPIR-V, so
+// startup does no file I/O at all unless an override is set.
+std::optional<vk::ShaderModule>
+load_shader(const vk::Device& logical_device, const std::string_view name,
+            const std::optional<std::filesystem::path>& override_directory =
+                shader_override_directory());
@@ -0,0 +1,325 @@
+#include "swapchain.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <thread>
+
+#include "cpu_profiler.hpp"
+
+std::optional<PresentPolicy> parse_present_policy(const std::string_view name) {
+  if (name == "latency") {
+    return PresentPolicy::eLowestLatency;
+  }
+  if (name == "no-tearing") {
+    return PresentPolicy::eNoTearing;
+  }
+  if (name == "throughput") {
+    return PresentPolicy::eMaxThroughput;
+  }
+  return std::nullopt;
+}
+
+std::string_view present_mode_name(const vk::PresentModeKHR mode) {
+  switch (mode) {
+  case vk::PresentModeKHR::eImmediate:
+    return "immediate";
+  case vk::PresentModeKHR::eMailbox:
+    return "mailbox";
+  case vk::PresentModeKHR::eFifo:
+    return "fifo";
+  case vk::PresentModeKHR::eFifoRelaxed:
+    return "fifo relaxed";
+  default:
+    return "other";
+  }
+}
+
+vk::PresentModeKHR
+choose_present_mode(const std::vector<vk::PresentModeKHR>& available,
+                    const PresentPolicy policy) {
+  using enum vk::PresentModeKHR;
+  const auto preferred = std::invoke([policy] {
+    switch (policy) {
+    case PresentPolicy::eLowestLatency:
+      return std::vector{eImmediate, eMailbox, eFifoRelaxed};
+    case PresentPolicy::eMaxThroughput:
+      return std::vector{eMailbox, eImmediate, eFifoRelaxed};
+    case PresentPolicy::eNoTearing:
+    default:
+      return std::vector{eMailbox};
+    }
+  });
+  for (const auto mode : preferred) {
+    if (std::ranges::contains(available, mode)) {
+      return mode;
+    }
+  }
+  return eFifo;
+}
+
+vk::SurfaceFormatKHR choose_surface_format(
+    const vk::PhysicalDevice& physical_device, const vk::SurfaceKHR& surface) {
+  const auto formats = physical_device.getSurfaceFormatsKHR(surface);
+  for (const auto format :
+       {vk::Format::eB8G8R8A8Srgb, vk::Format::eR8G8B8A8Srgb}) {
+    const auto match = std::ranges::find_if(
+        formats, [format](const vk::SurfaceFormatKHR& candidate) {
+          return candidate.format == format &&
+                 candidate.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear;
+        });
+    if (match != formats.end()) {
+      return *match;
+    }
+  }
+  return formats.front();
+}
+
+vk::Extent2D
+choose_swapchain_extent(const vk::SurfaceCapabilitiesKHR& capabilities,
+                        const vk::Extent2D framebuffer_extent) {
+  // A current extent of all ones means the window size is ours to pick.
+  if (capabilities.currentExtent.width != UINT32_MAX) {
+    return capabilities.currentExtent;
+  }
+  return vk::Extent2D{
+      std::clamp(framebuffer_extent.width, capabilities.minImageExtent.width,
+                 capabilities.maxImageExtent.width),
+      std::clamp(framebuffer_extent.height,
+                 capabilities.minImageExtent.height,
+                 capabilities.maxImageExtent.height)};
+}
+
+std::uint32_t
+choose_image_count(const vk::SurfaceCapabilitiesKHR& capabilities,
+                   const vk::PresentModeKHR present_mode,
+                   const PresentPolicy policy) {
+  auto count = capabilities.minImageCount;
+  // Mailbox needs a spare image to render into while one is on screen and
+  // another is queued, and FIFO without tearing wants one to keep the GPU
+  // busy while the display holds the rest.
+  if (present_mode == vk::PresentModeKHR::eMailbox ||
+      policy != PresentPolicy::eLowestLatency) {
+    count += 1;
+  }
+  if (policy == PresentPolicy::eMaxThroughput) {
+    count = std::max(count, 3u);
+  }
+  if (capabilities.maxImageCount != 0) {
+    count = std::min(count, capabilities.maxImageCount);
+  }
+  return count;
+}
+
+vk::CompositeAlphaFlagBitsKHR
+choose_composite_alpha(const vk::SurfaceCapabilitiesKHR& capabilities) {
+  for (const auto alpha : {vk::CompositeAlphaFlagBitsKHR::eOpaque,
+                           vk::CompositeAlphaFlagBitsKHR::eInherit,
+                           vk::CompositeAlphaFlagBitsKHR::ePreMultiplied,
+                           vk::CompositeAlphaFlagBitsKHR::ePostMultiplied}) {
+    if (capabilities.supportedCompositeAlpha & alpha) {
+      return alpha;
+    }
+  }
+  return vk::CompositeAlphaFlagBitsKHR::eOpaque;
+}
+
+Swapchain create_swapchain(const vk::PhysicalDevice& physical_device,
+                           const vk::Device& logical_device,
+                           const vk::SurfaceKHR& surface,
+                           const vk::RenderPass& render_pass,
+                           const vk::Extent2D framebuffer_extent,
+                           const PresentPolicy policy,
+                           const vk::SwapchainKHR& old_swapchain) {
+  PICANTE_ZONE("create swapchain");
+  const auto surface_capabilities =
+      physical_device.getSurfaceCapabilitiesKHR(surface);
+  auto swapchain           = Swapchain{};
+  swapchain.policy         = policy;
+  swapchain.surface_format = choose_surface_format(physical_device, surface);
+  swapchain.present_mode   = choose_present_mode(
+      physical_device.getSurfacePresentModesKHR(surface), policy);
+  swapchain.extent =
+      choose_swapchain_extent(surface_capabilities, framebuffer_extent);
+
+  auto creation_info          = vk::SwapchainCreateInfoKHR{};
+  creation_info.surface       = surface;
+  creation_info.minImageCount = choose_image_count(
+      surface_capabilities, swapchain.present_mode, policy);
+  creation_info.imageFormat     = swapchain.surface_format.format;
+  creation_info.imageColorSpace = swapchain.surface_format.colorSpace;
+  creation_info.presentMode     = swapchain.present_mode;
+  creation_info.imageArrayLayers =
+      1;  // Only not one when developing stereoscopic 3D app.
+  creation_info.imageExtent      = swapchain.extent;
+  creation_info.imageUsage       = vk::ImageUsageFlagBits::eColorAttachment;
+  creation_info.imageSharingMode = vk::SharingMode::eExclusive;
+  creation_info.preTransform     = surface_capabilities.currentTransform;
+  creation_info.compositeAlpha = choose_composite_alpha(surface_capabilities);
+  creation_info.clipped        = VK_TRUE;
+  creation_info.oldSwapchain   = old_swapchain;
+  swapchain.swapchain = logical_device.createSwapchainKHRUnique(creation_info);
+
+  swapchain.images =
+      logical_device.getSwapchainImagesKHR(swapchain.swapchain.get());
+  const auto image_views = create_image_views(
+      logical_device, swapchain.images, swapchain.surface_format.format);
+  for (const auto& image_view : image_views) {
+    swapchain.image_views.emplace_back(image_view, logical_device);
+  }
+  for (const auto& frame_buffer : create_framebuffers(
+           logical_device, render_pass, image_views, swapchain.extent)) {
+    swapchain.frame_buffers.emplace_back(frame_buffer, logical_device);
+  }
+  return swapchain;
+}
+
+// Everything that goes away with a swapchain. Destroyed in reverse member
+// order, framebuffers before views before the swapchain.
+struct RetiredSwapchain {
+  std::vector<vk::UniqueSemaphore> render_finished;
+  Swapchain swapchain;
+};
+
+void recreate_swapchain(const vk::PhysicalDevice& physical_device,
+                        const vk::Device& logical_device,
+                        const vk::SurfaceKHR& surface,
+                        const vk::RenderPass& render_pass,
+                        const vk::Extent2D framebuffer_extent,
+                        Swapchain& swapchain, FrameRing& frame_ring) {
+  PICANTE_ZONE("recreate swapchain");
+  auto replacement = create_swapchain(
+      physical_device, logical_device, surface, render_pass,
+      framebuffer_extent, swapchain.policy, swapchain.swapchain.get());
+  auto render_finished =
+      std::vector<vk::UniqueSemaphore>(replacement.images.size());
+  for (auto& semaphore : render_finished) {
+    semaphore = logical_device.createSemaphoreUnique({});
+  }
+  std::swap(render_finished, frame_ring.render_finished);
+  auto retired = std::make_shared<RetiredSwapchain>(
+      std::move(render_finished), std::move(swapchain));
+  swapchain = std::move(replacement);
+  // Presents don't signal anything we can wait on, but they were queued
+  // before the last frame's fence and the old swapchain has already been
+  // retired by oldSwapchain, so nothing presents from it after that.
+  defer_deletion_after_last_submit(
+      frame_ring,
+      [retired = std::move(retired)]() mutable { retired.reset(); });
+}
+
+PresentResult draw_frame(const vk::Device& logical_device,
+                         const vk::Queue& queue, const Swapchain& swapchain,
+                         FrameRing& frame_ring,
+                         const CommandBufferSetup& command_buffer_setup) {
+  PICANTE_ZONE("draw frame");
+  auto& slot       = begin_frame_slot(logical_device, frame_ring);
+  auto imageIndex  = std::uint32_t{0};
+  const auto start = std::chrono::steady_clock::now();
+  const auto acquired = std::invoke([&] {
+    PICANTE_ZONE("acquire");
+    return logical_device.acquireNextImageKHR(
+        swapchain.swapchain.get(), UINT64_MAX, slot.image_available.get(),
+        VK_NULL_HANDLE, &imageIndex);
+  });
+  frame_ring.blocked += std::chrono::steady_clock::now() - start;
+  if (acquired == vk::Result::eErrorOutOfDateKHR) {
+    // Nothing was acquired and the slot's fence is still signalled, so the
+    // slot can be used again as is.
+    return PresentResult::eOutOfDate;
+  }
+  if (acquired != vk::Result::eSuccess &&
+      acquired != vk::Result::eSuboptimalKHR) {
+    // Device or surface lost, recreating the swapchain won't help.
+    throw vk::SystemError(vk::make_error_code(acquired),
+                          "acquireNextImageKHR");
+  }
+  // Only reset once we know we are going to submit, otherwise the next wait
+  // on this slot would never return.
+  logical_device.resetFences(slot.in_flight.get());
+  logical_device.resetCommandPool(slot.command_pool.get());
+  {
+    PICANTE_ZONE("record");
+    command_buffer_setup(swapchain.frame_buffers[imageIndex].get(),
+                         slot.command_buffer);
+  }
+  auto waits = take_frame_waits(frame_ring);
+  waits.semaphores.push_back(slot.image_available.get());
+  waits.stages.push_back(vk::PipelineStageFlagBits::eColorAttachmentOutput);
+  // The binary semaphore's value is ignored, the timeline info is only
+  // chained when there are timeline semaphores to signal.
+  auto signals               = take_frame_signals(frame_ring);
+  const auto timeline        = !signals.semaphores.empty();
+  const auto render_finished = frame_ring.render_finished[imageIndex].get();
+  signals.semaphores.push_back(render_finished);
+  signals.values.push_back(0);
+  vk::TimelineSemaphoreSubmitInfo timelineInfo;
+  timelineInfo.signalSemaphoreValueCount = signals.values.size();
+  timelineInfo.pSignalSemaphoreValues    = signals.values.data();
+  vk::SubmitInfo submitInfo;
+  submitInfo.waitSemaphoreCount   = waits.semaphores.size();
+  submitInfo.pWaitSemaphores      = waits.semaphores.data();
+  submitInfo.pWaitDstStageMask    = waits.stages.data();
+  submitInfo.pCommandBuffers      = &slot.command_buffer;
+  submitInfo.commandBufferCount   = 1;
+  submitInfo.signalSemaphoreCount = signals.semaphores.size();
+  submitInfo.pSignalSemaphores    = signals.semaphores.data();
+  if (timeline) {
+    submitInfo.pNext = &timelineInfo;
+  }
+  {
+    PICANTE_ZONE("submit");
+    queue.submit(submitInfo, slot.in_flight.get());
+  }
+  const auto swapchain_handle = swapchain.swapchain.get();
+  vk::PresentInfoKHR presentInfo;
+  presentInfo.waitSemaphoreCount = 1;
+  presentInfo.pWaitSemaphores    = &render_finished;
+  presentInfo.swapchainCount     = 1;
+  presentInfo.pSwapchains        = &swapchain_handle;
+  presentInfo.pImageIndices      = &imageIndex;
+  const auto present_start       = std::chrono::steady_clock::now();
+  const auto presented           = std::invoke([&] {
+    PICANTE_ZONE("present");
+    return queue.presentKHR(&presentInfo);
+  });
+  // Some drivers block in present rather than acquire on FIFO.
+  frame_ring.blocked += std::chrono::steady_clock::now() - present_start;
+  advance_frame_ring(frame_ring);
+  if (presented == vk::Result::eErrorOutOfDateKHR) {
+    return PresentResult::eOutOfDate;
+  }
+  if (presented != vk::Result::eSuccess &&
+      presented != vk::Result::eSuboptimalKHR) {
+    throw vk::SystemError(vk::make_error_code(presented), "presentKHR");
+  }
+  if (presented == vk::Result::eSuboptimalKHR ||
+      acquired == vk::Result::eSuboptimalKHR) {
+    return PresentResult::eSuboptimal;
+  }
+  return PresentResult::ePresented;
+}
+
+void pace_frame(LatencyLimiter& limiter, const FrameRing& frame_ring) {
+  pace_frame(limiter, frame_ring.blocked);
+}
+
+void pace_frame(LatencyLimiter& limiter,
+                const std::chrono::steady_clock::duration blocked) {
+  if (!limiter.enabled) {
+    return;
+  }
+  const auto error_us =
+      std::chrono::duration<double, std::micro>(blocked - limiter.slack)
+          .count();
+  const auto sleep_us =
+      std::clamp(static_cast<double>(limiter.sleep.count()) +
+                     limiter.gain * error_us,
+                 0.0, static_cast<double>(limiter.max_sleep.count()));
+  limiter.sleep =
+      std::chrono::microseconds{static_cast<std::int64_t>(sleep_us)};
+  if (limiter.sleep.count() > 0) {
+    PICANTE_ZONE("latency limiter");
+    std::this_thread::sleep_for(limiter.sleep);
+  }
+}
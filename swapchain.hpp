@@ -0,0 +1,117 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "picante.hpp"
+
+// What to trade for what when picking a present mode. Each falls back to
+// FIFO, the only mode every implementation has to support.
+enum class PresentPolicy {
+  // Immediate, then mailbox, with as few images as allowed. May tear.
+  eLowestLatency,
+  // Mailbox, then FIFO. Never tears.
+  eNoTearing,
+  // Mailbox, then immediate, with an extra image so the CPU and GPU never
+  // wait on the display.
+  eMaxThroughput,
+};
+
+// "latency", "no-tearing" or "throughput".
+std::optional<PresentPolicy> parse_present_policy(const std::string_view name);
+
+std::string_view present_mode_name(const vk::PresentModeKHR mode);
+
+vk::PresentModeKHR
+choose_present_mode(const std::vector<vk::PresentModeKHR>& available,
+                    const PresentPolicy policy);
+
+// Prefers an sRGB BGRA or RGBA format in the sRGB color space, otherwise
+// takes whatever comes first. Stable for a given surface, so render passes
+// built against it stay valid across swapchain recreation.
+vk::SurfaceFormatKHR choose_surface_format(
+    const vk::PhysicalDevice& physical_device, const vk::SurfaceKHR& surface);
+
+// The surface's current extent when it dictates one, otherwise the window's
+// framebuffer size clamped to what the surface allows.
+vk::Extent2D
+choose_swapchain_extent(const vk::SurfaceCapabilitiesKHR& capabilities,
+                        const vk::Extent2D framebuffer_extent);
+
+struct Swapchain {
+  vk::UniqueSwapchainKHR swapchain;
+  vk::SurfaceFormatKHR surface_format;
+  vk::Extent2D extent;
+  vk::PresentModeKHR present_mode = vk::PresentModeKHR::eFifo;
+  PresentPolicy policy            = PresentPolicy::eNoTearing;
+  std::vector<vk::Image> images;
+  std::vector<vk::UniqueImageView> image_views;
+  std::vector<vk::UniqueFramebuffer> frame_buffers;
+};
+
+// framebuffer_extent is the window size in pixels, it must not be zero.
+// Passing the swapchain being replaced as old_swapchain lets the presentation
+// engine hand its resources over.
+Swapchain create_swapchain(const vk::PhysicalDevice& physical_device,
+                           const vk::Device& logical_device,
+                           const vk::SurfaceKHR& surface,
+                           const vk::RenderPass& render_pass,
+                           const vk::Extent2D framebuffer_extent,
+                           const PresentPolicy policy,
+                           const vk::SwapchainKHR& old_swapchain = {});
+
+// Replaces the swapchain, its views and framebuffers and the ring's per image
+// semaphores without waiting for the device to go idle. The old ones are
+// destroyed once the last frame submitted against them has finished.
+void recreate_swapchain(const vk::PhysicalDevice& physical_device,
+                        const vk::Device& logical_device,
+                        const vk::SurfaceKHR& surface,
+                        const vk::RenderPass& render_pass,
+                        const vk::Extent2D framebuffer_extent,
+                        Swapchain& swapchain, FrameRing& frame_ring);
+
+enum class PresentResult {
+  ePresented,
+  // Presented, but the swapchain no longer matches the surface exactly and
+  // should be recreated when convenient.
+  eSuboptimal,
+  // Nothing was presented, the swapchain has to be recreated first. The frame
+  // may or may not have been submitted.
+  eOutOfDate,
+};
+
+// Throws vk::SystemError on anything worse than out of date, e.g. a lost
+// device or surface.
+PresentResult draw_frame(const vk::Device& logical_device,
+                         const vk::Queue& queue, const Swapchain& swapchain,
+                         FrameRing& frame_ring,
+                         const CommandBufferSetup& command_buffer_setup);
+
+// Holds the CPU back before it samples input so frames don't queue up behind
+// the display. Without it a FIFO swapchain lets the CPU run a whole ring of
+// frames ahead and every frame shows input that old. The limiter sleeps
+// instead of blocking in the fence wait or acquire, steering the time
+// actually spent blocked towards a small slack.
+struct LatencyLimiter {
+  bool enabled = true;
+  // Blocking we still allow per frame, so a frame that comes in a little
+  // slow doesn't starve the GPU.
+  std::chrono::microseconds slack{500};
+  // Fraction of the error corrected every frame. Lower is steadier, higher
+  // reacts faster to a change in frame time.
+  double gain = 0.5;
+  std::chrono::microseconds max_sleep{50000};
+  std::chrono::microseconds sleep{0};
+};
+
+// Call once per frame right before polling input.
+void pace_frame(LatencyLimiter& limiter, const FrameRing& frame_ring);
+// For when frames overlap and the ring belongs to another thread, blocked is
+// FrameRing::blocked of the latest frame that finished.
+void pace_frame(LatencyLimiter& limiter,
+                const std::chrono::steady_clock::duration blocked);
@@ -0,0 +1,361 @@
+#include "texture_format.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <ranges>
+
+// The fixed part of a KTX2 file, followed by one KtxLevelIndex per level.
+struct Ktx2Header {
+  std::array<std::uint8_t, 12> identifier = ktx2_identifier;
+  std::uint32_t vk_format                 = 0;
+  std::uint32_t type_size                 = 1;
+  std::uint32_t pixel_width               = 0;
+  std::uint32_t pixel_height              = 0;
+  std::uint32_t pixel_depth               = 0;
+  std::uint32_t layer_count               = 0;
+  std::uint32_t face_count                = 1;
+  std::uint32_t level_count               = 0;
+  std::uint32_t supercompression_scheme   = 0;
+  std::uint32_t dfd_byte_offset           = 0;
+  std::uint32_t dfd_byte_length           = 0;
+  std::uint32_t kvd_byte_offset           = 0;
+  std::uint32_t kvd_byte_length           = 0;
+  std::uint64_t sgd_byte_offset           = 0;
+  std::uint64_t sgd_byte_length           = 0;
+};
+static_assert(sizeof(Ktx2Header) == 80);
+
+struct KtxLevelIndex {
+  std::uint64_t byte_offset              = 0;
+  std::uint64_t byte_length              = 0;
+  std::uint64_t uncompressed_byte_length = 0;
+};
+static_assert(sizeof(KtxLevelIndex) == 24);
+
+std::optional<TextureBlock> texture_block(const TextureFormat format) {
+  switch (format) {
+  case TextureFormat::eR8G8B8A8Unorm:
+  case TextureFormat::eR8G8B8A8Srgb:
+    return TextureBlock{1, 1, 4};
+  case TextureFormat::eBc1RgbUnorm:
+  case TextureFormat::eBc1RgbSrgb:
+  case TextureFormat::eBc1RgbaUnorm:
+  case TextureFormat::eBc1RgbaSrgb:
+    return TextureBlock{4, 4, 8};
+  case TextureFormat::eBc3Unorm:
+  case TextureFormat::eBc3Srgb:
+  case TextureFormat::eBc5Unorm:
+  case TextureFormat::eBc5Snorm:
+  case TextureFormat::eBc7Unorm:
+  case TextureFormat::eBc7Srgb:
+    return TextureBlock{4, 4, 16};
+  default:
+    return std::nullopt;
+  }
+}
+
+bool is_srgb(const TextureFormat format) {
+  switch (format) {
+  case TextureFormat::eR8G8B8A8Srgb:
+  case TextureFormat::eBc1RgbSrgb:
+  case TextureFormat::eBc1RgbaSrgb:
+  case TextureFormat::eBc3Srgb:
+  case TextureFormat::eBc7Srgb:
+    return true;
+  default:
+    return false;
+  }
+}
+
+std::uint64_t texture_level_size(const TextureFormat format,
+                                 const std::uint32_t width,
+                                 const std::uint32_t height,
+                                 const std::uint32_t level) {
+  const auto block = texture_block(format).value_or(TextureBlock{});
+  const auto level_width  = std::max(width >> level, 1u);
+  const auto level_height = std::max(height >> level, 1u);
+  const auto blocks_wide  = (level_width + block.width - 1) / block.width;
+  const auto blocks_high  = (level_height + block.height - 1) / block.height;
+  return std::uint64_t{blocks_wide} * blocks_high * block.bytes;
+}
+
+std::uint32_t full_mip_level_count(const std::uint32_t width,
+                                   const std::uint32_t height) {
+  return std::bit_width(std::max({width, height, 1u}));
+}
+
+std::optional<KtxTexture> open_ktx2(const std::filesystem::path& path) {
+  auto file = map_file(path);
+  if (!file || file->size < sizeof(Ktx2Header)) {
+    return std::nullopt;
+  }
+  auto header = Ktx2Header{};
+  std::memcpy(&header, file->data.get(), sizeof(header));
+  const auto format = static_cast<TextureFormat>(header.vk_format);
+  const auto block  = texture_block(format);
+  if (header.identifier != ktx2_identifier || !block ||
+      header.supercompression_scheme != 0 || header.pixel_width == 0 ||
+      header.pixel_depth > 1 || header.face_count == 0) {
+    return std::nullopt;
+  }
+  auto texture          = KtxTexture{};
+  texture.format        = format;
+  texture.width         = header.pixel_width;
+  texture.height        = std::max(header.pixel_height, 1u);
+  texture.layer_count   = std::max(header.layer_count, 1u) * header.face_count;
+  texture.generate_mips = header.level_count == 0;
+  const auto level_count = std::max(header.level_count, 1u);
+  if (level_count > full_mip_level_count(texture.width, texture.height) ||
+      level_count * sizeof(KtxLevelIndex) > file->size - sizeof(Ktx2Header)) {
+    return std::nullopt;
+  }
+  // The level index isn't necessarily 8 byte aligned within the mapping.
+  for (const auto level : std::views::iota(0u, level_count)) {
+    auto index = KtxLevelIndex{};
+    std::memcpy(&index,
+                file->data.get() + sizeof(Ktx2Header) +
+                    level * sizeof(KtxLevelIndex),
+                sizeof(index));
+    const auto expected =
+        texture_level_size(format, texture.width, texture.height, level) *
+        texture.layer_count;
+    if (index.byte_length != expected || index.byte_offset > file->size ||
+        index.byte_length > file->size - index.byte_offset) {
+      return std::nullopt;
+    }
+    texture.levels.push_back({index.byte_offset, index.byte_length});
+  }
+  texture.file = std::move(*file);
+  return texture;
+}
+
+std::span<const std::byte> ktx_level_bytes(const KtxTexture& texture,
+                                           const std::uint32_t level) {
+  const auto& entry = texture.levels[level];
+  return {texture.file.data.get() + entry.offset, entry.size};
+}
+
+// Khronos data format descriptor color models and transfer functions.
+std::uint32_t dfd_color_model(const TextureFormat format) {
+  switch (format) {
+  case TextureFormat::eBc1RgbUnorm:
+  case TextureFormat::eBc1RgbSrgb:
+  case TextureFormat::eBc1RgbaUnorm:
+  case TextureFormat::eBc1RgbaSrgb:
+    return 128;
+  case TextureFormat::eBc3Unorm:
+  case TextureFormat::eBc3Srgb:
+    return 130;
+  case TextureFormat::eBc5Unorm:
+  case TextureFormat::eBc5Snorm:
+    return 132;
+  case TextureFormat::eBc7Unorm:
+  case TextureFormat::eBc7Srgb:
+    return 134;
+  default:
+    return 1;
+  }
+}
+
+bool write_ktx2(const std::filesystem::path& path, const TextureFormat format,
+                const std::uint32_t width, const std::uint32_t height,
+                const std::span<const std::vector<std::byte>> levels,
+                const bool generate_mips) {
+  const auto block = texture_block(format);
+  if (!block || levels.empty() || (generate_mips && levels.size() != 1)) {
+    return false;
+  }
+  auto header         = Ktx2Header{};
+  header.vk_format    = static_cast<std::uint32_t>(format);
+  header.pixel_width  = width;
+  header.pixel_height = height;
+  header.level_count  =
+      generate_mips ? 0 : static_cast<std::uint32_t>(levels.size());
+
+  // A basic descriptor block without samples.
+  const auto block_dimensions = (block->width - 1) | (block->height - 1) << 8;
+  const auto dfd              = std::array<std::uint32_t, 7>{
+      7 * sizeof(std::uint32_t),
+      0,
+      2 | 24 << 16,
+      dfd_color_model(format) | 1 << 8 | (is_srgb(format) ? 2 : 1) << 16,
+      block_dimensions,
+      block->bytes,
+      0};
+  header.dfd_byte_offset =
+      sizeof(Ktx2Header) + levels.size() * sizeof(KtxLevelIndex);
+  header.dfd_byte_length = sizeof(dfd);
+
+  // Smallest level first, each aligned to both the block size and 4.
+  const auto alignment = std::lcm(block->bytes, 4u);
+  auto index           = std::vector<KtxLevelIndex>(levels.size());
+  auto offset          = std::uint64_t{header.dfd_byte_offset + sizeof(dfd)};
+  for (const auto level : std::views::iota(0uz, levels.size()) |
+                              std::views::reverse) {
+    offset                   = (offset + alignment - 1) / alignment * alignment;
+    index[level].byte_offset = offset;
+    index[level].byte_length = levels[level].size();
+    index[level].uncompressed_byte_length = levels[level].size();
+    offset += levels[level].size();
+  }
+
+  auto stream = std::ofstream{path, std::ios::binary | std::ios::trunc};
+  stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  stream.write(reinterpret_cast<const char*>(index.data()),
+               static_cast<std::streamsize>(index.size() *
+                                            sizeof(KtxLevelIndex)));
+  stream.write(reinterpret_cast<const char*>(dfd.data()), sizeof(dfd));
+  for (const auto level : std::views::iota(0uz, levels.size()) |
+                              std::views::reverse) {
+    stream.seekp(static_cast<std::streamoff>(index[level].byte_offset));
+    stream.write(reinterpret_cast<const char*>(levels[level].data()),
+                 static_cast<std::streamsize>(levels[level].size()));
+  }
+  return static_cast<bool>(stream);
+}
+
+std::optional<TextureFormat>
+decoded_texture_format(const TextureFormat format) {
+  switch (format) {
+  case TextureFormat::eBc1RgbUnorm:
+  case TextureFormat::eBc1RgbaUnorm:
+  case TextureFormat::eBc3Unorm:
+  case TextureFormat::eBc5Unorm:
+    return TextureFormat::eR8G8B8A8Unorm;
+  case TextureFormat::eBc1RgbSrgb:
+  case TextureFormat::eBc1RgbaSrgb:
+  case TextureFormat::eBc3Srgb:
+    return TextureFormat::eR8G8B8A8Srgb;
+  default:
+    return std::nullopt;
+  }
+}
+
+std::uint64_t read_block_bits(const std::span<const std::byte> bytes) {
+  auto bits = std::uint64_t{0};
+  std::memcpy(&bits, bytes.data(), std::min(bytes.size(), sizeof(bits)));
+  return bits;
+}
+
+// BC1 color block, or BC3's color half, into 16 RGBA texels. BC3 always
+// uses four colors, whatever order the endpoints are in. In three color
+// mode the fourth is transparent for BC1 RGBA and opaque black for BC1 RGB.
+void decode_bc1_block(const std::span<const std::byte> block,
+                      const TextureFormat format,
+                      std::array<std::array<std::uint8_t, 4>, 16>& texels) {
+  const auto four_colors_only =
+      format == TextureFormat::eBc3Unorm || format == TextureFormat::eBc3Srgb;
+  const auto transparent_black = format == TextureFormat::eBc1RgbaUnorm ||
+                                 format == TextureFormat::eBc1RgbaSrgb;
+
+  const auto bits   = read_block_bits(block);
+  const auto expand = [](const std::uint32_t color) {
+    const auto r = (color >> 11) & 31;
+    const auto g = (color >> 5) & 63;
+    const auto b = color & 31;
+    return std::array<std::uint32_t, 3>{r << 3 | r >> 2, g << 2 | g >> 4,
+                                        b << 3 | b >> 2};
+  };
+  const auto color0 = static_cast<std::uint32_t>(bits & 0xffff);
+  const auto color1 = static_cast<std::uint32_t>(bits >> 16 & 0xffff);
+  const auto c0     = expand(color0);
+  const auto c1     = expand(color1);
+  auto palette      = std::array<std::array<std::uint8_t, 4>, 4>{};
+  const auto mix    = [&](const std::uint32_t weight0,
+                       const std::uint32_t weight1,
+                       const std::uint32_t total) {
+    auto color = std::array<std::uint8_t, 4>{0, 0, 0, 255};
+    for (const auto channel : std::views::iota(0, 3)) {
+      color[channel] = static_cast<std::uint8_t>(
+          (c0[channel] * weight0 + c1[channel] * weight1) / total);
+    }
+    return color;
+  };
+  palette[0] = mix(1, 0, 1);
+  palette[1] = mix(0, 1, 1);
+  if (four_colors_only || color0 > color1) {
+    palette[2] = mix(2, 1, 3);
+    palette[3] = mix(1, 2, 3);
+  } else {
+    palette[2] = mix(1, 1, 2);
+    palette[3] = mix(0, 0, 1);
+    if (transparent_black) {
+      palette[3][3] = 0;
+    }
+  }
+  for (const auto texel : std::views::iota(0, 16)) {
+    texels[texel] = palette[bits >> (32 + 2 * texel) & 3];
+  }
+}
+
+// BC4 style block, as BC3 alpha and both BC5 channels, into one channel of
+// 16 RGBA texels.
+void decode_bc4_block(const std::span<const std::byte> block,
+                      const std::size_t channel,
+                      std::array<std::array<std::uint8_t, 4>, 16>& texels) {
+  const auto bits = read_block_bits(block);
+  const auto a0   = static_cast<std::uint32_t>(bits & 0xff);
+  const auto a1   = static_cast<std::uint32_t>(bits >> 8 & 0xff);
+  auto palette    = std::array<std::uint32_t, 8>{a0, a1};
+  if (a0 > a1) {
+    for (const auto step : std::views::iota(1u, 7u)) {
+      palette[step + 1] = ((7 - step) * a0 + step * a1) / 7;
+    }
+  } else {
+    for (const auto step : std::views::iota(1u, 5u)) {
+      palette[step + 1] = ((5 - step) * a0 + step * a1) / 5;
+    }
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+  for (const auto texel : std::views::iota(0, 16)) {
+    texels[texel][channel] =
+        static_cast<std::uint8_t>(palette[bits >> (16 + 3 * texel) & 7]);
+  }
+}
+
+std::vector<std::byte> decode_texture_level(const TextureFormat format,
+                                            const std::uint32_t width,
+                                            const std::uint32_t height,
+                                            std::span<const std::byte> blocks) {
+  const auto block = texture_block(format);
+  if (!block || !decoded_texture_format(format)) {
+    return {};
+  }
+  auto rgba         = std::vector<std::byte>(std::size_t{width} * height * 4);
+  auto texels       = std::array<std::array<std::uint8_t, 4>, 16>{};
+  const auto stride = std::size_t{block->bytes};
+  for (auto y = 0u; y < height; y += 4) {
+    for (auto x = 0u; x < width; x += 4) {
+      const auto data = blocks.first(stride);
+      blocks          = blocks.subspan(stride);
+      switch (format) {
+      case TextureFormat::eBc3Unorm:
+      case TextureFormat::eBc3Srgb:
+        decode_bc1_block(data.subspan(8), format, texels);
+        decode_bc4_block(data.first(8), 3, texels);
+        break;
+      case TextureFormat::eBc5Unorm:
+        texels.fill({0, 0, 0, 255});
+        decode_bc4_block(data.first(8), 0, texels);
+        decode_bc4_block(data.subspan(8), 1, texels);
+        break;
+      default:
+        decode_bc1_block(data, format, texels);
+        break;
+      }
+      // Blocks hang over the edge of levels that aren't a multiple of four.
+      for (const auto row : std::views::iota(0u, std::min(4u, height - y))) {
+        for (const auto column :
+             std::views::iota(0u, std::min(4u, width - x))) {
+          std::memcpy(&rgba[((y + row) * std::size_t{width} + x + column) * 4],
+                      texels[row * 4 + column].data(), 4);
+        }
+      }
+    }
+  }
+  return rgba;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "mapped_file.hpp"
+
+// KTX2 textures holding block compressed or RGBA8 levels. Like mesh packs a
+// file is mmapped and its levels are copied from the mapping into staging
+// memory as they are, the GPU decodes BCn itself. Supercompressed files
+// (Basis Universal, zstd) aren't supported. Nothing in here needs Vulkan.
+
+constexpr std::array<std::uint8_t, 12> ktx2_identifier{
+    0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+// The VkFormat values picante loads, spelled out so offline tools don't need
+// the Vulkan headers.
+enum class TextureFormat : std::uint32_t {
+  eUndefined     = 0,
+  eR8G8B8A8Unorm = 37,
+  eR8G8B8A8Srgb  = 43,
+  eBc1RgbUnorm   = 131,
+  eBc1RgbSrgb    = 132,
+  eBc1RgbaUnorm  = 133,
+  eBc1RgbaSrgb   = 134,
+  eBc3Unorm      = 137,
+  eBc3Srgb       = 138,
+  eBc5Unorm      = 141,
+  eBc5Snorm      = 142,
+  eBc7Unorm      = 145,
+  eBc7Srgb       = 146,
+};
+
+// Texels per block and bytes per block, 1x1 for uncompressed formats.
+struct TextureBlock {
+  std::uint32_t width  = 1;
+  std::uint32_t height = 1;
+  std::uint32_t bytes  = 4;
+};
+
+std::optional<TextureBlock> texture_block(const TextureFormat format);
+bool is_srgb(const TextureFormat format);
+
+// Bytes of one layer of a mip level, whole blocks even where the level is
+// smaller than one.
+std::uint64_t texture_level_size(const TextureFormat format,
+                                 const std::uint32_t width,
+                                 const std::uint32_t height,
+                                 const std::uint32_t level);
+
+// Levels down to 1x1.
+std::uint32_t full_mip_level_count(const std::uint32_t width,
+                                   const std::uint32_t height);
+
+struct KtxLevel {
+  std::uint64_t offset = 0;
+  std::uint64_t size   = 0;
+};
+
+struct KtxTexture {
+  MappedFile file;
+  TextureFormat format = TextureFormat::eUndefined;
+  std::uint32_t width  = 0;
+  std::uint32_t height = 0;
+  // Array layers times cube faces, stored one after the other in a level.
+  std::uint32_t layer_count = 1;
+  // levels[0] is the full size one.
+  std::vector<KtxLevel> levels;
+  // The file has level 0 only and asks for the rest to be generated.
+  bool generate_mips = false;
+};
+
+// Maps the file and checks the header and that every level is where it says
+// and as big as it should be. 2D textures and arrays only.
+std::optional<KtxTexture> open_ktx2(const std::filesystem::path& path);
+
+std::span<const std::byte> ktx_level_bytes(const KtxTexture& texture,
+                                           const std::uint32_t level);
+
+// levels[0] is the full size one. A single level with generate_mips set
+// writes a level count of zero. The data format descriptor only names the
+// color model, it is what picante writes for synthetic test data rather than
+// something a general purpose tool needs.
+bool write_ktx2(const std::filesystem::path& path, const TextureFormat format,
+                const std::uint32_t width, const std::uint32_t height,
+                const std::span<const std::vector<std::byte>> levels,
+                const bool generate_mips = false);
+
+// For devices that can't sample a format: what decode_texture_level turns it
+// into, if it can decode it at all. BC1, BC3 and unsigned BC5 only, BC7
+// takes more decoder than it's worth for a fallback.
+std::optional<TextureFormat> decoded_texture_format(const TextureFormat format);
+
+// One layer of one level decoded to tightly packed RGBA8.
+std::vector<std::byte> decode_texture_level(const TextureFormat format,
+                                            const std::uint32_t width,
+                                            const std::uint32_t height,
+                                            std::span<const std::byte> blocks);
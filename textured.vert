@@ -0,0 +1,28 @@
+#version 450
+
+// bindless.vert with everything bound the old way, one descriptor set per
+// texture. Only the benchmark uses it, as what bindless is measured against.
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragUv;
+
+layout(std430, set = 0, binding = 0) readonly buffer Transforms {
+  mat4 transforms[];
+};
+
+layout(push_constant) uniform Constants {
+  mat4 view_projection;
+  uint object;
+};
+
+vec2 positions[3] = vec2[](vec2(0.0, -0.5), vec2(0.5, 0.5), vec2(-0.5, 0.5));
+
+vec3 colors[3] =
+    vec3[](vec3(1.0, 0.0, 0.0), vec3(0.0, 1.0, 0.0), vec3(0.0, 0.0, 1.0));
+
+void main() {
+  const vec4 position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
+  gl_Position = view_projection * transforms[object] * position;
+  fragColor   = colors[gl_VertexIndex];
+  fragUv      = positions[gl_VertexIndex] + 0.5;
+}
@@ -0,0 +1,243 @@
+#include "textures.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <ranges>
+#include <span>
+#include <vector>
+
+// Staging offsets for copies have to be a multiple of the block size, this
+// covers every format texture_format.hpp knows.
+constexpr vk::DeviceSize texture_staging_alignment = 16;
+
+DeviceFeatures texture_features() {
+  auto features                      = DeviceFeatures{};
+  features.core.textureCompressionBC = VK_TRUE;
+  return features;
+}
+
+bool supports_format_features(const vk::PhysicalDevice& physical_device,
+                              const vk::Format format,
+                              const vk::FormatFeatureFlags features) {
+  return (physical_device.getFormatProperties(format).optimalTilingFeatures &
+          features) == features;
+}
+
+void record_mip_generation(const vk::CommandBuffer& command_buffer,
+                           const vk::Image& image, const vk::Extent2D& extent,
+                           const std::uint32_t level_count,
+                           const std::uint32_t layer_count,
+                           const vk::Filter filter) {
+  vk::ImageMemoryBarrier imageBarrier;
+  imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  imageBarrier.image               = image;
+  imageBarrier.subresourceRange    = vk::ImageSubresourceRange{
+      vk::ImageAspectFlagBits::eColor, 0, 1, 0, layer_count};
+  const auto level_offset = [&extent](const std::uint32_t level) {
+    return vk::Offset3D{
+        static_cast<std::int32_t>(std::max(extent.width >> level, 1u)),
+        static_cast<std::int32_t>(std::max(extent.height >> level, 1u)), 1};
+  };
+  for (const auto level : std::views::iota(1u, level_count)) {
+    // The level before was written by the copy or the last blit.
+    imageBarrier.subresourceRange.baseMipLevel = level - 1;
+    imageBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    imageBarrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+    imageBarrier.oldLayout     = vk::ImageLayout::eTransferDstOptimal;
+    imageBarrier.newLayout     = vk::ImageLayout::eTransferSrcOptimal;
+    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                   vk::PipelineStageFlagBits::eTransfer, {},
+                                   {}, {}, imageBarrier);
+    vk::ImageBlit blit;
+    blit.srcSubresource = vk::ImageSubresourceLayers{
+        vk::ImageAspectFlagBits::eColor, level - 1, 0, layer_count};
+    blit.srcOffsets[1]  = level_offset(level - 1);
+    blit.dstSubresource = vk::ImageSubresourceLayers{
+        vk::ImageAspectFlagBits::eColor, level, 0, layer_count};
+    blit.dstOffsets[1]  = level_offset(level);
+    command_buffer.blitImage(image, vk::ImageLayout::eTransferSrcOptimal,
+                             image, vk::ImageLayout::eTransferDstOptimal,
+                             blit, filter);
+    imageBarrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
+    imageBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+    imageBarrier.oldLayout     = vk::ImageLayout::eTransferSrcOptimal;
+    imageBarrier.newLayout     = vk::ImageLayout::eShaderReadOnlyOptimal;
+    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                   vk::PipelineStageFlagBits::eFragmentShader,
+                                   {}, {}, {}, imageBarrier);
+  }
+  // The last level is only ever written.
+  imageBarrier.subresourceRange.baseMipLevel = level_count - 1;
+  imageBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+  imageBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+  imageBarrier.oldLayout     = vk::ImageLayout::eTransferDstOptimal;
+  imageBarrier.newLayout     = vk::ImageLayout::eShaderReadOnlyOptimal;
+  command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                 vk::PipelineStageFlagBits::eFragmentShader,
+                                 {}, {}, {}, imageBarrier);
+}
+
+std::optional<Texture>
+create_ktx2_texture(DeviceAllocator& allocator,
+                    const vk::PhysicalDevice& physical_device,
+                    const vk::Queue& queue,
+                    const std::uint32_t queue_family_index,
+                    const KtxTexture& source) {
+  auto texture           = Texture{};
+  texture.format         = static_cast<vk::Format>(source.format);
+  texture.extent         = vk::Extent2D{source.width, source.height};
+  texture.layer_count    = source.layer_count;
+  const auto level_count = static_cast<std::uint32_t>(source.levels.size());
+  const auto sampled     = vk::FormatFeatureFlagBits::eSampledImage |
+                       vk::FormatFeatureFlagBits::eTransferDst;
+  // Level data as it goes into staging, straight from the mapping unless it
+  // had to be decoded.
+  auto levels  = std::vector<std::span<const std::byte>>{};
+  auto decoded = std::vector<std::vector<std::byte>>{};
+  if (supports_format_features(physical_device, texture.format, sampled)) {
+    for (const auto level : std::views::iota(0u, level_count)) {
+      levels.push_back(ktx_level_bytes(source, level));
+    }
+  } else {
+    const auto fallback = decoded_texture_format(source.format);
+    if (!fallback ||
+        !supports_format_features(physical_device,
+                                  static_cast<vk::Format>(*fallback),
+                                  sampled)) {
+      return std::nullopt;
+    }
+    texture.format  = static_cast<vk::Format>(*fallback);
+    texture.decoded = true;
+    decoded.reserve(level_count);
+    for (const auto level : std::views::iota(0u, level_count)) {
+      const auto blocks     = ktx_level_bytes(source, level);
+      const auto layer_size = blocks.size() / source.layer_count;
+      auto& texels          = decoded.emplace_back();
+      for (const auto layer : std::views::iota(0u, source.layer_count)) {
+        const auto layer_texels = decode_texture_level(
+            source.format, std::max(source.width >> level, 1u),
+            std::max(source.height >> level, 1u),
+            blocks.subspan(layer * layer_size, layer_size));
+        texels.insert(texels.end(), layer_texels.begin(), layer_texels.end());
+      }
+      levels.push_back(texels);
+    }
+  }
+
+  // Blitting needs both ends of the blit, linear filtering is nicer but
+  // optional.
+  const auto blits =
+      source.generate_mips &&
+      supports_format_features(physical_device, texture.format,
+                               vk::FormatFeatureFlagBits::eBlitSrc |
+                                   vk::FormatFeatureFlagBits::eBlitDst);
+  const auto filter =
+      supports_format_features(
+          physical_device, texture.format,
+          vk::FormatFeatureFlagBits::eSampledImageFilterLinear)
+          ? vk::Filter::eLinear
+          : vk::Filter::eNearest;
+  texture.level_count =
+      blits ? full_mip_level_count(source.width, source.height) : level_count;
+
+  auto offsets = std::vector<vk::DeviceSize>{};
+  for (const auto& level : levels) {
+    offsets.push_back(texture.uploaded_bytes);
+    texture.uploaded_bytes += (level.size() + texture_staging_alignment - 1) /
+                              texture_staging_alignment *
+                              texture_staging_alignment;
+  }
+  auto staging = create_buffer(allocator, texture.uploaded_bytes,
+                               vk::BufferUsageFlagBits::eTransferSrc,
+                               vk::MemoryPropertyFlagBits::eHostVisible);
+  if (!staging) {
+    return std::nullopt;
+  }
+  for (const auto [level, offset] : std::views::zip(levels, offsets)) {
+    std::memcpy(staging->allocation.mapped + offset, level.data(),
+                level.size());
+  }
+  flush_memory(allocator, staging->allocation);
+
+  vk::ImageCreateInfo imageInfo;
+  imageInfo.imageType   = vk::ImageType::e2D;
+  imageInfo.format      = texture.format;
+  imageInfo.extent      = vk::Extent3D{texture.extent, 1};
+  imageInfo.mipLevels   = texture.level_count;
+  imageInfo.arrayLayers = texture.layer_count;
+  imageInfo.usage = vk::ImageUsageFlagBits::eSampled |
+                    vk::ImageUsageFlagBits::eTransferDst;
+  if (blits) {
+    imageInfo.usage |= vk::ImageUsageFlagBits::eTransferSrc;
+  }
+  auto image = create_image(allocator, imageInfo,
+                            vk::MemoryPropertyFlagBits::eDeviceLocal);
+  if (!image) {
+    destroy_buffer(allocator, *staging);
+    return std::nullopt;
+  }
+  const auto record = [&](const vk::CommandBuffer& command_buffer) {
+    vk::ImageMemoryBarrier imageBarrier;
+    imageBarrier.dstAccessMask       = vk::AccessFlagBits::eTransferWrite;
+    imageBarrier.oldLayout           = vk::ImageLayout::eUndefined;
+    imageBarrier.newLayout           = vk::ImageLayout::eTransferDstOptimal;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image               = image->image.get();
+    imageBarrier.subresourceRange    = vk::ImageSubresourceRange{
+        vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0,
+        VK_REMAINING_ARRAY_LAYERS};
+    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+                                   vk::PipelineStageFlagBits::eTransfer, {},
+                                   {}, {}, imageBarrier);
+    // One region per level, every layer of a level is contiguous.
+    auto regions = std::vector<vk::BufferImageCopy>{};
+    for (const auto [level, offset] : std::views::enumerate(offsets)) {
+      const auto mip = static_cast<std::uint32_t>(level);
+      vk::BufferImageCopy region;
+      region.bufferOffset     = offset;
+      region.imageSubresource = vk::ImageSubresourceLayers{
+          vk::ImageAspectFlagBits::eColor, mip, 0, texture.layer_count};
+      region.imageExtent =
+          vk::Extent3D{std::max(texture.extent.width >> mip, 1u),
+                       std::max(texture.extent.height >> mip, 1u), 1};
+      regions.push_back(region);
+    }
+    command_buffer.copyBufferToImage(staging->buffer.get(), image->image.get(),
+                                     vk::ImageLayout::eTransferDstOptimal,
+                                     regions);
+    if (blits) {
+      record_mip_generation(command_buffer, image->image.get(), texture.extent,
+                            texture.level_count, texture.layer_count, filter);
+      return;
+    }
+    imageBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    imageBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+    imageBarrier.oldLayout     = vk::ImageLayout::eTransferDstOptimal;
+    imageBarrier.newLayout     = vk::ImageLayout::eShaderReadOnlyOptimal;
+    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                   vk::PipelineStageFlagBits::eFragmentShader,
+                                   {}, {}, {}, imageBarrier);
+  };
+  submit_immediate(allocator.logical_device, queue, queue_family_index,
+                   record);
+  destroy_buffer(allocator, *staging);
+
+  vk::ImageViewCreateInfo viewInfo;
+  viewInfo.image    = image->image.get();
+  viewInfo.viewType = texture.layer_count > 1 ? vk::ImageViewType::e2DArray
+                                              : vk::ImageViewType::e2D;
+  viewInfo.format   = texture.format;
+  viewInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+  viewInfo.subresourceRange.levelCount = texture.level_count;
+  viewInfo.subresourceRange.layerCount = texture.layer_count;
+  texture.view  = allocator.logical_device.createImageViewUnique(viewInfo);
+  texture.image = std::move(*image);
+  return texture;
+}
+
+void destroy_texture(DeviceAllocator& allocator, Texture& texture) {
+  texture.view.reset();
+  destroy_image(allocator, texture.image);
+}
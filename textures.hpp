@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include <vulkan/vulkan.hpp>
+
+#include "allocator.hpp"
+#include "picante.hpp"
+#include "texture_format.hpp"
+
+// Sampled textures from KTX2 files. Block compressed levels are copied into
+// the image as they are, a quarter to an eighth of the bytes RGBA8 would
+// take, uncompressed files without mips get theirs blitted on the GPU.
+// Formats the device can't sample are decoded on the CPU where
+// texture_format.hpp knows how.
+
+// Makes every BC format samplable. Without it getFormatProperties decides.
+DeviceFeatures texture_features();
+
+struct Texture {
+  AllocatedImage image;
+  vk::UniqueImageView view;
+  vk::Format format = vk::Format::eUndefined;
+  vk::Extent2D extent;
+  std::uint32_t level_count = 1;
+  std::uint32_t layer_count = 1;
+  // What went through the staging buffer.
+  vk::DeviceSize uploaded_bytes = 0;
+  // The file's format wasn't samplable and it was decoded to RGBA8.
+  bool decoded = false;
+};
+
+bool supports_format_features(const vk::PhysicalDevice& physical_device,
+                              const vk::Format format,
+                              const vk::FormatFeatureFlags features);
+
+// Fills levels 1 and up from level 0 by blitting each level from the one
+// before it. Every level must be in TRANSFER_DST_OPTIMAL and is left in
+// SHADER_READ_ONLY_OPTIMAL.
+void record_mip_generation(const vk::CommandBuffer& command_buffer,
+                           const vk::Image& image, const vk::Extent2D& extent,
+                           const std::uint32_t level_count,
+                           const std::uint32_t layer_count,
+                           const vk::Filter filter);
+
+// Uploads every level through one staging buffer and blocks until it's done,
+// meant for load time. Mips the file asks to have generated are only
+// generated where the format can be blitted, otherwise the texture has one
+// level.
+std::optional<Texture>
+create_ktx2_texture(DeviceAllocator& allocator,
+                    const vk::PhysicalDevice& physical_device,
+                    const vk::Queue& queue,
+                    const std::uint32_t queue_family_index,
+                    const KtxTexture& source);
+
+void destroy_texture(DeviceAllocator& allocator, Texture& texture);
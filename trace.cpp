@@ -0,0 +1,68 @@
+#include "trace.hpp"
+
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string_view>
+
+std::string escape_trace_string(const std::string_view value) {
+  auto escaped = std::string{};
+  escaped.reserve(value.size());
+  for (const auto character : value) {
+    if (character == '"' || character == '\\') {
+      escaped += '\\';
+      escaped += character;
+    } else if (static_cast<unsigned char>(character) < 0x20) {
+      auto code = std::array<char, 7>{};
+      std::snprintf(code.data(), code.size(), "\\u%04x", character);
+      escaped += code.data();
+    } else {
+      escaped += character;
+    }
+  }
+  return escaped;
+}
+
+void write_chrome_trace(std::ostream& stream,
+                        const std::span<const TraceEvent> events) {
+  // Tracks become thread ids in order of first appearance.
+  auto track_ids = std::map<std::string_view, std::size_t>{};
+  for (const auto& event : events) {
+    track_ids.try_emplace(event.track, track_ids.size() + 1);
+  }
+  stream << "{\"traceEvents\": [\n";
+  auto first = true;
+  const auto separator = [&first, &stream] {
+    stream << (first ? "  " : ",\n  ");
+    first = false;
+  };
+  for (const auto& [track, id] : track_ids) {
+    separator();
+    stream << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+              "\"tid\": "
+           << id << ", \"args\": {\"name\": \"" << escape_trace_string(track)
+           << "\"}}";
+  }
+  // Enough digits for microsecond timestamps taken from a steady_clock that
+  // has been up for a while.
+  stream.precision(17);
+  for (const auto& event : events) {
+    separator();
+    stream << "{\"name\": \"" << escape_trace_string(event.name)
+           << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+           << track_ids.at(event.track) << ", \"ts\": " << event.start_us
+           << ", \"dur\": " << event.duration_us << "}";
+  }
+  stream << "\n], \"displayTimeUnit\": \"ms\"}\n";
+}
+
+bool save_chrome_trace(const std::filesystem::path& path,
+                       const std::span<const TraceEvent> events) {
+  auto file = std::ofstream{path, std::ios::trunc};
+  if (!file) {
+    return false;
+  }
+  write_chrome_trace(file, events);
+  return static_cast<bool>(file);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+
+// One complete ("X") event of a Chrome trace, as loaded by chrome://tracing
+// and ui.perfetto.dev. Each track shows up as its own named thread.
+struct TraceEvent {
+  std::string name;
+  std::string track;
+  // Microseconds on the steady_clock, so CPU and GPU events line up.
+  double start_us    = 0.0;
+  double duration_us = 0.0;
+};
+
+inline double trace_time_us(const std::chrono::steady_clock::time_point time) {
+  return std::chrono::duration<double, std::micro>(time.time_since_epoch())
+      .count();
+}
+
+void write_chrome_trace(std::ostream& stream,
+                        const std::span<const TraceEvent> events);
+
+bool save_chrome_trace(const std::filesystem::path& path,
+                       const std::span<const TraceEvent> events);
@@ -0,0 +1,80 @@
+#include "upload_ring.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+vk::DeviceSize align_upload(const vk::DeviceSize value,
+                            const vk::DeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+std::optional<UploadRing>
+create_upload_ring(DeviceAllocator& allocator,
+                   const vk::PhysicalDevice& physical_device,
+                   const std::size_t frame_count,
+                   const vk::DeviceSize frame_size) {
+  const auto& limits = physical_device.getProperties().limits;
+  auto ring          = UploadRing{};
+  ring.allocator     = &allocator;
+  // Both are powers of two, so the larger is a multiple of the smaller. The
+  // atom size keeps every region's flush to itself.
+  ring.alignment  = std::max({limits.minUniformBufferOffsetAlignment,
+                              limits.minStorageBufferOffsetAlignment,
+                              allocator.non_coherent_atom_size});
+  ring.frame_size = align_upload(std::max<vk::DeviceSize>(frame_size, 1),
+                                 ring.alignment);
+
+  auto buffer = create_buffer(allocator, ring.frame_size * frame_count,
+                              upload_ring_usage,
+                              vk::MemoryPropertyFlagBits::eHostVisible);
+  if (!buffer) {
+    return std::nullopt;
+  }
+  ring.buffer = std::move(*buffer);
+  return ring;
+}
+
+void destroy_upload_ring(UploadRing& ring) {
+  destroy_buffer(*ring.allocator, ring.buffer);
+  ring.frame_size = 0;
+}
+
+void begin_upload_frame(UploadRing& ring, const std::size_t slot) {
+  ring.last_frame_bytes = ring.head;
+  ring.current          = slot;
+  ring.head             = 0;
+}
+
+std::optional<UploadAllocation> allocate_upload(UploadRing& ring,
+                                                const vk::DeviceSize size) {
+  if (size > ring.frame_size - ring.head) {
+    ++ring.overflow_count;
+    return std::nullopt;
+  }
+  // Regions are aligned sizes, so padding the end never runs past one.
+  const auto offset     = ring.current * ring.frame_size + ring.head;
+  ring.head             = align_upload(ring.head + size, ring.alignment);
+  ring.peak_frame_bytes = std::max(ring.peak_frame_bytes, ring.head);
+  return UploadAllocation{
+      ring.buffer.buffer.get(), offset,
+      std::span{ring.buffer.allocation.mapped + offset,
+                static_cast<std::size_t>(size)}};
+}
+
+std::optional<UploadAllocation>
+upload_to_ring(UploadRing& ring, const std::span<const std::byte> data) {
+  const auto allocation = allocate_upload(ring, data.size());
+  if (allocation) {
+    std::memcpy(allocation->mapped.data(), data.data(), data.size());
+  }
+  return allocation;
+}
+
+void flush_upload_frame(const UploadRing& ring) {
+  if (ring.head == 0) {
+    return;
+  }
+  flush_memory(*ring.allocator, ring.buffer.allocation,
+               ring.current * ring.frame_size, ring.head);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include <vulkan/vulkan.hpp>
+
+#include "allocator.hpp"
+#include "picante.hpp"
+
+// Data that changes every frame, camera matrices, per object transforms, UI
+// vertices, written straight into one persistently mapped host visible
+// buffer. Each frame slot owns a region of it and bump allocates from the
+// start of its region every time the slot comes around, so getting data to
+// the GPU is an offset bump and a memcpy, with nothing allocated or freed.
+// Offsets are aligned for dynamic uniform and storage buffer descriptors,
+// which can bind the whole buffer once and pass the offset per draw.
+
+constexpr vk::DeviceSize default_upload_ring_frame_size = 4ull * 1024 * 1024;
+
+constexpr vk::BufferUsageFlags upload_ring_usage =
+    vk::BufferUsageFlagBits::eUniformBuffer |
+    vk::BufferUsageFlagBits::eStorageBuffer |
+    vk::BufferUsageFlagBits::eVertexBuffer |
+    vk::BufferUsageFlagBits::eIndexBuffer;
+
+struct UploadAllocation {
+  vk::Buffer buffer;
+  // From the start of buffer, what goes into a dynamic offset.
+  vk::DeviceSize offset = 0;
+  std::span<std::byte> mapped;
+};
+
+struct UploadRing {
+  DeviceAllocator* allocator = nullptr;
+  AllocatedBuffer buffer;
+  vk::DeviceSize frame_size = 0;
+  // The larger of the uniform and storage buffer offset alignments.
+  vk::DeviceSize alignment = 1;
+  // Region being allocated from and how far into it.
+  std::size_t current = 0;
+  vk::DeviceSize head = 0;
+  // Bytes handed out over the last frame finished and the most any frame
+  // has taken, alignment padding included.
+  vk::DeviceSize last_frame_bytes = 0;
+  vk::DeviceSize peak_frame_bytes = 0;
+  // Allocations that didn't fit in their frame's region.
+  std::uint64_t overflow_count = 0;
+};
+
+// frame_size bytes for each of frame_count slots, rounded up to the
+// alignment. Null if the memory can't be allocated.
+std::optional<UploadRing>
+create_upload_ring(DeviceAllocator& allocator,
+                   const vk::PhysicalDevice& physical_device,
+                   const std::size_t frame_count,
+                   const vk::DeviceSize frame_size =
+                       default_upload_ring_frame_size);
+
+void destroy_upload_ring(UploadRing& ring);
+
+// Starts over in slot's region. Only once the GPU is done with the frame
+// that last used it, e.g. while recording after begin_frame_slot.
+void begin_upload_frame(UploadRing& ring, const std::size_t slot);
+
+// nullopt, counted as an overflow, when the frame's region is full.
+std::optional<UploadAllocation> allocate_upload(UploadRing& ring,
+                                                const vk::DeviceSize size);
+
+// allocate_upload and a memcpy of data into it.
+std::optional<UploadAllocation>
+upload_to_ring(UploadRing& ring, const std::span<const std::byte> data);
+
+// Makes what the current frame wrote visible to the GPU, a no-op on coherent
+// memory. Before the frame is submitted.
+void flush_upload_frame(const UploadRing& ring);
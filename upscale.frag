@@ -0,0 +1,21 @@
+#version 450
+
+// Stretches the used corner of a dynamically scaled render target over the
+// whole output with a bilinear tap.
+
+layout(location = 0) in vec2 fragUv;
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform sampler2D scaled;
+
+layout(push_constant) uniform Upscale {
+  // Rendered extent over the target's full extent.
+  vec2 uvScale;
+  // Half a texel short of the rendered edge, so the filter never reads what
+  // is left over from a frame rendered at a larger scale.
+  vec2 uvMax;
+};
+
+void main() {
+  outColor = texture(scaled, min(fragUv * uvScale, uvMax));
+}